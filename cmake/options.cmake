@@ -12,4 +12,16 @@ if (ENABLE_LIBLCR STREQUAL "ON")
     message("${Green}--  Enable liblcr${ColourReset}")
 endif()
 
+option(ENABLE_SIMD_JSON "enable the vectorized json front end of OPT_PARSE_SIMD" OFF)
+if (ENABLE_SIMD_JSON STREQUAL "ON")
+    add_definitions(-DENABLE_SIMD_JSON=1)
+    message("${Green}--  Enable simd json${ColourReset}")
+endif()
+
+option(ENABLE_JSON_TABLES "generate the json types as wrappers of the table driven code" OFF)
+if (ENABLE_JSON_TABLES STREQUAL "ON")
+    set(JSON_GENERATE_FLAGS --tables)
+    message("${Green}--  Enable json tables${ColourReset}")
+endif()
+
 message("${BoldGreen}---- Selected options end ----${ColourReset}")
@@ -26,6 +26,7 @@
 #endif
 #include <read_file.h>
 #include "defs.h"
+#include "json_desc.h"
 
 #include "log.h"
 
@@ -51,6 +52,10 @@ defs_process *defs_process_parse_data(const char *jsondata, const struct parser_
         ctx = (const struct parser_context *)(&tmp_ctx);
     }
 
+    if ((ctx->options & OPT_PARSE_STREAM) && !(ctx->options & OPT_PARSE_FULLKEY)) {
+        return json_stream_parse(jsondata, strlen(jsondata), &desc_defs_process, ctx, err);
+    }
+
     tree = yajl_tree_parse(jsondata, errbuf, sizeof(errbuf));
     if (tree == NULL) {
         if (asprintf(err, "cannot parse the data: %s", errbuf) < 0) {
@@ -26,6 +26,7 @@
 #endif
 #include <read_file.h>
 #include "oci_runtime_hooks.h"
+#include "json_desc.h"
 
 #include "log.h"
 #include "utils_memory.h"
@@ -57,6 +58,12 @@ oci_runtime_spec_hooks *oci_runtime_spec_hooks_parse_file(const char *filename,
         }
         return NULL;
     }
+    if ((ctx->options & OPT_PARSE_STREAM) && !(ctx->options & OPT_PARSE_FULLKEY)) {
+        oci_runtime_spec_hooks *hooks = json_stream_parse(content, strlen(content), &desc_oci_runtime_spec_hooks,
+                                                           ctx, err);
+        free(content);
+        return hooks;
+    }
     tree = yajl_tree_parse(content, errbuf, sizeof(errbuf));
     free(content);
     if (tree == NULL) {
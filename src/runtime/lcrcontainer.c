@@ -29,7 +29,9 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 #include <signal.h>
 
 #include <lxc/lxccontainer.h>
@@ -44,6 +46,7 @@
 #include "utils_convert.h"
 #include "utils_file.h"
 #include "utils_memory.h"
+#include "utils_workpool.h"
 #include "oci_runtime_spec.h"
 
 static inline bool is_container_exists(struct lxc_container *c)
@@ -330,13 +333,39 @@ static bool lcr_check_container_running(struct lxc_container *c, const char *nam
     return true;
 }
 
+static bool container_kill(struct lxc_container *c, const char *name, uint32_t signal)
+{
+    int sret = 0;
+    pid_t pid = 0;
+
+    if (!lcr_check_container_running(c, name)) {
+        return false;
+    }
+
+    pid = c->init_pid(c);
+    if (pid < 0) {
+        ERROR("Failed to get init pid");
+        return false;
+    }
+
+    sret = kill(pid, (int)signal);
+    if (sret < 0) {
+        if (errno == ESRCH) {
+            WARN("Can not kill process (pid=%d) with signal %d for container: no such process", pid, signal);
+            return true;
+        }
+        ERROR("Can not kill process (pid=%d) with signal %d for container", pid, signal);
+        return false;
+    }
+
+    return true;
+}
+
 bool lcr_kill(const char *name, const char *lcrpath, uint32_t signal)
 {
     struct lxc_container *c = NULL;
     const char *path = lcrpath ? lcrpath : LCRPATH;
     bool ret = false;
-    int sret = 0;
-    pid_t pid = 0;
 
     clear_error_message(&g_lcr_error);
     if (name == NULL) {
@@ -359,30 +388,8 @@ bool lcr_kill(const char *name, const char *lcrpath, uint32_t signal)
         return false;
     }
 
-    if (!lcr_check_container_running(c, name)) {
-        goto out_put;
-    }
-
-    pid = c->init_pid(c);
-    if (pid < 0) {
-        ERROR("Failed to get init pid");
-        goto out_put;
-    }
+    ret = container_kill(c, name, signal);
 
-    sret = kill(pid, (int)signal);
-    if (sret < 0) {
-        if (errno == ESRCH) {
-            WARN("Can not kill process (pid=%d) with signal %d for container: no such process", pid, signal);
-            ret = true;
-            goto out_put;
-        }
-        ERROR("Can not kill process (pid=%d) with signal %d for container", pid, signal);
-        goto out_put;
-    }
-
-    ret = true;
-
-out_put:
     lxc_container_put(c);
     isula_libutils_free_log_prefix();
     return ret;
@@ -554,6 +561,23 @@ out_put:
     return bret;
 }
 
+static bool container_state(struct lxc_container *c, const char *name, struct lcr_container_state *lcs,
+                            int cgroup_version, isula_cgroup_reader_t **reader)
+{
+    if (!is_container_exists(c)) {
+        ERROR("No such container: %s", name);
+        return false;
+    }
+
+    if (!is_container_can_control(c)) {
+        ERROR("Insufficent privileges to control");
+        return false;
+    }
+
+    do_lcr_state(c, lcs, cgroup_version, reader);
+    return true;
+}
+
 bool lcr_state(const char *name, const char *lcrpath, struct lcr_container_state *lcs)
 {
     struct lxc_container *c = NULL;
@@ -573,23 +597,177 @@ bool lcr_state(const char *name, const char *lcrpath, struct lcr_container_state
         return false;
     }
 
-    if (!is_container_exists(c)) {
-        ERROR("No such container: %s", name);
-        bret = false;
-        goto out_put;
+    bret = container_state(c, name, lcs, 0, NULL);
+
+    lxc_container_put(c);
+    isula_libutils_free_log_prefix();
+    return bret;
+}
+
+struct state_batch {
+    const char **names;
+    const char *lcrpath;
+    // detected once for the whole batch
+    int cgroup_version;
+    struct lcr_container_state *out;
+    bool *success;
+};
+
+// workers kept between batches, taken out while a batch runs so concurrent batches do not share them
+static pthread_mutex_t g_state_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static isula_workpool_t *g_state_pool = NULL;
+static size_t g_state_pool_size = 0;
+static pid_t g_state_pool_owner = 0;
+
+static isula_workpool_t *state_pool_get(size_t nworkers)
+{
+    isula_workpool_t *pool = NULL;
+    size_t size = 0;
+
+    pthread_mutex_lock(&g_state_pool_lock);
+    // the workers of the parent do not exist in a forked child, the pool is dropped
+    if (g_state_pool != NULL && g_state_pool_owner == getpid()) {
+        pool = g_state_pool;
+        size = g_state_pool_size;
     }
+    g_state_pool = NULL;
+    pthread_mutex_unlock(&g_state_pool_lock);
 
-    if (!is_container_can_control(c)) {
-        ERROR("Insufficent privileges to control");
-        bret = false;
-        goto out_put;
+    if (pool != NULL && size == nworkers) {
+        return pool;
     }
+    isula_workpool_free(pool);
+    return isula_workpool_new(nworkers);
+}
+
+static void state_pool_put(isula_workpool_t *pool, size_t nworkers)
+{
+    pthread_mutex_lock(&g_state_pool_lock);
+    if (g_state_pool == NULL) {
+        g_state_pool = pool;
+        g_state_pool_size = nworkers;
+        g_state_pool_owner = getpid();
+        pool = NULL;
+    }
+    pthread_mutex_unlock(&g_state_pool_lock);
+    isula_workpool_free(pool);
+}
+
+static void state_batch_one(size_t index, void *data)
+{
+    struct state_batch *batch = (struct state_batch *)data;
+    const char *name = batch->names[index];
+    struct lxc_container *c = NULL;
+
+    batch->success[index] = false;
+    if (name == NULL) {
+        ERROR("Missing container name at %zu", index);
+        return;
+    }
+
+    isula_libutils_set_log_prefix(name);
+    c = lxc_container_new(name, batch->lcrpath);
+    if (c == NULL) {
+        ERROR("Failed to load config %s for state: %s", batch->lcrpath, name);
+        isula_libutils_free_log_prefix();
+        return;
+    }
+
+    batch->success[index] = container_state(c, name, &batch->out[index], batch->cgroup_version, NULL);
 
-    do_lcr_state(c, lcs);
-out_put:
     lxc_container_put(c);
     isula_libutils_free_log_prefix();
-    return bret;
+}
+
+bool lcr_state_batch(const char **names, size_t n, const char *lcrpath, struct lcr_container_state *out,
+                     bool *success, size_t nthreads)
+{
+    struct state_batch batch = { 0 };
+    isula_workpool_t *pool = NULL;
+    size_t failed = 0;
+    size_t i;
+    long cpus;
+
+    clear_error_message(&g_lcr_error);
+    if (names == NULL || out == NULL || success == NULL) {
+        ERROR("Invalid input");
+        return false;
+    }
+
+    // the states are always safe to pass to lcr_container_state_free, even on failure
+    (void)memset(out, 0, sizeof(*out) * n);
+    (void)memset(success, 0, sizeof(*success) * n);
+    if (n == 0) {
+        return true;
+    }
+
+    batch.names = names;
+    batch.lcrpath = lcrpath ? lcrpath : LCRPATH;
+    batch.out = out;
+    batch.success = success;
+
+    // checked once here instead of failing each container on its own
+    if (!isula_dir_exists(batch.lcrpath)) {
+        lcr_set_error_message(LCR_ERR_CONFIG, "Invalid lcr path: %s", batch.lcrpath);
+        ERROR("Invalid lcr path: %s", batch.lcrpath);
+        return false;
+    }
+
+    batch.cgroup_version = lcr_util_get_cgroup_version();
+    if (batch.cgroup_version < 0) {
+        // the readers detect it again, or the states come from lxc
+        batch.cgroup_version = 0;
+    }
+
+    if (nthreads == 0) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = cpus > 0 ? (size_t)cpus : 1;
+    }
+    if (nthreads > n) {
+        nthreads = n;
+    }
+
+    // the calling thread works too, so the pool only needs the others
+    if (nthreads > 1) {
+        pool = state_pool_get(nthreads - 1);
+        if (pool == NULL) {
+            WARN("Failed to start workers for state batch, collecting serially");
+        }
+    }
+    if (pool == NULL || isula_workpool_run(pool, n, state_batch_one, &batch) != 0) {
+        for (i = 0; i < n; i++) {
+            state_batch_one(i, &batch);
+        }
+    }
+    if (pool != NULL) {
+        state_pool_put(pool, nthreads - 1);
+    }
+
+    for (i = 0; i < n; i++) {
+        if (!success[i]) {
+            failed++;
+        }
+    }
+    if (failed > 0) {
+        lcr_set_error_message(LCR_ERR_RUNTIME, "Failed to get state of %zu of %zu containers", failed, n);
+        return false;
+    }
+    return true;
+}
+
+static bool container_get_pids(struct lxc_container *c, const char *name, pid_t **pids, size_t *pids_len)
+{
+    if (!is_container_exists(c)) {
+        ERROR("No such container");
+        return false;
+    }
+
+    if (!c->get_container_pids(c, pids, pids_len)) {
+        ERROR("Error: Failed to get container %s pids\n", name);
+        return false;
+    }
+
+    return true;
 }
 
 bool lcr_get_container_pids(const char *name, const char *lcrpath, pid_t **pids, size_t *pids_len)
@@ -611,19 +789,8 @@ bool lcr_get_container_pids(const char *name, const char *lcrpath, pid_t **pids,
         return false;
     }
 
-    if (!is_container_exists(c)) {
-        ERROR("No such container");
-        bret = false;
-        goto out_put;
-    }
-
-    if (!c->get_container_pids(c, pids, pids_len)) {
-        ERROR("Error: Failed to get container %s pids\n", name);
-        bret = false;
-        goto out_put;
-    }
+    bret = container_get_pids(c, name, pids, pids_len);
 
-out_put:
     lxc_container_put(c);
     isula_libutils_free_log_prefix();
     return bret;
@@ -641,6 +808,26 @@ void lcr_container_state_free(struct lcr_container_state *lcs)
     lcs->state = NULL;
 }
 
+static bool container_pause(struct lxc_container *c)
+{
+    if (!is_container_exists(c)) {
+        ERROR("No such container");
+        return false;
+    }
+
+    if (!is_container_can_control(c)) {
+        ERROR("Insufficent privleges to contol");
+        return false;
+    }
+
+    if (!c->freeze(c)) {
+        ERROR("Failed to pause");
+        return false;
+    }
+
+    return true;
+}
+
 bool lcr_pause(const char *name, const char *lcrpath)
 {
     struct lxc_container *c = NULL;
@@ -663,28 +850,31 @@ bool lcr_pause(const char *name, const char *lcrpath)
         return false;
     }
 
+    bret = container_pause(c);
+
+    lxc_container_put(c);
+    isula_libutils_free_log_prefix();
+    return bret;
+}
+
+static bool container_resume(struct lxc_container *c)
+{
     if (!is_container_exists(c)) {
         ERROR("No such container");
-        bret = false;
-        goto out_put;
+        return false;
     }
 
     if (!is_container_can_control(c)) {
         ERROR("Insufficent privleges to contol");
-        bret = false;
-        goto out_put;
+        return false;
     }
 
-    if (!c->freeze(c)) {
-        ERROR("Failed to pause");
-        bret = false;
-        goto out_put;
+    if (!c->unfreeze(c)) {
+        ERROR("Failed to resume");
+        return false;
     }
 
-out_put:
-    lxc_container_put(c);
-    isula_libutils_free_log_prefix();
-    return bret;
+    return true;
 }
 
 bool lcr_resume(const char *name, const char *lcrpath)
@@ -706,28 +896,36 @@ bool lcr_resume(const char *name, const char *lcrpath)
         goto out;
     }
 
+    bret = container_resume(c);
+
+    lxc_container_put(c);
+out:
+    isula_libutils_free_log_prefix();
+    return bret;
+}
+
+static bool container_resize(struct lxc_container *c, const char *name, unsigned int height, unsigned int width)
+{
     if (!is_container_exists(c)) {
         ERROR("No such container");
-        goto out_put;
+        return false;
     }
 
     if (!is_container_can_control(c)) {
         ERROR("Insufficent privleges to contol");
-        goto out_put;
+        return false;
     }
 
-    if (!c->unfreeze(c)) {
-        ERROR("Failed to resume");
-        goto out_put;
+    if (!lcr_check_container_running(c, name)) {
+        return false;
     }
 
-    bret = true;
+    if (!c->set_terminal_winch(c, height, width)) {
+        ERROR("Failed to resize: %s", name);
+        return false;
+    }
 
-out_put:
-    lxc_container_put(c);
-out:
-    isula_libutils_free_log_prefix();
-    return bret;
+    return true;
 }
 
 bool lcr_resize(const char *name, const char *lcrpath, unsigned int height, unsigned int width)
@@ -752,30 +950,8 @@ bool lcr_resize(const char *name, const char *lcrpath, unsigned int height, unsi
         return false;
     }
 
-    if (!is_container_exists(c)) {
-        ERROR("No such container");
-        bret = false;
-        goto out_put;
-    }
-
-    if (!is_container_can_control(c)) {
-        ERROR("Insufficent privleges to contol");
-        bret = false;
-        goto out_put;
-    }
+    bret = container_resize(c, name, height, width);
 
-    if (!lcr_check_container_running(c, name)) {
-        bret = false;
-        goto out_put;
-    }
-
-    if (!c->set_terminal_winch(c, height, width)) {
-        ERROR("Failed to resize: %s", name);
-        bret = false;
-        goto out_put;
-    }
-
-out_put:
     lxc_container_put(c);
     isula_libutils_free_log_prefix();
     return bret;
@@ -972,6 +1148,29 @@ static bool lcr_get_console_config_items(struct lxc_container *c, struct lcr_con
     return ret;
 }
 
+static bool container_get_console_config(struct lxc_container *c, const char *name,
+                                         struct lcr_console_config *config)
+{
+    bool ret = true;
+
+    if (!is_container_exists(c)) {
+        ERROR("No such container");
+        lcr_set_error_message(LCR_ERR_RUNTIME, "No such container:%s or the configuration files has been corrupted",
+                              name);
+        return false;
+    }
+    if (!is_container_can_control(c)) {
+        ERROR("Insufficent privleges to contol");
+        return ret;
+    }
+
+    ret = lcr_get_console_config_items(c, config);
+    if (!ret) {
+        lcr_free_console_config(config);
+    }
+    return ret;
+}
+
 bool lcr_get_console_config(const char *name, const char *lcrpath, struct lcr_console_config *config)
 {
     bool ret = true;
@@ -992,27 +1191,32 @@ bool lcr_get_console_config(const char *name, const char *lcrpath, struct lcr_co
         return false;
     }
 
+    ret = container_get_console_config(c, name, config);
+
+    lxc_container_put(c);
+    isula_libutils_free_log_prefix();
+    return ret;
+}
+
+static bool container_update(struct lxc_container *c, const char *name, const char *lcrpath,
+                             const struct lcr_cgroup_resources *cr)
+{
     if (!is_container_exists(c)) {
         ERROR("No such container");
-        lcr_set_error_message(LCR_ERR_RUNTIME, "No such container:%s or the configuration files has been corrupted",
-                              name);
-        ret = false;
-        goto out_put;
+        return false;
     }
+
     if (!is_container_can_control(c)) {
-        ERROR("Insufficent privleges to contol");
-        goto out_put;
+        ERROR("Insufficent privileges to control");
+        return false;
     }
 
-    ret = lcr_get_console_config_items(c, config);
-    if (!ret) {
-        lcr_free_console_config(config);
+    if (c->is_running(c) && cr->kernel_memory_limit) {
+        ERROR("Can not update kernel memory to a running container, please stop it first");
+        return false;
     }
 
-out_put:
-    lxc_container_put(c);
-    isula_libutils_free_log_prefix();
-    return ret;
+    return do_update(c, name, lcrpath, (struct lcr_cgroup_resources *)cr);
 }
 
 bool lcr_update(const char *name, const char *lcrpath, const struct lcr_cgroup_resources *cr)
@@ -1042,38 +1246,319 @@ bool lcr_update(const char *name, const char *lcrpath, const struct lcr_cgroup_r
         goto out_free;
     }
 
-    if (!is_container_exists(c)) {
-        ERROR("No such container");
-        goto out_put;
+    bret = container_update(c, name, tmp_path, cr);
+
+    lxc_container_put(c);
+
+out_free:
+    isula_libutils_free_log_prefix();
+    if (!bret) {
+        lcr_try_set_error_message(LCR_ERR_RUNTIME, "Runtime error when updating cgroup");
     }
+    return bret;
+}
 
-    if (!is_container_can_control(c)) {
-        ERROR("Insufficent privileges to control");
-        goto out_put;
+struct lcr_handle {
+    char *name;
+    char *lcrpath;
+    /* config file of the container, its version tells when to reload */
+    char *config_file;
+    pthread_mutex_t lock;
+    struct lxc_container *c;
+    // cgroup files of the container kept open between state calls
+    isula_cgroup_reader_t *metrics;
+    bool loaded_stat;
+    struct stat st;
+    unsigned int refcnt;
+};
+
+static bool same_config_version(const struct stat *a, const struct stat *b)
+{
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino && a->st_size == b->st_size &&
+           a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+static void lcr_handle_free(lcr_handle_t *handle)
+{
+    if (handle->c != NULL) {
+        lxc_container_put(handle->c);
+    }
+    isula_cgroup_reader_free(handle->metrics);
+    pthread_mutex_destroy(&handle->lock);
+    free(handle->name);
+    free(handle->lcrpath);
+    free(handle->config_file);
+    free(handle);
+}
+
+lcr_handle_t *lcr_open(const char *name, const char *lcrpath)
+{
+    lcr_handle_t *handle = NULL;
+    const char *tmp_path = lcrpath ? lcrpath : LCRPATH;
+    size_t len = 0;
+    int nret = 0;
+
+    clear_error_message(&g_lcr_error);
+    if (name == NULL) {
+        ERROR("Missing container name");
+        return NULL;
     }
 
-    if (c->is_running(c) && cr->kernel_memory_limit) {
-        ERROR("Can not update kernel memory to a running container, please stop it first");
-        goto out_put;
+    handle = isula_common_calloc_s(sizeof(*handle));
+    if (handle == NULL) {
+        ERROR("Out of memory");
+        return NULL;
+    }
+    if (pthread_mutex_init(&handle->lock, NULL) != 0) {
+        ERROR("Failed to init handle lock");
+        free(handle);
+        return NULL;
+    }
+    handle->refcnt = 1;
+    handle->name = isula_strdup_s(name);
+    handle->lcrpath = isula_strdup_s(tmp_path);
+    // $lcrpath + '/' + $name + '/config' + \0
+    len = strlen(tmp_path) + strlen(name) + 9;
+    handle->config_file = isula_common_calloc_s(len);
+    if (handle->name == NULL || handle->lcrpath == NULL || handle->config_file == NULL) {
+        ERROR("Out of memory");
+        goto err_out;
+    }
+    nret = snprintf(handle->config_file, len, "%s/%s/config", tmp_path, name);
+    if (nret < 0 || (size_t)nret >= len) {
+        ERROR("Error writing config pathname");
+        goto err_out;
     }
 
-    if (!do_update(c, name, tmp_path, (struct lcr_cgroup_resources *)cr)) {
-        goto out_put;
+    isula_libutils_set_log_prefix(name);
+    handle->loaded_stat = stat(handle->config_file, &handle->st) == 0;
+    handle->c = lxc_container_new(name, tmp_path);
+    if (handle->c == NULL) {
+        lcr_set_error_message(LCR_ERR_CONFIG, "Failed to load config for open: %s", name);
+        ERROR("Failed to load config %s for open: %s", tmp_path, name);
+        isula_libutils_free_log_prefix();
+        goto err_out;
     }
+    isula_libutils_free_log_prefix();
+    return handle;
 
-    bret = true;
+err_out:
+    lcr_handle_free(handle);
+    return NULL;
+}
 
-out_put:
-    lxc_container_put(c);
+lcr_handle_t *lcr_handle_get(lcr_handle_t *handle)
+{
+    if (handle != NULL) {
+        (void)__atomic_add_fetch(&handle->refcnt, 1, __ATOMIC_RELAXED);
+    }
+    return handle;
+}
 
-out_free:
+void lcr_close(lcr_handle_t *handle)
+{
+    if (handle == NULL) {
+        return;
+    }
+    if (__atomic_sub_fetch(&handle->refcnt, 1, __ATOMIC_ACQ_REL) == 0) {
+        lcr_handle_free(handle);
+    }
+}
+
+/*
+ * Referenced container of the handle for one call, reloaded first if its
+ * config file changed since it was loaded; the log prefix is set until
+ * handle_release.
+ */
+static struct lxc_container *handle_acquire(lcr_handle_t *handle, const char *action)
+{
+    struct lxc_container *c = NULL;
+    struct stat st;
+    bool have_stat = false;
+
+    clear_error_message(&g_lcr_error);
+    if (handle == NULL) {
+        ERROR("Missing container handle");
+        return NULL;
+    }
+
+    isula_libutils_set_log_prefix(handle->name);
+    have_stat = stat(handle->config_file, &st) == 0;
+
+    pthread_mutex_lock(&handle->lock);
+    if (!have_stat || !handle->loaded_stat || !same_config_version(&st, &handle->st)) {
+        c = lxc_container_new(handle->name, handle->lcrpath);
+        if (c == NULL) {
+            pthread_mutex_unlock(&handle->lock);
+            lcr_set_error_message(LCR_ERR_CONFIG, "Failed to load config for %s: %s", action, handle->name);
+            ERROR("Failed to load config for %s: %s.", action, handle->name);
+            isula_libutils_free_log_prefix();
+            return NULL;
+        }
+        lxc_container_put(handle->c);
+        handle->c = c;
+        handle->loaded_stat = have_stat;
+        if (have_stat) {
+            handle->st = st;
+        }
+    }
+    c = handle->c;
+    if (lxc_container_get(c) != 1) {
+        c = NULL;
+    }
+    pthread_mutex_unlock(&handle->lock);
+
+    if (c == NULL) {
+        ERROR("Failed to get container for %s: %s.", action, handle->name);
+        isula_libutils_free_log_prefix();
+    }
+    return c;
+}
+
+static void handle_release(struct lxc_container *c)
+{
+    lxc_container_put(c);
     isula_libutils_free_log_prefix();
+}
+
+bool lcr_handle_state(lcr_handle_t *handle, struct lcr_container_state *lcs)
+{
+    struct lxc_container *c = handle_acquire(handle, "state");
+    isula_cgroup_reader_t *reader = NULL;
+    bool bret = false;
+
+    if (c == NULL) {
+        return false;
+    }
+
+    // the reader is taken out of the handle so concurrent calls do not share it
+    pthread_mutex_lock(&handle->lock);
+    reader = handle->metrics;
+    handle->metrics = NULL;
+    pthread_mutex_unlock(&handle->lock);
+
+    bret = container_state(c, handle->name, lcs, 0, &reader);
+
+    pthread_mutex_lock(&handle->lock);
+    if (handle->metrics == NULL) {
+        handle->metrics = reader;
+        reader = NULL;
+    }
+    pthread_mutex_unlock(&handle->lock);
+    isula_cgroup_reader_free(reader);
+
+    handle_release(c);
+    return bret;
+}
+
+bool lcr_handle_kill(lcr_handle_t *handle, uint32_t signal)
+{
+    struct lxc_container *c = NULL;
+    bool bret = false;
+
+    if (signal >= NSIG) {
+        ERROR("'%u' isn't a valid signal number", signal);
+        return false;
+    }
+    c = handle_acquire(handle, "kill");
+    if (c == NULL) {
+        return false;
+    }
+    bret = container_kill(c, handle->name, signal);
+    handle_release(c);
+    return bret;
+}
+
+bool lcr_handle_pause(lcr_handle_t *handle)
+{
+    struct lxc_container *c = handle_acquire(handle, "pause");
+    bool bret = false;
+
+    if (c == NULL) {
+        return false;
+    }
+    bret = container_pause(c);
+    handle_release(c);
+    return bret;
+}
+
+bool lcr_handle_resume(lcr_handle_t *handle)
+{
+    struct lxc_container *c = handle_acquire(handle, "resume");
+    bool bret = false;
+
+    if (c == NULL) {
+        return false;
+    }
+    bret = container_resume(c);
+    handle_release(c);
+    return bret;
+}
+
+bool lcr_handle_get_container_pids(lcr_handle_t *handle, pid_t **pids, size_t *pids_len)
+{
+    struct lxc_container *c = handle_acquire(handle, "get pids");
+    bool bret = false;
+
+    if (c == NULL) {
+        return false;
+    }
+    bret = container_get_pids(c, handle->name, pids, pids_len);
+    handle_release(c);
+    return bret;
+}
+
+bool lcr_handle_resize(lcr_handle_t *handle, unsigned int height, unsigned int width)
+{
+    struct lxc_container *c = handle_acquire(handle, "resize");
+    bool bret = false;
+
+    if (c == NULL) {
+        return false;
+    }
+    bret = container_resize(c, handle->name, height, width);
+    handle_release(c);
+    return bret;
+}
+
+bool lcr_handle_update(lcr_handle_t *handle, const struct lcr_cgroup_resources *cr)
+{
+    struct lxc_container *c = NULL;
+    bool bret = false;
+
+    if (cr == NULL) {
+        ERROR("Invalid input");
+        return false;
+    }
+    c = handle_acquire(handle, "update");
+    if (c != NULL) {
+        bret = container_update(c, handle->name, handle->lcrpath, cr);
+        handle_release(c);
+    }
     if (!bret) {
         lcr_try_set_error_message(LCR_ERR_RUNTIME, "Runtime error when updating cgroup");
     }
     return bret;
 }
 
+bool lcr_handle_get_console_config(lcr_handle_t *handle, struct lcr_console_config *config)
+{
+    struct lxc_container *c = NULL;
+    bool bret = false;
+
+    if (config == NULL) {
+        ERROR("Parameter is NULL");
+        return false;
+    }
+    c = handle_acquire(handle, "get console config of");
+    if (c == NULL) {
+        return false;
+    }
+    bret = container_get_console_config(c, handle->name, config);
+    handle_release(c);
+    return bret;
+}
+
 const char *lcr_get_errmsg()
 {
     if (g_lcr_error.errcode == LCR_SUCCESS) {
@@ -53,7 +53,8 @@ struct blkio_stats {
 };
 
 /*
-* Store lcr container state
+* Store lcr container state, the same units whether it is read from the cgroup
+* or through lxc: times in nanoseconds, unlimited limits are 0
 */
 struct lcr_container_state {
     /* Name of container */
@@ -64,14 +65,14 @@ struct lcr_container_state {
     pid_t init;
     /* Current pids */
     uint64_t pids_current;
-    /* CPU usage */
+    /* CPU usage, user and system time were cgroup v1 clock ticks before */
     uint64_t cpu_use_nanos;
     uint64_t cpu_use_user;
     uint64_t cpu_use_sys;
     /* BlkIO usage */
     struct blkio_stats io_service_bytes;
     struct blkio_stats io_serviced;
-    /* Memory usage */
+    /* Memory usage, no limit was the raw cgroup v1 value before */
     uint64_t mem_used;
     uint64_t mem_limit;
     uint64_t rss_bytes;
@@ -84,6 +85,12 @@ struct lcr_container_state {
     uint64_t cache;
     uint64_t cache_total;
     uint64_t inactive_file_total;
+    /* CPU throttling, time in nanoseconds */
+    uint64_t cpu_nr_periods;
+    uint64_t cpu_nr_throttled;
+    uint64_t cpu_throttled_nanos;
+    /* Pids limit, 0 if unlimited */
+    uint64_t pids_limit;
 };
 
 typedef enum {
@@ -194,6 +201,20 @@ __EXPORT__ bool lcr_clean(const char *name, const char *lcrpath, const char *log
 */
 __EXPORT__ bool lcr_state(const char *name, const char *lcrpath, struct lcr_container_state *lcs);
 
+/*
+* Get state of many containers at once, spread over worker threads
+* param names		: container names, required.
+* param n		: number of containers.
+* param lcrpath	: container path, set to NULL if you want use default lcrpath.
+* param out		: returned container states, n entries, free each with lcr_container_state_free.
+* param success	: returned per container result, n entries.
+* param nthreads	: threads to use including the caller, 0 for one per online cpu.
+*			  the worker threads are kept for the next batch.
+* return: true if the state of every container was got.
+*/
+__EXPORT__ bool lcr_state_batch(const char **names, size_t n, const char *lcrpath, struct lcr_container_state *out,
+                                bool *success, size_t nthreads);
+
 /*
 * Pause a container
 * param name		: container name, required.
@@ -278,6 +299,100 @@ __EXPORT__ bool lcr_get_container_pids(const char *name, const char *lcrpath, pi
 __EXPORT__ bool lcr_resize(const char *name, const char *lcrpath, unsigned int height, unsigned int width);
 __EXPORT__ bool lcr_exec_resize(const char *name, const char *lcrpath, const char *suffix, unsigned int height,
                      unsigned int width);
+
+/*
+* Persistent handle of a container, keeps the loaded container across calls
+* and reloads it only when its config file changes. Safe to share between
+* threads, every lcr_handle_get must be paired with a lcr_close.
+*/
+typedef struct lcr_handle lcr_handle_t;
+
+/*
+* Open a handle to a container
+* param name		: container name, required.
+* param lcrpath	: container path, set to NULL if you want use default lcrpath.
+* return: handle on success, NULL on failure.
+*/
+__EXPORT__ lcr_handle_t *lcr_open(const char *name, const char *lcrpath);
+
+/*
+* Take another reference to a handle
+*/
+__EXPORT__ lcr_handle_t *lcr_handle_get(lcr_handle_t *handle);
+
+/*
+* Drop a reference to a handle, the last one releases the container
+*/
+__EXPORT__ void lcr_close(lcr_handle_t *handle);
+
+/*
+* Same as lcr_state, lcr_kill, lcr_pause, lcr_resume, lcr_get_container_pids,
+* lcr_resize, lcr_update and lcr_get_console_config on the container of the handle
+*/
+__EXPORT__ bool lcr_handle_state(lcr_handle_t *handle, struct lcr_container_state *lcs);
+__EXPORT__ bool lcr_handle_kill(lcr_handle_t *handle, uint32_t signal);
+__EXPORT__ bool lcr_handle_pause(lcr_handle_t *handle);
+__EXPORT__ bool lcr_handle_resume(lcr_handle_t *handle);
+__EXPORT__ bool lcr_handle_get_container_pids(lcr_handle_t *handle, pid_t **pids, size_t *pids_len);
+__EXPORT__ bool lcr_handle_resize(lcr_handle_t *handle, unsigned int height, unsigned int width);
+__EXPORT__ bool lcr_handle_update(lcr_handle_t *handle, const struct lcr_cgroup_resources *cr);
+__EXPORT__ bool lcr_handle_get_console_config(lcr_handle_t *handle, struct lcr_console_config *config);
+
+/*
+* Change of a container between two samples of a stats subscription
+*/
+struct lcr_container_stats {
+    /* Name of container */
+    const char *name;
+    /* The sample, valid during the callback only */
+    const struct lcr_container_state *state;
+    /* Nanoseconds since the previous sample */
+    uint64_t interval_nanos;
+    /* Counter deltas since the previous sample */
+    uint64_t cpu_use_nanos;
+    uint64_t cpu_use_user;
+    uint64_t cpu_use_sys;
+    uint64_t cpu_throttled_nanos;
+    struct blkio_stats io_service_bytes;
+    struct blkio_stats io_serviced;
+    uint64_t page_faults;
+    uint64_t major_page_faults;
+    /* Rates over the interval, CPU in percent of one cpu */
+    double cpu_percent;
+    double cpu_user_percent;
+    double cpu_sys_percent;
+    double read_bytes_per_sec;
+    double write_bytes_per_sec;
+    double read_iops;
+    double write_iops;
+    double page_faults_per_sec;
+    double major_page_faults_per_sec;
+};
+
+typedef void (*lcr_stats_cb_t)(const struct lcr_container_stats *stats, void *data);
+
+typedef struct lcr_stats_subscription lcr_stats_subscription_t;
+
+/*
+* Sample containers every interval on an internal thread and report their changes
+* param names		: container names, required.
+* param n		: number of containers.
+* param lcrpath	: container path, set to NULL if you want use default lcrpath.
+* param interval_ms	: sampling interval of each container in milliseconds, the samples
+*			  of different containers are spread over the interval.
+* param cb		: called on the sampler thread for every sample that follows a sample of
+*			  the same running container, nothing is reported for stopped or restarted ones.
+* param data		: passed to cb.
+* return: subscription on success, NULL on failure.
+*/
+__EXPORT__ lcr_stats_subscription_t *lcr_stats_subscribe(const char **names, size_t n, const char *lcrpath,
+                                                         unsigned int interval_ms, lcr_stats_cb_t cb, void *data);
+
+/*
+* Stop sampling and free the subscription, must not be called from its callback
+*/
+__EXPORT__ void lcr_stats_unsubscribe(lcr_stats_subscription_t *sub);
+
 #ifdef __cplusplus
 }
 #endif
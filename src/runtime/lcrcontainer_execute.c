@@ -766,25 +766,97 @@ out_free:
     return bret;
 }
 
-void do_lcr_state(struct lxc_container *c, struct lcr_container_state *lcs)
+/*
+ * Metrics of a running container straight from its cgroup files, of the given
+ * cgroup version or 0 to detect it. A reader in *cache is reused while the
+ * init pid is the same, and the reader used is left there for the next call.
+ */
+static bool state_from_cgroup(struct lxc_container *c, struct lcr_container_state *lcs, int cgroup_version,
+                              isula_cgroup_reader_t **cache)
 {
-    struct lxc_container_metrics lxc_metrics = { 0 };
+    isula_cgroup_reader_t *reader = cache != NULL ? *cache : NULL;
+    struct isula_cgroup_metrics metrics = { 0 };
+    const char *state = NULL;
+    pid_t init;
+    bool ret = false;
 
-    if (c == NULL) {
-        ERROR("Invalid argument c");
-        return;
+    init = c->init_pid(c);
+    if (init <= 0) {
+        goto out;
     }
 
-    if (lcs == NULL) {
-        ERROR("Invalid argument lcs");
-        return;
+    if (reader != NULL && isula_cgroup_reader_pid(reader) != init) {
+        isula_cgroup_reader_free(reader);
+        reader = NULL;
+    }
+    if (reader == NULL) {
+        reader = isula_cgroup_reader_new_pid(cgroup_version, init);
+    }
+    if (reader == NULL || isula_cgroup_reader_read(reader, &metrics) != 0) {
+        DEBUG("Failed to read cgroup metrics of container %s", c->name);
+        goto out;
     }
 
-    clear_error_message(&g_lcr_error);
-    (void)memset(lcs, 0x00, sizeof(struct lcr_container_state));
+    state = c->state(c);
+    if (state == NULL) {
+        goto out;
+    }
+    lcs->state = isula_strdup_s(state);
+    lcs->init = init;
+
+    lcs->cpu_use_nanos = metrics.cpu_use_nanos;
+    lcs->cpu_use_user = metrics.cpu_use_user;
+    lcs->cpu_use_sys = metrics.cpu_use_sys;
+    lcs->cpu_nr_periods = metrics.cpu_nr_periods;
+    lcs->cpu_nr_throttled = metrics.cpu_nr_throttled;
+    lcs->cpu_throttled_nanos = metrics.cpu_throttled_nanos;
+
+    lcs->pids_current = metrics.pids_current;
+    lcs->pids_limit = metrics.pids_limit;
+
+    lcs->io_serviced.read = metrics.io_read_ops;
+    lcs->io_serviced.write = metrics.io_write_ops;
+    lcs->io_serviced.total = metrics.io_total_ops;
+
+    lcs->io_service_bytes.read = metrics.io_read_bytes;
+    lcs->io_service_bytes.write = metrics.io_write_bytes;
+    lcs->io_service_bytes.total = metrics.io_total_bytes;
+
+    lcs->mem_used = metrics.mem_used;
+    lcs->mem_limit = metrics.mem_limit;
+    lcs->kmem_used = metrics.kmem_used;
+    lcs->kmem_limit = metrics.kmem_limit;
+    lcs->rss_bytes = metrics.rss_bytes;
+    lcs->page_faults = metrics.page_faults;
+    lcs->major_page_faults = metrics.major_page_faults;
+
+    lcs->cache = metrics.cache;
+    lcs->cache_total = metrics.cache_total;
+    lcs->inactive_file_total = metrics.inactive_file_total;
+    ret = true;
 
-    lcs->name = isula_strdup_s(c->name);
-    lcs->init = -1;// init to -1
+out:
+    if (!ret) {
+        isula_cgroup_reader_free(reader);
+        reader = NULL;
+    }
+    if (cache != NULL) {
+        *cache = reader;
+    } else {
+        isula_cgroup_reader_free(reader);
+    }
+    return ret;
+}
+
+/*
+ * Metrics as lxc reports them, in the units of state_from_cgroup: on cgroup v1
+ * lxc gives the user and system times in clock ticks and no limit as the raw
+ * limit_in_bytes value.
+ */
+static void state_from_lxc(struct lxc_container *c, struct lcr_container_state *lcs, int cgroup_version)
+{
+    struct lxc_container_metrics lxc_metrics = { 0 };
+    int version = cgroup_version != 0 ? cgroup_version : isula_cgroup_host_version();
 
     if (!c->get_container_metrics(c, &lxc_metrics)) {
         DEBUG("Failed to get container %s metrics", c->name);
@@ -819,6 +891,39 @@ void do_lcr_state(struct lxc_container *c, struct lcr_container_state *lcs)
     lcs->cache = lxc_metrics.cache;
     lcs->cache_total = lxc_metrics.cache_total;
     lcs->inactive_file_total = lxc_metrics.inactive_file_total;
+
+    if (version == CGROUP_VERSION_1) {
+        lcs->cpu_use_user = isula_cgroup_v1_ticks_to_nanos(lcs->cpu_use_user);
+        lcs->cpu_use_sys = isula_cgroup_v1_ticks_to_nanos(lcs->cpu_use_sys);
+        lcs->mem_limit = isula_cgroup_v1_limit(lcs->mem_limit);
+        lcs->kmem_limit = isula_cgroup_v1_limit(lcs->kmem_limit);
+    }
+}
+
+void do_lcr_state(struct lxc_container *c, struct lcr_container_state *lcs, int cgroup_version,
+                  isula_cgroup_reader_t **reader)
+{
+    if (c == NULL) {
+        ERROR("Invalid argument c");
+        return;
+    }
+
+    if (lcs == NULL) {
+        ERROR("Invalid argument lcs");
+        return;
+    }
+
+    clear_error_message(&g_lcr_error);
+    (void)memset(lcs, 0x00, sizeof(struct lcr_container_state));
+
+    lcs->name = isula_strdup_s(c->name);
+    lcs->init = -1;// init to -1
+
+    // stopped containers and unreadable cgroups go through lxc
+    if (state_from_cgroup(c, lcs, cgroup_version, reader)) {
+        return;
+    }
+    state_from_lxc(c, lcs, cgroup_version);
 }
 
 #define ExitSignalOffset 128
@@ -25,6 +25,7 @@
 #define __LCR_CONTAINER_EXECUTE_H
 
 #include "lcrcontainer.h"
+#include "utils_cgroup.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -32,7 +33,8 @@ extern "C" {
 
 bool do_update(struct lxc_container *c, const char *name, const char *lcrpath, struct lcr_cgroup_resources *cr);
 
-void do_lcr_state(struct lxc_container *c, struct lcr_container_state *lcs);
+void do_lcr_state(struct lxc_container *c, struct lcr_container_state *lcs, int cgroup_version,
+                  isula_cgroup_reader_t **reader);
 
 bool do_attach(const char *name, const char *path, const struct lcr_exec_request *request, int *exit_code);
 
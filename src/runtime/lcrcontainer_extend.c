@@ -70,91 +70,34 @@ out_put:
     return NULL;
 }
 
-static int realloc_annotations(oci_runtime_spec *oci_spec, size_t new_lens)
-{
-    size_t new_size = 0;
-    unsigned long old_size = 0;
-    char **fkey = NULL;
-    char **fval = NULL;
-    int nret = 0;
-
-    if (new_lens < 1) {
-        return 0;
-    }
-
-    if (!oci_spec->annotations) {
-        oci_spec->annotations = isula_common_calloc_s(sizeof(json_map_string_string));
-        if (!oci_spec->annotations) {
-            ERROR("Out of memory");
-            nret = -1;
-            goto out;
-        }
-    }
-
-    if (new_lens > SIZE_MAX / sizeof(char *) - oci_spec->annotations->len) {
-        ERROR("Too many annotations!");
-        nret = -1;
-        goto out;
-    }
-    new_size = (oci_spec->annotations->len + new_lens) * sizeof(char *);
-    old_size = oci_spec->annotations->len * sizeof(char *);
-    nret = isula_mem_realloc((void **)&fkey, new_size, (void **)&(oci_spec->annotations->keys), old_size);
-    if (nret) {
-        ERROR("Failed to realloc memory for files limit variables");
-        nret = -1;
-        goto out;
-    }
-    oci_spec->annotations->keys = fkey;
-
-    nret = isula_mem_realloc((void **)&fval, new_size, (void **)&(oci_spec->annotations->values), old_size);
-    if (nret) {
-        ERROR("Failed to realloc memory for files limit variables");
-        nret = -1;
-        goto out;
-    }
-    oci_spec->annotations->values = fval;
-    oci_spec->annotations->len += new_lens;
-
-out:
-    return nret;
-}
-
-static int make_annotations(oci_runtime_spec *container, const struct lxc_container *c, int fpos)
+static int make_annotations(oci_runtime_spec *container, const struct lxc_container *c)
 {
     int ret = -1;
     int nret;
     char default_path[PATH_MAX] = { 0 };
     char *realpath = NULL;
     json_map_string_string *anno = container->annotations;
+    const char *log_path = json_map_string_string_get(anno, "log.console.file");
 
-    if (fpos == -1) {
-        if (realloc_annotations(container, 1)) {
-            ERROR("Realloc annotations failed");
-            goto out;
-        }
-        fpos = (int)(anno->len - 1);
-        anno->keys[fpos] = isula_strdup_s("log.console.file");
-        anno->values[fpos] = NULL;
-    }
-
-    if (!anno->values[fpos]) {
+    if (log_path == NULL) {
         nret = snprintf(default_path, PATH_MAX, "%s/%s/%s", c->config_path, c->name, "console.log");
         if (nret < 0 || nret >= PATH_MAX) {
             ERROR("create default path: %s failed", default_path);
             goto out;
         }
-        if (anno->values[fpos]) {
-            free(anno->values[fpos]);
+        if (json_map_string_string_put(anno, "log.console.file", default_path) != 0) {
+            ERROR("Out of memory");
+            goto out;
         }
-        anno->values[fpos] = isula_strdup_s(default_path);
+        log_path = json_map_string_string_get(anno, "log.console.file");
     }
-    if (strcmp("none", anno->values[fpos]) == 0) {
+    if (strcmp("none", log_path) == 0) {
         DEBUG("Disable console log.");
         ret = 0;
         goto out;
     }
-    if (isula_file_ensure_path(&realpath, anno->values[fpos])) {
-        SYSERROR("Invalid log path: %s.", anno->values[fpos]);
+    if (isula_file_ensure_path(&realpath, log_path)) {
+        SYSERROR("Invalid log path: %s.", log_path);
         goto out;
     }
     ret = 0;
@@ -163,15 +106,8 @@ out:
     return ret;
 }
 
-static inline bool is_annotations_key_console_file(const char *key)
-{
-    return strcmp(key, "log.console.file") == 0;
-}
-
 static int check_annotations(oci_runtime_spec *container, const struct lxc_container *c)
 {
-    size_t i;
-    int fpos = -1;
     bool ret = false;
 
     if (c == NULL) {
@@ -183,15 +119,9 @@ static int check_annotations(oci_runtime_spec *container, const struct lxc_conta
         if (!ret) {
             goto out;
         }
-    } else {
-        for (i = 0; i < container->annotations->len; i++) {
-            if (is_annotations_key_console_file(container->annotations->keys[i])) {
-                fpos = (int)i;
-            }
-        }
     }
 
-    if (make_annotations(container, c, fpos)) {
+    if (make_annotations(container, c)) {
         goto out;
     }
     ret = true;
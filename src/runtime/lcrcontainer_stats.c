@@ -0,0 +1,347 @@
+/******************************************************************************
+ * lcr: utils library for iSula
+ *
+ * Copyright (c) Huawei Technologies Co., Ltd. 2023. All rights reserved.
+ *
+ * Authors:
+ * Haozi007 <liuhao27@huawei.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ********************************************************************************/
+
+/*
+ * container stats streaming
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+
+#include "error.h"
+#include "lcrcontainer.h"
+#include "lcrcontainer_stats.h"
+#include "log.h"
+#include "utils_mainloop.h"
+#include "utils_memory.h"
+
+#define NSEC_PER_SEC 1000000000ULL
+#define NSEC_PER_MSEC 1000000ULL
+
+struct stats_entry {
+    lcr_handle_t *handle;
+    char *name;
+    // previous sample, valid when have_prev
+    struct lcr_container_state prev;
+    uint64_t prev_nanos;
+    bool have_prev;
+};
+
+struct lcr_stats_subscription {
+    struct stats_entry *entries;
+    size_t n;
+    lcr_stats_cb_t cb;
+    void *data;
+
+    // each timer tick samples the containers of one slot, so the samples
+    // of an interval are spread over it instead of all happening at once
+    size_t slots;
+    size_t next_slot;
+
+    isula_epoll_descr_t descr;
+    int timer_fd;
+    int stop_fd;
+    pthread_t thread;
+    bool thread_started;
+};
+
+static uint64_t monotonic_nanos(void)
+{
+    struct timespec ts = { 0 };
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static bool counter_delta(uint64_t prev, uint64_t cur, uint64_t *delta)
+{
+    // counters only go back when the cgroup was recreated
+    if (cur < prev) {
+        return false;
+    }
+    *delta = cur - prev;
+    return true;
+}
+
+static bool blkio_delta(const struct blkio_stats *prev, const struct blkio_stats *cur, struct blkio_stats *delta)
+{
+    return counter_delta(prev->read, cur->read, &delta->read) &&
+           counter_delta(prev->write, cur->write, &delta->write) &&
+           counter_delta(prev->total, cur->total, &delta->total);
+}
+
+static double per_second(uint64_t delta, uint64_t interval_nanos)
+{
+    return (double)delta * (double)NSEC_PER_SEC / (double)interval_nanos;
+}
+
+bool lcr_stats_compute(const struct lcr_container_state *prev, const struct lcr_container_state *cur,
+                       uint64_t interval_nanos, struct lcr_container_stats *stats)
+{
+    if (interval_nanos == 0 || cur->init <= 0 || prev->init != cur->init) {
+        return false;
+    }
+
+    if (!counter_delta(prev->cpu_use_nanos, cur->cpu_use_nanos, &stats->cpu_use_nanos) ||
+        !counter_delta(prev->cpu_use_user, cur->cpu_use_user, &stats->cpu_use_user) ||
+        !counter_delta(prev->cpu_use_sys, cur->cpu_use_sys, &stats->cpu_use_sys) ||
+        !counter_delta(prev->cpu_throttled_nanos, cur->cpu_throttled_nanos, &stats->cpu_throttled_nanos) ||
+        !blkio_delta(&prev->io_service_bytes, &cur->io_service_bytes, &stats->io_service_bytes) ||
+        !blkio_delta(&prev->io_serviced, &cur->io_serviced, &stats->io_serviced) ||
+        !counter_delta(prev->page_faults, cur->page_faults, &stats->page_faults) ||
+        !counter_delta(prev->major_page_faults, cur->major_page_faults, &stats->major_page_faults)) {
+        return false;
+    }
+
+    stats->interval_nanos = interval_nanos;
+    stats->cpu_percent = per_second(stats->cpu_use_nanos, interval_nanos) * 100 / NSEC_PER_SEC;
+    stats->cpu_user_percent = per_second(stats->cpu_use_user, interval_nanos) * 100 / NSEC_PER_SEC;
+    stats->cpu_sys_percent = per_second(stats->cpu_use_sys, interval_nanos) * 100 / NSEC_PER_SEC;
+    stats->read_bytes_per_sec = per_second(stats->io_service_bytes.read, interval_nanos);
+    stats->write_bytes_per_sec = per_second(stats->io_service_bytes.write, interval_nanos);
+    stats->read_iops = per_second(stats->io_serviced.read, interval_nanos);
+    stats->write_iops = per_second(stats->io_serviced.write, interval_nanos);
+    stats->page_faults_per_sec = per_second(stats->page_faults, interval_nanos);
+    stats->major_page_faults_per_sec = per_second(stats->major_page_faults, interval_nanos);
+    return true;
+}
+
+static void stats_entry_reset(struct stats_entry *entry)
+{
+    if (entry->have_prev) {
+        lcr_container_state_free(&entry->prev);
+        entry->have_prev = false;
+    }
+}
+
+static void stats_sample(struct lcr_stats_subscription *sub, struct stats_entry *entry)
+{
+    struct lcr_container_state cur = { 0 };
+    struct lcr_container_stats stats = { 0 };
+    uint64_t now;
+
+    if (!lcr_handle_state(entry->handle, &cur)) {
+        lcr_container_state_free(&cur);
+        stats_entry_reset(entry);
+        return;
+    }
+    now = monotonic_nanos();
+
+    if (entry->have_prev && lcr_stats_compute(&entry->prev, &cur, now - entry->prev_nanos, &stats)) {
+        stats.name = entry->name;
+        stats.state = &cur;
+        sub->cb(&stats, sub->data);
+    }
+
+    stats_entry_reset(entry);
+    entry->prev = cur;
+    entry->prev_nanos = now;
+    entry->have_prev = true;
+}
+
+static int stats_timer_cb(int fd, uint32_t event, void *data, isula_epoll_descr_t *descr)
+{
+    struct lcr_stats_subscription *sub = (struct lcr_stats_subscription *)data;
+    uint64_t expirations = 0;
+    size_t i;
+
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return EPOLL_LOOP_HANDLE_CONTINUE;
+    }
+
+    // a late tick samples the slots it missed, a full round at most
+    if (expirations > sub->slots) {
+        expirations = sub->slots;
+    }
+    for (; expirations > 0; expirations--) {
+        for (i = sub->next_slot; i < sub->n; i += sub->slots) {
+            stats_sample(sub, &sub->entries[i]);
+        }
+        sub->next_slot = (sub->next_slot + 1) % sub->slots;
+    }
+    return EPOLL_LOOP_HANDLE_CONTINUE;
+}
+
+static int stats_stop_cb(int fd, uint32_t event, void *data, isula_epoll_descr_t *descr)
+{
+    return EPOLL_LOOP_HANDLE_CLOSE;
+}
+
+static void *stats_thread(void *arg)
+{
+    struct lcr_stats_subscription *sub = (struct lcr_stats_subscription *)arg;
+
+    if (isula_epoll_loop(&sub->descr, -1) != 0) {
+        ERROR("Stats sampler loop failed");
+    }
+    // the thread local error would leak with the thread
+    clear_error_message(&g_lcr_error);
+    return NULL;
+}
+
+static void stats_subscription_free(struct lcr_stats_subscription *sub)
+{
+    size_t i;
+
+    if (sub->descr.fd >= 0) {
+        (void)isula_epoll_close(&sub->descr);
+    }
+    if (sub->timer_fd >= 0) {
+        close(sub->timer_fd);
+    }
+    if (sub->stop_fd >= 0) {
+        close(sub->stop_fd);
+    }
+    for (i = 0; sub->entries != NULL && i < sub->n; i++) {
+        stats_entry_reset(&sub->entries[i]);
+        lcr_close(sub->entries[i].handle);
+        free(sub->entries[i].name);
+    }
+    free(sub->entries);
+    free(sub);
+}
+
+static int stats_start(struct lcr_stats_subscription *sub, unsigned int interval_ms)
+{
+    struct itimerspec its = { 0 };
+    uint64_t tick;
+    sigset_t all, old;
+    int nret;
+
+    // ticks of at least a millisecond, so many containers share a slot
+    sub->slots = sub->n < interval_ms ? sub->n : interval_ms;
+    tick = (uint64_t)interval_ms * NSEC_PER_MSEC / sub->slots;
+    its.it_value.tv_sec = (time_t)(tick / NSEC_PER_SEC);
+    its.it_value.tv_nsec = (long)(tick % NSEC_PER_SEC);
+    its.it_interval = its.it_value;
+
+    sub->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    sub->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (sub->timer_fd < 0 || sub->stop_fd < 0) {
+        SYSERROR("Failed to create stats sampler fds");
+        return -1;
+    }
+    if (isula_epoll_open(&sub->descr) != 0) {
+        SYSERROR("Failed to create stats sampler epoll");
+        return -1;
+    }
+    if (isula_epoll_add_handler(&sub->descr, sub->timer_fd, stats_timer_cb, sub) != 0 ||
+        isula_epoll_add_handler(&sub->descr, sub->stop_fd, stats_stop_cb, sub) != 0) {
+        ERROR("Failed to add stats sampler handlers");
+        return -1;
+    }
+    if (timerfd_settime(sub->timer_fd, 0, &its, NULL) != 0) {
+        SYSERROR("Failed to arm stats sampler timer");
+        return -1;
+    }
+
+    // signals are for the threads of the caller, not for the sampler
+    (void)sigfillset(&all);
+    (void)pthread_sigmask(SIG_SETMASK, &all, &old);
+    nret = pthread_create(&sub->thread, NULL, stats_thread, sub);
+    (void)pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (nret != 0) {
+        ERROR("Failed to start stats sampler thread");
+        return -1;
+    }
+    sub->thread_started = true;
+    return 0;
+}
+
+lcr_stats_subscription_t *lcr_stats_subscribe(const char **names, size_t n, const char *lcrpath,
+                                              unsigned int interval_ms, lcr_stats_cb_t cb, void *data)
+{
+    struct lcr_stats_subscription *sub = NULL;
+    size_t i;
+
+    clear_error_message(&g_lcr_error);
+    if (names == NULL || n == 0 || interval_ms == 0 || cb == NULL) {
+        ERROR("Invalid input");
+        return NULL;
+    }
+
+    sub = isula_common_calloc_s(sizeof(*sub));
+    if (sub == NULL) {
+        ERROR("Out of memory");
+        return NULL;
+    }
+    sub->descr.fd = -1;
+    sub->timer_fd = -1;
+    sub->stop_fd = -1;
+    sub->cb = cb;
+    sub->data = data;
+    sub->entries = isula_smart_calloc_s(sizeof(*sub->entries), n);
+    if (sub->entries == NULL) {
+        ERROR("Out of memory");
+        goto err_out;
+    }
+
+    for (i = 0; i < n; i++) {
+        sub->entries[i].handle = lcr_open(names[i], lcrpath);
+        if (sub->entries[i].handle == NULL) {
+            ERROR("Failed to open container %s for stats", names[i] != NULL ? names[i] : "(null)");
+            goto err_out;
+        }
+        sub->n++;
+        sub->entries[i].name = isula_strdup_s(names[i]);
+        if (sub->entries[i].name == NULL) {
+            ERROR("Out of memory");
+            goto err_out;
+        }
+    }
+
+    if (stats_start(sub, interval_ms) != 0) {
+        lcr_try_set_error_message(LCR_ERR_RUNTIME, "Failed to start stats sampler");
+        goto err_out;
+    }
+    return sub;
+
+err_out:
+    stats_subscription_free(sub);
+    return NULL;
+}
+
+void lcr_stats_unsubscribe(lcr_stats_subscription_t *sub)
+{
+    uint64_t one = 1;
+
+    if (sub == NULL) {
+        return;
+    }
+
+    if (sub->thread_started) {
+        if (write(sub->stop_fd, &one, sizeof(one)) != sizeof(one)) {
+            SYSERROR("Failed to stop stats sampler");
+        }
+        (void)pthread_join(sub->thread, NULL);
+    }
+    stats_subscription_free(sub);
+}
@@ -0,0 +1,48 @@
+/******************************************************************************
+ * lcr: utils library for iSula
+ *
+ * Copyright (c) Huawei Technologies Co., Ltd. 2023. All rights reserved.
+ *
+ * Authors:
+ * Haozi007 <liuhao27@huawei.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ********************************************************************************/
+
+#ifndef __LCR_CONTAINER_STATS_H
+#define __LCR_CONTAINER_STATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lcrcontainer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Fill stats with the change from prev to cur, interval_nanos apart. Fails when
+ * the two samples are not of one run of a running container: no interval, no
+ * init, another init or a counter that went back.
+ */
+bool lcr_stats_compute(const struct lcr_container_state *prev, const struct lcr_container_state *cur,
+                       uint64_t interval_nanos, struct lcr_container_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __LCR_CONTAINER_STATS_H */
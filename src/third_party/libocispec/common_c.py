@@ -47,7 +47,14 @@ def generate_json_common_c(out):
 # include <string.h>
 # include <errno.h>
 # include <limits.h>
+# include <fcntl.h>
+# include <pthread.h>
+# include <unistd.h>
+# include <sys/stat.h>
 # include "json_common.h"
+# include "utils_buffer.h"
+# include "utils_file.h"
+# include "utils_workpool.h"
 
 #define YAJL_GET_OBJECT_NO_CHECK(v) (&(v)->u.object)
 #define YAJL_GET_STRING_NO_CHECK(v) ((v)->u.string)
@@ -62,20 +69,18 @@ def generate_json_common_c(out):
 #define MAX_MEMORY_SIZE ((size_t)1 << 31)
 #endif
 
-static yajl_gen_status gen_yajl_val (yajl_val obj, yajl_gen g, parser_error *err);
-
 static yajl_gen_status gen_yajl_val_obj (yajl_val obj, yajl_gen g, parser_error *err)
 {
     size_t i;
     yajl_gen_status stat = yajl_gen_status_ok;
 
-    stat = yajl_gen_map_open (g);
+    stat = json_gen_map_open (g);
     if (yajl_gen_status_ok != stat)
         GEN_SET_ERROR_AND_RETURN (stat, err);
 
     for (i = 0; i < obj->u.object.len; i++)
     {
-        stat = yajl_gen_string (g, (const unsigned char *) obj->u.object.keys[i], strlen (obj->u.object.keys[i]));
+        stat = json_gen_string (g, (const unsigned char *) obj->u.object.keys[i], strlen (obj->u.object.keys[i]));
         if (yajl_gen_status_ok != stat)
             GEN_SET_ERROR_AND_RETURN (stat, err);
         stat = gen_yajl_val (obj->u.object.values[i], g, err);
@@ -83,7 +88,7 @@ static yajl_gen_status gen_yajl_val_obj (yajl_val obj, yajl_gen g, parser_error
             GEN_SET_ERROR_AND_RETURN (stat, err);
     }
 
-    stat = yajl_gen_map_close (g);
+    stat = json_gen_map_close (g);
     if (yajl_gen_status_ok != stat)
         GEN_SET_ERROR_AND_RETURN (stat, err);
     return yajl_gen_status_ok;
@@ -94,7 +99,7 @@ static yajl_gen_status gen_yajl_val_array (yajl_val arr, yajl_gen g, parser_erro
     size_t i;
     yajl_gen_status stat = yajl_gen_status_ok;
 
-    stat = yajl_gen_array_open (g);
+    stat = json_gen_array_open (g);
     if (yajl_gen_status_ok != stat)
         GEN_SET_ERROR_AND_RETURN (stat, err);
 
@@ -105,13 +110,13 @@ static yajl_gen_status gen_yajl_val_array (yajl_val arr, yajl_gen g, parser_erro
             GEN_SET_ERROR_AND_RETURN (stat, err);
     }
 
-    stat = yajl_gen_array_close (g);
+    stat = json_gen_array_close (g);
     if (yajl_gen_status_ok != stat)
         GEN_SET_ERROR_AND_RETURN (stat, err);
     return yajl_gen_status_ok;
 }
 
-static yajl_gen_status gen_yajl_val (yajl_val obj, yajl_gen g, parser_error *err)
+yajl_gen_status gen_yajl_val (yajl_val obj, yajl_gen g, parser_error *err)
 {
     yajl_gen_status __stat = yajl_gen_status_ok;
     char *__tstr;
@@ -123,7 +128,7 @@ static yajl_gen_status gen_yajl_val (yajl_val obj, yajl_gen g, parser_error *err
             if (__tstr == NULL) {
                 return __stat;
             }
-            __stat = yajl_gen_string (g, (const unsigned char *) __tstr, strlen (__tstr));
+            __stat = json_gen_string (g, (const unsigned char *) __tstr, strlen (__tstr));
             if (yajl_gen_status_ok != __stat)
                 GEN_SET_ERROR_AND_RETURN (__stat, err);
             return yajl_gen_status_ok;
@@ -132,7 +137,7 @@ static yajl_gen_status gen_yajl_val (yajl_val obj, yajl_gen g, parser_error *err
             if (__tstr == NULL) {
                 return __stat;
             }
-            __stat = yajl_gen_number (g, __tstr, strlen (__tstr));
+            __stat = json_gen_number (g, __tstr, strlen (__tstr));
             if (yajl_gen_status_ok != __stat)
                 GEN_SET_ERROR_AND_RETURN (__stat, err);
             return yajl_gen_status_ok;
@@ -141,11 +146,11 @@ static yajl_gen_status gen_yajl_val (yajl_val obj, yajl_gen g, parser_error *err
         case yajl_t_array:
             return gen_yajl_val_array (obj, g, err);
         case yajl_t_true:
-            return yajl_gen_bool (g, true);
+            return json_gen_bool (g, true);
         case yajl_t_false:
-            return yajl_gen_bool (g, false);
+            return json_gen_bool (g, false);
         case yajl_t_null:
-            return yajl_gen_null(g);
+            return json_gen_null(g);
         case yajl_t_any:
             return __stat;
     }
@@ -163,7 +168,7 @@ yajl_gen_status gen_yajl_object_residual (yajl_val obj, yajl_gen g, parser_error
         {
             continue;
         }
-        stat = yajl_gen_string (g, (const unsigned char *) obj->u.object.keys[i], strlen (obj->u.object.keys[i]));
+        stat = json_gen_string (g, (const unsigned char *) obj->u.object.keys[i], strlen (obj->u.object.keys[i]));
         if (yajl_gen_status_ok != stat)
             GEN_SET_ERROR_AND_RETURN (stat, err);
         stat = gen_yajl_val (obj->u.object.values[i], g, err);
@@ -183,7 +188,7 @@ map_uint (void *ctx, long long unsigned int num)
   ret = snprintf (numstr, sizeof (numstr), "%llu", num);
   if (ret < 0 || (size_t) ret >= sizeof (numstr))
     return yajl_gen_in_error_state;
-  return yajl_gen_number ((yajl_gen) ctx, (const char *) numstr,
+  return json_gen_number ((yajl_gen) ctx, (const char *) numstr,
 			  strlen (numstr));
 }
 
@@ -196,7 +201,7 @@ map_int (void *ctx, long long int num)
   ret = snprintf (numstr, sizeof (numstr), "%lld", num);
   if (ret < 0 || (size_t) ret >= sizeof (numstr))
     return yajl_gen_in_error_state;
-  return yajl_gen_number ((yajl_gen) ctx, (const char *) numstr,
+  return json_gen_number ((yajl_gen) ctx, (const char *) numstr,
 			  strlen (numstr));
 }
 
@@ -204,7 +209,9 @@ map_int (void *ctx, long long int num)
 bool
 json_gen_init (yajl_gen * g, const struct parser_context *ctx)
 {
-  *g = yajl_gen_alloc (NULL);
+  yajl_alloc_funcs afs;
+
+  *g = yajl_gen_alloc (json_allocator_yajl (ctx->allocator, &afs));
   if (NULL == *g)
     return false;
 
@@ -215,6 +222,316 @@ json_gen_init (yajl_gen * g, const struct parser_context *ctx)
   return true;
 }
 
+/* staging area between the json writer and the output, so that the
+   document is never held in full */
+# define JSON_GEN_STAGE_SIZE 8192
+
+struct json_gen_stage
+{
+  int fd;
+  isula_buffer *buffer;
+  /* whole document in a growing heap buffer, for json_gen_to_string */
+  char *string;
+  size_t string_cap;
+  size_t used;
+  int error;
+  char data[JSON_GEN_STAGE_SIZE + 1];
+};
+
+static void
+json_gen_stage_flush (struct json_gen_stage *stage)
+{
+  /* json_gen_to_string keeps everything in stage->string */
+  if (stage->error != 0 || stage->used == 0 || (stage->fd < 0 && stage->buffer == NULL))
+    return;
+  if (stage->buffer != NULL)
+    {
+      /* yajl escapes NUL characters, so the staged data is a C string */
+      stage->data[stage->used] = '\\0';
+      if (stage->buffer->append (stage->buffer, stage->data) != 0)
+        stage->error = ENOMEM;
+    }
+  else if (isula_file_total_write_nointr (stage->fd, stage->data, stage->used) != (ssize_t) stage->used)
+    stage->error = errno != 0 ? errno : EIO;
+  stage->used = 0;
+}
+
+static void
+json_gen_stage_print (void *ctx, const char *str, size_t len)
+{
+  struct json_gen_stage *stage = ctx;
+
+  if (stage->error != 0)
+    return;
+  if (stage->fd < 0 && stage->buffer == NULL)
+    {
+      if (stage->string_cap - stage->used <= len)
+        {
+          size_t cap = stage->string_cap != 0 ? stage->string_cap : JSON_GEN_STAGE_SIZE;
+          char *tmp;
+
+          while (cap - stage->used <= len)
+            {
+              if (cap > MAX_MEMORY_SIZE / 2)
+                {
+                  stage->error = ENOMEM;
+                  return;
+                }
+              cap *= 2;
+            }
+          tmp = realloc (stage->string, cap);
+          if (tmp == NULL)
+            {
+              stage->error = ENOMEM;
+              return;
+            }
+          stage->string = tmp;
+          stage->string_cap = cap;
+        }
+      (void) memcpy (stage->string + stage->used, str, len);
+      stage->used += len;
+      return;
+    }
+
+  while (len > 0 && stage->error == 0)
+    {
+      size_t n = JSON_GEN_STAGE_SIZE - stage->used;
+      if (n > len)
+        n = len;
+      (void) memcpy (stage->data + stage->used, str, n);
+      stage->used += n;
+      str += n;
+      len -= n;
+      if (stage->used == JSON_GEN_STAGE_SIZE)
+        json_gen_stage_flush (stage);
+    }
+}
+
+static int
+json_gen_to_stage (json_gen_func gen, const void *ptr, struct json_gen_stage *stage,
+                   const struct parser_context *ctx, parser_error *err)
+{
+  struct parser_context tmp_ctx = { 0 };
+  yajl_gen g = NULL;
+  int ret = -1;
+
+  if (ptr == NULL || err == NULL)
+    return -1;
+
+  *err = NULL;
+  if (ctx == NULL)
+    ctx = (const struct parser_context *) (&tmp_ctx);
+
+  g = json_gen_writer_alloc (json_gen_stage_print, stage, !(ctx->options & OPT_GEN_SIMPLIFY),
+                             !(ctx->options & OPT_GEN_NO_VALIDATE_UTF8), ctx->allocator);
+  if (g == NULL)
+    {
+      *err = strdup ("Json_gen init failed");
+      return -1;
+    }
+
+  if (yajl_gen_status_ok != gen (g, ptr, ctx, err))
+    {
+      if (*err == NULL)
+        *err = strdup ("Failed to generate json");
+      goto out;
+    }
+
+  json_gen_writer_flush (g);
+  json_gen_stage_flush (stage);
+  if (stage->error != 0)
+    {
+      if (asprintf (err, "Failed to write json: %s", strerror (stage->error)) < 0)
+        *err = strdup ("error allocating memory");
+      goto out;
+    }
+  ret = 0;
+
+out:
+  json_gen_writer_free (g);
+  return ret;
+}
+
+static struct json_allocator *
+ctx_allocator (const struct parser_context *ctx)
+{
+  return ctx != NULL ? ctx->allocator : NULL;
+}
+
+char *
+json_gen_to_string (json_gen_func gen, const void *ptr, const struct parser_context *ctx, parser_error *err)
+{
+  struct json_gen_stage *stage = json_alloc_calloc (ctx_allocator (ctx), 1, sizeof (*stage));
+  char *ret = NULL;
+
+  if (stage == NULL)
+    {
+      if (err != NULL)
+        *err = strdup ("Cannot allocate memory");
+      return NULL;
+    }
+  stage->fd = -1;
+  if (json_gen_to_stage (gen, ptr, stage, ctx, err) == 0)
+    {
+      /* the print callback always leaves room for the terminator */
+      if (stage->string == NULL)
+        stage->string = calloc (1, 1);
+      else
+        stage->string[stage->used] = '\\0';
+      if (stage->string == NULL)
+        *err = strdup ("Cannot allocate memory");
+      ret = stage->string;
+      stage->string = NULL;
+    }
+  free (stage->string);
+  json_alloc_free (ctx_allocator (ctx), stage);
+  return ret;
+}
+
+int
+json_gen_to_fd (json_gen_func gen, const void *ptr, int fd, const struct parser_context *ctx, parser_error *err)
+{
+  struct json_gen_stage *stage;
+  int ret;
+
+  if (fd < 0)
+    {
+      if (err != NULL)
+        *err = strdup ("Invalid file descriptor");
+      return -1;
+    }
+  stage = json_alloc_calloc (ctx_allocator (ctx), 1, sizeof (*stage));
+  if (stage == NULL)
+    {
+      if (err != NULL)
+        *err = strdup ("Cannot allocate memory");
+      return -1;
+    }
+  stage->fd = fd;
+  ret = json_gen_to_stage (gen, ptr, stage, ctx, err);
+  json_alloc_free (ctx_allocator (ctx), stage);
+  return ret;
+}
+
+int
+json_gen_to_buffer (json_gen_func gen, const void *ptr, isula_buffer *buf, const struct parser_context *ctx,
+                    parser_error *err)
+{
+  struct json_gen_stage *stage;
+  int ret;
+
+  if (buf == NULL)
+    {
+      if (err != NULL)
+        *err = strdup ("Invalid buffer");
+      return -1;
+    }
+  stage = json_alloc_calloc (ctx_allocator (ctx), 1, sizeof (*stage));
+  if (stage == NULL)
+    {
+      if (err != NULL)
+        *err = strdup ("Cannot allocate memory");
+      return -1;
+    }
+  stage->fd = -1;
+  stage->buffer = buf;
+  ret = json_gen_to_stage (gen, ptr, stage, ctx, err);
+  json_alloc_free (ctx_allocator (ctx), stage);
+  return ret;
+}
+
+/* flush the directory entry of path, so that a rename to it survives a crash */
+static int
+json_sync_parent_dir (const char *path)
+{
+  __auto_free char *dir = NULL;
+  char *slash;
+  int fd;
+  int ret;
+  int saved_errno;
+
+  dir = strdup (strchr (path, '/') != NULL ? path : ".");
+  if (dir == NULL)
+    return -1;
+  slash = strrchr (dir, '/');
+  if (slash == dir)
+    dir[1] = '\\0';
+  else if (slash != NULL)
+    *slash = '\\0';
+
+  fd = open (dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  ret = fsync (fd);
+  saved_errno = errno;
+  (void) close (fd);
+  errno = saved_errno;
+  return ret;
+}
+
+int
+json_gen_to_file_atomic (json_gen_func gen, const void *ptr, const char *path, mode_t mode,
+                         const struct parser_context *ctx, parser_error *err)
+{
+  __auto_free char *tmp_path = NULL;
+  int fd;
+
+  if (path == NULL || err == NULL)
+    return -1;
+
+  /* write a sibling and rename it over path, readers see the old or the new file */
+  if (asprintf (&tmp_path, "%s.tmp-XXXXXX", path) < 0)
+    {
+      tmp_path = NULL;
+      *err = strdup ("error allocating memory");
+      return -1;
+    }
+  fd = mkostemp (tmp_path, O_CLOEXEC);
+  if (fd < 0)
+    {
+      if (asprintf (err, "Failed to create %s: %s", tmp_path, strerror (errno)) < 0)
+        *err = strdup ("error allocating memory");
+      return -1;
+    }
+
+  if (fchmod (fd, mode) != 0)
+    {
+      if (asprintf (err, "Failed to chmod %s: %s", tmp_path, strerror (errno)) < 0)
+        *err = strdup ("error allocating memory");
+      goto err_out;
+    }
+  if (json_gen_to_fd (gen, ptr, fd, ctx, err) != 0)
+    goto err_out;
+  if (fsync (fd) != 0 || close (fd) != 0)
+    {
+      fd = -1;
+      if (asprintf (err, "Failed to sync %s: %s", tmp_path, strerror (errno)) < 0)
+        *err = strdup ("error allocating memory");
+      goto err_out;
+    }
+  fd = -1;
+  if (rename (tmp_path, path) != 0)
+    {
+      if (asprintf (err, "Failed to rename %s to %s: %s", tmp_path, path, strerror (errno)) < 0)
+        *err = strdup ("error allocating memory");
+      goto err_out;
+    }
+  /* path holds the new content already, only its durability is in doubt */
+  if (json_sync_parent_dir (path) != 0)
+    {
+      if (asprintf (err, "Failed to sync the directory of %s: %s", path, strerror (errno)) < 0)
+        *err = strdup ("error allocating memory");
+      return -1;
+    }
+  return 0;
+
+err_out:
+  if (fd >= 0)
+    (void) close (fd);
+  (void) unlink (tmp_path);
+  return -1;
+}
+
 yajl_val
 get_val (yajl_val tree, const char *name, yajl_type type)
 {
@@ -256,6 +573,175 @@ void *smart_calloc(size_t count, size_t extra, size_t unit_size) {
     return ret;
 }
 
+void *
+json_ctx_calloc (const struct parser_context *ctx, size_t count, size_t extra, size_t unit_size)
+{
+  void *ret;
+
+  if (ctx == NULL || ctx->arena == NULL)
+    return smart_calloc (count, extra, unit_size);
+
+  if (unit_size == 0 || extra > MAX_MEMORY_SIZE || count > MAX_MEMORY_SIZE - extra)
+    return NULL;
+  if (count + extra == 0 || count + extra > (MAX_MEMORY_SIZE / unit_size))
+    return NULL;
+
+  ret = json_arena_alloc (ctx->arena, (count + extra) * unit_size);
+  if (ret != NULL)
+    (void) memset (ret, 0, (count + extra) * unit_size);
+  return ret;
+}
+
+char *
+json_ctx_strdup (const struct parser_context *ctx, const char *src)
+{
+  size_t len;
+  char *ret;
+
+  if (ctx == NULL || ctx->arena == NULL)
+    return strdup (src);
+
+  len = strlen (src);
+  ret = json_arena_alloc (ctx->arena, len + 1);
+  if (ret != NULL)
+    (void) memcpy (ret, src, len + 1);
+  return ret;
+}
+
+yajl_val
+json_tree_parse (const char *jsondata, size_t len, bool terminated, char *errbuf, size_t errbuf_size)
+{
+  __auto_free char *copy = NULL;
+
+  if (terminated)
+    return yajl_tree_parse (jsondata, errbuf, errbuf_size);
+
+  copy = malloc (len + 1);
+  if (copy == NULL)
+    {
+      (void) snprintf (errbuf, errbuf_size, "out of memory");
+      return NULL;
+    }
+  (void) memcpy (copy, jsondata, len);
+  copy[len] = '\\0';
+  return yajl_tree_parse (copy, errbuf, errbuf_size);
+}
+
+struct json_parse_files
+{
+  const char **paths;
+  json_parse_file_func parse;
+  const struct parser_context *ctx;
+  void **out;
+  parser_error *errs;
+  size_t failed;
+};
+
+static void
+json_parse_files_task (size_t i, void *data)
+{
+  struct json_parse_files *job = data;
+  parser_error err = NULL;
+
+  job->out[i] = job->parse (job->paths[i], job->ctx, &err);
+  if (job->out[i] == NULL)
+    __atomic_add_fetch (&job->failed, 1, __ATOMIC_RELAXED);
+  if (job->errs != NULL)
+    job->errs[i] = err;
+  else
+    free (err);
+}
+
+/* workers kept between calls, taken out while a call runs so that concurrent
+   calls do not share them */
+static pthread_mutex_t json_parse_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static isula_workpool_t *json_parse_pool = NULL;
+static size_t json_parse_pool_size = 0;
+static pid_t json_parse_pool_owner = 0;
+
+static isula_workpool_t *
+json_parse_pool_get (size_t nworkers)
+{
+  isula_workpool_t *pool = NULL;
+  size_t size = 0;
+
+  pthread_mutex_lock (&json_parse_pool_lock);
+  /* the workers of the parent do not exist in a forked child, the pool is dropped */
+  if (json_parse_pool != NULL && json_parse_pool_owner == getpid ())
+    {
+      pool = json_parse_pool;
+      size = json_parse_pool_size;
+    }
+  json_parse_pool = NULL;
+  pthread_mutex_unlock (&json_parse_pool_lock);
+
+  if (pool != NULL && size == nworkers)
+    return pool;
+  isula_workpool_free (pool);
+  return isula_workpool_new (nworkers);
+}
+
+static void
+json_parse_pool_put (isula_workpool_t *pool, size_t nworkers)
+{
+  pthread_mutex_lock (&json_parse_pool_lock);
+  if (json_parse_pool == NULL)
+    {
+      json_parse_pool = pool;
+      json_parse_pool_size = nworkers;
+      json_parse_pool_owner = getpid ();
+      pool = NULL;
+    }
+  pthread_mutex_unlock (&json_parse_pool_lock);
+  isula_workpool_free (pool);
+}
+
+int
+json_parse_files_parallel (const char **paths, size_t n, size_t nthreads, json_parse_file_func parse,
+                           const struct parser_context *ctx, void **out, parser_error *errs)
+{
+  struct parser_context heap_ctx = { 0 };
+  struct json_parse_files job;
+  isula_workpool_t *pool = NULL;
+  size_t i;
+
+  if ((n > 0 && (paths == NULL || out == NULL)) || parse == NULL)
+    return -1;
+
+  if (ctx != NULL)
+    heap_ctx = *ctx;
+  heap_ctx.arena = NULL;
+  job.paths = paths;
+  job.parse = parse;
+  job.ctx = &heap_ctx;
+  job.out = out;
+  job.errs = errs;
+  job.failed = 0;
+
+  if (nthreads == 0)
+    {
+      long cpus = sysconf (_SC_NPROCESSORS_ONLN);
+      nthreads = cpus > 0 ? (size_t) cpus : 1;
+    }
+  if (nthreads > n)
+    nthreads = n;
+  /* the calling thread works too; without a pool the files are parsed in turn */
+  if (nthreads > 1)
+    pool = json_parse_pool_get (nthreads - 1);
+  if (pool == NULL)
+    {
+      for (i = 0; i < n; i++)
+        json_parse_files_task (i, &job);
+    }
+  else
+    {
+      (void) isula_workpool_run (pool, n, json_parse_files_task, &job);
+      json_parse_pool_put (pool, nthreads - 1);
+    }
+
+  return job.failed == 0 ? 0 : -1;
+}
+
 int
 common_safe_double (const char *numstr, double *converted)
 {
@@ -525,8 +1011,8 @@ gen_json_map_int_int (void *ctx, const json_map_int_int * map,
   if (map != NULL)
     len = map->len;
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 0);
-  stat = yajl_gen_map_open ((yajl_gen) g);
+    json_gen_beautify (g, 0);
+  stat = json_gen_map_open ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
   for (i = 0; i < len; i++)
@@ -543,7 +1029,7 @@ gen_json_map_int_int (void *ctx, const json_map_int_int * map,
 	  return yajl_gen_in_error_state;
 	}
       stat =
-	yajl_gen_string ((yajl_gen) g, (const unsigned char *) numstr,
+	json_gen_string ((yajl_gen) g, (const unsigned char *) numstr,
 			 strlen (numstr));
       if (yajl_gen_status_ok != stat)
 	GEN_SET_ERROR_AND_RETURN (stat, err);
@@ -552,23 +1038,214 @@ gen_json_map_int_int (void *ctx, const json_map_int_int * map,
 	GEN_SET_ERROR_AND_RETURN (stat, err);
     }
 
-  stat = yajl_gen_map_close ((yajl_gen) g);
+  stat = json_gen_map_close ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 1);
+    json_gen_beautify (g, 1);
   return yajl_gen_status_ok;
 }
 
+/* private state of a json_map_*: the capacity of the keys and values arrays
+   it was made for and, once a large map with string keys is looked up, the
+   open addressing index of its keys.  The slots hold the position of the key
+   plus one, 0 for an empty slot.  */
+struct json_map_state
+{
+  const void *keys;
+  const void *values;
+  size_t cap;
+  /* entries in the index, of mask + 1 slots */
+  size_t len;
+  size_t mask;
+  size_t *slots;
+};
+
+static void
+json_map_state_free (struct json_map_state *state)
+{
+  if (state != NULL)
+    free (state->slots);
+  free (state);
+}
+
+static void
+json_map_index_drop (struct json_map_state *state)
+{
+  if (state == NULL)
+    return;
+  free (state->slots);
+  state->slots = NULL;
+  state->len = 0;
+  state->mask = 0;
+}
+
+/* the state of a map with these arrays of len entries, dropped if the
+   arrays were replaced or filled past it behind its back */
+static struct json_map_state *
+json_map_state_check (struct json_map_state **state, const void *keys, const void *values, size_t len)
+{
+  if (*state != NULL && ((*state)->keys != keys || (*state)->values != values || (*state)->cap < len))
+    {
+      json_map_state_free (*state);
+      *state = NULL;
+    }
+  return *state;
+}
+
+/* make room in the arrays of a json_map_* for one more entry past len,
+   growing them geometrically so that n appends copy O(n) entries.  Maps
+   allocated by an arena cannot grow.  */
+static int
+json_map_reserve (const void *map, void **keys, void **values, size_t len, struct json_map_state **state,
+                  size_t key_size, size_t value_size)
+{
+  size_t unit = key_size > value_size ? key_size : value_size;
+  size_t n;
+  void *p;
+
+  if (json_map_state_check (state, *keys, *values, len) != NULL && len < (*state)->cap)
+    return 0;
+  if (len > SIZE_MAX / 2 / unit || json_arena_owns (map))
+    return -1;
+  n = len < 4 ? 8 : len * 2;
+
+  p = realloc (*keys, n * key_size);
+  if (p == NULL)
+    return -1;
+  *keys = p;
+  p = realloc (*values, n * value_size);
+  if (p == NULL)
+    return -1;
+  *values = p;
+
+  /* without memory for the state the next append grows the arrays again */
+  if (*state == NULL)
+    *state = calloc (1, sizeof (**state));
+  if (*state != NULL)
+    {
+      (*state)->keys = *keys;
+      (*state)->values = *values;
+      (*state)->cap = n;
+    }
+  return 0;
+}
+
+/* smaller maps are scanned */
+#define JSON_MAP_INDEX_MIN 16
+
+static size_t
+json_map_key_hash (const char *key)
+{
+  uint64_t h = 0xcbf29ce484222325ULL;
+
+  for (; *key != '\\0'; key++)
+    {
+      h ^= (unsigned char) *key;
+      h *= 0x100000001b3ULL;
+    }
+  return (size_t) h;
+}
+
+static void
+json_map_index_insert (struct json_map_state *state, const char *key, size_t pos)
+{
+  size_t h = json_map_key_hash (key) & state->mask;
+
+  while (state->slots[h] != 0)
+    h = (h + 1) & state->mask;
+  state->slots[h] = pos + 1;
+}
+
+static void
+json_map_index_build (struct json_map_state **state, char **keys, const void *values, size_t len)
+{
+  size_t cap = 32;
+  size_t i;
+
+  while (cap / 2 <= len)
+    {
+      if (cap > SIZE_MAX / 2 / sizeof (size_t))
+        return;
+      cap *= 2;
+    }
+  if (*state == NULL)
+    {
+      *state = calloc (1, sizeof (**state));
+      if (*state == NULL)
+        return;
+      (*state)->keys = keys;
+      (*state)->values = values;
+      (*state)->cap = len;
+    }
+  (*state)->slots = calloc (cap, sizeof (size_t));
+  if ((*state)->slots == NULL)
+    return;
+  (*state)->mask = cap - 1;
+  for (i = 0; i < len; i++)
+    if (keys[i] != NULL)
+      json_map_index_insert (*state, keys[i], i);
+  (*state)->len = len;
+}
+
+/* position of key in keys, len if it is missing.  The index of a large map
+   is built on first use and rebuilt if entries were added behind its back;
+   without memory for it the keys are scanned.  */
+static size_t
+json_map_string_find (const void *map, char **keys, const void *values, size_t len,
+                      struct json_map_state **state, const char *key)
+{
+  size_t h, i;
+
+  if (json_map_state_check (state, keys, values, len) != NULL && (*state)->len != len)
+    json_map_index_drop (*state);
+  if ((*state == NULL || (*state)->slots == NULL) && len >= JSON_MAP_INDEX_MIN && !json_arena_owns (map))
+    json_map_index_build (state, keys, values, len);
+
+  if (*state == NULL || (*state)->slots == NULL)
+    {
+      for (i = 0; i < len; i++)
+        if (keys[i] != NULL && strcmp (keys[i], key) == 0)
+          return i;
+      return len;
+    }
+
+  for (h = json_map_key_hash (key) & (*state)->mask; (*state)->slots[h] != 0; h = (h + 1) & (*state)->mask)
+    {
+      i = (*state)->slots[h] - 1;
+      if (i < len && keys[i] != NULL && strcmp (keys[i], key) == 0)
+        return i;
+    }
+  return len;
+}
+
+/* record the entry just appended at pos in the index, if there is one */
+static void
+json_map_index_add (struct json_map_state *state, const char *key, size_t pos)
+{
+  if (state == NULL || state->slots == NULL || state->len != pos)
+    return;
+  if ((pos + 1) * 2 > state->mask + 1)
+    {
+      /* rebuilt larger by the next lookup */
+      json_map_index_drop (state);
+      return;
+    }
+  json_map_index_insert (state, key, pos);
+  state->len = pos + 1;
+}
+
 void
 free_json_map_int_int (json_map_int_int * map)
 {
-  if (map != NULL)
+  if (map != NULL && !json_arena_owns (map))
     {
       free (map->keys);
       map->keys = NULL;
       free (map->values);
       map->values = NULL;
+      json_map_state_free (map->_state);
+      map->_state = NULL;
       free (map);
     }
 }
@@ -583,24 +1260,23 @@ make_json_map_int_int (yajl_val src, const struct parser_context *ctx,
   size_t i;
   size_t len;
 
-  (void) ctx;			/* Silence compiler warning.  */
 
   if (src == NULL || YAJL_GET_OBJECT (src) == NULL)
     return NULL;
 
   len = YAJL_GET_OBJECT_NO_CHECK (src)->len;
-  ret = smart_calloc (1, 0, sizeof (*ret));
+  ret = json_ctx_calloc (ctx, 1, 0, sizeof (*ret));
   if (ret == NULL)
     return NULL;
 
   ret->len = 0;
-  ret->keys = smart_calloc (len, 1, sizeof (int));
+  ret->keys = json_ctx_calloc (ctx, len, 1, sizeof (int));
   if (ret->keys == NULL)
     {
       return NULL;
     }
 
-  ret->values = smart_calloc (len, 1, sizeof (int));
+  ret->values = json_ctx_calloc (ctx, len, 1, sizeof (int));
   if (ret->values == NULL)
     {
       return NULL;
@@ -659,40 +1335,24 @@ make_json_map_int_int (yajl_val src, const struct parser_context *ctx,
 int
 append_json_map_int_int (json_map_int_int * map, int key, int val)
 {
-  size_t len;
-  __auto_free int *keys = NULL;
-  __auto_free int *vals = NULL;
+  void *keys, *values;
 
   if (map == NULL)
     return -1;
 
-  if ((SIZE_MAX / sizeof (int) - 1) < map->len)
-    return -1;
-
-  len = map->len + 1;
-  keys = smart_calloc (len, 0, sizeof (int));
-  if (keys == NULL)
-    return -1;
-  vals = smart_calloc (len, 0, sizeof (int));
-  if (vals == NULL)
+  keys = map->keys;
+  values = map->values;
+  if (json_map_reserve (map, &keys, &values, map->len, &map->_state, sizeof (int), sizeof (int)) != 0)
     {
+      map->keys = keys;
+      map->values = values;
       return -1;
     }
-
-  if (map->len)
-    {
-      (void) memcpy (keys, map->keys, map->len * sizeof (int));
-      (void) memcpy (vals, map->values, map->len * sizeof (int));
-    }
-  free (map->keys);
   map->keys = keys;
-  keys = NULL;
-  free (map->values);
-  map->values = vals;
-  vals = NULL;
+  map->values = values;
+
   map->keys[map->len] = key;
   map->values[map->len] = val;
-
   map->len++;
   return 0;
 }
@@ -707,8 +1367,8 @@ gen_json_map_int_bool (void *ctx, const json_map_int_bool * map,
   if (map != NULL)
     len = map->len;
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 0);
-  stat = yajl_gen_map_open ((yajl_gen) g);
+    json_gen_beautify (g, 0);
+  stat = json_gen_map_open ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
   for (i = 0; i < len; i++)
@@ -725,27 +1385,27 @@ gen_json_map_int_bool (void *ctx, const json_map_int_bool * map,
 	  return yajl_gen_in_error_state;
 	}
       stat =
-	yajl_gen_string ((yajl_gen) g, (const unsigned char *) numstr,
+	json_gen_string ((yajl_gen) g, (const unsigned char *) numstr,
 			 strlen (numstr));
       if (yajl_gen_status_ok != stat)
 	GEN_SET_ERROR_AND_RETURN (stat, err);
-      stat = yajl_gen_bool ((yajl_gen) g, (int) (map->values[i]));
+      stat = json_gen_bool ((yajl_gen) g, (int) (map->values[i]));
       if (yajl_gen_status_ok != stat)
 	GEN_SET_ERROR_AND_RETURN (stat, err);
     }
 
-  stat = yajl_gen_map_close ((yajl_gen) g);
+  stat = json_gen_map_close ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 1);
+    json_gen_beautify (g, 1);
   return yajl_gen_status_ok;
 }
 
 void
 free_json_map_int_bool (json_map_int_bool * map)
 {
-  if (map != NULL)
+  if (map != NULL && !json_arena_owns (map))
     {
       size_t i;
       for (i = 0; i < map->len; i++)
@@ -757,6 +1417,8 @@ free_json_map_int_bool (json_map_int_bool * map)
       map->keys = NULL;
       free (map->values);
       map->values = NULL;
+      json_map_state_free (map->_state);
+      map->_state = NULL;
       free (map);
     }
 }
@@ -771,22 +1433,21 @@ make_json_map_int_bool (yajl_val src, const struct parser_context *ctx,
   size_t i;
   size_t len;
 
-  (void) ctx;			/* Silence compiler warning.  */
 
   if (src == NULL || YAJL_GET_OBJECT (src) == NULL)
     return NULL;
 
   len = YAJL_GET_OBJECT_NO_CHECK (src)->len;
-  ret = smart_calloc (1, 0, sizeof (*ret));
+  ret = json_ctx_calloc (ctx, 1, 0, sizeof (*ret));
   if (ret == NULL)
     return NULL;
   ret->len = 0;
-  ret->keys = smart_calloc (len, 1, sizeof (int));
+  ret->keys = json_ctx_calloc (ctx, len, 1, sizeof (int));
   if (ret->keys == NULL)
     {
       return NULL;
     }
-  ret->values = smart_calloc (len, 1, sizeof (bool));
+  ret->values = json_ctx_calloc (ctx, len, 1, sizeof (bool));
   if (ret->values == NULL)
     {
       return NULL;
@@ -837,41 +1498,24 @@ make_json_map_int_bool (yajl_val src, const struct parser_context *ctx,
 int
 append_json_map_int_bool (json_map_int_bool * map, int key, bool val)
 {
-  size_t len;
-  __auto_free int *keys = NULL;
-  __auto_free bool *vals = NULL;
+  void *keys, *values;
 
   if (map == NULL)
     return -1;
 
-  if ((SIZE_MAX / sizeof (int) - 1) < map->len
-      || (SIZE_MAX / sizeof (bool) - 1) < map->len)
-    return -1;
-
-  len = map->len + 1;
-  keys = smart_calloc (len, 0, sizeof (int));
-  if (keys == NULL)
-    return -1;
-  vals = smart_calloc (len, 0, sizeof (bool));
-  if (vals == NULL)
+  keys = map->keys;
+  values = map->values;
+  if (json_map_reserve (map, &keys, &values, map->len, &map->_state, sizeof (int), sizeof (bool)) != 0)
     {
+      map->keys = keys;
+      map->values = values;
       return -1;
     }
-
-  if (map->len)
-    {
-      (void) memcpy (keys, map->keys, map->len * sizeof (int));
-      (void) memcpy (vals, map->values, map->len * sizeof (bool));
-    }
-  free (map->keys);
   map->keys = keys;
-  keys = NULL;
-  free (map->values);
-  map->values = vals;
-  vals = NULL;
+  map->values = values;
+
   map->keys[map->len] = key;
   map->values[map->len] = val;
-
   map->len++;
   return 0;
 }
@@ -886,9 +1530,9 @@ gen_json_map_int_string (void *ctx, const json_map_int_string * map,
   if (map != NULL)
     len = map->len;
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 0);
+    json_gen_beautify (g, 0);
 
-  stat = yajl_gen_map_open ((yajl_gen) g);
+  stat = json_gen_map_open ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
   for (i = 0; i < len; i++)
@@ -905,30 +1549,30 @@ gen_json_map_int_string (void *ctx, const json_map_int_string * map,
 	  return yajl_gen_in_error_state;
 	}
       stat =
-	yajl_gen_string ((yajl_gen) g, (const unsigned char *) numstr,
+	json_gen_string ((yajl_gen) g, (const unsigned char *) numstr,
 			 strlen (numstr));
       if (yajl_gen_status_ok != stat)
 	GEN_SET_ERROR_AND_RETURN (stat, err);
       stat =
-	yajl_gen_string ((yajl_gen) g,
+	json_gen_string ((yajl_gen) g,
 			 (const unsigned char *) (map->values[i]),
 			 strlen (map->values[i]));
       if (yajl_gen_status_ok != stat)
 	GEN_SET_ERROR_AND_RETURN (stat, err);
     }
 
-  stat = yajl_gen_map_close ((yajl_gen) g);
+  stat = json_gen_map_close ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 1);
+    json_gen_beautify (g, 1);
   return yajl_gen_status_ok;
 }
 
 void
 free_json_map_int_string (json_map_int_string * map)
 {
-  if (map != NULL)
+  if (map != NULL && !json_arena_owns (map))
     {
       size_t i;
       for (i = 0; i < map->len; i++)
@@ -941,6 +1585,8 @@ free_json_map_int_string (json_map_int_string * map)
       map->keys = NULL;
       free (map->values);
       map->values = NULL;
+      json_map_state_free (map->_state);
+      map->_state = NULL;
       free (map);
     }
 }
@@ -958,22 +1604,21 @@ make_json_map_int_string (yajl_val src, const struct parser_context *ctx,
   if (src == NULL || YAJL_GET_OBJECT (src) == NULL)
     return NULL;
 
-  (void) ctx;			/* Silence compiler warning.  */
 
   len = YAJL_GET_OBJECT_NO_CHECK (src)->len;
 
-  ret = smart_calloc (1, 0, sizeof (*ret));
+  ret = json_ctx_calloc (ctx, 1, 0, sizeof (*ret));
   if (ret == NULL)
     return NULL;
 
   ret->len = 0;
-  ret->keys = smart_calloc (len, 1, sizeof (int));
+  ret->keys = json_ctx_calloc (ctx, len, 1, sizeof (int));
   if (ret->keys == NULL)
     {
       return NULL;
     }
 
-  ret->values = smart_calloc (len, 1, sizeof (char *));
+  ret->values = json_ctx_calloc (ctx, len, 1, sizeof (char *));
   if (ret->values == NULL)
     {
       return NULL;
@@ -1015,7 +1660,7 @@ make_json_map_int_string (yajl_val src, const struct parser_context *ctx,
               return NULL;
             }
           char *str = YAJL_GET_STRING_NO_CHECK (srcval);
-          ret->values[i] = strdup (str ? str : "");
+          ret->values[i] = json_ctx_strdup (ctx, str ? str : "");
         }
     }
   return move_ptr (ret);
@@ -1025,36 +1670,31 @@ int
 append_json_map_int_string (json_map_int_string * map, int key,
 			    const char *val)
 {
-  size_t len;
-  int *keys = NULL;
-  char **vals = NULL;
+  void *keys, *values;
   char *new_value;
 
   if (map == NULL)
     return -1;
 
-  if ((SIZE_MAX / sizeof (int) - 1) < map->len
-      || (SIZE_MAX / sizeof (char *) - 1) < map->len)
-    return -1;
-
-  len = map->len + 1;
-  keys = realloc (map->keys, len * sizeof (int));
-  if (keys == NULL)
-    return -1;
+  keys = map->keys;
+  values = map->values;
+  if (json_map_reserve (map, &keys, &values, map->len, &map->_state, sizeof (int), sizeof (char *)) != 0)
+    {
+      map->keys = keys;
+      map->values = values;
+      return -1;
+    }
   map->keys = keys;
-
-  vals = realloc (map->values, len * sizeof (char *));
-  if (vals == NULL)
-    return -1;
-  map->values = vals;
+  map->values = values;
 
   new_value = strdup (val ? val : "");
   if (new_value == NULL)
-    return -1;
+    {
+      return -1;
+    }
 
   map->keys[map->len] = key;
   map->values[map->len] = new_value;
-
   map->len++;
   return 0;
 }
@@ -1069,14 +1709,14 @@ gen_json_map_string_int (void *ctx, const json_map_string_int * map,
   if (map != NULL)
     len = map->len;
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 0);
-  stat = yajl_gen_map_open ((yajl_gen) g);
+    json_gen_beautify (g, 0);
+  stat = json_gen_map_open ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
   for (i = 0; i < len; i++)
     {
       stat =
-	yajl_gen_string ((yajl_gen) g, (const unsigned char *) (map->keys[i]),
+	json_gen_string ((yajl_gen) g, (const unsigned char *) (map->keys[i]),
 			 strlen (map->keys[i]));
       if (yajl_gen_status_ok != stat)
 	GEN_SET_ERROR_AND_RETURN (stat, err);
@@ -1085,18 +1725,18 @@ gen_json_map_string_int (void *ctx, const json_map_string_int * map,
 	GEN_SET_ERROR_AND_RETURN (stat, err);
     }
 
-  stat = yajl_gen_map_close ((yajl_gen) g);
+  stat = json_gen_map_close ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 1);
+    json_gen_beautify (g, 1);
   return yajl_gen_status_ok;
 }
 
 void
 free_json_map_string_int (json_map_string_int * map)
 {
-  if (map != NULL)
+  if (map != NULL && !json_arena_owns (map))
     {
       size_t i;
       for (i = 0; i < map->len; i++)
@@ -1108,6 +1748,8 @@ free_json_map_string_int (json_map_string_int * map)
       map->keys = NULL;
       free (map->values);
       map->values = NULL;
+      json_map_state_free (map->_state);
+      map->_state = NULL;
       free (map);
     }
 }
@@ -1122,26 +1764,25 @@ make_json_map_string_int (yajl_val src, const struct parser_context *ctx,
   size_t i;
   size_t len;
 
-  (void) ctx;			/* Silence compiler warning.  */
 
   if (src == NULL || YAJL_GET_OBJECT (src) == NULL)
     return NULL;
 
   len = YAJL_GET_OBJECT_NO_CHECK (src)->len;
-  ret = smart_calloc (1, 0, sizeof (*ret));
+  ret = json_ctx_calloc (ctx, 1, 0, sizeof (*ret));
   if (ret == NULL)
     {
       *(err) = strdup ("error allocating memory");
       return NULL;
     }
   ret->len = 0;
-  ret->keys = smart_calloc (len, 1, sizeof (char *));
+  ret->keys = json_ctx_calloc (ctx, len, 1, sizeof (char *));
   if (ret->keys == NULL)
     {
       *(err) = strdup ("error allocating memory");
       return NULL;
     }
-  ret->values = smart_calloc (len, 1, sizeof (int));
+  ret->values = json_ctx_calloc (ctx, len, 1, sizeof (int));
   if (ret->values == NULL)
     {
       *(err) = strdup ("error allocating memory");
@@ -1156,7 +1797,7 @@ make_json_map_string_int (yajl_val src, const struct parser_context *ctx,
       ret->values[i] = 0;
       ret->len = i + 1;
 
-      ret->keys[i] = strdup (srckey ? srckey : "");
+      ret->keys[i] = json_ctx_strdup (ctx, srckey ? srckey : "");
       if (ret->keys[i] == NULL)
         {
           *(err) = strdup ("error allocating memory");
@@ -1194,34 +1835,29 @@ int
 append_json_map_string_int (json_map_string_int * map, const char *key,
 			    int val)
 {
-  size_t len;
-  char **keys = NULL;
-  int *vals = NULL;
-  char *new_value;
+  void *keys, *values;
+  char *new_key;
 
   if (map == NULL)
     return -1;
 
-  if ((SIZE_MAX / sizeof (char *) - 1) < map->len
-      || (SIZE_MAX / sizeof (int) - 1) < map->len)
-    return -1;
-
-  len = map->len + 1;
-  keys = realloc (map->keys, len * sizeof (char *));
-  if (keys == NULL)
-    return -1;
+  keys = map->keys;
+  values = map->values;
+  if (json_map_reserve (map, &keys, &values, map->len, &map->_state, sizeof (char *), sizeof (int)) != 0)
+    {
+      map->keys = keys;
+      map->values = values;
+      return -1;
+    }
   map->keys = keys;
-  vals = realloc (map->values, len * sizeof (int));
-  if (vals == NULL)
-    return -1;
-  map->values = vals;
+  map->values = values;
 
-  new_value = strdup (key ? key : "");
-  if (new_value == NULL)
+  new_key = strdup (key ? key : "");
+  if (new_key == NULL)
     return -1;
-  map->keys[map->len] = new_value;
-  map->values[map->len] = val;
 
+  map->keys[map->len] = new_key;
+  map->values[map->len] = val;
   map->len++;
   return 0;
 }
@@ -1236,14 +1872,14 @@ gen_json_map_string_int64 (void *ctx, const json_map_string_int64 *map,
     if (map != NULL)
         len = map->len;
     if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-        yajl_gen_config (g, yajl_gen_beautify, 0);
-    stat = yajl_gen_map_open ((yajl_gen)g);
+        json_gen_beautify (g, 0);
+    stat = json_gen_map_open ((yajl_gen)g);
     if (yajl_gen_status_ok != stat)
         GEN_SET_ERROR_AND_RETURN (stat, err);
 
     for (i = 0; i < len; i++)
     {
-        stat = yajl_gen_string ((yajl_gen)g, (const unsigned char *)(map->keys[i]), strlen(map->keys[i]));
+        stat = json_gen_string ((yajl_gen)g, (const unsigned char *)(map->keys[i]), strlen(map->keys[i]));
         if (yajl_gen_status_ok != stat)
             GEN_SET_ERROR_AND_RETURN (stat, err);
         stat = map_int(g, map->values[i]);
@@ -1251,18 +1887,18 @@ gen_json_map_string_int64 (void *ctx, const json_map_string_int64 *map,
             GEN_SET_ERROR_AND_RETURN (stat, err);
     }
 
-    stat = yajl_gen_map_close ((yajl_gen)g);
+    stat = json_gen_map_close ((yajl_gen)g);
     if (yajl_gen_status_ok != stat)
         GEN_SET_ERROR_AND_RETURN (stat, err);
     if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-        yajl_gen_config (g, yajl_gen_beautify, 1);
+        json_gen_beautify (g, 1);
     return yajl_gen_status_ok;
 }
 
 void
 free_json_map_string_int64 (json_map_string_int64 *map)
 {
-    if (map != NULL)
+    if (map != NULL && !json_arena_owns (map))
     {
         size_t i;
         for (i = 0; i < map->len; i++)
@@ -1274,6 +1910,8 @@ free_json_map_string_int64 (json_map_string_int64 *map)
         map->keys = NULL;
         free (map->values);
         map->values = NULL;
+        json_map_state_free (map->_state);
+        map->_state = NULL;
         free (map);
     }
 }
@@ -1290,17 +1928,17 @@ make_json_map_string_int64 (yajl_val src, const struct parser_context *ctx, pars
         size_t len = YAJL_GET_OBJECT (src)->len;
         char **keys = NULL;
         int64_t *vals = NULL;
-        ret = smart_calloc (1, 0, sizeof(*ret));
+        ret = json_ctx_calloc (ctx, 1, 0, sizeof(*ret));
         if (ret == NULL) {
           return NULL;
         }
-        keys = smart_calloc (len, 1, sizeof (char *));
+        keys = json_ctx_calloc (ctx, len, 1, sizeof (char *));
         if (keys == NULL) {
           return NULL;
         }
-        vals = smart_calloc (len, 1, sizeof (int64_t));
+        vals = json_ctx_calloc (ctx, len, 1, sizeof (int64_t));
         if (vals == NULL) {
-          free(keys);
+          ret->keys = keys;
           return NULL;
         }
         ret->len = len;
@@ -1310,7 +1948,7 @@ make_json_map_string_int64 (yajl_val src, const struct parser_context *ctx, pars
         {
             const char *srckey = YAJL_GET_OBJECT (src)->keys[i];
             yajl_val srcval = YAJL_GET_OBJECT (src)->values[i];
-            ret->keys[i] = strdup (srckey ? srckey : "");
+            ret->keys[i] = json_ctx_strdup (ctx, srckey ? srckey : "");
 
             if (srcval != NULL)
             {
@@ -1340,41 +1978,31 @@ make_json_map_string_int64 (yajl_val src, const struct parser_context *ctx, pars
 int
 append_json_map_string_int64 (json_map_string_int64 *map, const char *key, int64_t val)
 {
-    size_t len;
-    char **keys = NULL;
-    int64_t *vals = NULL;
-
-    if (map == NULL)
-        return -1;
+  void *keys, *values;
+  char *new_key;
 
-    if ((SIZE_MAX / sizeof (char *) - 1) < map->len || (SIZE_MAX / sizeof (int) - 1) < map->len)
-        return -1;
+  if (map == NULL)
+    return -1;
 
-    len = map->len + 1;
-    keys = smart_calloc (len, 0, sizeof(char *));
-    if (keys == NULL) {
-      return -1;
-    }
-    vals = smart_calloc (len, 0, sizeof(int64_t));
-    if (vals == NULL) {
-      free(keys);
+  keys = map->keys;
+  values = map->values;
+  if (json_map_reserve (map, &keys, &values, map->len, &map->_state, sizeof (char *), sizeof (int64_t)) != 0)
+    {
+      map->keys = keys;
+      map->values = values;
       return -1;
     }
+  map->keys = keys;
+  map->values = values;
 
-    if (map->len)
-    {
-        (void)memcpy (keys, map->keys, map->len * sizeof (char *));
-        (void)memcpy (vals, map->values, map->len * sizeof (int64_t));
-    }
-    free (map->keys);
-    map->keys = keys;
-    free (map->values);
-    map->values = vals;
-    map->keys[map->len] = strdup (key ? key : "");
-    map->values[map->len] = val;
+  new_key = strdup (key ? key : "");
+  if (new_key == NULL)
+    return -1;
 
-    map->len++;
-    return 0;
+  map->keys[map->len] = new_key;
+  map->values[map->len] = val;
+  map->len++;
+  return 0;
 }
 
 yajl_gen_status
@@ -1388,34 +2016,34 @@ gen_json_map_string_bool (void *ctx, const json_map_string_bool * map,
   if (map != NULL)
     len = map->len;
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 0);
-  stat = yajl_gen_map_open ((yajl_gen) g);
+    json_gen_beautify (g, 0);
+  stat = json_gen_map_open ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
   for (i = 0; i < len; i++)
     {
       stat =
-	yajl_gen_string ((yajl_gen) g, (const unsigned char *) (map->keys[i]),
+	json_gen_string ((yajl_gen) g, (const unsigned char *) (map->keys[i]),
 			 strlen (map->keys[i]));
       if (yajl_gen_status_ok != stat)
 	GEN_SET_ERROR_AND_RETURN (stat, err);
-      stat = yajl_gen_bool ((yajl_gen) g, (int) (map->values[i]));
+      stat = json_gen_bool ((yajl_gen) g, (int) (map->values[i]));
       if (yajl_gen_status_ok != stat)
 	GEN_SET_ERROR_AND_RETURN (stat, err);
     }
 
-  stat = yajl_gen_map_close ((yajl_gen) g);
+  stat = json_gen_map_close ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 1);
+    json_gen_beautify (g, 1);
   return yajl_gen_status_ok;
 }
 
 void
 free_json_map_string_bool (json_map_string_bool * map)
 {
-  if (map != NULL)
+  if (map != NULL && !json_arena_owns (map))
     {
       size_t i;
       for (i = 0; i < map->len; i++)
@@ -1428,6 +2056,8 @@ free_json_map_string_bool (json_map_string_bool * map)
       map->keys = NULL;
       free (map->values);
       map->values = NULL;
+      json_map_state_free (map->_state);
+      map->_state = NULL;
       free (map);
     }
 }
@@ -1442,24 +2072,23 @@ make_json_map_string_bool (yajl_val src, const struct parser_context *ctx,
   size_t i;
   size_t len;
 
-  (void) ctx;			/* Silence compiler warning.  */
 
   len = YAJL_GET_OBJECT_NO_CHECK (src)->len;
 
   if (src == NULL || YAJL_GET_OBJECT (src) == NULL)
     return NULL;
 
-  ret = smart_calloc (1, 0, sizeof (*ret));
+  ret = json_ctx_calloc (ctx, 1, 0, sizeof (*ret));
   if (ret == NULL)
     return NULL;
   ret->len = 0;
-  ret->keys = smart_calloc (len, 1, sizeof (char *));
+  ret->keys = json_ctx_calloc (ctx, len, 1, sizeof (char *));
   if (ret->keys == NULL)
     {
       return NULL;
     }
 
-  ret->values = smart_calloc (len, 1, sizeof (bool));
+  ret->values = json_ctx_calloc (ctx, len, 1, sizeof (bool));
   if (ret->values == NULL)
     {
       return NULL;
@@ -1473,7 +2102,7 @@ make_json_map_string_bool (yajl_val src, const struct parser_context *ctx,
       ret->values[i] = NULL;
       ret->len = i + 1;
 
-      ret->keys[i] = strdup (srckey ? srckey : "");
+      ret->keys[i] = json_ctx_strdup (ctx, srckey ? srckey : "");
       if (ret->keys[i] == NULL)
         {
           *(err) = strdup ("error allocating memory");
@@ -1503,49 +2132,29 @@ int
 append_json_map_string_bool (json_map_string_bool * map, const char *key,
 			     bool val)
 {
-  size_t len;
-  __auto_free char **keys = NULL;
-  __auto_free bool *vals = NULL;
-  __auto_free char *new_value;
+  void *keys, *values;
+  char *new_key;
 
   if (map == NULL)
     return -1;
 
-  if ((SIZE_MAX / sizeof (char *) - 1) < map->len
-      || (SIZE_MAX / sizeof (bool) - 1) < map->len)
-    return -1;
-
-  len = map->len + 1;
-  keys = smart_calloc (len, 0, sizeof (char *));
-  if (keys == NULL)
-    return -1;
-  vals = smart_calloc (len, 0, sizeof (bool));
-  if (vals == NULL)
+  keys = map->keys;
+  values = map->values;
+  if (json_map_reserve (map, &keys, &values, map->len, &map->_state, sizeof (char *), sizeof (bool)) != 0)
     {
+      map->keys = keys;
+      map->values = values;
       return -1;
     }
+  map->keys = keys;
+  map->values = values;
 
-  new_value = strdup (key ? key : "");
-  if (new_value == NULL)
-    {
-      return -1;
-    }
+  new_key = strdup (key ? key : "");
+  if (new_key == NULL)
+    return -1;
 
-  if (map->len)
-    {
-      (void) memcpy (keys, map->keys, map->len * sizeof (char *));
-      (void) memcpy (vals, map->values, map->len * sizeof (bool));
-    }
-  free (map->keys);
-  map->keys = keys;
-  keys = NULL;
-  free (map->values);
-  map->values = vals;
-  vals = NULL;
-  map->keys[map->len] = new_value;
-  new_value = NULL;
+  map->keys[map->len] = new_key;
   map->values[map->len] = val;
-
   map->len++;
   return 0;
 }
@@ -1562,39 +2171,39 @@ gen_json_map_string_string (void *ctx, const json_map_string_string * map,
     len = map->len;
 
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 0);
+    json_gen_beautify (g, 0);
 
-  stat = yajl_gen_map_open ((yajl_gen) g);
+  stat = json_gen_map_open ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
 
   for (i = 0; i < len; i++)
     {
       stat =
-	yajl_gen_string ((yajl_gen) g, (const unsigned char *) (map->keys[i]),
+	json_gen_string ((yajl_gen) g, (const unsigned char *) (map->keys[i]),
 			 strlen (map->keys[i]));
       if (yajl_gen_status_ok != stat)
 	GEN_SET_ERROR_AND_RETURN (stat, err);
       stat =
-	yajl_gen_string ((yajl_gen) g,
+	json_gen_string ((yajl_gen) g,
 			 (const unsigned char *) (map->values[i]),
 			 strlen (map->values[i]));
       if (yajl_gen_status_ok != stat)
 	GEN_SET_ERROR_AND_RETURN (stat, err);
     }
 
-  stat = yajl_gen_map_close ((yajl_gen) g);
+  stat = json_gen_map_close ((yajl_gen) g);
   if (yajl_gen_status_ok != stat)
     GEN_SET_ERROR_AND_RETURN (stat, err);
   if (!len && !(ptx->options & OPT_GEN_SIMPLIFY))
-    yajl_gen_config (g, yajl_gen_beautify, 1);
+    json_gen_beautify (g, 1);
   return yajl_gen_status_ok;
 }
 
 void
 free_json_map_string_string (json_map_string_string * map)
 {
-  if (map != NULL)
+  if (map != NULL && !json_arena_owns (map))
     {
       size_t i;
       for (i = 0; i < map->len; i++)
@@ -1608,6 +2217,8 @@ free_json_map_string_string (json_map_string_string * map)
       map->keys = NULL;
       free (map->values);
       map->values = NULL;
+      json_map_state_free (map->_state);
+      map->_state = NULL;
       free (map);
     }
 }
@@ -1622,13 +2233,12 @@ make_json_map_string_string (yajl_val src, const struct parser_context *ctx,
   size_t i;
   size_t len;
 
-  (void) ctx;			/* Silence compiler warning.  */
   if (src == NULL || YAJL_GET_OBJECT (src) == NULL)
     return NULL;
 
   len = YAJL_GET_OBJECT_NO_CHECK (src)->len;
 
-  ret = malloc (sizeof (*ret));
+  ret = json_ctx_calloc (ctx, 1, 0, sizeof (*ret));
   if (ret == NULL)
     {
       *(err) = strdup ("error allocating memory");
@@ -1637,14 +2247,14 @@ make_json_map_string_string (yajl_val src, const struct parser_context *ctx,
 
   ret->len = 0;
 
-  ret->keys = smart_calloc (len, 1, sizeof (char *));
+  ret->keys = json_ctx_calloc (ctx, len, 1, sizeof (char *));
   if (ret->keys == NULL)
     {
       *(err) = strdup ("error allocating memory");
       return NULL;
     }
 
-  ret->values = smart_calloc (len, 1, sizeof (char *));
+  ret->values = json_ctx_calloc (ctx, len, 1, sizeof (char *));
   if (ret->values == NULL)
     {
       *(err) = strdup ("error allocating memory");
@@ -1659,7 +2269,7 @@ make_json_map_string_string (yajl_val src, const struct parser_context *ctx,
       ret->values[i] = NULL;
       ret->len = i + 1;
 
-      ret->keys[i] = strdup (srckey ? srckey : "");
+      ret->keys[i] = json_ctx_strdup (ctx, srckey ? srckey : "");
       if (ret->keys[i] == NULL)
         {
           return NULL;
@@ -1679,7 +2289,7 @@ make_json_map_string_string (yajl_val src, const struct parser_context *ctx,
 
           str = YAJL_GET_STRING_NO_CHECK (srcval);
 
-          ret->values[i] = strdup (str ? str : "");
+          ret->values[i] = json_ctx_strdup (ctx, str ? str : "");
           if (ret->values[i] == NULL)
             {
               return NULL;
@@ -1693,62 +2303,92 @@ int
 append_json_map_string_string (json_map_string_string * map, const char *key,
 			       const char *val)
 {
-  size_t len, i;
-  __auto_free char **keys = NULL;
-  __auto_free char **values = NULL;
-  __auto_free char *new_key = NULL;
-  __auto_free char *new_value = NULL;
+  return json_map_string_string_put (map, key ? key : "", val);
+}
 
-  if (map == NULL)
-    return -1;
+const char *
+json_map_string_string_get (const json_map_string_string *map, const char *key)
+{
+  json_map_string_string *m = (json_map_string_string *) map;
+  size_t i;
 
-  for (i = 0; i < map->len; i++)
-    {
-      if (strcmp (map->keys[i], key) == 0)
-	{
-          char *v = strdup (val ? val : "");
-          if (v == NULL)
-            return -1;
-	  free (map->values[i]);
-	  map->values[i] = v;
-	  return 0;
-	}
-    }
+  if (map == NULL || key == NULL)
+    return NULL;
+  i = json_map_string_find (map, map->keys, map->values, map->len, &m->_state, key);
+  return i < map->len ? map->values[i] : NULL;
+}
 
-  if ((SIZE_MAX / sizeof (char *) - 1) < map->len)
-    return -1;
+int
+json_map_string_string_put (json_map_string_string *map, const char *key, const char *val)
+{
+  void *keys, *values;
+  char *new_key;
+  char *new_value;
+  size_t i;
 
-  new_key = strdup (key ? key : "");
-  if (new_key == NULL)
+  if (map == NULL || key == NULL)
     return -1;
 
   new_value = strdup (val ? val : "");
   if (new_value == NULL)
     return -1;
 
-  len = map->len + 1;
-  keys = realloc (map->keys, len * sizeof (char *));
-  if (keys == NULL)
-    return -1;
+  i = json_map_string_find (map, map->keys, map->values, map->len, &map->_state, key);
+  if (i < map->len)
+    {
+      free (map->values[i]);
+      map->values[i] = new_value;
+      return 0;
+    }
+
+  keys = map->keys;
+  values = map->values;
+  if (json_map_reserve (map, &keys, &values, map->len, &map->_state, sizeof (char *), sizeof (char *)) != 0)
+    {
+      map->keys = keys;
+      map->values = values;
+      free (new_value);
+      return -1;
+    }
   map->keys = keys;
-  keys = NULL;
-  map->keys[map->len] = NULL;
+  map->values = values;
 
-  values = realloc (map->values, len * sizeof (char *));
-  if (values == NULL)
-    return -1;
+  new_key = strdup (key);
+  if (new_key == NULL)
+    {
+      free (new_value);
+      return -1;
+    }
 
   map->keys[map->len] = new_key;
-  new_key = NULL;
-  map->values = values;
-  values = NULL;
   map->values[map->len] = new_value;
-  new_value = NULL;
-
+  json_map_index_add (map->_state, new_key, map->len);
   map->len++;
   return 0;
 }
 
+int
+json_map_string_string_del (json_map_string_string *map, const char *key)
+{
+  size_t i;
+
+  if (map == NULL || key == NULL)
+    return -1;
+
+  i = json_map_string_find (map, map->keys, map->values, map->len, &map->_state, key);
+  if (i == map->len || json_arena_owns (map))
+    return -1;
+
+  free (map->keys[i]);
+  free (map->values[i]);
+  (void) memmove (map->keys + i, map->keys + i + 1, (map->len - i - 1) * sizeof (char *));
+  (void) memmove (map->values + i, map->values + i + 1, (map->len - i - 1) * sizeof (char *));
+  map->len--;
+  /* positions past i moved, the next lookup rebuilds the index */
+  json_map_index_drop (map->_state);
+  return 0;
+}
+
 int
 dup_json_map_string_string(const json_map_string_string *src, json_map_string_string *dest)
 {
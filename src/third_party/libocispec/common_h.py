@@ -50,6 +50,7 @@ def generate_json_common_h(out):
 # include <stdio.h>
 # include <string.h>
 # include <stdint.h>
+# include <sys/types.h>
 # include <yajl/yajl_tree.h>
 # include <yajl/yajl_gen.h>
 
@@ -78,6 +79,15 @@ extern "C" {
 # define OPT_PARSE_FULLKEY 0x08
 // options not to validate utf8 data
 # define OPT_GEN_NO_VALIDATE_UTF8 0x10
+// options to parse with yajl callbacks straight into the structs, without a yajl tree
+# define OPT_PARSE_STREAM 0x20
+// options to keep the members marked lazy in the schema as yajl trees until their get_ accessor
+# define OPT_PARSE_LAZY 0x40
+// options to drive OPT_PARSE_STREAM from the vectorized front end when it is built, instead of yajl
+# define OPT_PARSE_SIMD 0x80
+// options to share the values of the members marked intern in the schema through the process wide
+// pool of json_intern, such values must not be changed or freed but by free_<type>
+# define OPT_PARSE_INTERN 0x100
 
 #define define_cleaner_function(type, cleaner)           \\
         static inline void cleaner##_function(type *ptr) \\
@@ -114,12 +124,82 @@ static inline void ptr_free_function(void *p) {
 
 typedef char *parser_error;
 
+// layout descriptor of a generated type, see json_desc.h
+struct json_type_desc;
+
+// bump allocator for parsed objects, see json_arena_new
+struct json_arena;
+
+// memory hooks of a parser_context, see json_alloc.c; a NULL hook falls back
+// to libc, the counters are kept either way
+struct json_allocator
+{
+  void *(*malloc) (void *opaque, size_t size);
+  void *(*calloc) (void *opaque, size_t count, size_t size);
+  void *(*realloc) (void *opaque, void *ptr, size_t size);
+  void (*free) (void *opaque, void *ptr);
+  void *opaque;
+  // bytes held, allocations made and the most bytes held at once
+  size_t bytes;
+  size_t count;
+  size_t peak;
+};
+
 struct parser_context
 {
   unsigned int options;
   FILE *errfile;
+  // when set, make_ allocates the parsed objects from it and free_ leaves them alone
+  struct json_arena *arena;
+  // when set, the yajl handles, the scratch buffers of the stream parser and
+  // the generators allocate from it; the parsed objects stay ordinary heap
+  // memory unless arena is set too, e.g. to json_arena_new_with (0, allocator)
+  struct json_allocator *allocator;
 };
 
+// malloc, calloc, realloc and free through the hooks of a, or libc if a is NULL
+void *json_alloc_malloc (struct json_allocator *a, size_t size);
+
+void *json_alloc_calloc (struct json_allocator *a, size_t count, size_t size);
+
+void *json_alloc_realloc (struct json_allocator *a, void *ptr, size_t size);
+
+void json_alloc_free (struct json_allocator *a, void *ptr);
+
+// start a new measurement: zero the allocation count, peak is the bytes held
+void json_allocator_reset (struct json_allocator *a);
+
+// fill afs with the hooks of a for yajl_alloc and yajl_gen_alloc, NULL if a is NULL
+yajl_alloc_funcs *json_allocator_yajl (struct json_allocator *a, yajl_alloc_funcs *afs);
+
+struct json_arena *json_arena_new (size_t chunk_size);
+
+// an arena whose chunks come from alloc
+struct json_arena *json_arena_new_with (size_t chunk_size, struct json_allocator *alloc);
+
+void *json_arena_alloc (struct json_arena *arena, size_t size);
+
+// hand the malloc'ed buffer ptr over to the arena, it is freed at the next reset
+int json_arena_adopt (struct json_arena *arena, void *ptr, size_t size);
+
+// make free_ of root free the whole arena, for arenas private to one parsed object
+void json_arena_bind (struct json_arena *arena, void *root);
+
+// run fn (ptr) at the next reset of the arena
+int json_arena_defer (struct json_arena *arena, void (*fn) (void *ptr), void *ptr);
+
+// release everything allocated from the arena, keeping one chunk for reuse
+void json_arena_reset (struct json_arena *arena);
+
+void json_arena_free (struct json_arena *arena);
+
+bool json_arena_owns (const void *ptr);
+
+// true if ptr must be left to its arena, which is freed when ptr is bound to it
+bool json_arena_release (void *ptr);
+
+yajl_gen_status gen_yajl_val (yajl_val obj, yajl_gen g, parser_error *err);
+
 yajl_gen_status gen_yajl_object_residual (yajl_val obj, yajl_gen g, parser_error *err);
 
 yajl_gen_status map_uint (void *ctx, long long unsigned int num);
@@ -128,12 +208,124 @@ yajl_gen_status map_int (void *ctx, long long int num);
 
 bool json_gen_init (yajl_gen * g, const struct parser_context *ctx);
 
+// buffered writer with the output of a yajl generator, see json_gen.c; the
+// json_gen_ primitives write to it and forward any other handle to yajl
+yajl_gen json_gen_writer_alloc (yajl_print_t print, void *ctx, bool beautify, bool validate_utf8,
+                                struct json_allocator *alloc);
+
+void json_gen_writer_flush (yajl_gen g);
+
+void json_gen_writer_free (yajl_gen g);
+
+void json_gen_beautify (yajl_gen g, int on);
+
+yajl_gen_status json_gen_map_open (yajl_gen g);
+
+yajl_gen_status json_gen_map_close (yajl_gen g);
+
+yajl_gen_status json_gen_array_open (yajl_gen g);
+
+yajl_gen_status json_gen_array_close (yajl_gen g);
+
+yajl_gen_status json_gen_null (yajl_gen g);
+
+yajl_gen_status json_gen_bool (yajl_gen g, int boolean);
+
+yajl_gen_status json_gen_number (yajl_gen g, const char *str, size_t len);
+
+yajl_gen_status json_gen_double (yajl_gen g, double number);
+
+yajl_gen_status json_gen_string (yajl_gen g, const unsigned char *str, size_t len);
+
+// a constant key that needs no escaping, copied as it is
+yajl_gen_status json_gen_key (yajl_gen g, const char *key, size_t len);
+
+// the members of the object tree whose key field_index does not know (all of
+// them if it is NULL) as the compact json text kept in _residual, "k":v,...;
+// *residual is NULL when there are none.  Returns -1 when out of memory.
+int json_residual_make (yajl_val tree, int (*field_index) (const char *key, size_t len),
+                        const struct parser_context *ctx, char **residual);
+
+// the members kept by json_residual_make as a yajl object
+yajl_val json_residual_tree (const char *residual);
+
+// writes the members kept by json_residual_make into the object being generated
+yajl_gen_status json_gen_residual (yajl_gen g, const char *residual, parser_error *err);
+
+// parser fed with a document in pieces, see the <type>_parser_ functions
+struct json_stream_parser;
+
+// drop a parser that is not finished, along with what it parsed
+void json_stream_parser_free (struct json_stream_parser *parser);
+
+struct __isula_buffer;
+
+// generates the json of ptr into g, the gen_<type> functions behind a common signature;
+// it emits through the json_gen_ primitives, the json_gen_to_ helpers pass a writer as g
+typedef yajl_gen_status (*json_gen_func) (yajl_gen g, const void *ptr, const struct parser_context *ctx,
+                                          parser_error *err);
+
+// the generated json as a string, without copying it out of the generator
+char *json_gen_to_string (json_gen_func gen, const void *ptr, const struct parser_context *ctx, parser_error *err);
+
+// write the generated json to fd through a bounded staging buffer
+int json_gen_to_fd (json_gen_func gen, const void *ptr, int fd, const struct parser_context *ctx, parser_error *err);
+
+// append the generated json to the isula_buffer buf
+int json_gen_to_buffer (json_gen_func gen, const void *ptr, struct __isula_buffer *buf,
+                        const struct parser_context *ctx, parser_error *err);
+
+// replace path with the generated json: write a temporary file, fsync it, rename it over path
+// and fsync the parent directory so that the rename itself is durable
+int json_gen_to_file_atomic (json_gen_func gen, const void *ptr, const char *path, mode_t mode,
+                             const struct parser_context *ctx, parser_error *err);
+
 yajl_val get_val (yajl_val tree, const char *name, yajl_type type);
 
+static inline yajl_val get_typed_val (yajl_val val, yajl_type type)
+{
+  return (val != NULL && val->type == type) ? val : NULL;
+}
+
 char *safe_strdup(const char *src);
 
 void *smart_calloc(size_t count, size_t extra, size_t unit_size);
 
+// smart_calloc and strdup from the arena of ctx, if any
+void *json_ctx_calloc (const struct parser_context *ctx, size_t count, size_t extra, size_t unit_size);
+
+char *json_ctx_strdup (const struct parser_context *ctx, const char *src);
+
+// the copy of the len bytes at str in the pool of interned strings, which lives as long as the
+// process; NULL if str is too long to be worth it, holds a NUL or memory is out
+const char *json_intern (const char *str, size_t len);
+
+// whether ptr is a string of the interned pool
+bool json_interned (const void *ptr);
+
+// free ptr, unless it is an interned string
+void json_intern_free (void *ptr);
+
+// src interned under OPT_PARSE_INTERN, else or if json_intern gives up a json_ctx_strdup copy
+char *json_ctx_intern (const struct parser_context *ctx, const char *src);
+
+// number of strings and bytes held by the interned pool
+void json_intern_stats (size_t *strings, size_t *bytes);
+
+// yajl_tree_parse of the len bytes at jsondata, copied first unless terminated
+// tells that jsondata[len] is a NUL
+yajl_val json_tree_parse (const char *jsondata, size_t len, bool terminated, char *errbuf, size_t errbuf_size);
+
+typedef void *(*json_parse_file_func) (const char *filename, const struct parser_context *ctx, parser_error *err);
+
+// parse the n files of paths with parse on a pool of nthreads workers (one per
+// cpu if 0), out[i] and errs[i] are the result of paths[i]; errs may be NULL.
+// The workers are kept for the next call.  Arenas are single threaded, so the
+// arena of ctx is not used.
+// Returns 0 if every file was parsed.
+int json_parse_files_parallel (const char **paths, size_t n, size_t nthreads, json_parse_file_func parse,
+                               const struct parser_context *ctx, void **out, parser_error *errs);
+
 int common_safe_double (const char *numstr, double *converted);
 
 int common_safe_uint8 (const char *numstr, uint8_t * converted);
@@ -156,15 +348,26 @@ int common_safe_int64 (const char *numstr, int64_t * converted);
 
 int common_safe_int (const char *numstr, int *converted);
 
+/* The json_map_* types keep len entries in their keys and values arrays.
+   _state is private to the map functions: the spare capacity of the arrays
+   and the hash index of the string keys of a large map.  It records the
+   arrays it describes and is dropped as soon as they, or len, no longer
+   match it, so code replacing or resizing the arrays itself stays safe.
+   Maps are released with their free_json_map_* function.  */
+struct json_map_state;
+
 typedef struct
 {
   int *keys;
   int *values;
   size_t len;
+  struct json_map_state *_state;
 } json_map_int_int;
 
 void free_json_map_int_int (json_map_int_int * map);
 
+json_map_int_int *clone_json_map_int_int (const json_map_int_int *src);
+
 json_map_int_int *make_json_map_int_int (yajl_val src,
 					 const struct parser_context *ctx,
 					 parser_error * err);
@@ -180,10 +383,13 @@ typedef struct
   int *keys;
   bool *values;
   size_t len;
+  struct json_map_state *_state;
 } json_map_int_bool;
 
 void free_json_map_int_bool (json_map_int_bool * map);
 
+json_map_int_bool *clone_json_map_int_bool (const json_map_int_bool *src);
+
 json_map_int_bool *make_json_map_int_bool (yajl_val src,
 					   const struct parser_context *ctx,
 					   parser_error * err);
@@ -200,10 +406,13 @@ typedef struct
   int *keys;
   char **values;
   size_t len;
+  struct json_map_state *_state;
 } json_map_int_string;
 
 void free_json_map_int_string (json_map_int_string * map);
 
+json_map_int_string *clone_json_map_int_string (const json_map_int_string *src);
+
 json_map_int_string *make_json_map_int_string (yajl_val src,
 					       const struct parser_context
 					       *ctx, parser_error * err);
@@ -221,10 +430,13 @@ typedef struct
   char **keys;
   int *values;
   size_t len;
+  struct json_map_state *_state;
 } json_map_string_int;
 
 void free_json_map_string_int (json_map_string_int * map);
 
+json_map_string_int *clone_json_map_string_int (const json_map_string_int *src);
+
 json_map_string_int *make_json_map_string_int (yajl_val src,
 					       const struct parser_context
 					       *ctx, parser_error * err);
@@ -242,10 +454,13 @@ typedef struct
   char **keys;
   bool *values;
   size_t len;
+  struct json_map_state *_state;
 } json_map_string_bool;
 
 void free_json_map_string_bool (json_map_string_bool * map);
 
+json_map_string_bool *clone_json_map_string_bool (const json_map_string_bool *src);
+
 json_map_string_bool *make_json_map_string_bool (yajl_val src,
 						 const struct parser_context
 						 *ctx, parser_error * err);
@@ -255,10 +470,13 @@ typedef struct
     char **keys;
     int64_t *values;
     size_t len;
+    struct json_map_state *_state;
 } json_map_string_int64;
 
 void free_json_map_string_int64 (json_map_string_int64 *map);
 
+json_map_string_int64 *clone_json_map_string_int64 (const json_map_string_int64 *src);
+
 json_map_string_int64 *make_json_map_string_int64 (yajl_val src,
                                                    const struct
                                                    parser_context *ctx,
@@ -284,10 +502,13 @@ typedef struct
   char **keys;
   char **values;
   size_t len;
+  struct json_map_state *_state;
 } json_map_string_string;
 
 void free_json_map_string_string (json_map_string_string * map);
 
+json_map_string_string *clone_json_map_string_string (const json_map_string_string *src);
+
 json_map_string_string *make_json_map_string_string (yajl_val src,
 						     const struct
 						     parser_context *ctx,
@@ -304,6 +525,16 @@ int append_json_map_string_string (json_map_string_string * map,
 
 int dup_json_map_string_string(const json_map_string_string *src, json_map_string_string *dest);
 
+/* value of key in map, NULL if it is missing; the first lookup of a large
+   map builds its index, so concurrent readers need their own lock */
+const char *json_map_string_string_get (const json_map_string_string *map, const char *key);
+
+/* set key to a copy of val, replacing the previous value if any */
+int json_map_string_string_put (json_map_string_string *map, const char *key, const char *val);
+
+/* remove key, keeping the order of the other entries; -1 if it is missing */
+int json_map_string_string_del (json_map_string_string *map, const char *key);
+
 char *json_marshal_string (const char *str, size_t length,
 			   const struct parser_context *ctx,
 			   parser_error * err);
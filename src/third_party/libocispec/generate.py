@@ -575,6 +575,15 @@ def parse_dict(schema_info, name, schema, objs, curfile):
     for i in objs:
         node, _ = resolve_type(schema_info, name.append(i), schema, objs[i], curfile)
         if node:
+            if objs[i].get('lazy', False):
+                if node.typ not in ('object', 'mapStringObject') and \
+                        (node.typ != 'array' or node.subtyp == 'byte'):
+                    raise RuntimeError("Lazy member %s must be an object or an array" % i)
+                node.lazy = True
+            if objs[i].get('intern', False):
+                if node.typ != 'string' and (node.typ != 'array' or node.subtyp != 'string'):
+                    raise RuntimeError("Interned member %s must be a string or an array of strings" % i)
+                node.intern = True
             obj.append(node)
     if not obj:
         obj = None
@@ -690,10 +699,12 @@ def expand(tree, structs, visited):
 
 def reflection(schema_info, gen_ref):
     """
-    Description: generate c language for parse json map string object
+    Description: generate c language for parse json map string object, returns
+                 the bytes saved by the struct member ordering
     Interface: None
     History: 2019-06-17
     """
+    saved = 0
     with open(schema_info.header.name, "w") as \
             header_file, open(schema_info.source.name, "w") as source_file:
         fcntl.flock(header_file, fcntl.LOCK_EX)
@@ -707,7 +718,7 @@ def reflection(schema_info, gen_ref):
                     print("Failed parse schema")
                     sys.exit(1)
                 structs = expand(tree, [], {})
-                headers.header_reflect(structs, schema_info, header_file)
+                saved = headers.header_reflect(structs, schema_info, header_file)
                 sources.src_reflect(structs, schema_info, source_file, tree.typ)
             except RuntimeError:
                 traceback.print_exc()
@@ -723,6 +734,7 @@ def reflection(schema_info, gen_ref):
         if schema_info.refs:
             for reffile in schema_info.refs.values():
                 reflection(reffile, True)
+    return saved
 
 
 def gen_common_files(out):
@@ -752,21 +764,24 @@ def handle_single_file(args, srcpath, gen_ref, schemapath):
                     if target_file.endswith(JSON_SUFFIX):
                         schema_info = schema_from_file(os.path.join(dirpath, target_file), \
                                                        srcpath.name)
-                        reflection(schema_info, gen_ref)
-                        print("\033[1;34mReflection:\033[0m\t%-60s \033[1;32mSuccess\033[0m" % (target_file))
+                        saved = reflection(schema_info, gen_ref)
+                        print("\033[1;34mReflection:\033[0m\t%-60s \033[1;32mSuccess\033[0m (%d bytes saved by layout)" % \
+                              (target_file, saved))
         else:
             # only parse files in current direcotory
             for target_file in os.listdir(schemapath.name):
                 fullpath = os.path.join(schemapath.name, target_file)
                 if fullpath.endswith(JSON_SUFFIX) and os.path.isfile(fullpath):
                     schema_info = schema_from_file(fullpath, srcpath.name)
-                    reflection(schema_info, gen_ref)
-                    print("\033[1;34mReflection:\033[0m\t%-60s \033[1;32mSuccess\033[0m" % (fullpath))
+                    saved = reflection(schema_info, gen_ref)
+                    print("\033[1;34mReflection:\033[0m\t%-60s \033[1;32mSuccess\033[0m (%d bytes saved by layout)" % \
+                          (fullpath, saved))
     else:
         if schemapath.name.endswith(JSON_SUFFIX):
             schema_info = schema_from_file(schemapath.name, srcpath.name)
-            reflection(schema_info, gen_ref)
-            print("\033[1;34mReflection:\033[0m\t%-60s \033[1;32mSuccess\033[0m" % (schemapath.name))
+            saved = reflection(schema_info, gen_ref)
+            print("\033[1;34mReflection:\033[0m\t%-60s \033[1;32mSuccess\033[0m (%d bytes saved by layout)" % \
+                  (schemapath.name, saved))
         else:
             print('File %s is not ends with .json' % schemapath.name)
 
@@ -813,6 +828,9 @@ def main():
     parser.add_argument(
         '--out',
         help='Specify a directory to save C header and source(default is current directory)')
+    parser.add_argument('--tables',
+                        action='store_true',
+                        help='Parse, generate and free objects with the generic code of json_table.c')
     args = parser.parse_args()
 
     if not args.root:
@@ -825,6 +843,7 @@ def main():
         sys.exit(1)
 
     MyRoot.root_path = root_path
+    sources.TABLE_MODE = args.tables
 
     if args.out:
         srcpath = helpers.FilePath(args.out)
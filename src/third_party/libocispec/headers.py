@@ -26,9 +26,99 @@
 # special exception, which will cause the skeleton and the resulting
 # libocispec output files to be licensed under the GNU General Public
 # License without this special exception.
+import os
 import helpers
 
-def append_header_arr(obj, header, prefix):
+# LP64 size (and alignment) of the member types the generator emits, anything
+# spelled with a '*' is a pointer
+MEMBER_SIZES = {
+    'bool': 1, 'char': 1, 'int8_t': 1, 'uint8_t': 1,
+    'int16_t': 2, 'uint16_t': 2,
+    'int': 4, 'int32_t': 4, 'uint32_t': 4, 'uid_t': 4, 'gid_t': 4,
+    'double': 8, 'int64_t': 8, 'uint64_t': 8, 'size_t': 8, 'yajl_val': 8,
+}
+
+
+class StructMembers(object):
+    '''
+    Description: Collect the member declarations of a struct, so that they can
+                 be emitted ordered by alignment instead of schema order
+    Interface: None
+    History: 2026-10-18
+    '''
+    def __init__(self):
+        self.members = []
+
+    def write(self, decl):
+        '''
+        Description: Add one member declaration
+        Interface: None
+        History: 2026-10-18
+        '''
+        self.members.append(decl)
+
+
+def member_size(decl):
+    '''
+    Description: Get size of a member declaration
+    Interface: None
+    History: 2026-10-18
+    '''
+    if '*' in decl:
+        return 8
+    return MEMBER_SIZES.get(decl.split()[0], 8)
+
+
+def struct_size(members):
+    '''
+    Description: Get size of a struct with the members laid out in order
+    Interface: None
+    History: 2026-10-18
+    '''
+    offset = 0
+    align = 1
+    for decl in members:
+        size = member_size(decl)
+        offset = (offset + size - 1) // size * size + size
+        align = max(align, size)
+    return (offset + align - 1) // align * align
+
+
+def write_struct_members(members, typename, header, layout):
+    '''
+    Description: Write the members of a struct, widest alignment first, and
+                 record the bytes this saves over schema order
+    Interface: None
+    History: 2026-10-18
+    '''
+    packed = sorted(members.members, key=member_size, reverse=True)
+    for decl in packed:
+        header.write(decl)
+    if layout is not None:
+        layout.append((typename, struct_size(members.members), struct_size(packed)))
+
+
+def write_layout_report(schema_info, layout):
+    '''
+    Description: Write the bytes saved per type by the member ordering next to
+                 the generated header
+    Interface: None
+    History: 2026-10-18
+    '''
+    report = os.path.splitext(schema_info.header.name)[0] + "_layout.txt"
+    saved = 0
+    with open(report, "w") as out:
+        out.write("# Generated from %s. Do not edit!\n" % (schema_info.name.basename))
+        out.write("# struct sizes in bytes on LP64: schema order, emitted, saved\n")
+        for typename, before, after in layout:
+            out.write("%-60s %6d %6d %6d\n" % (typename, before, after, before - after))
+            saved += before - after
+        out.write("%-60s %6d %6d %6d\n" % ("total", sum(i[1] for i in layout), \
+            sum(i[2] for i in layout), saved))
+    return saved
+
+
+def append_header_arr(obj, header, prefix, layout=None):
     '''
     Description: Write c header file of array
     Interface: None
@@ -38,6 +128,7 @@ def append_header_arr(obj, header, prefix):
         return
 
     header.write("typedef struct {\n")
+    members = StructMembers()
     for i in obj.subtypobj:
         if i.typ == 'array':
             c_typ = helpers.get_prefixed_pointer(i.name, i.subtyp, prefix) or \
@@ -46,20 +137,23 @@ def append_header_arr(obj, header, prefix):
                 c_typ = helpers.get_name_substr(i.name, prefix)
 
             if not helpers.judge_complex(i.subtyp):
-                header.write("    %s%s*%s;\n" % (c_typ, " " if '*' not in c_typ else "", \
+                members.write("    %s%s*%s;\n" % (c_typ, " " if '*' not in c_typ else "", \
                     i.fixname))
             else:
-                header.write("    %s **%s;\n" % (c_typ, i.fixname))
-            header.write("    size_t %s;\n\n" % (i.fixname + "_len"))
+                members.write("    %s **%s;\n" % (c_typ, i.fixname))
+            members.write("    size_t %s;\n\n" % (i.fixname + "_len"))
         else:
             c_typ = helpers.get_prefixed_pointer(i.name, i.typ, prefix) or \
                 helpers.get_map_c_types(i.typ)
-            header.write("    %s%s%s;\n" % (c_typ, " " if '*' not in c_typ else "", i.fixname))
+            members.write("    %s%s%s;\n" % (c_typ, " " if '*' not in c_typ else "", i.fixname))
     typename = helpers.get_name_substr(obj.name, prefix)
+    write_struct_members(members, typename, header, layout)
     header.write("}\n%s;\n\n" % typename)
     header.write("void free_%s (%s *ptr);\n\n" % (typename, typename))
     header.write("%s *make_%s (yajl_val tree, const struct parser_context *ctx, parser_error *err);"\
         "\n\n" % (typename, typename))
+    header.write("extern const struct json_type_desc desc_%s;\n\n" % typename)
+    header_desc_functions(typename, header)
 
 
 def append_header_map_str_obj(obj, header, prefix):
@@ -131,7 +225,7 @@ def append_header_child_others(child, header, prefix):
     header.write("    %s%s%s;\n\n" % (c_typ, " " if '*' not in c_typ else "", child.fixname))
 
 
-def append_type_c_header(obj, header, prefix):
+def append_type_c_header(obj, header, prefix, layout=None):
     '''
     Description: Write c header file
     Interface: None
@@ -141,7 +235,7 @@ def append_type_c_header(obj, header, prefix):
         return
 
     if obj.typ == 'array':
-        append_header_arr(obj, header, prefix)
+        append_header_arr(obj, header, prefix, layout)
         return
 
     if obj.typ == 'mapStringObject':
@@ -154,13 +248,17 @@ def append_type_c_header(obj, header, prefix):
         header.write("typedef struct {\n")
         if obj.children is None:
             header.write("    char unuseful; // unuseful definition to avoid empty struct\n")
+        members = StructMembers()
         for i in obj.children or []:
             if i.typ == 'array':
-                append_header_child_arr(i, header, prefix)
+                append_header_child_arr(i, members, prefix)
             else:
-                append_header_child_others(i, header, prefix)
+                append_header_child_others(i, members, prefix)
         if obj.children is not None:
-            header.write("    yajl_val _residual;\n")
+            members.write("    char *_residual;\n")
+        if helpers.lazy_fields(obj):
+            members.write("    yajl_val _lazy;\n")
+        write_struct_members(members, helpers.get_prefixed_name(obj.name, prefix), header, layout)
     typename = helpers.get_prefixed_name(obj.name, prefix)
     header.write("}\n%s;\n\n" % typename)
     header.write("void free_%s (%s *ptr);\n\n" % (typename, typename))
@@ -168,6 +266,11 @@ def append_type_c_header(obj, header, prefix):
         ";\n\n" % (typename, typename))
     header.write("yajl_gen_status gen_%s (yajl_gen g, const %s *ptr, const struct parser_context "\
         "*ctx, parser_error *err);\n\n" % (typename, typename))
+    header.write("extern const struct json_type_desc desc_%s;\n\n" % typename)
+    header_desc_functions(typename, header)
+    for _, i in helpers.lazy_fields(obj):
+        header.write("int get_%s_%s (%s *ptr, const struct parser_context *ctx, parser_error *err);\n\n" \
+            % (typename, i.fixname, typename))
 
 def header_reflect_top_array(obj, prefix, header):
     c_typ = helpers.get_prefixed_pointer(obj.name, obj.subtyp, prefix) or \
@@ -192,14 +295,91 @@ def header_reflect_top_array(obj, prefix, header):
 
 
     header.write("void free_%s (%s *ptr);\n\n" % (typename, typename))
+    if helpers.desc_supported_top_array(obj):
+        header.write("extern const struct json_type_desc desc_%s;\n\n" % typename)
+        header_desc_functions(typename, header)
     header.write("%s *%s_parse_file(const char *filename, const struct "\
         "parser_context *ctx, parser_error *err);\n\n" % (typename, typename))
+    header_parse_files_parallel(typename, header)
     header.write("%s *%s_parse_file_stream(FILE *stream, const struct "\
         "parser_context *ctx, parser_error *err);\n\n" % (typename, typename))
     header.write("%s *%s_parse_data(const char *jsondata, const struct "\
         "parser_context *ctx, parser_error *err);\n\n" % (typename, typename))
+    header.write("%s *%s_parse_data_len(const char *jsondata, size_t len, const struct "\
+        "parser_context *ctx, parser_error *err);\n\n" % (typename, typename))
+    if helpers.desc_supported_top_array(obj):
+        header.write("%s *%s_parse_data_insitu(char *jsondata, const struct "\
+            "parser_context *ctx, parser_error *err);\n\n" % (typename, typename))
+    header_generate_json(typename, header)
+    if helpers.desc_supported_top_array(obj):
+        header_binary(typename, header)
+        header_push_parser(typename, header)
+
+def header_desc_functions(typename, header):
+    '''
+    Description: generate prototypes of the functions built on the layout descriptor
+    Interface: None
+    History: 2026-10-18
+    '''
+    header.write("%s *clone_%s (const %s *src);\n\n" % (typename, typename, typename))
+    header.write("bool equal_%s (const %s *a, const %s *b);\n\n" % (typename, typename, typename))
+    header.write("uint64_t hash_%s (const %s *ptr);\n\n" % (typename, typename))
+    header.write("char *diff_%s (const %s *a, const %s *b, const struct parser_context *ctx, "\
+        "parser_error *err);\n\n" % (typename, typename, typename))
+    header.write("%s *apply_merge_patch_%s (const %s *ptr, const char *patch, "\
+        "const struct parser_context *ctx, parser_error *err);\n\n" % (typename, typename, typename))
+
+def header_parse_files_parallel(typename, header):
+    '''
+    Description: generate the prototype of the parallel parse of many files
+    Interface: None
+    History: 2026-10-18
+    '''
+    header.write("int %s_parse_files_parallel(const char **paths, size_t n, size_t nthreads, "\
+        "const struct parser_context *ctx, %s **out, parser_error *errs);\n\n" % (typename, typename))
+
+def header_binary(typename, header):
+    '''
+    Description: generate binary encoding prototypes
+    Interface: None
+    History: 2026-10-18
+    '''
+    header.write("int %s_encode_binary(const %s *ptr, uint8_t **data, size_t *len, "\
+        "parser_error *err);\n\n" % (typename, typename))
+    header.write("%s *%s_decode_binary(const uint8_t *data, size_t len, "\
+        "const struct parser_context *ctx, parser_error *err);\n\n" % (typename, typename))
+    header.write("%s *%s_decode_binary_file(const char *path, "\
+        "const struct parser_context *ctx, parser_error *err);\n\n" % (typename, typename))
+
+def header_push_parser(typename, header):
+    '''
+    Description: generate the prototypes of the parser fed in pieces
+    Interface: None
+    History: 2026-10-18
+    '''
+    header.write("struct json_stream_parser *%s_parser_new(const struct parser_context *ctx, "\
+        "size_t max_size);\n\n" % (typename))
+    header.write("int %s_parser_feed(struct json_stream_parser *parser, const char *buf, size_t len, "\
+        "parser_error *err);\n\n" % (typename))
+    header.write("int %s_parser_feed_fd(struct json_stream_parser *parser, int fd, "\
+        "parser_error *err);\n\n" % (typename))
+    header.write("%s *%s_parser_finish(struct json_stream_parser *parser, "\
+        "parser_error *err);\n\n" % (typename, typename))
+
+def header_generate_json(typename, header):
+    '''
+    Description: generate json output prototypes
+    Interface: None
+    History: 2026-10-18
+    '''
     header.write("char *%s_generate_json(const %s *ptr, "\
         "const struct parser_context *ctx, parser_error *err);\n\n" % (typename, typename))
+    header.write("int %s_generate_json_fd(const %s *ptr, int fd, "\
+        "const struct parser_context *ctx, parser_error *err);\n\n" % (typename, typename))
+    header.write("int %s_generate_json_to_buffer(const %s *ptr, struct __isula_buffer *buf, "\
+        "const struct parser_context *ctx, parser_error *err);\n\n" % (typename, typename))
+    header.write("int %s_generate_json_file_atomic(const %s *ptr, const char *path, mode_t mode, "\
+        "const struct parser_context *ctx, parser_error *err);\n\n" % (typename, typename))
 
 def header_reflect(structs, schema_info, header):
     '''
@@ -209,6 +389,8 @@ def header_reflect(structs, schema_info, header):
     '''
     prefix = schema_info.prefix
     header.write("// Generated from %s. Do not edit!\n" % (schema_info.name.basename))
+    header.write("// The struct members are ordered by alignment, not as in the schema, and the\n")
+    header.write("// order changes with the schema: initialize them by name, never by position.\n")
     header.write("#ifndef %s_SCHEMA_H\n" % prefix.upper())
     header.write("#define %s_SCHEMA_H\n\n" % prefix.upper())
     header.write("#include <sys/types.h>\n")
@@ -221,19 +403,29 @@ def header_reflect(structs, schema_info, header):
     header.write("extern \"C\" {\n")
     header.write("#endif\n\n")
 
+    layout = []
     for i in structs:
-        append_type_c_header(i, header, prefix)
+        append_type_c_header(i, header, prefix, layout)
+    saved = write_layout_report(schema_info, layout)
     length = len(structs)
     toptype = structs[length - 1].typ if length != 0 else ""
     if toptype == 'object':
         header.write("%s *%s_parse_file(const char *filename, const struct parser_context *ctx, "\
             "parser_error *err);\n\n" % (prefix, prefix))
+        header_parse_files_parallel(prefix, header)
         header.write("%s *%s_parse_file_stream(FILE *stream, const struct parser_context *ctx, "\
             "parser_error *err);\n\n" % (prefix, prefix))
         header.write("%s *%s_parse_data(const char *jsondata, const struct parser_context *ctx, "\
             "parser_error *err);\n\n" % (prefix, prefix))
-        header.write("char *%s_generate_json(const %s *ptr, const struct parser_context *ctx, "\
+        header.write("%s *%s_parse_data_len(const char *jsondata, size_t len, const struct parser_context *ctx, "\
+            "parser_error *err);\n\n" % (prefix, prefix))
+        header.write("%s *%s_parse_data_insitu(char *jsondata, const struct parser_context *ctx, "\
             "parser_error *err);\n\n" % (prefix, prefix))
+        header.write("%s *%s_parse_data_paths(const char *jsondata, const char **json_pointers, "\
+            "const struct parser_context *ctx, parser_error *err);\n\n" % (prefix, prefix))
+        header_generate_json(prefix, header)
+        header_binary(prefix, header)
+        header_push_parser(prefix, header)
     elif toptype == 'array':
         header_reflect_top_array(structs[length - 1], prefix, header)
 
@@ -241,3 +433,4 @@ def header_reflect(structs, schema_info, header):
     header.write("}\n")
     header.write("#endif\n\n")
     header.write("#endif\n\n")
+    return saved
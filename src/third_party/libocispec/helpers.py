@@ -145,6 +145,33 @@ def get_top_array_type_name(name, prefix):
     return "%s_container" % prefix if name is None or name == "" or prefix == name \
         else "%s_%s_container" % (prefix, name)
 
+def desc_supported_top_array(obj):
+    '''
+    Description: Check top array type has a layout descriptor, byte strings have none
+    Interface: None
+    History: 2026-10-18
+    '''
+    return obj.subtyp != 'byte'
+
+def lazy_fields(obj):
+    '''
+    Description: Members of an object decoded on first access under OPT_PARSE_LAZY,
+                 as (slot, node) pairs
+    Interface: None
+    History: 2026-10-18
+    '''
+    if obj.typ != 'object' or obj.subtypname:
+        return []
+    return [(slot, i) for slot, i in enumerate(obj.children or []) if i.lazy]
+
+def lazy_yajl_type(node):
+    '''
+    Description: yajl type of the value kept for a lazy member
+    Interface: None
+    History: 2026-10-18
+    '''
+    return 'yajl_t_array' if node.typ == 'array' else 'yajl_t_object'
+
 def get_name_substr(name, prefix):
     '''
     Description: Make array name
@@ -265,6 +292,8 @@ class Unite(object):
     def __init__(self, name, typ, children, subtyp=None, subtypobj=None, subtypname=None, \
         required=None, doublearray=False):
         self.typ = typ
+        self.lazy = False
+        self.intern = False
         self.children = children
         self.subtyp = subtyp
         self.subtypobj = subtypobj
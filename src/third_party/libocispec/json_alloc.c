@@ -0,0 +1,220 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+
+/* Allocator behind parser_context.allocator.  Every block carries its size
+   in front of it, so that free and realloc keep the counters right for the
+   hooks as well as for libc, and yajl handles can be pointed at the same
+   hooks through json_allocator_yajl.  The counters are updated atomically,
+   as a context may be shared by the workers of json_parse_files_parallel;
+   the hooks have to be thread safe for the same reason.  */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "json_common.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* keeps the block after it aligned as malloc would */
+#define ALLOC_HEADER 16
+
+static void
+account (struct json_allocator *a, size_t size)
+{
+  size_t bytes = __atomic_add_fetch (&a->bytes, size, __ATOMIC_RELAXED);
+  size_t peak = __atomic_load_n (&a->peak, __ATOMIC_RELAXED);
+
+  (void) __atomic_add_fetch (&a->count, 1, __ATOMIC_RELAXED);
+  while (bytes > peak
+         && !__atomic_compare_exchange_n (&a->peak, &peak, bytes, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    ;
+}
+
+static void
+unaccount (struct json_allocator *a, size_t size)
+{
+  (void) __atomic_sub_fetch (&a->bytes, size, __ATOMIC_RELAXED);
+}
+
+static void *
+raw_malloc (struct json_allocator *a, size_t size)
+{
+  if (a->malloc != NULL)
+    return a->malloc (a->opaque, size);
+  return malloc (size);
+}
+
+static void
+raw_free (struct json_allocator *a, void *ptr)
+{
+  if (a->free != NULL)
+    a->free (a->opaque, ptr);
+  else
+    free (ptr);
+}
+
+static void *
+block_of (void *raw, size_t size)
+{
+  if (raw == NULL)
+    return NULL;
+  *(size_t *) raw = size;
+  return (unsigned char *) raw + ALLOC_HEADER;
+}
+
+static size_t
+size_of (void *ptr)
+{
+  return *(size_t *) ((unsigned char *) ptr - ALLOC_HEADER);
+}
+
+void *
+json_alloc_malloc (struct json_allocator *a, size_t size)
+{
+  void *ret;
+
+  if (a == NULL)
+    return malloc (size);
+  if (size > SIZE_MAX - ALLOC_HEADER)
+    return NULL;
+  ret = block_of (raw_malloc (a, ALLOC_HEADER + size), size);
+  if (ret != NULL)
+    account (a, size);
+  return ret;
+}
+
+void *
+json_alloc_calloc (struct json_allocator *a, size_t count, size_t size)
+{
+  void *ret;
+
+  if (a == NULL)
+    return calloc (count, size);
+  if (size != 0 && count > (SIZE_MAX - ALLOC_HEADER) / size)
+    return NULL;
+  if (a->calloc != NULL)
+    ret = block_of (a->calloc (a->opaque, 1, ALLOC_HEADER + count * size), count * size);
+  else
+    {
+      ret = block_of (raw_malloc (a, ALLOC_HEADER + count * size), count * size);
+      if (ret != NULL)
+        (void) memset (ret, 0, count * size);
+    }
+  if (ret != NULL)
+    account (a, count * size);
+  return ret;
+}
+
+void *
+json_alloc_realloc (struct json_allocator *a, void *ptr, size_t size)
+{
+  size_t old;
+  void *raw;
+
+  if (a == NULL)
+    return realloc (ptr, size);
+  if (ptr == NULL)
+    return json_alloc_malloc (a, size);
+  if (size > SIZE_MAX - ALLOC_HEADER)
+    return NULL;
+
+  old = size_of (ptr);
+  if (a->realloc != NULL)
+    raw = a->realloc (a->opaque, (unsigned char *) ptr - ALLOC_HEADER, ALLOC_HEADER + size);
+  else if (a->malloc == NULL && a->free == NULL)
+    raw = realloc ((unsigned char *) ptr - ALLOC_HEADER, ALLOC_HEADER + size);
+  else
+    {
+      raw = raw_malloc (a, ALLOC_HEADER + size);
+      if (raw == NULL)
+        return NULL;
+      (void) memcpy ((unsigned char *) raw + ALLOC_HEADER, ptr, old < size ? old : size);
+      raw_free (a, (unsigned char *) ptr - ALLOC_HEADER);
+    }
+  if (raw == NULL)
+    return NULL;
+  unaccount (a, old);
+  account (a, size);
+  return block_of (raw, size);
+}
+
+void
+json_alloc_free (struct json_allocator *a, void *ptr)
+{
+  if (ptr == NULL)
+    return;
+  if (a == NULL)
+    {
+      free (ptr);
+      return;
+    }
+  unaccount (a, size_of (ptr));
+  raw_free (a, (unsigned char *) ptr - ALLOC_HEADER);
+}
+
+void
+json_allocator_reset (struct json_allocator *a)
+{
+  __atomic_store_n (&a->count, 0, __ATOMIC_RELAXED);
+  __atomic_store_n (&a->peak, __atomic_load_n (&a->bytes, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+static void *
+yajl_malloc_hook (void *ctx, size_t size)
+{
+  return json_alloc_malloc (ctx, size);
+}
+
+static void *
+yajl_realloc_hook (void *ctx, void *ptr, size_t size)
+{
+  return json_alloc_realloc (ctx, ptr, size);
+}
+
+static void
+yajl_free_hook (void *ctx, void *ptr)
+{
+  json_alloc_free (ctx, ptr);
+}
+
+yajl_alloc_funcs *
+json_allocator_yajl (struct json_allocator *a, yajl_alloc_funcs *afs)
+{
+  if (a == NULL)
+    return NULL;
+  afs->malloc = yajl_malloc_hook;
+  afs->realloc = yajl_realloc_hook;
+  afs->free = yajl_free_hook;
+  afs->ctx = a;
+  return afs;
+}
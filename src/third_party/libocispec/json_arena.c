@@ -0,0 +1,401 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+
+/* Arena backing parser_context.arena: a chain of chunks served by a bump
+   pointer.  Everything make_<type> allocates for a parse comes from it, and
+   the whole result goes away with one json_arena_reset or json_arena_free.
+   The chunks of the live arenas are registered in a table sorted by
+   address, so that free_<type> can tell an arena owned object apart with a
+   binary search and leave it alone, or free the whole arena when it was
+   bound to that object.  The chunks and the arena itself come from the
+   allocator given to json_arena_new_with, if any.  */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "json_common.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ARENA_ALIGN 16
+#define ARENA_CHUNK_SIZE (64 * 1024)
+/* chunks double up to this many times the initial size */
+#define ARENA_MAX_GROWTH 64
+
+struct json_arena_chunk
+{
+  struct json_arena_chunk *next;
+  unsigned char *data;
+  size_t size;
+  size_t used;
+  /* holds a single allocation larger than a regular chunk */
+  bool dedicated;
+  /* data is a buffer handed over by json_arena_adopt */
+  bool adopted;
+};
+
+#define CHUNK_HEADER ((sizeof (struct json_arena_chunk) + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1))
+#define CHUNK_DATA(chunk) ((chunk)->data)
+
+struct json_arena_cleanup
+{
+  struct json_arena_cleanup *next;
+  void (*fn) (void *ptr);
+  void *ptr;
+};
+
+struct json_arena
+{
+  /* the chunk being filled comes first */
+  struct json_arena_chunk *chunks;
+  size_t chunk_size;
+  size_t next_size;
+  struct json_arena_cleanup *cleanups;
+  /* the object whose free_ releases the arena, see json_arena_bind */
+  void *root;
+  struct json_allocator *alloc;
+};
+
+/* data of a chunk of a live arena */
+struct arena_range
+{
+  uintptr_t start;
+  uintptr_t end;
+  struct json_arena *arena;
+};
+
+/* the ranges of the live arenas by start address, they only change when
+   chunks come and go */
+static pthread_rwlock_t arenas_lock = PTHREAD_RWLOCK_INITIALIZER;
+static struct arena_range *ranges;
+static size_t ranges_len;
+static size_t ranges_cap;
+
+/* index of the first range starting after addr */
+static size_t
+range_upper (uintptr_t addr)
+{
+  size_t lo = 0, hi = ranges_len;
+
+  while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (ranges[mid].start <= addr)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+/* with arenas_lock held for writing */
+static int
+range_add (struct json_arena *arena, const struct json_arena_chunk *chunk)
+{
+  uintptr_t start = (uintptr_t) CHUNK_DATA (chunk);
+  size_t at;
+
+  if (ranges_len == ranges_cap)
+    {
+      size_t cap = ranges_cap != 0 ? ranges_cap * 2 : 64;
+      struct arena_range *tmp = realloc (ranges, cap * sizeof (*ranges));
+
+      if (tmp == NULL)
+        return -1;
+      ranges = tmp;
+      ranges_cap = cap;
+    }
+  at = range_upper (start);
+  (void) memmove (&ranges[at + 1], &ranges[at], (ranges_len - at) * sizeof (*ranges));
+  ranges[at].start = start;
+  ranges[at].end = start + chunk->size;
+  ranges[at].arena = arena;
+  __atomic_store_n (&ranges_len, ranges_len + 1, __ATOMIC_RELEASE);
+  return 0;
+}
+
+/* with arenas_lock held for writing */
+static void
+range_del (const struct json_arena_chunk *chunk)
+{
+  uintptr_t start = (uintptr_t) CHUNK_DATA (chunk);
+  size_t at = range_upper (start);
+
+  if (at == 0 || ranges[at - 1].start != start)
+    return;
+  at--;
+  (void) memmove (&ranges[at], &ranges[at + 1], (ranges_len - at - 1) * sizeof (*ranges));
+  __atomic_store_n (&ranges_len, ranges_len - 1, __ATOMIC_RELEASE);
+}
+
+static int
+chunk_link (struct json_arena *arena, struct json_arena_chunk *chunk)
+{
+  (void) pthread_rwlock_wrlock (&arenas_lock);
+  if (range_add (arena, chunk) != 0)
+    {
+      (void) pthread_rwlock_unlock (&arenas_lock);
+      return -1;
+    }
+  /* a dedicated chunk is full already, keep serving from the current one */
+  if (chunk->dedicated && arena->chunks != NULL)
+    {
+      chunk->next = arena->chunks->next;
+      arena->chunks->next = chunk;
+    }
+  else
+    {
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+    }
+  (void) pthread_rwlock_unlock (&arenas_lock);
+  return 0;
+}
+
+static struct json_arena_chunk *
+chunk_new (struct json_arena *arena, size_t size, bool dedicated)
+{
+  struct json_arena_chunk *chunk;
+
+  if (size > SIZE_MAX - CHUNK_HEADER)
+    return NULL;
+  chunk = json_alloc_malloc (arena->alloc, CHUNK_HEADER + size);
+  if (chunk == NULL)
+    return NULL;
+  chunk->data = (unsigned char *) chunk + CHUNK_HEADER;
+  chunk->size = size;
+  chunk->used = 0;
+  chunk->dedicated = dedicated;
+  chunk->adopted = false;
+  if (chunk_link (arena, chunk) != 0)
+    {
+      json_alloc_free (arena->alloc, chunk);
+      return NULL;
+    }
+  return chunk;
+}
+
+/* with arenas_lock held for writing */
+static void
+chunk_free (struct json_arena *arena, struct json_arena_chunk *chunk)
+{
+  range_del (chunk);
+  if (chunk->adopted)
+    free (chunk->data);
+  json_alloc_free (arena->alloc, chunk);
+}
+
+struct json_arena *
+json_arena_new (size_t chunk_size)
+{
+  return json_arena_new_with (chunk_size, NULL);
+}
+
+struct json_arena *
+json_arena_new_with (size_t chunk_size, struct json_allocator *alloc)
+{
+  struct json_arena *arena = json_alloc_calloc (alloc, 1, sizeof (*arena));
+
+  if (arena == NULL)
+    return NULL;
+  arena->alloc = alloc;
+  if (chunk_size == 0)
+    chunk_size = ARENA_CHUNK_SIZE;
+  arena->chunk_size = (chunk_size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+  arena->next_size = arena->chunk_size;
+  return arena;
+}
+
+void *
+json_arena_alloc (struct json_arena *arena, size_t size)
+{
+  struct json_arena_chunk *chunk = arena->chunks;
+  void *ret;
+
+  if (size > SIZE_MAX - ARENA_ALIGN)
+    return NULL;
+  size = (size + ARENA_ALIGN - 1) & ~(size_t) (ARENA_ALIGN - 1);
+  if (chunk == NULL || chunk->dedicated || chunk->size - chunk->used < size)
+    {
+      if (size > arena->next_size / 4)
+        {
+          chunk = chunk_new (arena, size, true);
+          if (chunk == NULL)
+            return NULL;
+          chunk->used = size;
+          return CHUNK_DATA (chunk);
+        }
+      chunk = chunk_new (arena, arena->next_size, false);
+      if (chunk == NULL)
+        return NULL;
+      if (arena->next_size < arena->chunk_size * ARENA_MAX_GROWTH)
+        arena->next_size *= 2;
+    }
+  ret = CHUNK_DATA (chunk) + chunk->used;
+  chunk->used += size;
+  return ret;
+}
+
+int
+json_arena_adopt (struct json_arena *arena, void *ptr, size_t size)
+{
+  struct json_arena_chunk *chunk = json_alloc_malloc (arena->alloc, sizeof (*chunk));
+
+  if (chunk == NULL)
+    return -1;
+  chunk->data = ptr;
+  chunk->size = size;
+  chunk->used = size;
+  chunk->dedicated = true;
+  chunk->adopted = true;
+  if (chunk_link (arena, chunk) != 0)
+    {
+      json_alloc_free (arena->alloc, chunk);
+      return -1;
+    }
+  return 0;
+}
+
+void
+json_arena_bind (struct json_arena *arena, void *root)
+{
+  arena->root = root;
+}
+
+int
+json_arena_defer (struct json_arena *arena, void (*fn) (void *ptr), void *ptr)
+{
+  struct json_arena_cleanup *cleanup = json_arena_alloc (arena, sizeof (*cleanup));
+
+  if (cleanup == NULL)
+    return -1;
+  cleanup->fn = fn;
+  cleanup->ptr = ptr;
+  cleanup->next = arena->cleanups;
+  arena->cleanups = cleanup;
+  return 0;
+}
+
+void
+json_arena_reset (struct json_arena *arena)
+{
+  struct json_arena_chunk *chunk, *next, *keep = NULL;
+
+  if (arena == NULL)
+    return;
+
+  while (arena->cleanups != NULL)
+    {
+      struct json_arena_cleanup *cleanup = arena->cleanups;
+      arena->cleanups = cleanup->next;
+      cleanup->fn (cleanup->ptr);
+    }
+
+  (void) pthread_rwlock_wrlock (&arenas_lock);
+  /* keep the newest regular chunk, it is the largest one */
+  for (chunk = arena->chunks; chunk != NULL; chunk = next)
+    {
+      next = chunk->next;
+      if (keep == NULL && !chunk->dedicated)
+        {
+          keep = chunk;
+          continue;
+        }
+      chunk_free (arena, chunk);
+    }
+  if (keep != NULL)
+    {
+      keep->next = NULL;
+      keep->used = 0;
+    }
+  arena->chunks = keep;
+  arena->root = NULL;
+  (void) pthread_rwlock_unlock (&arenas_lock);
+}
+
+void
+json_arena_free (struct json_arena *arena)
+{
+  if (arena == NULL)
+    return;
+  json_arena_reset (arena);
+
+  /* the chunk kept by the reset */
+  if (arena->chunks != NULL)
+    {
+      (void) pthread_rwlock_wrlock (&arenas_lock);
+      chunk_free (arena, arena->chunks);
+      (void) pthread_rwlock_unlock (&arenas_lock);
+    }
+  json_alloc_free (arena->alloc, arena);
+}
+
+static struct json_arena *
+find_owner (const void *ptr)
+{
+  uintptr_t addr = (uintptr_t) ptr;
+  struct json_arena *arena = NULL;
+  size_t at;
+
+  /* no live arena, as for every parse without one */
+  if (ptr == NULL || __atomic_load_n (&ranges_len, __ATOMIC_ACQUIRE) == 0)
+    return NULL;
+
+  (void) pthread_rwlock_rdlock (&arenas_lock);
+  at = range_upper (addr);
+  if (at > 0 && addr < ranges[at - 1].end)
+    arena = ranges[at - 1].arena;
+  (void) pthread_rwlock_unlock (&arenas_lock);
+  return arena;
+}
+
+bool
+json_arena_owns (const void *ptr)
+{
+  return find_owner (ptr) != NULL;
+}
+
+bool
+json_arena_release (void *ptr)
+{
+  struct json_arena *arena = find_owner (ptr);
+
+  if (arena == NULL)
+    return false;
+  if (arena->root == ptr)
+    json_arena_free (arena);
+  return true;
+}
@@ -0,0 +1,1207 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+/* Compact binary form of the generated types, driven by the layout
+   descriptors.  It is meant for state private to one build, the json
+   form stays the one to exchange data with.
+
+   The layout is a header, the body and the string table:
+
+     "LOCB" | version | schema hash (u64 le) | table offset (u64 le)
+     body
+     string count | (length | bytes) ...
+
+   All the integers but the header ones are LEB128 varints, signed
+   numbers are zigzag encoded and doubles are stored as their 8 bytes
+   in little endian.  Every distinct string is stored once in the
+   table, and referred to from the body by its index plus one, zero
+   being NULL.
+
+   An object is the count of the fields which are set, then the slot of
+   each in the descriptor followed by its value, in increasing slot
+   order, and for types with a residual a flag followed by the unknown
+   keys as a json object in the string table.  Arrays and maps are their
+   length followed by the items.  Pointers inside arrays and maps are
+   preceded by a presence byte.  */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "json_desc.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define BINARY_MAGIC "LOCB"
+#define BINARY_MAGIC_LEN 4
+#define BINARY_VERSION 1
+#define BINARY_HEADER_SIZE (BINARY_MAGIC_LEN + 1 + 8 + 8)
+/* bounds the recursion on untrusted input */
+#define BINARY_MAX_DEPTH 256
+/* types nested deeper than this only contribute their name to the hash */
+#define BINARY_HASH_DEPTH 64
+
+struct bin_buf
+{
+  uint8_t *data;
+  size_t len;
+  size_t cap;
+};
+
+struct bin_str
+{
+  uint64_t hash;
+  /* bytes of the string in the table buffer */
+  size_t off;
+  size_t len;
+  /* index in the table plus one, 0 for a free slot */
+  size_t ref;
+};
+
+struct bin_enc
+{
+  struct bin_buf out;
+  struct bin_buf table;
+  size_t count;
+  struct bin_str *strs;
+  size_t strs_cap;
+  char *err;
+};
+
+struct bin_ref
+{
+  const uint8_t *data;
+  size_t len;
+};
+
+struct bin_dec
+{
+  const uint8_t *pos;
+  const uint8_t *end;
+  struct bin_ref *strs;
+  size_t count;
+  const struct parser_context *ctx;
+  char *err;
+};
+
+static int
+bin_error (char **err, const char *fmt, ...)
+{
+  va_list ap;
+
+  if (*err != NULL)
+    return 0;
+  va_start (ap, fmt);
+  if (vasprintf (err, fmt, ap) < 0)
+    *err = strdup ("error allocating memory");
+  va_end (ap);
+  return 0;
+}
+
+static uint64_t
+fnv1a (uint64_t h, const void *data, size_t len)
+{
+  const uint8_t *p = data;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      h ^= p[i];
+      h *= 0x100000001b3ULL;
+    }
+  return h;
+}
+
+static uint64_t
+hash_type (uint64_t h, const struct json_type_desc *type, const struct json_type_desc **stack, size_t depth)
+{
+  size_t i;
+
+  h = fnv1a (h, type->name, strlen (type->name) + 1);
+  for (i = 0; i < depth; i++)
+    if (stack[i] == type)
+      return h;
+  if (depth == BINARY_HASH_DEPTH)
+    return h;
+  stack[depth] = type;
+
+  h = fnv1a (h, &type->kind, sizeof (type->kind));
+  h = fnv1a (h, &type->residual, sizeof (type->residual));
+  for (i = 0; i < type->fields_len; i++)
+    {
+      const struct json_field_desc *field = &type->fields[i];
+      unsigned char kinds[5] = { field->kind, field->item, field->num, field->map, field->flags };
+
+      h = fnv1a (h, field->name, strlen (field->name) + 1);
+      h = fnv1a (h, kinds, sizeof (kinds));
+      if (field->type != NULL)
+        h = hash_type (h, field->type, stack, depth + 1);
+    }
+  return h;
+}
+
+uint64_t
+json_binary_schema_hash (const struct json_type_desc *desc)
+{
+  const struct json_type_desc *stack[BINARY_HASH_DEPTH];
+
+  return hash_type (0xcbf29ce484222325ULL, desc, stack, 0);
+}
+
+static bool
+number_signed (unsigned char num)
+{
+  return num <= JSON_NUM_INT64;
+}
+
+static bool
+store_signed (unsigned char num, void *dest, int64_t val)
+{
+  switch (num)
+    {
+    case JSON_NUM_INT8:
+      if (val < INT8_MIN || val > INT8_MAX)
+        return false;
+      *(int8_t *) dest = (int8_t) val;
+      return true;
+    case JSON_NUM_INT16:
+      if (val < INT16_MIN || val > INT16_MAX)
+        return false;
+      *(int16_t *) dest = (int16_t) val;
+      return true;
+    case JSON_NUM_INT32:
+      if (val < INT32_MIN || val > INT32_MAX)
+        return false;
+      *(int32_t *) dest = (int32_t) val;
+      return true;
+    case JSON_NUM_INT64:
+      *(int64_t *) dest = val;
+      return true;
+    default:
+      if (val < INT_MIN || val > INT_MAX)
+        return false;
+      *(int *) dest = (int) val;
+      return true;
+    }
+}
+
+static bool
+store_unsigned (unsigned char num, void *dest, uint64_t val)
+{
+  switch (num)
+    {
+    case JSON_NUM_UINT8:
+      if (val > UINT8_MAX)
+        return false;
+      *(uint8_t *) dest = (uint8_t) val;
+      return true;
+    case JSON_NUM_UINT16:
+      if (val > UINT16_MAX)
+        return false;
+      *(uint16_t *) dest = (uint16_t) val;
+      return true;
+    case JSON_NUM_UINT32:
+      if (val > UINT32_MAX)
+        return false;
+      *(uint32_t *) dest = (uint32_t) val;
+      return true;
+    case JSON_NUM_UINT64:
+      *(uint64_t *) dest = val;
+      return true;
+    default:
+      if (val > UINT_MAX)
+        return false;
+      *(unsigned int *) dest = (unsigned int) val;
+      return true;
+    }
+}
+
+/* encoder */
+
+static int
+buf_reserve (struct bin_enc *e, struct bin_buf *b, size_t n)
+{
+  size_t cap;
+  uint8_t *tmp;
+
+  if (b->cap - b->len >= n)
+    return 1;
+  cap = b->cap > 0 ? b->cap : 256;
+  while (cap - b->len < n)
+    {
+      if (cap > SIZE_MAX / 2)
+        return bin_error (&e->err, "error allocating memory");
+      cap *= 2;
+    }
+  tmp = realloc (b->data, cap);
+  if (tmp == NULL)
+    return bin_error (&e->err, "error allocating memory");
+  b->data = tmp;
+  b->cap = cap;
+  return 1;
+}
+
+static int
+put_bytes (struct bin_enc *e, struct bin_buf *b, const void *data, size_t len)
+{
+  if (!buf_reserve (e, b, len))
+    return 0;
+  if (len > 0)
+    (void) memcpy (b->data + b->len, data, len);
+  b->len += len;
+  return 1;
+}
+
+static int
+put_varint (struct bin_enc *e, struct bin_buf *b, uint64_t val)
+{
+  uint8_t tmp[10];
+  size_t n = 0;
+
+  do
+    {
+      tmp[n] = val & 0x7f;
+      val >>= 7;
+      if (val != 0)
+        tmp[n] |= 0x80;
+      n++;
+    }
+  while (val != 0);
+  return put_bytes (e, b, tmp, n);
+}
+
+static int
+put_byte (struct bin_enc *e, uint8_t val)
+{
+  return put_bytes (e, &e->out, &val, 1);
+}
+
+static int
+put_number (struct bin_enc *e, unsigned char num, const void *src)
+{
+  uint8_t bytes[8];
+  uint64_t bits;
+  int64_t val;
+  size_t i;
+
+  if (num == JSON_NUM_DOUBLE)
+    {
+      (void) memcpy (&bits, src, sizeof (bits));
+      for (i = 0; i < sizeof (bytes); i++)
+        bytes[i] = (uint8_t) (bits >> (8 * i));
+      return put_bytes (e, &e->out, bytes, sizeof (bytes));
+    }
+  if (!number_signed (num))
+    return put_varint (e, &e->out, json_number_load_unsigned (num, src));
+  val = json_number_load_signed (num, src);
+  return put_varint (e, &e->out, ((uint64_t) val << 1) ^ (uint64_t) (val >> 63));
+}
+
+static int
+strs_grow (struct bin_enc *e)
+{
+  size_t cap = e->strs_cap > 0 ? e->strs_cap * 2 : 64;
+  struct bin_str *strs;
+  size_t i, j;
+
+  strs = calloc (cap, sizeof (*strs));
+  if (strs == NULL)
+    return bin_error (&e->err, "error allocating memory");
+  for (i = 0; i < e->strs_cap; i++)
+    {
+      if (e->strs[i].ref == 0)
+        continue;
+      for (j = e->strs[i].hash & (cap - 1); strs[j].ref != 0; j = (j + 1) & (cap - 1))
+        ;
+      strs[j] = e->strs[i];
+    }
+  free (e->strs);
+  e->strs = strs;
+  e->strs_cap = cap;
+  return 1;
+}
+
+/* reference to str in the string table, added the first time it is seen */
+static int
+put_strn (struct bin_enc *e, const char *str, size_t len)
+{
+  uint64_t hash;
+  size_t i;
+
+  if (str == NULL)
+    return put_varint (e, &e->out, 0);
+
+  if (e->count * 2 >= e->strs_cap && !strs_grow (e))
+    return 0;
+  hash = fnv1a (0xcbf29ce484222325ULL, str, len);
+  for (i = hash & (e->strs_cap - 1); e->strs[i].ref != 0; i = (i + 1) & (e->strs_cap - 1))
+    {
+      struct bin_str *s = &e->strs[i];
+      if (s->hash == hash && s->len == len && memcmp (e->table.data + s->off, str, len) == 0)
+        return put_varint (e, &e->out, s->ref);
+    }
+
+  if (!put_varint (e, &e->table, len))
+    return 0;
+  e->strs[i].hash = hash;
+  e->strs[i].off = e->table.len;
+  e->strs[i].len = len;
+  e->strs[i].ref = ++e->count;
+  if (!put_bytes (e, &e->table, str, len))
+    return 0;
+  return put_varint (e, &e->out, e->strs[i].ref);
+}
+
+static int
+put_str (struct bin_enc *e, const char *str)
+{
+  return put_strn (e, str, str != NULL ? strlen (str) : 0);
+}
+
+static int enc_type (struct bin_enc *e, const struct json_type_desc *type, const void *ptr, size_t depth);
+
+static int
+enc_map (struct bin_enc *e, unsigned char kind, const struct json_map_layout *map)
+{
+  const struct json_map_desc *md = &json_map_descs[kind];
+  size_t vsize = json_value_size (md->kind, md->num);
+  size_t i;
+
+  if (!put_varint (e, &e->out, map->len))
+    return 0;
+  for (i = 0; i < map->len; i++)
+    {
+      const char *val = (const char *) map->values + i * vsize;
+      if (md->int_key)
+        {
+          if (!put_number (e, JSON_NUM_INT, (const int *) map->keys + i))
+            return 0;
+        }
+      else if (!put_str (e, ((char *const *) map->keys)[i]))
+        return 0;
+
+      if (md->kind == JSON_KIND_STRING)
+        {
+          if (!put_str (e, *(char *const *) val))
+            return 0;
+        }
+      else if (md->kind == JSON_KIND_BOOL)
+        {
+          if (!put_byte (e, *(const bool *) val))
+            return 0;
+        }
+      else if (!put_number (e, md->num, val))
+        return 0;
+    }
+  return 1;
+}
+
+/* value of kind stored at src, nullable pointers get a presence byte */
+static int
+enc_value (struct bin_enc *e, const struct json_field_desc *field, unsigned char kind, const void *src,
+           bool nullable, size_t depth)
+{
+  const void *ptr;
+
+  switch (kind)
+    {
+    case JSON_KIND_STRING:
+      return put_str (e, *(char *const *) src);
+    case JSON_KIND_BOOL:
+      return put_byte (e, *(const bool *) src);
+    case JSON_KIND_NUMBER:
+      return put_number (e, field->num, src);
+    default:
+      break;
+    }
+
+  ptr = *(void *const *) src;
+  if (nullable)
+    {
+      if (!put_byte (e, ptr != NULL))
+        return 0;
+      if (ptr == NULL)
+        return 1;
+    }
+  switch (kind)
+    {
+    case JSON_KIND_BOOL_PTR:
+      return put_byte (e, *(const bool *) ptr);
+    case JSON_KIND_NUMBER_PTR:
+      return put_number (e, field->num, ptr);
+    case JSON_KIND_OBJECT:
+      return enc_type (e, field->type, ptr, depth + 1);
+    case JSON_KIND_MAP:
+      return enc_map (e, field->map, ptr);
+    default:
+      return bin_error (&e->err, "Invalid value for key '%s'", field->name);
+    }
+}
+
+static int
+enc_array (struct bin_enc *e, const struct json_field_desc *field, const char *base, size_t depth)
+{
+  const char *items = *(char *const *) (base + field->offset);
+  size_t len = *(const size_t *) (base + field->len_offset);
+  size_t size = json_value_size (field->item, field->num);
+  size_t i, j;
+
+  if (!put_varint (e, &e->out, len))
+    return 0;
+  if (!(field->flags & JSON_FIELD_DOUBLE_ARRAY))
+    {
+      for (i = 0; i < len; i++)
+        if (!enc_value (e, field, field->item, items + i * size, true, depth))
+          return 0;
+      return 1;
+    }
+
+  for (i = 0; i < len; i++)
+    {
+      const char *sub = ((char *const *) items)[i];
+      size_t sublen = (*(size_t *const *) (base + field->item_lens_offset))[i];
+
+      if (!put_varint (e, &e->out, sublen))
+        return 0;
+      for (j = 0; j < sublen; j++)
+        if (!enc_value (e, field, field->item, sub + j * size, true, depth))
+          return 0;
+    }
+  return 1;
+}
+
+static int
+enc_residual (struct bin_enc *e, const char *residual)
+{
+  char *text = NULL;
+  int ret;
+
+  if (asprintf (&text, "{%s}", residual) < 0)
+    return bin_error (&e->err, "error allocating memory");
+  ret = put_strn (e, text, strlen (text));
+  free (text);
+  return ret;
+}
+
+static int
+enc_object (struct bin_enc *e, const struct json_type_desc *type, const char *ptr, size_t depth)
+{
+  size_t i, n = 0;
+  const char *residual = NULL;
+
+  for (i = 0; i < type->fields_len; i++)
+    if (json_field_is_set (&type->fields[i], ptr))
+      n++;
+  if (!put_varint (e, &e->out, n))
+    return 0;
+
+  for (i = 0; i < type->fields_len; i++)
+    {
+      const struct json_field_desc *field = &type->fields[i];
+      const char *src = ptr + field->offset;
+
+      if (!json_field_is_set (field, ptr))
+        continue;
+      if (!put_varint (e, &e->out, i))
+        return 0;
+      if (field->kind == JSON_KIND_ARRAY)
+        {
+          if (!enc_array (e, field, ptr, depth))
+            return 0;
+        }
+      else if (field->kind == JSON_KIND_BYTES)
+        {
+          size_t len = *(const size_t *) (ptr + field->len_offset);
+          if (!put_varint (e, &e->out, len) || !put_bytes (e, &e->out, *(const uint8_t *const *) src, len))
+            return 0;
+        }
+      else if (!enc_value (e, field, field->kind, src, false, depth))
+        return 0;
+    }
+
+  if (!type->residual)
+    return 1;
+  residual = *(const char *const *) (ptr + type->residual_offset);
+  if (residual != NULL && *residual == '\0')
+    residual = NULL;
+  if (!put_byte (e, residual != NULL))
+    return 0;
+  return residual != NULL ? enc_residual (e, residual) : 1;
+}
+
+static int
+enc_type (struct bin_enc *e, const struct json_type_desc *type, const void *ptr, size_t depth)
+{
+  const struct json_field_desc *field = &type->fields[0];
+  const char *base = ptr;
+  size_t i, len;
+  int ret;
+
+  if (depth > BINARY_MAX_DEPTH)
+    return bin_error (&e->err, "Too deeply nested value of type '%s'", type->name);
+
+  switch (type->kind)
+    {
+    case JSON_TYPE_ARRAY:
+      return enc_array (e, field, base, depth);
+    case JSON_TYPE_MAP:
+      len = *(const size_t *) (base + field->len_offset);
+      if (!put_varint (e, &e->out, len))
+        return 0;
+      for (i = 0; i < len; i++)
+        {
+          const char *values = *(char *const *) (base + field->offset);
+          if (!put_str (e, (*(char **const *) (base + type->keys_offset))[i])
+              || !enc_value (e, field, field->kind, values + i * sizeof (void *), true, depth))
+            return 0;
+        }
+      return 1;
+    default:
+      /* lazy members still kept as trees are encoded as if decoded */
+      base = json_lazy_view (type, ptr);
+      ret = enc_object (e, type, base, depth);
+      json_lazy_view_free (type, ptr, base);
+      return ret;
+    }
+}
+
+int
+json_binary_encode (const struct json_type_desc *desc, const void *ptr, uint8_t **data, size_t *len,
+                    parser_error *err)
+{
+  struct bin_enc e = { 0 };
+  uint64_t hash, off;
+  size_t i;
+
+  if (desc == NULL || ptr == NULL || data == NULL || len == NULL || err == NULL)
+    return -1;
+  *err = NULL;
+
+  if (!buf_reserve (&e, &e.out, BINARY_HEADER_SIZE))
+    goto err_out;
+  (void) memcpy (e.out.data, BINARY_MAGIC, BINARY_MAGIC_LEN);
+  e.out.data[BINARY_MAGIC_LEN] = BINARY_VERSION;
+  e.out.len = BINARY_HEADER_SIZE;
+  if (!enc_type (&e, desc, ptr, 0))
+    goto err_out;
+
+  off = e.out.len;
+  if (!put_varint (&e, &e.out, e.count) || !put_bytes (&e, &e.out, e.table.data, e.table.len))
+    goto err_out;
+  hash = json_binary_schema_hash (desc);
+  for (i = 0; i < 8; i++)
+    {
+      e.out.data[BINARY_MAGIC_LEN + 1 + i] = (uint8_t) (hash >> (8 * i));
+      e.out.data[BINARY_MAGIC_LEN + 9 + i] = (uint8_t) (off >> (8 * i));
+    }
+
+  free (e.table.data);
+  free (e.strs);
+  *data = e.out.data;
+  *len = e.out.len;
+  return 0;
+
+err_out:
+  free (e.out.data);
+  free (e.table.data);
+  free (e.strs);
+  *err = e.err != NULL ? e.err : strdup ("error allocating memory");
+  return -1;
+}
+
+/* decoder */
+
+static int
+truncated (struct bin_dec *d)
+{
+  return bin_error (&d->err, "Invalid binary data: truncated");
+}
+
+static int
+get_varint (struct bin_dec *d, uint64_t *val)
+{
+  uint64_t ret = 0;
+  unsigned shift;
+
+  for (shift = 0; shift < 64; shift += 7)
+    {
+      uint8_t byte;
+
+      if (d->pos >= d->end)
+        return truncated (d);
+      byte = *d->pos++;
+      ret |= (uint64_t) (byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        {
+          *val = ret;
+          return 1;
+        }
+    }
+  return bin_error (&d->err, "Invalid binary data: bad varint");
+}
+
+/* count of items which take at least one byte each */
+static int
+get_count (struct bin_dec *d, size_t *count)
+{
+  uint64_t val;
+
+  if (!get_varint (d, &val))
+    return 0;
+  if (val > (uint64_t) (d->end - d->pos))
+    return truncated (d);
+  *count = (size_t) val;
+  return 1;
+}
+
+static int
+get_byte (struct bin_dec *d, uint8_t *val)
+{
+  if (d->pos >= d->end)
+    return truncated (d);
+  *val = *d->pos++;
+  return 1;
+}
+
+static void *
+dec_calloc (struct bin_dec *d, size_t count, size_t unit_size)
+{
+  void *ret = json_ctx_calloc (d->ctx, count, 0, unit_size);
+  if (ret == NULL)
+    bin_error (&d->err, "error allocating memory");
+  return ret;
+}
+
+static int
+get_number (struct bin_dec *d, const struct json_field_desc *field, unsigned char num, void *dest)
+{
+  uint64_t val = 0;
+  size_t i;
+
+  if (num == JSON_NUM_DOUBLE)
+    {
+      if (d->end - d->pos < 8)
+        return truncated (d);
+      for (i = 0; i < 8; i++)
+        val |= (uint64_t) d->pos[i] << (8 * i);
+      d->pos += 8;
+      (void) memcpy (dest, &val, sizeof (double));
+      return 1;
+    }
+  if (!get_varint (d, &val))
+    return 0;
+  if (number_signed (num) ? store_signed (num, dest, (int64_t) (val >> 1) ^ -(int64_t) (val & 1))
+                          : store_unsigned (num, dest, val))
+    return 1;
+  return bin_error (&d->err, "Invalid binary data: value out of range for key '%s'", field->name);
+}
+
+/* intern tells to share the string through json_intern under OPT_PARSE_INTERN */
+static int
+get_str (struct bin_dec *d, char **dest, bool intern)
+{
+  const struct bin_ref *ref;
+  uint64_t idx;
+  char *str = NULL;
+
+  if (!get_varint (d, &idx))
+    return 0;
+  if (idx == 0)
+    {
+      *dest = NULL;
+      return 1;
+    }
+  if (idx > d->count)
+    return bin_error (&d->err, "Invalid binary data: bad string reference");
+  ref = &d->strs[idx - 1];
+  if (intern && d->ctx != NULL && (d->ctx->options & OPT_PARSE_INTERN))
+    str = (char *) json_intern ((const char *) ref->data, ref->len);
+  if (str != NULL)
+    {
+      *dest = str;
+      return 1;
+    }
+  str = json_ctx_calloc (d->ctx, ref->len, 1, 1);
+  if (str == NULL)
+    return bin_error (&d->err, "error allocating memory");
+  (void) memcpy (str, ref->data, ref->len);
+  str[ref->len] = '\0';
+  *dest = str;
+  return 1;
+}
+
+static int dec_type (struct bin_dec *d, const struct json_type_desc *type, void **dest, size_t depth);
+
+static int
+dec_map (struct bin_dec *d, const struct json_field_desc *field, struct json_map_layout *map)
+{
+  const struct json_map_desc *md = &json_map_descs[field->map];
+  size_t vsize = json_value_size (md->kind, md->num);
+  size_t i, n = 0;
+
+  if (!get_count (d, &n))
+    return 0;
+  if (n == 0)
+    return 1;
+  map->keys = dec_calloc (d, n, md->int_key ? sizeof (int) : sizeof (char *));
+  map->values = dec_calloc (d, n, vsize);
+  if (map->keys == NULL || map->values == NULL)
+    return 0;
+  map->len = n;
+
+  for (i = 0; i < n; i++)
+    {
+      char *val = (char *) map->values + i * vsize;
+      uint8_t b = 0;
+
+      if (md->int_key)
+        {
+          if (!get_number (d, field, JSON_NUM_INT, (int *) map->keys + i))
+            return 0;
+        }
+      else if (!get_str (d, (char **) map->keys + i, false))
+        return 0;
+
+      if (md->kind == JSON_KIND_STRING)
+        {
+          if (!get_str (d, (char **) val, false))
+            return 0;
+        }
+      else if (md->kind == JSON_KIND_BOOL)
+        {
+          if (!get_byte (d, &b))
+            return 0;
+          *(bool *) val = b != 0;
+        }
+      else if (!get_number (d, field, md->num, val))
+        return 0;
+    }
+  return 1;
+}
+
+static int
+dec_value (struct bin_dec *d, const struct json_field_desc *field, unsigned char kind, void *dest, bool nullable,
+           size_t depth)
+{
+  void *ptr;
+  uint8_t b = 0;
+
+  switch (kind)
+    {
+    case JSON_KIND_STRING:
+      return get_str (d, (char **) dest, (field->flags & JSON_FIELD_INTERN) != 0);
+    case JSON_KIND_BOOL:
+      if (!get_byte (d, &b))
+        return 0;
+      *(bool *) dest = b != 0;
+      return 1;
+    case JSON_KIND_NUMBER:
+      return get_number (d, field, field->num, dest);
+    default:
+      break;
+    }
+
+  if (nullable)
+    {
+      if (!get_byte (d, &b))
+        return 0;
+      if (b == 0)
+        return 1;
+    }
+  switch (kind)
+    {
+    case JSON_KIND_BOOL_PTR:
+      if (!get_byte (d, &b))
+        return 0;
+      ptr = dec_calloc (d, 1, sizeof (bool));
+      if (ptr == NULL)
+        return 0;
+      *(bool *) ptr = b != 0;
+      *(void **) dest = ptr;
+      return 1;
+    case JSON_KIND_NUMBER_PTR:
+      ptr = dec_calloc (d, 1, json_number_size (field->num));
+      if (ptr == NULL)
+        return 0;
+      *(void **) dest = ptr;
+      return get_number (d, field, field->num, ptr);
+    case JSON_KIND_OBJECT:
+      return dec_type (d, field->type, (void **) dest, depth + 1);
+    case JSON_KIND_MAP:
+      ptr = dec_calloc (d, 1, sizeof (struct json_map_layout));
+      if (ptr == NULL)
+        return 0;
+      *(void **) dest = ptr;
+      return dec_map (d, field, ptr);
+    default:
+      return bin_error (&d->err, "Invalid value for key '%s'", field->name);
+    }
+}
+
+static int
+dec_array (struct bin_dec *d, const struct json_field_desc *field, char *base, size_t depth)
+{
+  size_t size = json_value_size (field->item, field->num);
+  size_t i, j, n = 0, sublen = 0;
+  size_t *lens = NULL;
+  char *items;
+
+  if (!get_count (d, &n))
+    return 0;
+  if (field->flags & JSON_FIELD_DOUBLE_ARRAY)
+    {
+      items = dec_calloc (d, n + 1, sizeof (void *));
+      lens = dec_calloc (d, n + 1, sizeof (size_t));
+      if (items == NULL || lens == NULL)
+        {
+          if (d->ctx->arena == NULL)
+            {
+              free (items);
+              free (lens);
+            }
+          return 0;
+        }
+      *(size_t **) (base + field->item_lens_offset) = lens;
+    }
+  else
+    {
+      items = dec_calloc (d, n + 1, size);
+      if (items == NULL)
+        return 0;
+    }
+  *(void **) (base + field->offset) = items;
+  *(size_t *) (base + field->len_offset) = n;
+
+  if (lens == NULL)
+    {
+      for (i = 0; i < n; i++)
+        if (!dec_value (d, field, field->item, items + i * size, true, depth))
+          return 0;
+      return 1;
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      char *sub;
+
+      if (!get_count (d, &sublen))
+        return 0;
+      sub = dec_calloc (d, sublen + 1, size);
+      if (sub == NULL)
+        return 0;
+      ((char **) items)[i] = sub;
+      lens[i] = sublen;
+      for (j = 0; j < sublen; j++)
+        if (!dec_value (d, field, field->item, sub + j * size, true, depth))
+          return 0;
+    }
+  return 1;
+}
+
+static int
+dec_residual (struct bin_dec *d, char **dest)
+{
+  char errbuf[1024];
+  char *text = NULL;
+  struct parser_context heap_ctx = { 0 };
+  const struct parser_context *ctx = d->ctx;
+  yajl_val tree;
+  int ret;
+
+  /* the text is only needed by the parse */
+  d->ctx = &heap_ctx;
+  ret = get_str (d, &text, false);
+  d->ctx = ctx;
+  if (!ret || text == NULL)
+    return ret;
+
+  /* written again, so that only well formed members are kept */
+  tree = yajl_tree_parse (text, errbuf, sizeof (errbuf));
+  free (text);
+  if (tree == NULL || !YAJL_IS_OBJECT (tree))
+    {
+      yajl_tree_free (tree);
+      return bin_error (&d->err, "Invalid binary data: bad unknown keys");
+    }
+  ret = json_residual_make (tree, NULL, ctx, dest);
+  yajl_tree_free (tree);
+  if (ret != 0)
+    return bin_error (&d->err, "error allocating memory");
+  return 1;
+}
+
+static int
+dec_object (struct bin_dec *d, const struct json_type_desc *type, char *ptr, size_t depth)
+{
+  size_t i, n = 0;
+  uint64_t idx = 0;
+  int64_t last = -1;
+  uint8_t b = 0;
+
+  if (!get_count (d, &n))
+    return 0;
+  for (i = 0; i < n; i++)
+    {
+      const struct json_field_desc *field;
+      char *dest;
+
+      if (!get_varint (d, &idx))
+        return 0;
+      if (idx >= type->fields_len || (int64_t) idx <= last)
+        return bin_error (&d->err, "Invalid binary data: bad field of type '%s'", type->name);
+      last = (int64_t) idx;
+      field = &type->fields[idx];
+      dest = ptr + field->offset;
+
+      if (field->kind == JSON_KIND_ARRAY)
+        {
+          if (!dec_array (d, field, ptr, depth))
+            return 0;
+        }
+      else if (field->kind == JSON_KIND_BYTES)
+        {
+          size_t len = 0;
+          uint8_t *bytes;
+
+          if (!get_count (d, &len))
+            return 0;
+          bytes = dec_calloc (d, len + 1, 1);
+          if (bytes == NULL)
+            return 0;
+          (void) memcpy (bytes, d->pos, len);
+          d->pos += len;
+          *(uint8_t **) dest = bytes;
+          *(size_t *) (ptr + field->len_offset) = len;
+        }
+      else if (!dec_value (d, field, field->kind, dest, false, depth))
+        return 0;
+    }
+
+  if (!type->residual)
+    return 1;
+  if (!get_byte (d, &b))
+    return 0;
+  return b != 0 ? dec_residual (d, (char **) (ptr + type->residual_offset)) : 1;
+}
+
+static int
+dec_type (struct bin_dec *d, const struct json_type_desc *type, void **dest, size_t depth)
+{
+  const struct json_field_desc *field = &type->fields[0];
+  char *ptr;
+  size_t i, n = 0;
+
+  if (depth > BINARY_MAX_DEPTH)
+    return bin_error (&d->err, "Invalid binary data: too deeply nested");
+
+  ptr = dec_calloc (d, 1, type->size);
+  if (ptr == NULL)
+    return 0;
+  *dest = ptr;
+
+  switch (type->kind)
+    {
+    case JSON_TYPE_ARRAY:
+      return dec_array (d, field, ptr, depth);
+    case JSON_TYPE_MAP:
+      if (!get_count (d, &n))
+        return 0;
+      if (n == 0)
+        return 1;
+      *(char ***) (ptr + type->keys_offset) = dec_calloc (d, n, sizeof (char *));
+      *(void **) (ptr + field->offset) = dec_calloc (d, n, sizeof (void *));
+      if (*(void **) (ptr + type->keys_offset) == NULL || *(void **) (ptr + field->offset) == NULL)
+        return 0;
+      *(size_t *) (ptr + field->len_offset) = n;
+      for (i = 0; i < n; i++)
+        {
+          char *values = *(char **) (ptr + field->offset);
+          if (!get_str (d, *(char ***) (ptr + type->keys_offset) + i, false)
+              || !dec_value (d, field, field->kind, values + i * sizeof (void *), true, depth))
+            return 0;
+        }
+      return 1;
+    default:
+      return dec_object (d, type, ptr, depth);
+    }
+}
+
+static uint64_t
+get_u64 (const uint8_t *p)
+{
+  uint64_t val = 0;
+  size_t i;
+
+  for (i = 0; i < 8; i++)
+    val |= (uint64_t) p[i] << (8 * i);
+  return val;
+}
+
+static int
+read_table (struct bin_dec *d, const uint8_t *table, const uint8_t *end)
+{
+  const uint8_t *body = d->pos;
+  const uint8_t *body_end = d->end;
+  uint64_t len;
+  size_t i;
+
+  d->pos = table;
+  d->end = end;
+  if (!get_count (d, &d->count))
+    return 0;
+  if (d->count > 0)
+    {
+      d->strs = calloc (d->count, sizeof (*d->strs));
+      if (d->strs == NULL)
+        return bin_error (&d->err, "error allocating memory");
+    }
+  for (i = 0; i < d->count; i++)
+    {
+      if (!get_varint (d, &len))
+        return 0;
+      if (len > (uint64_t) (d->end - d->pos))
+        return truncated (d);
+      d->strs[i].data = d->pos;
+      d->strs[i].len = len;
+      d->pos += len;
+    }
+  if (d->pos != d->end)
+    return bin_error (&d->err, "Invalid binary data: trailing garbage");
+  d->pos = body;
+  d->end = body_end;
+  return 1;
+}
+
+void *
+json_binary_decode (const void *data, size_t len, const struct json_type_desc *desc,
+                    const struct parser_context *ctx, parser_error *err)
+{
+  struct parser_context tmp_ctx = { 0 };
+  struct bin_dec d = { 0 };
+  const uint8_t *p = data;
+  void *root = NULL;
+  uint64_t off;
+
+  if (data == NULL || desc == NULL || err == NULL)
+    return NULL;
+  *err = NULL;
+  if (ctx == NULL)
+    ctx = &tmp_ctx;
+  d.ctx = ctx;
+
+  if (len < BINARY_HEADER_SIZE || memcmp (p, BINARY_MAGIC, BINARY_MAGIC_LEN) != 0)
+    {
+      *err = strdup ("Invalid binary data: bad magic");
+      return NULL;
+    }
+  if (p[BINARY_MAGIC_LEN] != BINARY_VERSION)
+    {
+      if (asprintf (err, "Unsupported binary data version %u", p[BINARY_MAGIC_LEN]) < 0)
+        *err = strdup ("error allocating memory");
+      return NULL;
+    }
+  if (get_u64 (p + BINARY_MAGIC_LEN + 1) != json_binary_schema_hash (desc))
+    {
+      if (asprintf (err, "Binary data does not match the schema of '%s'", desc->name) < 0)
+        *err = strdup ("error allocating memory");
+      return NULL;
+    }
+  off = get_u64 (p + BINARY_MAGIC_LEN + 9);
+  if (off < BINARY_HEADER_SIZE || off > len)
+    {
+      *err = strdup ("Invalid binary data: bad string table offset");
+      return NULL;
+    }
+
+  d.pos = p + BINARY_HEADER_SIZE;
+  d.end = p + off;
+  if (!read_table (&d, p + off, p + len))
+    goto out;
+  if (dec_type (&d, desc, &root, 0) && d.pos != d.end)
+    bin_error (&d.err, "Invalid binary data: trailing garbage");
+
+out:
+  free (d.strs);
+  if (d.err != NULL)
+    {
+      if (root != NULL)
+        desc->free (root);
+      *err = d.err;
+      return NULL;
+    }
+  return root;
+}
+
+void *
+json_binary_decode_file (const char *path, const struct json_type_desc *desc, const struct parser_context *ctx,
+                         parser_error *err)
+{
+  struct stat st;
+  void *map, *ret;
+  int fd;
+
+  if (path == NULL || desc == NULL || err == NULL)
+    return NULL;
+  *err = NULL;
+
+  fd = open (path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    {
+      if (asprintf (err, "cannot open the file %s: %s", path, strerror (errno)) < 0)
+        *err = strdup ("error allocating memory");
+      return NULL;
+    }
+  if (fstat (fd, &st) != 0 || st.st_size < BINARY_HEADER_SIZE)
+    {
+      (void) close (fd);
+      if (asprintf (err, "cannot read the file: %s", path) < 0)
+        *err = strdup ("error allocating memory");
+      return NULL;
+    }
+  map = mmap (NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  (void) close (fd);
+  if (map == MAP_FAILED)
+    {
+      if (asprintf (err, "cannot map the file %s: %s", path, strerror (errno)) < 0)
+        *err = strdup ("error allocating memory");
+      return NULL;
+    }
+  ret = json_binary_decode (map, (size_t) st.st_size, desc, ctx, err);
+  (void) munmap (map, (size_t) st.st_size);
+  return ret;
+}
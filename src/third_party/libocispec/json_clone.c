@@ -0,0 +1,500 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+/* Deep copies of the generated types, driven by the layout descriptors.
+   The copy is allocated like a parse with the same context would do,
+   so that it is released with free_<type> or with the arena.  */
+
+#include "json_desc.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the copies are consistent at every step, so that a failed clone is
+   released with the free function of its type */
+
+static char *
+clone_str (const struct parser_context *ctx, const char *src, bool *ok)
+{
+  char *ret;
+
+  if (src == NULL)
+    return NULL;
+  ret = json_ctx_strdup (ctx, src);
+  if (ret == NULL)
+    *ok = false;
+  return ret;
+}
+
+static void *
+clone_mem (const struct parser_context *ctx, const void *src, size_t count, size_t extra, size_t unit_size, bool *ok)
+{
+  void *ret;
+
+  if (src == NULL)
+    return NULL;
+  ret = json_ctx_calloc (ctx, count, extra, unit_size);
+  if (ret == NULL)
+    {
+      *ok = false;
+      return NULL;
+    }
+  if (count > 0)
+    (void) memcpy (ret, src, count * unit_size);
+  return ret;
+}
+
+yajl_val
+json_yajl_val_clone (yajl_val src)
+{
+  yajl_val ret;
+  size_t i, len;
+
+  if (src == NULL)
+    return NULL;
+  ret = calloc (1, sizeof (*ret));
+  if (ret == NULL)
+    return NULL;
+  ret->type = src->type;
+
+  switch (src->type)
+    {
+    case yajl_t_string:
+      ret->u.string = strdup (src->u.string != NULL ? src->u.string : "");
+      if (ret->u.string == NULL)
+        goto err_out;
+      break;
+    case yajl_t_number:
+      ret->u.number = src->u.number;
+      ret->u.number.r = NULL;
+      if (src->u.number.r != NULL)
+        {
+          ret->u.number.r = strdup (src->u.number.r);
+          if (ret->u.number.r == NULL)
+            goto err_out;
+        }
+      break;
+    case yajl_t_object:
+      len = src->u.object.len;
+      if (len == 0)
+        break;
+      ret->u.object.keys = calloc (len, sizeof (const char *));
+      ret->u.object.values = calloc (len, sizeof (yajl_val));
+      if (ret->u.object.keys == NULL || ret->u.object.values == NULL)
+        goto err_out;
+      for (i = 0; i < len; i++)
+        {
+          ret->u.object.keys[i] = strdup (src->u.object.keys[i] != NULL ? src->u.object.keys[i] : "");
+          if (ret->u.object.keys[i] == NULL)
+            goto err_out;
+          ret->u.object.len++;
+          if (src->u.object.values[i] == NULL)
+            continue;
+          ret->u.object.values[i] = json_yajl_val_clone (src->u.object.values[i]);
+          if (ret->u.object.values[i] == NULL)
+            goto err_out;
+        }
+      break;
+    case yajl_t_array:
+      len = src->u.array.len;
+      if (len == 0)
+        break;
+      ret->u.array.values = calloc (len, sizeof (yajl_val));
+      if (ret->u.array.values == NULL)
+        goto err_out;
+      for (i = 0; i < len; i++)
+        {
+          ret->u.array.len++;
+          if (src->u.array.values[i] == NULL)
+            continue;
+          ret->u.array.values[i] = json_yajl_val_clone (src->u.array.values[i]);
+          if (ret->u.array.values[i] == NULL)
+            goto err_out;
+        }
+      break;
+    default:
+      break;
+    }
+  return ret;
+
+err_out:
+  yajl_tree_free (ret);
+  return NULL;
+}
+
+static void *
+clone_map (const struct parser_context *ctx, unsigned char kind, const struct json_map_layout *src, bool *ok)
+{
+  const struct json_map_desc *md = &json_map_descs[kind];
+  size_t vsize = json_value_size (md->kind, md->num);
+  struct json_map_layout *ret;
+  size_t i;
+
+  ret = json_ctx_calloc (ctx, 1, 0, sizeof (*ret));
+  if (ret == NULL)
+    {
+      *ok = false;
+      return NULL;
+    }
+  if (src->len == 0)
+    return ret;
+
+  if (md->int_key)
+    ret->keys = clone_mem (ctx, src->keys, src->len, 0, sizeof (int), ok);
+  else
+    ret->keys = json_ctx_calloc (ctx, src->len, 0, sizeof (char *));
+  if (md->kind == JSON_KIND_STRING)
+    ret->values = json_ctx_calloc (ctx, src->len, 0, sizeof (char *));
+  else
+    ret->values = clone_mem (ctx, src->values, src->len, 0, vsize, ok);
+  if (ret->keys == NULL || ret->values == NULL)
+    {
+      *ok = false;
+      return ret;
+    }
+  ret->len = src->len;
+
+  for (i = 0; i < src->len && *ok; i++)
+    {
+      if (!md->int_key)
+        ((char **) ret->keys)[i] = clone_str (ctx, ((char **) src->keys)[i], ok);
+      if (md->kind == JSON_KIND_STRING)
+        ((char **) ret->values)[i] = clone_str (ctx, ((char **) src->values)[i], ok);
+    }
+  return ret;
+}
+
+static void *clone_type (const struct json_type_desc *type, const void *src, const struct parser_context *ctx,
+                         bool *ok);
+
+/* copy the value of kind at src to dest */
+static void
+clone_value (const struct json_field_desc *field, unsigned char kind, const void *src, void *dest,
+             const struct parser_context *ctx, bool *ok)
+{
+  const void *ptr;
+
+  switch (kind)
+    {
+    case JSON_KIND_STRING:
+      /* an interned value is shared by the copy as well */
+      if ((field->flags & JSON_FIELD_INTERN) && json_interned (*(char *const *) src))
+        *(char **) dest = *(char *const *) src;
+      else
+        *(char **) dest = clone_str (ctx, *(char *const *) src, ok);
+      return;
+    case JSON_KIND_BOOL:
+      *(bool *) dest = *(const bool *) src;
+      return;
+    case JSON_KIND_NUMBER:
+      (void) memcpy (dest, src, json_number_size (field->num));
+      return;
+    default:
+      break;
+    }
+
+  ptr = *(void *const *) src;
+  if (ptr == NULL)
+    return;
+  switch (kind)
+    {
+    case JSON_KIND_BOOL_PTR:
+      *(void **) dest = clone_mem (ctx, ptr, 1, 0, sizeof (bool), ok);
+      break;
+    case JSON_KIND_NUMBER_PTR:
+      *(void **) dest = clone_mem (ctx, ptr, 1, 0, json_number_size (field->num), ok);
+      break;
+    case JSON_KIND_OBJECT:
+      *(void **) dest = clone_type (field->type, ptr, ctx, ok);
+      break;
+    case JSON_KIND_MAP:
+      *(void **) dest = clone_map (ctx, field->map, ptr, ok);
+      break;
+    default:
+      break;
+    }
+}
+
+static void
+clone_array (const struct json_field_desc *field, const char *src, char *dest, const struct parser_context *ctx,
+             bool *ok)
+{
+  const char *items = *(char *const *) (src + field->offset);
+  size_t len = *(const size_t *) (src + field->len_offset);
+  size_t size = json_value_size (field->item, field->num);
+  const size_t *lens = NULL;
+  size_t *dest_lens = NULL;
+  char *dest_items;
+  size_t i, j;
+
+  if (items == NULL)
+    return;
+  if (field->flags & JSON_FIELD_DOUBLE_ARRAY)
+    {
+      lens = *(size_t *const *) (src + field->item_lens_offset);
+      dest_items = json_ctx_calloc (ctx, len + 1, 0, sizeof (void *));
+      dest_lens = clone_mem (ctx, lens, len, 1, sizeof (size_t), ok);
+      if (dest_items == NULL || (lens != NULL && dest_lens == NULL))
+        {
+          if (ctx->arena == NULL)
+            {
+              free (dest_items);
+              free (dest_lens);
+            }
+          *ok = false;
+          return;
+        }
+      *(size_t **) (dest + field->item_lens_offset) = dest_lens;
+    }
+  else
+    {
+      dest_items = json_ctx_calloc (ctx, len + 1, 0, size);
+      if (dest_items == NULL)
+        {
+          *ok = false;
+          return;
+        }
+    }
+  *(void **) (dest + field->offset) = dest_items;
+  *(size_t *) (dest + field->len_offset) = len;
+
+  if (lens == NULL && !(field->flags & JSON_FIELD_DOUBLE_ARRAY))
+    {
+      for (i = 0; i < len && *ok; i++)
+        clone_value (field, field->item, items + i * size, dest_items + i * size, ctx, ok);
+      return;
+    }
+
+  for (i = 0; i < len && *ok; i++)
+    {
+      const char *sub = ((char *const *) items)[i];
+      size_t sublen = lens != NULL ? lens[i] : 0;
+      char *dest_sub;
+
+      if (sub == NULL)
+        continue;
+      dest_sub = json_ctx_calloc (ctx, sublen + 1, 0, size);
+      if (dest_sub == NULL)
+        {
+          *ok = false;
+          return;
+        }
+      ((char **) dest_items)[i] = dest_sub;
+      for (j = 0; j < sublen && *ok; j++)
+        clone_value (field, field->item, sub + j * size, dest_sub + j * size, ctx, ok);
+    }
+}
+
+static void
+clone_lazy (const struct parser_context *ctx, yajl_val src, yajl_val *dest, bool *ok)
+{
+  yajl_val copy;
+
+  if (src == NULL)
+    return;
+  copy = json_lazy_clone (src);
+  if (copy == NULL)
+    {
+      *ok = false;
+      return;
+    }
+  /* the trees stay on the heap, release them with the arena */
+  if (ctx->arena != NULL && json_arena_defer (ctx->arena, (void (*) (void *)) yajl_tree_free, copy) != 0)
+    {
+      yajl_tree_free (copy);
+      *ok = false;
+      return;
+    }
+  *dest = copy;
+}
+
+static void
+clone_object (const struct json_type_desc *type, const char *src, char *dest, const struct parser_context *ctx,
+              bool *ok)
+{
+  size_t i;
+
+  for (i = 0; i < type->fields_len && *ok; i++)
+    {
+      const struct json_field_desc *field = &type->fields[i];
+      const char *from = src + field->offset;
+      char *to = dest + field->offset;
+
+      if (field->kind == JSON_KIND_ARRAY)
+        clone_array (field, src, dest, ctx, ok);
+      else if (field->kind == JSON_KIND_BYTES)
+        {
+          size_t len = *(const size_t *) (src + field->len_offset);
+          *(void **) to = clone_mem (ctx, *(void *const *) from, len, 1, 1, ok);
+          if (*(void **) to != NULL)
+            *(size_t *) (dest + field->len_offset) = len;
+        }
+      else
+        clone_value (field, field->kind, from, to, ctx, ok);
+    }
+
+  if (type->residual && *ok)
+    *(char **) (dest + type->residual_offset) = clone_str (ctx, *(char *const *) (src + type->residual_offset), ok);
+  /* the copy keeps the lazy members that are not decoded yet */
+  if (type->lazy_make != NULL && *ok)
+    clone_lazy (ctx, *(const yajl_val *) (src + type->lazy_offset), (yajl_val *) (dest + type->lazy_offset), ok);
+}
+
+static void *
+clone_type (const struct json_type_desc *type, const void *src, const struct parser_context *ctx, bool *ok)
+{
+  const struct json_field_desc *field = &type->fields[0];
+  char *const *keys;
+  const char *values;
+  char *ret;
+  size_t i, len;
+
+  ret = json_ctx_calloc (ctx, 1, 0, type->size);
+  if (ret == NULL)
+    {
+      *ok = false;
+      return NULL;
+    }
+
+  switch (type->kind)
+    {
+    case JSON_TYPE_ARRAY:
+      clone_array (field, src, ret, ctx, ok);
+      break;
+    case JSON_TYPE_MAP:
+      keys = *(char **const *) ((const char *) src + type->keys_offset);
+      values = *(char *const *) ((const char *) src + field->offset);
+      len = *(const size_t *) ((const char *) src + field->len_offset);
+      if (len == 0)
+        break;
+      *(char ***) (ret + type->keys_offset) = json_ctx_calloc (ctx, len, 0, sizeof (char *));
+      *(void **) (ret + field->offset) = json_ctx_calloc (ctx, len, 0, sizeof (void *));
+      if (*(void **) (ret + type->keys_offset) == NULL || *(void **) (ret + field->offset) == NULL)
+        {
+          *ok = false;
+          break;
+        }
+      *(size_t *) (ret + field->len_offset) = len;
+      for (i = 0; i < len && *ok; i++)
+        {
+          (*(char ***) (ret + type->keys_offset))[i] = clone_str (ctx, keys[i], ok);
+          clone_value (field, field->kind, values + i * sizeof (void *),
+                       *(char **) (ret + field->offset) + i * sizeof (void *), ctx, ok);
+        }
+      break;
+    default:
+      clone_object (type, src, ret, ctx, ok);
+      break;
+    }
+  return ret;
+}
+
+void *
+json_clone (const struct json_type_desc *desc, const void *src, const struct parser_context *ctx)
+{
+  struct parser_context tmp_ctx = { 0 };
+  bool ok = true;
+  void *ret;
+
+  if (desc == NULL || src == NULL)
+    return NULL;
+  if (ctx == NULL)
+    ctx = &tmp_ctx;
+
+  ret = clone_type (desc, src, ctx, &ok);
+  if (!ok)
+    {
+      if (ret != NULL)
+        desc->free (ret);
+      return NULL;
+    }
+  return ret;
+}
+
+static void *
+clone_json_map (unsigned char kind, const void *src, void (*release) (void *))
+{
+  struct parser_context ctx = { 0 };
+  bool ok = true;
+  void *ret;
+
+  if (src == NULL)
+    return NULL;
+  ret = clone_map (&ctx, kind, src, &ok);
+  if (!ok)
+    {
+      if (ret != NULL)
+        release (ret);
+      return NULL;
+    }
+  return ret;
+}
+
+json_map_int_int *
+clone_json_map_int_int (const json_map_int_int *src)
+{
+  return clone_json_map (JSON_MAP_INT_INT, src, (void (*) (void *)) free_json_map_int_int);
+}
+
+json_map_int_bool *
+clone_json_map_int_bool (const json_map_int_bool *src)
+{
+  return clone_json_map (JSON_MAP_INT_BOOL, src, (void (*) (void *)) free_json_map_int_bool);
+}
+
+json_map_int_string *
+clone_json_map_int_string (const json_map_int_string *src)
+{
+  return clone_json_map (JSON_MAP_INT_STRING, src, (void (*) (void *)) free_json_map_int_string);
+}
+
+json_map_string_int *
+clone_json_map_string_int (const json_map_string_int *src)
+{
+  return clone_json_map (JSON_MAP_STRING_INT, src, (void (*) (void *)) free_json_map_string_int);
+}
+
+json_map_string_bool *
+clone_json_map_string_bool (const json_map_string_bool *src)
+{
+  return clone_json_map (JSON_MAP_STRING_BOOL, src, (void (*) (void *)) free_json_map_string_bool);
+}
+
+json_map_string_int64 *
+clone_json_map_string_int64 (const json_map_string_int64 *src)
+{
+  return clone_json_map (JSON_MAP_STRING_INT64, src, (void (*) (void *)) free_json_map_string_int64);
+}
+
+json_map_string_string *
+clone_json_map_string_string (const json_map_string_string *src)
+{
+  return clone_json_map (JSON_MAP_STRING_STRING, src, (void (*) (void *)) free_json_map_string_string);
+}
@@ -0,0 +1,1210 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+/* Equality, hashing and RFC 7386 merge patches of the generated types,
+   driven by the layout descriptors.  A member takes part when gen_<type>
+   writes it, so that equal objects generate the same json up to the
+   order of map keys and of unknown keys.  */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include "json_desc.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "go_crc64.h"
+
+/* "-2147483648" and the terminator */
+#define INT_KEY_LEN 12
+
+static bool
+str_equal (const char *a, const char *b)
+{
+  if (a == NULL || b == NULL)
+    return a == b;
+  return strcmp (a, b) == 0;
+}
+
+/* index of key in keys, looked up at hint first, or len */
+static size_t
+find_str (char *const *keys, size_t len, const char *key, size_t hint)
+{
+  size_t i;
+
+  if (hint < len && str_equal (keys[hint], key))
+    return hint;
+  for (i = 0; i < len; i++)
+    if (str_equal (keys[i], key))
+      return i;
+  return len;
+}
+
+static size_t
+yajl_find (yajl_val obj, const char *key, size_t hint)
+{
+  return find_str ((char *const *) obj->u.object.keys, obj->u.object.len, key, hint);
+}
+
+static size_t
+map_find (const struct json_map_desc *md, const struct json_map_layout *map, const struct json_map_layout *src,
+          size_t i)
+{
+  size_t j;
+
+  if (!md->int_key)
+    return find_str (map->keys, map->len, ((char *const *) src->keys)[i], i);
+  for (j = 0; j < map->len; j++)
+    if (((const int *) map->keys)[(i + j) % map->len] == ((const int *) src->keys)[i])
+      return (i + j) % map->len;
+  return map->len;
+}
+
+/* ---- equality ---- */
+
+static bool yajl_object_equal (yajl_val a, yajl_val b);
+
+bool
+json_yajl_val_equal (yajl_val a, yajl_val b)
+{
+  size_t i;
+
+  if (a == NULL || b == NULL)
+    return a == b;
+  if (a->type != b->type)
+    return false;
+
+  switch (a->type)
+    {
+    case yajl_t_string:
+      return str_equal (a->u.string, b->u.string);
+    case yajl_t_number:
+      if (a->u.number.r != NULL || b->u.number.r != NULL)
+        return str_equal (a->u.number.r, b->u.number.r);
+      return a->u.number.flags == b->u.number.flags && a->u.number.i == b->u.number.i
+             && memcmp (&a->u.number.d, &b->u.number.d, sizeof (double)) == 0;
+    case yajl_t_object:
+      return yajl_object_equal (a, b);
+    case yajl_t_array:
+      if (a->u.array.len != b->u.array.len)
+        return false;
+      for (i = 0; i < a->u.array.len; i++)
+        if (!json_yajl_val_equal (a->u.array.values[i], b->u.array.values[i]))
+          return false;
+      return true;
+    default:
+      return true;
+    }
+}
+
+/* the keys of objects are compared regardless of their order, a NULL
+   object is an empty one */
+static bool
+yajl_object_equal (yajl_val a, yajl_val b)
+{
+  size_t alen = YAJL_IS_OBJECT (a) ? a->u.object.len : 0;
+  size_t blen = YAJL_IS_OBJECT (b) ? b->u.object.len : 0;
+  size_t i, j;
+
+  if (alen != blen)
+    return false;
+  for (i = 0; i < alen; i++)
+    {
+      j = yajl_find (b, a->u.object.keys[i], i);
+      if (j == blen || !json_yajl_val_equal (a->u.object.values[i], b->u.object.values[j]))
+        return false;
+    }
+  return true;
+}
+
+/* the unknown keys of two objects, whose text is compared first */
+static bool
+residual_equal (const char *a, const char *b)
+{
+  yajl_val ta, tb;
+  bool ret;
+
+  if (str_equal (a, b))
+    return true;
+  ta = json_residual_tree (a);
+  tb = json_residual_tree (b);
+  ret = yajl_object_equal (ta, tb);
+  yajl_tree_free (ta);
+  yajl_tree_free (tb);
+  return ret;
+}
+
+static bool
+map_value_equal (const struct json_map_desc *md, const struct json_map_layout *a, size_t i,
+                 const struct json_map_layout *b, size_t j)
+{
+  size_t size = json_value_size (md->kind, md->num);
+
+  if (md->kind == JSON_KIND_STRING)
+    return str_equal (((char *const *) a->values)[i], ((char *const *) b->values)[j]);
+  return memcmp ((const char *) a->values + i * size, (const char *) b->values + j * size, size) == 0;
+}
+
+static bool
+map_equal (unsigned char kind, const struct json_map_layout *a, const struct json_map_layout *b)
+{
+  const struct json_map_desc *md = &json_map_descs[kind];
+  size_t i, j;
+
+  if (a->len != b->len)
+    return false;
+  for (i = 0; i < a->len; i++)
+    {
+      j = map_find (md, b, a, i);
+      if (j == b->len || !map_value_equal (md, a, i, b, j))
+        return false;
+    }
+  return true;
+}
+
+static bool type_equal (const struct json_type_desc *type, const void *a, const void *b);
+
+static bool
+value_equal (const struct json_field_desc *field, unsigned char kind, const void *a, const void *b)
+{
+  const void *pa, *pb;
+
+  switch (kind)
+    {
+    case JSON_KIND_STRING:
+      return str_equal (*(char *const *) a, *(char *const *) b);
+    case JSON_KIND_BOOL:
+      return *(const bool *) a == *(const bool *) b;
+    case JSON_KIND_NUMBER:
+      return memcmp (a, b, json_number_size (field->num)) == 0;
+    default:
+      break;
+    }
+
+  pa = *(void *const *) a;
+  pb = *(void *const *) b;
+  if (pa == NULL || pb == NULL)
+    return pa == pb;
+  switch (kind)
+    {
+    case JSON_KIND_BOOL_PTR:
+      return *(const bool *) pa == *(const bool *) pb;
+    case JSON_KIND_NUMBER_PTR:
+      return memcmp (pa, pb, json_number_size (field->num)) == 0;
+    case JSON_KIND_OBJECT:
+      return type_equal (field->type, pa, pb);
+    case JSON_KIND_MAP:
+      return map_equal (field->map, pa, pb);
+    default:
+      return true;
+    }
+}
+
+static bool
+array_equal (const struct json_field_desc *field, const char *a, const char *b)
+{
+  const char *aitems = *(char *const *) (a + field->offset);
+  const char *bitems = *(char *const *) (b + field->offset);
+  size_t len = *(const size_t *) (a + field->len_offset);
+  size_t size = json_value_size (field->item, field->num);
+  const size_t *alens, *blens;
+  size_t i, j, sublen;
+
+  if (json_field_is_set (field, a) != json_field_is_set (field, b)
+      || len != *(const size_t *) (b + field->len_offset))
+    return false;
+
+  if (!(field->flags & JSON_FIELD_DOUBLE_ARRAY))
+    {
+      for (i = 0; i < len; i++)
+        if (!value_equal (field, field->item, aitems + i * size, bitems + i * size))
+          return false;
+      return true;
+    }
+
+  alens = *(size_t *const *) (a + field->item_lens_offset);
+  blens = *(size_t *const *) (b + field->item_lens_offset);
+  for (i = 0; i < len; i++)
+    {
+      const char *asub = ((char *const *) aitems)[i];
+      const char *bsub = ((char *const *) bitems)[i];
+
+      sublen = alens != NULL ? alens[i] : 0;
+      if (sublen != (blens != NULL ? blens[i] : 0))
+        return false;
+      for (j = 0; j < sublen; j++)
+        if (!value_equal (field, field->item, asub + j * size, bsub + j * size))
+          return false;
+    }
+  return true;
+}
+
+static bool
+field_equal (const struct json_field_desc *field, const char *a, const char *b)
+{
+  const void *pa, *pb;
+  size_t len;
+
+  switch (field->kind)
+    {
+    case JSON_KIND_ARRAY:
+      return array_equal (field, a, b);
+    case JSON_KIND_BYTES:
+      pa = *(void *const *) (a + field->offset);
+      pb = *(void *const *) (b + field->offset);
+      len = *(const size_t *) (a + field->len_offset);
+      if (pa == NULL || pb == NULL)
+        return pa == pb;
+      return len == *(const size_t *) (b + field->len_offset) && memcmp (pa, pb, len) == 0;
+    default:
+      return value_equal (field, field->kind, a + field->offset, b + field->offset);
+    }
+}
+
+/* compares the views va and vb of a and b, and releases them */
+static bool
+object_equal (const struct json_type_desc *type, const char *va, const char *vb, const void *a, const void *b)
+{
+  bool ret = true;
+  size_t i;
+
+  for (i = 0; i < type->fields_len && ret; i++)
+    ret = field_equal (&type->fields[i], va, vb);
+  if (ret && type->residual)
+    ret = residual_equal (*(const char *const *) (va + type->residual_offset),
+                          *(const char *const *) (vb + type->residual_offset));
+  json_lazy_view_free (type, a, va);
+  json_lazy_view_free (type, b, vb);
+  return ret;
+}
+
+static bool
+type_equal (const struct json_type_desc *type, const void *a, const void *b)
+{
+  const struct json_field_desc *field = &type->fields[0];
+  const char *pa = a, *pb = b;
+  char *const *akeys, *const *bkeys;
+  const char *avalues, *bvalues;
+  size_t i, j, len;
+
+  if (a == b)
+    return true;
+
+  switch (type->kind)
+    {
+    case JSON_TYPE_ARRAY:
+      return array_equal (field, pa, pb);
+    case JSON_TYPE_MAP:
+      len = *(const size_t *) (pa + field->len_offset);
+      if (len != *(const size_t *) (pb + field->len_offset))
+        return false;
+      akeys = *(char **const *) (pa + type->keys_offset);
+      bkeys = *(char **const *) (pb + type->keys_offset);
+      avalues = *(char *const *) (pa + field->offset);
+      bvalues = *(char *const *) (pb + field->offset);
+      for (i = 0; i < len; i++)
+        {
+          j = find_str (bkeys, len, akeys[i], i);
+          if (j == len
+              || !value_equal (field, field->kind, avalues + i * sizeof (void *), bvalues + j * sizeof (void *)))
+            return false;
+        }
+      return true;
+    default:
+      return object_equal (type, json_lazy_view (type, a), json_lazy_view (type, b), a, b);
+    }
+}
+
+bool
+json_equal (const struct json_type_desc *desc, const void *a, const void *b)
+{
+  if (desc == NULL || a == NULL || b == NULL)
+    return a == b;
+  return type_equal (desc, a, b);
+}
+
+/* ---- hashing ---- */
+
+/* crc64 of the values fed in a fixed layout.  The entries of maps and of
+   objects are hashed on their own and summed, which does not depend on
+   their order.  */
+struct json_hasher
+{
+  const isula_crc_table_t *tab;
+  uint64_t crc;
+  size_t used;
+  unsigned char buf[256];
+};
+
+static void
+hasher_init (struct json_hasher *h, const isula_crc_table_t *tab)
+{
+  h->tab = tab;
+  h->crc = 0;
+  h->used = 0;
+}
+
+static void
+hash_flush (struct json_hasher *h)
+{
+  if (h->used == 0)
+    return;
+  (void) isula_crc_update (h->tab, &h->crc, h->buf, h->used);
+  h->used = 0;
+}
+
+static void
+hash_bytes (struct json_hasher *h, const void *data, size_t len)
+{
+  if (len > sizeof (h->buf) - h->used)
+    hash_flush (h);
+  if (len >= sizeof (h->buf))
+    {
+      (void) isula_crc_update (h->tab, &h->crc, (unsigned char *) data, len);
+      return;
+    }
+  (void) memcpy (h->buf + h->used, data, len);
+  h->used += len;
+}
+
+static void
+hash_byte (struct json_hasher *h, unsigned char val)
+{
+  hash_bytes (h, &val, 1);
+}
+
+static void
+hash_u64 (struct json_hasher *h, uint64_t val)
+{
+  unsigned char le[sizeof (uint64_t)];
+  size_t i;
+
+  for (i = 0; i < sizeof (le); i++)
+    le[i] = (unsigned char) (val >> (8 * i));
+  hash_bytes (h, le, sizeof (le));
+}
+
+static uint64_t
+hash_done (struct json_hasher *h)
+{
+  hash_flush (h);
+  return h->crc;
+}
+
+static void
+hash_str (struct json_hasher *h, const char *str)
+{
+  size_t len;
+
+  if (str == NULL)
+    {
+      hash_byte (h, 0);
+      return;
+    }
+  len = strlen (str);
+  hash_byte (h, 1);
+  hash_u64 (h, len);
+  hash_bytes (h, str, len);
+}
+
+static void
+hash_number (struct json_hasher *h, unsigned char num, const void *src)
+{
+  uint64_t bits;
+
+  if (num == JSON_NUM_DOUBLE)
+    (void) memcpy (&bits, src, sizeof (bits));
+  else if (num <= JSON_NUM_INT64)
+    bits = (uint64_t) json_number_load_signed (num, src);
+  else
+    bits = json_number_load_unsigned (num, src);
+  hash_u64 (h, bits);
+}
+
+static void hash_yajl_object (struct json_hasher *h, yajl_val obj);
+
+static void
+hash_yajl_val (struct json_hasher *h, yajl_val val)
+{
+  size_t i;
+
+  if (val == NULL)
+    {
+      hash_byte (h, 0);
+      return;
+    }
+  hash_byte (h, (unsigned char) (val->type + 1));
+  switch (val->type)
+    {
+    case yajl_t_string:
+      hash_str (h, val->u.string);
+      break;
+    case yajl_t_number:
+      hash_str (h, val->u.number.r);
+      if (val->u.number.r == NULL)
+        {
+          hash_u64 (h, (uint64_t) val->u.number.flags);
+          hash_u64 (h, (uint64_t) val->u.number.i);
+          hash_bytes (h, &val->u.number.d, sizeof (double));
+        }
+      break;
+    case yajl_t_object:
+      hash_yajl_object (h, val);
+      break;
+    case yajl_t_array:
+      hash_u64 (h, val->u.array.len);
+      for (i = 0; i < val->u.array.len; i++)
+        hash_yajl_val (h, val->u.array.values[i]);
+      break;
+    default:
+      break;
+    }
+}
+
+static void
+hash_yajl_object (struct json_hasher *h, yajl_val obj)
+{
+  size_t i, len = YAJL_IS_OBJECT (obj) ? obj->u.object.len : 0;
+  uint64_t sum = 0;
+
+  for (i = 0; i < len; i++)
+    {
+      struct json_hasher entry;
+
+      hasher_init (&entry, h->tab);
+      hash_str (&entry, obj->u.object.keys[i]);
+      hash_yajl_val (&entry, obj->u.object.values[i]);
+      sum += hash_done (&entry);
+    }
+  hash_u64 (h, len);
+  hash_u64 (h, sum);
+}
+
+static void
+hash_map (struct json_hasher *h, unsigned char kind, const struct json_map_layout *map)
+{
+  const struct json_map_desc *md = &json_map_descs[kind];
+  size_t size = json_value_size (md->kind, md->num);
+  uint64_t sum = 0;
+  size_t i;
+
+  for (i = 0; i < map->len; i++)
+    {
+      struct json_hasher entry;
+      const char *value = (const char *) map->values + i * size;
+
+      hasher_init (&entry, h->tab);
+      if (md->int_key)
+        hash_u64 (&entry, (uint64_t) (int64_t) ((const int *) map->keys)[i]);
+      else
+        hash_str (&entry, ((char *const *) map->keys)[i]);
+      if (md->kind == JSON_KIND_STRING)
+        hash_str (&entry, *(char *const *) value);
+      else if (md->kind == JSON_KIND_BOOL)
+        hash_byte (&entry, *(const bool *) value);
+      else
+        hash_number (&entry, md->num, value);
+      sum += hash_done (&entry);
+    }
+  hash_u64 (h, map->len);
+  hash_u64 (h, sum);
+}
+
+static void hash_type (struct json_hasher *h, const struct json_type_desc *type, const void *ptr);
+
+static void
+hash_value (struct json_hasher *h, const struct json_field_desc *field, unsigned char kind, const void *src)
+{
+  const void *ptr;
+
+  switch (kind)
+    {
+    case JSON_KIND_STRING:
+      hash_str (h, *(char *const *) src);
+      return;
+    case JSON_KIND_BOOL:
+      hash_byte (h, *(const bool *) src);
+      return;
+    case JSON_KIND_NUMBER:
+      hash_number (h, field->num, src);
+      return;
+    default:
+      break;
+    }
+
+  ptr = *(void *const *) src;
+  hash_byte (h, ptr != NULL);
+  if (ptr == NULL)
+    return;
+  switch (kind)
+    {
+    case JSON_KIND_BOOL_PTR:
+      hash_byte (h, *(const bool *) ptr);
+      break;
+    case JSON_KIND_NUMBER_PTR:
+      hash_number (h, field->num, ptr);
+      break;
+    case JSON_KIND_OBJECT:
+      hash_type (h, field->type, ptr);
+      break;
+    case JSON_KIND_MAP:
+      hash_map (h, field->map, ptr);
+      break;
+    default:
+      break;
+    }
+}
+
+static void
+hash_array (struct json_hasher *h, const struct json_field_desc *field, const char *base)
+{
+  const char *items = *(char *const *) (base + field->offset);
+  size_t len = *(const size_t *) (base + field->len_offset);
+  size_t size = json_value_size (field->item, field->num);
+  const size_t *lens;
+  size_t i, j, sublen;
+
+  hash_byte (h, json_field_is_set (field, base));
+  hash_u64 (h, len);
+  if (!(field->flags & JSON_FIELD_DOUBLE_ARRAY))
+    {
+      for (i = 0; i < len; i++)
+        hash_value (h, field, field->item, items + i * size);
+      return;
+    }
+
+  lens = *(size_t *const *) (base + field->item_lens_offset);
+  for (i = 0; i < len; i++)
+    {
+      const char *sub = ((char *const *) items)[i];
+
+      sublen = lens != NULL ? lens[i] : 0;
+      hash_u64 (h, sublen);
+      for (j = 0; j < sublen; j++)
+        hash_value (h, field, field->item, sub + j * size);
+    }
+}
+
+static void
+hash_type (struct json_hasher *h, const struct json_type_desc *type, const void *ptr)
+{
+  const struct json_field_desc *field = &type->fields[0];
+  const char *base = ptr;
+  char *const *keys;
+  const char *values;
+  uint64_t sum = 0;
+  size_t i, len;
+
+  switch (type->kind)
+    {
+    case JSON_TYPE_ARRAY:
+      hash_array (h, field, base);
+      return;
+    case JSON_TYPE_MAP:
+      len = *(const size_t *) (base + field->len_offset);
+      keys = *(char **const *) (base + type->keys_offset);
+      values = *(char *const *) (base + field->offset);
+      for (i = 0; i < len; i++)
+        {
+          struct json_hasher entry;
+
+          hasher_init (&entry, h->tab);
+          hash_str (&entry, keys[i]);
+          hash_value (&entry, field, field->kind, values + i * sizeof (void *));
+          sum += hash_done (&entry);
+        }
+      hash_u64 (h, len);
+      hash_u64 (h, sum);
+      return;
+    default:
+      break;
+    }
+
+  base = json_lazy_view (type, ptr);
+  for (i = 0; i < type->fields_len; i++)
+    {
+      field = &type->fields[i];
+      if (!json_field_is_set (field, base))
+        continue;
+      hash_u64 (h, i);
+      if (field->kind == JSON_KIND_ARRAY)
+        hash_array (h, field, base);
+      else if (field->kind == JSON_KIND_BYTES)
+        {
+          len = *(const size_t *) (base + field->len_offset);
+          hash_u64 (h, len);
+          hash_bytes (h, *(void *const *) (base + field->offset), len);
+        }
+      else
+        hash_value (h, field, field->kind, base + field->offset);
+    }
+  /* after the last slot, so that the unknown keys cannot alias a field */
+  hash_u64 (h, type->fields_len);
+  if (type->residual)
+    {
+      yajl_val residual = json_residual_tree (*(const char *const *) (base + type->residual_offset));
+      hash_yajl_object (h, residual);
+      yajl_tree_free (residual);
+    }
+  json_lazy_view_free (type, ptr, base);
+}
+
+uint64_t
+json_hash (const struct json_type_desc *desc, const void *ptr)
+{
+  struct json_hasher h;
+
+  if (desc == NULL || ptr == NULL)
+    return 0;
+  hasher_init (&h, new_isula_crc_table (ISO_POLY));
+  hash_type (&h, desc, ptr);
+  return hash_done (&h);
+}
+
+/* ---- merge patches ---- */
+
+struct diff_args
+{
+  const struct json_type_desc *desc;
+  const void *a;
+  const void *b;
+};
+
+#define DIFF_CHECK(stat)                      \
+  do                                          \
+    {                                         \
+      yajl_gen_status __s = (stat);           \
+      if (__s != yajl_gen_status_ok)          \
+        return __s;                           \
+    }                                         \
+  while (0)
+
+static yajl_gen_status
+gen_key (yajl_gen g, const char *key)
+{
+  if (key == NULL)
+    key = "";
+  return json_gen_string (g, (const unsigned char *) key, strlen (key));
+}
+
+static yajl_gen_status
+gen_scalar (yajl_gen g, unsigned char kind, unsigned char num, const void *src)
+{
+  const char *str;
+
+  switch (kind)
+    {
+    case JSON_KIND_STRING:
+      str = *(char *const *) src;
+      if (str == NULL)
+        return json_gen_null (g);
+      return json_gen_string (g, (const unsigned char *) str, strlen (str));
+    case JSON_KIND_BOOL:
+      return json_gen_bool (g, *(const bool *) src);
+    default:
+      if (num == JSON_NUM_DOUBLE)
+        return json_gen_double (g, *(const double *) src);
+      if (num <= JSON_NUM_INT64)
+        return map_int (g, json_number_load_signed (num, src));
+      return map_uint (g, json_number_load_unsigned (num, src));
+    }
+}
+
+static yajl_gen_status
+gen_map_entry (yajl_gen g, const struct json_map_desc *md, const struct json_map_layout *map, size_t i)
+{
+  char numstr[INT_KEY_LEN];
+
+  if (md->int_key)
+    {
+      (void) snprintf (numstr, sizeof (numstr), "%d", ((const int *) map->keys)[i]);
+      DIFF_CHECK (gen_key (g, numstr));
+    }
+  else
+    DIFF_CHECK (gen_key (g, ((char *const *) map->keys)[i]));
+  return gen_scalar (g, md->kind, md->num, (const char *) map->values + i * json_value_size (md->kind, md->num));
+}
+
+static yajl_gen_status
+gen_map (yajl_gen g, unsigned char kind, const struct json_map_layout *map)
+{
+  size_t i;
+
+  DIFF_CHECK (json_gen_map_open (g));
+  for (i = 0; i < map->len; i++)
+    DIFF_CHECK (gen_map_entry (g, &json_map_descs[kind], map, i));
+  return json_gen_map_close (g);
+}
+
+static yajl_gen_status
+gen_value (yajl_gen g, const struct json_field_desc *field, unsigned char kind, const void *src,
+           const struct parser_context *ctx, parser_error *err)
+{
+  const void *ptr;
+
+  if (kind == JSON_KIND_STRING || kind == JSON_KIND_BOOL || kind == JSON_KIND_NUMBER)
+    return gen_scalar (g, kind, field->num, src);
+
+  ptr = *(void *const *) src;
+  if (ptr == NULL)
+    return json_gen_null (g);
+  switch (kind)
+    {
+    case JSON_KIND_BOOL_PTR:
+      return gen_scalar (g, JSON_KIND_BOOL, 0, ptr);
+    case JSON_KIND_NUMBER_PTR:
+      return gen_scalar (g, JSON_KIND_NUMBER, field->num, ptr);
+    case JSON_KIND_OBJECT:
+      return field->type->gen (g, ptr, ctx, err);
+    case JSON_KIND_MAP:
+      return gen_map (g, field->map, ptr);
+    default:
+      return json_gen_null (g);
+    }
+}
+
+static yajl_gen_status
+gen_array (yajl_gen g, const struct json_field_desc *field, const char *base, const struct parser_context *ctx,
+           parser_error *err)
+{
+  const char *items = *(char *const *) (base + field->offset);
+  size_t len = *(const size_t *) (base + field->len_offset);
+  size_t size = json_value_size (field->item, field->num);
+  const size_t *lens = NULL;
+  size_t i, j;
+
+  if (field->flags & JSON_FIELD_DOUBLE_ARRAY)
+    lens = *(size_t *const *) (base + field->item_lens_offset);
+  DIFF_CHECK (json_gen_array_open (g));
+  for (i = 0; i < len; i++)
+    {
+      if (!(field->flags & JSON_FIELD_DOUBLE_ARRAY))
+        {
+          DIFF_CHECK (gen_value (g, field, field->item, items + i * size, ctx, err));
+          continue;
+        }
+      DIFF_CHECK (json_gen_array_open (g));
+      for (j = 0; lens != NULL && j < lens[i]; j++)
+        DIFF_CHECK (gen_value (g, field, field->item, ((char *const *) items)[i] + j * size, ctx, err));
+      DIFF_CHECK (json_gen_array_close (g));
+    }
+  return json_gen_array_close (g);
+}
+
+static yajl_gen_status
+gen_field (yajl_gen g, const struct json_field_desc *field, const char *base, const struct parser_context *ctx,
+           parser_error *err)
+{
+  switch (field->kind)
+    {
+    case JSON_KIND_ARRAY:
+      return gen_array (g, field, base, ctx, err);
+    case JSON_KIND_BYTES:
+      return json_gen_string (g, *(const unsigned char *const *) (base + field->offset),
+                              *(const size_t *) (base + field->len_offset));
+    default:
+      return gen_value (g, field, field->kind, base + field->offset, ctx, err);
+    }
+}
+
+/* the members of the patch between two json objects, without braces */
+static yajl_gen_status
+diff_yajl_members (yajl_gen g, yajl_val a, yajl_val b, parser_error *err)
+{
+  size_t alen = YAJL_IS_OBJECT (a) ? a->u.object.len : 0;
+  size_t blen = YAJL_IS_OBJECT (b) ? b->u.object.len : 0;
+  size_t i, j;
+
+  for (i = 0; i < blen; i++)
+    {
+      yajl_val bv = b->u.object.values[i];
+
+      j = alen > 0 ? yajl_find (a, b->u.object.keys[i], i) : alen;
+      if (j < alen && json_yajl_val_equal (a->u.object.values[j], bv))
+        continue;
+      DIFF_CHECK (gen_key (g, b->u.object.keys[i]));
+      if (j < alen && YAJL_IS_OBJECT (a->u.object.values[j]) && YAJL_IS_OBJECT (bv))
+        {
+          DIFF_CHECK (json_gen_map_open (g));
+          DIFF_CHECK (diff_yajl_members (g, a->u.object.values[j], bv, err));
+          DIFF_CHECK (json_gen_map_close (g));
+        }
+      else if (bv == NULL)
+        DIFF_CHECK (json_gen_null (g));
+      else
+        DIFF_CHECK (gen_yajl_val (bv, g, err));
+    }
+  for (i = 0; i < alen; i++)
+    {
+      if (blen > 0 && yajl_find (b, a->u.object.keys[i], i) < blen)
+        continue;
+      DIFF_CHECK (gen_key (g, a->u.object.keys[i]));
+      DIFF_CHECK (json_gen_null (g));
+    }
+  return yajl_gen_status_ok;
+}
+
+static yajl_gen_status
+diff_residual (yajl_gen g, const char *a, const char *b, parser_error *err)
+{
+  yajl_val ta, tb;
+  yajl_gen_status stat;
+
+  if (str_equal (a, b))
+    return yajl_gen_status_ok;
+  ta = json_residual_tree (a);
+  tb = json_residual_tree (b);
+  stat = diff_yajl_members (g, ta, tb, err);
+  yajl_tree_free (ta);
+  yajl_tree_free (tb);
+  return stat;
+}
+
+static yajl_gen_status
+diff_map (yajl_gen g, unsigned char kind, const struct json_map_layout *a, const struct json_map_layout *b)
+{
+  const struct json_map_desc *md = &json_map_descs[kind];
+  size_t i, j;
+
+  DIFF_CHECK (json_gen_map_open (g));
+  for (i = 0; i < b->len; i++)
+    {
+      j = map_find (md, a, b, i);
+      if (j < a->len && map_value_equal (md, a, j, b, i))
+        continue;
+      DIFF_CHECK (gen_map_entry (g, md, b, i));
+    }
+  for (i = 0; i < a->len; i++)
+    {
+      char numstr[INT_KEY_LEN];
+
+      if (map_find (md, b, a, i) < b->len)
+        continue;
+      if (md->int_key)
+        {
+          (void) snprintf (numstr, sizeof (numstr), "%d", ((const int *) a->keys)[i]);
+          DIFF_CHECK (gen_key (g, numstr));
+        }
+      else
+        DIFF_CHECK (gen_key (g, ((char *const *) a->keys)[i]));
+      DIFF_CHECK (json_gen_null (g));
+    }
+  return json_gen_map_close (g);
+}
+
+static yajl_gen_status diff_type (yajl_gen g, const struct json_type_desc *type, const void *a, const void *b,
+                                  const struct parser_context *ctx, parser_error *err);
+
+/* the patch of a value set in both a and b: objects are patched member
+   by member, everything else is replaced */
+static yajl_gen_status
+diff_value (yajl_gen g, const struct json_field_desc *field, unsigned char kind, const void *a, const void *b,
+            const struct parser_context *ctx, parser_error *err)
+{
+  const void *pa = *(void *const *) a;
+  const void *pb = *(void *const *) b;
+
+  if (kind == JSON_KIND_OBJECT && pa != NULL && pb != NULL && field->type->kind != JSON_TYPE_ARRAY)
+    return diff_type (g, field->type, pa, pb, ctx, err);
+  if (kind == JSON_KIND_MAP && pa != NULL && pb != NULL)
+    return diff_map (g, field->map, pa, pb);
+  return gen_value (g, field, kind, b, ctx, err);
+}
+
+static yajl_gen_status
+diff_object (yajl_gen g, const struct json_type_desc *type, const char *a, const char *b,
+             const struct parser_context *ctx, parser_error *err)
+{
+  size_t i;
+
+  DIFF_CHECK (json_gen_map_open (g));
+  for (i = 0; i < type->fields_len; i++)
+    {
+      const struct json_field_desc *field = &type->fields[i];
+      bool aset = json_field_is_set (field, a);
+
+      if (!json_field_is_set (field, b))
+        {
+          if (!aset)
+            continue;
+          DIFF_CHECK (gen_key (g, field->name));
+          DIFF_CHECK (json_gen_null (g));
+          continue;
+        }
+      if (aset && field_equal (field, a, b))
+        continue;
+      DIFF_CHECK (gen_key (g, field->name));
+      if (aset && field->kind != JSON_KIND_ARRAY && field->kind != JSON_KIND_BYTES)
+        DIFF_CHECK (diff_value (g, field, field->kind, a + field->offset, b + field->offset, ctx, err));
+      else
+        DIFF_CHECK (gen_field (g, field, b, ctx, err));
+    }
+  if (type->residual)
+    DIFF_CHECK (diff_residual (g, *(const char *const *) (a + type->residual_offset),
+                               *(const char *const *) (b + type->residual_offset), err));
+  return json_gen_map_close (g);
+}
+
+static yajl_gen_status
+diff_type (yajl_gen g, const struct json_type_desc *type, const void *a, const void *b,
+           const struct parser_context *ctx, parser_error *err)
+{
+  const struct json_field_desc *field = &type->fields[0];
+  const char *pa = a, *pb = b;
+  char *const *akeys, *const *bkeys;
+  const char *avalues, *bvalues;
+  yajl_gen_status stat;
+  size_t i, j, alen, blen;
+
+  switch (type->kind)
+    {
+    case JSON_TYPE_ARRAY:
+      /* merge patches replace arrays as a whole */
+      return type->gen (g, b, ctx, err);
+    case JSON_TYPE_MAP:
+      alen = *(const size_t *) (pa + field->len_offset);
+      blen = *(const size_t *) (pb + field->len_offset);
+      akeys = *(char **const *) (pa + type->keys_offset);
+      bkeys = *(char **const *) (pb + type->keys_offset);
+      avalues = *(char *const *) (pa + field->offset);
+      bvalues = *(char *const *) (pb + field->offset);
+      DIFF_CHECK (json_gen_map_open (g));
+      for (i = 0; i < blen; i++)
+        {
+          const char *bv = bvalues + i * sizeof (void *);
+
+          j = find_str (akeys, alen, bkeys[i], i);
+          if (j < alen && value_equal (field, field->kind, avalues + j * sizeof (void *), bv))
+            continue;
+          DIFF_CHECK (gen_key (g, bkeys[i]));
+          if (j < alen)
+            DIFF_CHECK (diff_value (g, field, field->kind, avalues + j * sizeof (void *), bv, ctx, err));
+          else
+            DIFF_CHECK (gen_value (g, field, field->kind, bv, ctx, err));
+        }
+      for (i = 0; i < alen; i++)
+        {
+          if (find_str (bkeys, blen, akeys[i], i) < blen)
+            continue;
+          DIFF_CHECK (gen_key (g, akeys[i]));
+          DIFF_CHECK (json_gen_null (g));
+        }
+      return json_gen_map_close (g);
+    default:
+      pa = json_lazy_view (type, a);
+      pb = json_lazy_view (type, b);
+      stat = diff_object (g, type, pa, pb, ctx, err);
+      json_lazy_view_free (type, a, pa);
+      json_lazy_view_free (type, b, pb);
+      return stat;
+    }
+}
+
+static yajl_gen_status
+gen_diff (yajl_gen g, const void *ptr, const struct parser_context *ctx, parser_error *err)
+{
+  const struct diff_args *args = ptr;
+
+  if (args->b == NULL)
+    return json_gen_null (g);
+  if (args->a == NULL)
+    return args->desc->gen (g, args->b, ctx, err);
+  return diff_type (g, args->desc, args->a, args->b, ctx, err);
+}
+
+char *
+json_diff (const struct json_type_desc *desc, const void *a, const void *b, const struct parser_context *ctx,
+           parser_error *err)
+{
+  struct parser_context gen_ctx = { 0 };
+  struct diff_args args = { desc, a, b };
+
+  if (desc == NULL || err == NULL)
+    return NULL;
+  if (ctx != NULL)
+    gen_ctx = *ctx;
+  gen_ctx.options |= OPT_GEN_SIMPLIFY;
+  gen_ctx.options &= ~OPT_GEN_KEY_VALUE;
+  return json_gen_to_string (gen_diff, &args, &gen_ctx, err);
+}
+
+static int
+yajl_object_append (yajl_val obj, const char *key, yajl_val value)
+{
+  size_t len = obj->u.object.len;
+  const char **keys;
+  yajl_val *values;
+  char *dup;
+
+  dup = strdup (key != NULL ? key : "");
+  keys = realloc (obj->u.object.keys, (len + 1) * sizeof (*keys));
+  if (keys != NULL)
+    obj->u.object.keys = keys;
+  values = realloc (obj->u.object.values, (len + 1) * sizeof (*values));
+  if (values != NULL)
+    obj->u.object.values = values;
+  if (dup == NULL || keys == NULL || values == NULL)
+    {
+      free (dup);
+      yajl_tree_free (value);
+      return -1;
+    }
+  keys[len] = dup;
+  values[len] = value;
+  obj->u.object.len++;
+  return 0;
+}
+
+static void
+yajl_object_remove (yajl_val obj, size_t i)
+{
+  size_t rest = obj->u.object.len - i - 1;
+
+  free ((char *) obj->u.object.keys[i]);
+  yajl_tree_free (obj->u.object.values[i]);
+  (void) memmove (&obj->u.object.keys[i], &obj->u.object.keys[i + 1], rest * sizeof (const char *));
+  (void) memmove (&obj->u.object.values[i], &obj->u.object.values[i + 1], rest * sizeof (yajl_val));
+  obj->u.object.len--;
+}
+
+/* RFC 7386 MergePatch (target, patch), taking over target.  NULL when
+   out of memory.  */
+static yajl_val
+merge_patch (yajl_val target, yajl_val patch)
+{
+  size_t i, j;
+
+  if (!YAJL_IS_OBJECT (patch))
+    {
+      yajl_tree_free (target);
+      return json_yajl_val_clone (patch);
+    }
+  if (!YAJL_IS_OBJECT (target))
+    {
+      yajl_tree_free (target);
+      target = calloc (1, sizeof (*target));
+      if (target == NULL)
+        return NULL;
+      target->type = yajl_t_object;
+    }
+
+  for (i = 0; i < patch->u.object.len; i++)
+    {
+      const char *key = patch->u.object.keys[i];
+      yajl_val value = patch->u.object.values[i];
+
+      j = yajl_find (target, key, i);
+      if (value == NULL || YAJL_IS_NULL (value))
+        {
+          if (j < target->u.object.len)
+            yajl_object_remove (target, j);
+          continue;
+        }
+      if (j < target->u.object.len)
+        {
+          target->u.object.values[j] = merge_patch (target->u.object.values[j], value);
+          if (target->u.object.values[j] == NULL)
+            goto err_out;
+          continue;
+        }
+      if (yajl_object_append (target, key, merge_patch (NULL, value)) != 0
+          || target->u.object.values[target->u.object.len - 1] == NULL)
+        goto err_out;
+    }
+  return target;
+
+err_out:
+  yajl_tree_free (target);
+  return NULL;
+}
+
+void *
+json_apply_merge_patch (const struct json_type_desc *desc, const void *ptr, const char *patch,
+                        const struct parser_context *ctx, parser_error *err)
+{
+  struct parser_context tmp_ctx = { 0 };
+  struct parser_context gen_ctx = { 0 };
+  char errbuf[1024];
+  char *text = NULL;
+  yajl_val target = NULL;
+  yajl_val tree = NULL;
+  void *ret = NULL;
+
+  if (desc == NULL || patch == NULL || err == NULL)
+    return NULL;
+  *err = NULL;
+  if (ctx == NULL)
+    ctx = &tmp_ctx;
+
+  tree = yajl_tree_parse (patch, errbuf, sizeof (errbuf));
+  if (tree == NULL)
+    {
+      if (asprintf (err, "cannot parse the merge patch: %s", errbuf) < 0)
+        *err = strdup ("error allocating memory");
+      return NULL;
+    }
+
+  if (ptr != NULL)
+    {
+      gen_ctx.options = OPT_GEN_SIMPLIFY;
+      text = json_gen_to_string (desc->gen, ptr, &gen_ctx, err);
+      if (text == NULL)
+        goto out;
+      target = yajl_tree_parse (text, errbuf, sizeof (errbuf));
+      if (target == NULL)
+        {
+          if (asprintf (err, "cannot parse the generated json: %s", errbuf) < 0)
+            *err = strdup ("error allocating memory");
+          goto out;
+        }
+    }
+
+  target = merge_patch (target, tree);
+  if (target == NULL)
+    {
+      *err = strdup ("error allocating memory");
+      goto out;
+    }
+  if (YAJL_IS_NULL (target))
+    {
+      if (asprintf (err, "merge patch removes the whole %s", desc->name) < 0)
+        *err = strdup ("error allocating memory");
+      goto out;
+    }
+  ret = desc->make (target, ctx, err);
+
+out:
+  yajl_tree_free (target);
+  yajl_tree_free (tree);
+  free (text);
+  return ret;
+}
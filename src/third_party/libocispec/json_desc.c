@@ -0,0 +1,220 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+#include "json_desc.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define JSON_MAP_FUNCS(name)                                                                  \
+  .make = (void *(*) (yajl_val, const struct parser_context *, parser_error *)) make_json_map_##name, \
+  .gen = (json_gen_func) gen_json_map_##name, .free = (void (*) (void *)) free_json_map_##name
+
+const struct json_map_desc json_map_descs[] = {
+  [JSON_MAP_INT_INT] = { true, JSON_KIND_NUMBER, JSON_NUM_INT, "int", JSON_MAP_FUNCS (int_int) },
+  [JSON_MAP_INT_BOOL] = { true, JSON_KIND_BOOL, 0, "bool", JSON_MAP_FUNCS (int_bool) },
+  [JSON_MAP_INT_STRING] = { true, JSON_KIND_STRING, 0, "string", JSON_MAP_FUNCS (int_string) },
+  [JSON_MAP_STRING_INT] = { false, JSON_KIND_NUMBER, JSON_NUM_INT, "int", JSON_MAP_FUNCS (string_int) },
+  [JSON_MAP_STRING_BOOL] = { false, JSON_KIND_BOOL, 0, "bool", JSON_MAP_FUNCS (string_bool) },
+  [JSON_MAP_STRING_INT64] = { false, JSON_KIND_NUMBER, JSON_NUM_INT64, "int64", JSON_MAP_FUNCS (string_int64) },
+  [JSON_MAP_STRING_STRING] = { false, JSON_KIND_STRING, 0, "string", JSON_MAP_FUNCS (string_string) },
+};
+
+const char *const json_number_names[] = {
+  [JSON_NUM_INT] = "integer",
+  [JSON_NUM_INT8] = "int8",
+  [JSON_NUM_INT16] = "int16",
+  [JSON_NUM_INT32] = "int32",
+  [JSON_NUM_INT64] = "int64",
+  [JSON_NUM_UID] = "UID",
+  [JSON_NUM_GID] = "GID",
+  [JSON_NUM_UINT8] = "uint8",
+  [JSON_NUM_UINT16] = "uint16",
+  [JSON_NUM_UINT32] = "uint32",
+  [JSON_NUM_UINT64] = "uint64",
+  [JSON_NUM_DOUBLE] = "double",
+};
+
+size_t
+json_number_size (unsigned char num)
+{
+  switch (num)
+    {
+    case JSON_NUM_INT8:
+    case JSON_NUM_UINT8:
+      return sizeof (uint8_t);
+    case JSON_NUM_INT16:
+    case JSON_NUM_UINT16:
+      return sizeof (uint16_t);
+    case JSON_NUM_INT32:
+    case JSON_NUM_UINT32:
+      return sizeof (uint32_t);
+    case JSON_NUM_INT64:
+    case JSON_NUM_UINT64:
+      return sizeof (uint64_t);
+    case JSON_NUM_DOUBLE:
+      return sizeof (double);
+    case JSON_NUM_UID:
+    case JSON_NUM_GID:
+      return sizeof (unsigned int);
+    default:
+      return sizeof (int);
+    }
+}
+
+size_t
+json_value_size (unsigned char kind, unsigned char num)
+{
+  if (kind == JSON_KIND_BOOL)
+    return sizeof (bool);
+  if (kind == JSON_KIND_NUMBER)
+    return json_number_size (num);
+  return sizeof (void *);
+}
+
+int
+json_number_convert (unsigned char num, const char *numstr, void *dest)
+{
+  switch (num)
+    {
+    case JSON_NUM_INT:
+      return common_safe_int (numstr, (int *) dest);
+    case JSON_NUM_INT8:
+      return common_safe_int8 (numstr, (int8_t *) dest);
+    case JSON_NUM_INT16:
+      return common_safe_int16 (numstr, (int16_t *) dest);
+    case JSON_NUM_INT32:
+      return common_safe_int32 (numstr, (int32_t *) dest);
+    case JSON_NUM_INT64:
+      return common_safe_int64 (numstr, (int64_t *) dest);
+    case JSON_NUM_UID:
+    case JSON_NUM_GID:
+      return common_safe_uint (numstr, (unsigned int *) dest);
+    case JSON_NUM_UINT8:
+      return common_safe_uint8 (numstr, (uint8_t *) dest);
+    case JSON_NUM_UINT16:
+      return common_safe_uint16 (numstr, (uint16_t *) dest);
+    case JSON_NUM_UINT32:
+      return common_safe_uint32 (numstr, (uint32_t *) dest);
+    case JSON_NUM_UINT64:
+      return common_safe_uint64 (numstr, (uint64_t *) dest);
+    case JSON_NUM_DOUBLE:
+      return common_safe_double (numstr, (double *) dest);
+    default:
+      return -EINVAL;
+    }
+}
+
+void
+json_value_free (unsigned char kind, const struct json_field_desc *field, void *ptr)
+{
+  if (ptr == NULL)
+    return;
+  switch (kind)
+    {
+    case JSON_KIND_OBJECT:
+      field->type->free (ptr);
+      break;
+    case JSON_KIND_MAP:
+      json_map_descs[field->map].free (ptr);
+      break;
+    case JSON_KIND_STRING:
+      if (field != NULL && (field->flags & JSON_FIELD_INTERN))
+        json_intern_free (ptr);
+      else
+        free (ptr);
+      break;
+    case JSON_KIND_BOOL_PTR:
+    case JSON_KIND_NUMBER_PTR:
+      free (ptr);
+      break;
+    default:
+      break;
+    }
+}
+
+int64_t
+json_number_load_signed (unsigned char num, const void *src)
+{
+  switch (num)
+    {
+    case JSON_NUM_INT8:
+      return *(const int8_t *) src;
+    case JSON_NUM_INT16:
+      return *(const int16_t *) src;
+    case JSON_NUM_INT32:
+      return *(const int32_t *) src;
+    case JSON_NUM_INT64:
+      return *(const int64_t *) src;
+    default:
+      return *(const int *) src;
+    }
+}
+
+uint64_t
+json_number_load_unsigned (unsigned char num, const void *src)
+{
+  switch (num)
+    {
+    case JSON_NUM_UINT8:
+      return *(const uint8_t *) src;
+    case JSON_NUM_UINT16:
+      return *(const uint16_t *) src;
+    case JSON_NUM_UINT32:
+      return *(const uint32_t *) src;
+    case JSON_NUM_UINT64:
+      return *(const uint64_t *) src;
+    default:
+      return *(const unsigned int *) src;
+    }
+}
+
+bool
+json_field_is_set (const struct json_field_desc *field, const char *base)
+{
+  static const uint8_t zero[sizeof (uint64_t)];
+  const char *src = base + field->offset;
+
+  switch (field->kind)
+    {
+    case JSON_KIND_BOOL:
+      return *(const bool *) src;
+    case JSON_KIND_NUMBER:
+      /* -0.0 is written only with OPT_GEN_KEY_VALUE, like 0 */
+      if (field->num == JSON_NUM_DOUBLE)
+        return *(const double *) src != 0;
+      return memcmp (src, zero, json_number_size (field->num)) != 0;
+    case JSON_KIND_ARRAY:
+      return *(void *const *) src != NULL || *(const size_t *) (base + field->len_offset) > 0;
+    default:
+      return *(void *const *) src != NULL;
+    }
+}
@@ -0,0 +1,309 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+#ifndef __JSON_DESC_H_
+#define __JSON_DESC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "json_common.h"
+
+/* Layout descriptors emitted by the generator for every generated type.
+   They describe where each json key lives inside the C struct, so that
+   generic code can fill or walk a struct without the per-type functions.  */
+
+enum json_field_kind
+{
+  JSON_KIND_STRING = 0,         /* char * */
+  JSON_KIND_BOOL,               /* bool */
+  JSON_KIND_BOOL_PTR,           /* bool * */
+  JSON_KIND_NUMBER,             /* inline number, see enum json_number_type */
+  JSON_KIND_NUMBER_PTR,         /* pointer to a number */
+  JSON_KIND_BYTES,              /* uint8_t * and length, a json string */
+  JSON_KIND_OBJECT,             /* pointer to a generated type */
+  JSON_KIND_MAP,                /* pointer to a json_map_* */
+  JSON_KIND_ARRAY,              /* items pointer and length, items of kind `item' */
+};
+
+enum json_number_type
+{
+  JSON_NUM_INT = 0,
+  JSON_NUM_INT8,
+  JSON_NUM_INT16,
+  JSON_NUM_INT32,
+  JSON_NUM_INT64,
+  JSON_NUM_UID,
+  JSON_NUM_GID,
+  JSON_NUM_UINT8,
+  JSON_NUM_UINT16,
+  JSON_NUM_UINT32,
+  JSON_NUM_UINT64,
+  JSON_NUM_DOUBLE,
+};
+
+enum json_map_kind
+{
+  JSON_MAP_INT_INT = 0,
+  JSON_MAP_INT_BOOL,
+  JSON_MAP_INT_STRING,
+  JSON_MAP_STRING_INT,
+  JSON_MAP_STRING_BOOL,
+  JSON_MAP_STRING_INT64,
+  JSON_MAP_STRING_STRING,
+};
+
+enum json_type_kind
+{
+  JSON_TYPE_OBJECT = 0,         /* struct with one member per key */
+  JSON_TYPE_MAP,                /* mapStringObject: keys, values and len */
+  JSON_TYPE_ARRAY,              /* top level container: items and len */
+};
+
+/* the field must be present, checked only for pointer members as make_ does */
+#define JSON_FIELD_REQUIRED 0x01
+/* array of arrays, with the inner lengths in item_lens_offset */
+#define JSON_FIELD_DOUBLE_ARRAY 0x02
+/* kept as a yajl tree under OPT_PARSE_LAZY until json_lazy_load */
+#define JSON_FIELD_LAZY 0x04
+/* string or strings shared through json_intern under OPT_PARSE_INTERN */
+#define JSON_FIELD_INTERN 0x08
+
+struct json_type_desc;
+
+struct json_field_desc
+{
+  const char *name;
+  /* the value member, or the items of an array */
+  size_t offset;
+  /* size_t length of arrays and bytes */
+  size_t len_offset;
+  /* size_t * inner lengths of double arrays */
+  size_t item_lens_offset;
+  /* descriptor of JSON_KIND_OBJECT values and items */
+  const struct json_type_desc *type;
+  unsigned char kind;
+  /* kind of the items of JSON_KIND_ARRAY */
+  unsigned char item;
+  unsigned char num;
+  unsigned char map;
+  unsigned char flags;
+};
+
+struct json_type_desc
+{
+  const char *name;
+  unsigned char kind;
+  /* object has a _residual member and warns about unknown keys */
+  bool residual;
+  size_t size;
+  size_t residual_offset;
+  /* keys member of JSON_TYPE_MAP, the values are described by fields[0] */
+  size_t keys_offset;
+  const struct json_field_desc *fields;
+  size_t fields_len;
+  /* slot in fields of a key, or -1 */
+  int (*field_index) (const char *key, size_t len);
+  void (*free) (void *ptr);
+  /* _lazy member and decoder of the JSON_FIELD_LAZY fields, by slot */
+  size_t lazy_offset;
+  void *(*lazy_make) (void *ptr, int slot, yajl_val val, const struct parser_context *ctx, parser_error *err);
+  /* gen_<type> and make_<type> */
+  json_gen_func gen;
+  void *(*make) (yajl_val tree, const struct parser_context *ctx, parser_error *err);
+};
+
+/* common layout of the json_map_* types */
+struct json_map_layout
+{
+  void *keys;
+  void *values;
+  size_t len;
+  struct json_map_state *_state;
+};
+
+/* keys and values of the json_map_* types, indexed by enum json_map_kind */
+struct json_map_desc
+{
+  bool int_key;
+  unsigned char kind;
+  unsigned char num;
+  const char *type;
+  /* make_, gen_ and free_json_map_<kind> */
+  void *(*make) (yajl_val src, const struct parser_context *ctx, parser_error *err);
+  json_gen_func gen;
+  void (*free) (void *ptr);
+};
+
+extern const struct json_map_desc json_map_descs[];
+
+/* schema names of the number types, as in the parse errors */
+extern const char *const json_number_names[];
+
+size_t json_number_size (unsigned char num);
+
+/* numstr converted with the common_safe_ function of type num into dest */
+int json_number_convert (unsigned char num, const char *numstr, void *dest);
+
+/* frees ptr, a value of kind described by field */
+void json_value_free (unsigned char kind, const struct json_field_desc *field, void *ptr);
+
+/* size of an inline value of kind, pointers for everything but numbers and bools */
+size_t json_value_size (unsigned char kind, unsigned char num);
+
+/* inline integer of type num at src, widened */
+int64_t json_number_load_signed (unsigned char num, const void *src);
+
+uint64_t json_number_load_unsigned (unsigned char num, const void *src);
+
+/* whether gen_<type> writes the member of base described by field */
+bool json_field_is_set (const struct json_field_desc *field, const char *base);
+
+void *json_stream_parse (const char *jsondata, size_t len, const struct json_type_desc *desc,
+                         const struct parser_context *ctx, parser_error *err);
+
+/* like json_stream_parse, but only for the members named by the NULL
+   terminated json_pointers, the other members stay NULL or zero.  A pointer
+   going into an array or a map selects all of it.  The required members on
+   the way are checked as by json_stream_parse.  OPT_PARSE_FULLKEY and
+   OPT_PARSE_LAZY are refused, they need the whole document.  */
+void *json_stream_parse_paths (const char *jsondata, size_t len, const struct json_type_desc *desc,
+                               const char **json_pointers, const struct parser_context *ctx, parser_error *err);
+
+/* like json_stream_parse, but takes over the malloc'ed jsondata: strings
+   without escapes are terminated in place and point into it.  The buffer
+   goes to the arena of ctx, or to a private arena freed with the result.  */
+void *json_stream_parse_insitu (char *jsondata, size_t len, const struct json_type_desc *desc,
+                                const struct parser_context *ctx, parser_error *err);
+
+/* push parser for a document of type desc of at most max_size bytes,
+   JSON_MAX_SIZE if 0.  It parses as json_stream_parse does.  OPT_PARSE_FULLKEY and
+   OPT_PARSE_LAZY need the whole document: the parser is returned, but its
+   first feed or finish fails.  NULL if out of memory.  */
+struct json_stream_parser *json_stream_parser_new (const struct json_type_desc *desc, size_t max_size,
+                                                   const struct parser_context *ctx);
+
+/* parse the next len bytes of the document, -1 and err once it failed */
+int json_stream_parser_feed (struct json_stream_parser *parser, const char *buf, size_t len, parser_error *err);
+
+/* feed what can be read from the non blocking fd: 1 at the end of the
+   input, 0 when it would block, -1 and err on errors */
+int json_stream_parser_feed_fd (struct json_stream_parser *parser, int fd, parser_error *err);
+
+/* the parsed document, or NULL and err; frees the parser */
+void *json_stream_parser_finish (struct json_stream_parser *parser, parser_error *err);
+
+/* deep copy of the object src of type desc, allocated from the arena of
+   ctx if it has one.  NULL on failure or when src is NULL.  */
+void *json_clone (const struct json_type_desc *desc, const void *src, const struct parser_context *ctx);
+
+/* deep copy of a yajl tree, released with yajl_tree_free */
+yajl_val json_yajl_val_clone (yajl_val src);
+
+/* compact binary form of the object ptr of type desc, see json_binary.c.
+   The malloc'ed result goes to data and its size to len.  */
+int json_binary_encode (const struct json_type_desc *desc, const void *ptr, uint8_t **data, size_t *len,
+                        parser_error *err);
+
+/* the object encoded in data, allocated as json_stream_parse does */
+void *json_binary_decode (const void *data, size_t len, const struct json_type_desc *desc,
+                          const struct parser_context *ctx, parser_error *err);
+
+/* json_binary_decode on the mapped file */
+void *json_binary_decode_file (const char *path, const struct json_type_desc *desc,
+                               const struct parser_context *ctx, parser_error *err);
+
+/* pending value of a lazy member, NULL once decoded or when absent */
+yajl_val json_lazy_get (yajl_val lazy, const char *key);
+
+/* moves val, a member of the object tree, to the pending values in *lazy */
+int json_lazy_keep (yajl_val *lazy, const char *key, yajl_val tree, yajl_val val, const struct parser_context *ctx);
+
+/* copy of the pending values of a lazy member set, with their parse options */
+yajl_val json_lazy_clone (yajl_val lazy);
+
+/* decodes the pending lazy member slot of ptr with the options of the parse
+   and the arena of ctx, which should be that of the parse.  0 when the
+   member is usable, also when it was decoded already.  */
+int json_lazy_load (const struct json_type_desc *desc, void *ptr, int slot, const struct parser_context *ctx,
+                    parser_error *err);
+
+/* ptr with its pending lazy members decoded, in a private shallow copy
+   released with json_lazy_view_free, or ptr itself when none is pending.  */
+const void *json_lazy_view (const struct json_type_desc *desc, const void *ptr);
+
+void json_lazy_view_free (const struct json_type_desc *desc, const void *ptr, const void *view);
+
+/* structural equality of the objects a and b of type desc: members are
+   compared when gen_<type> writes them, and the entries of maps and of the
+   unknown keys regardless of their order.  */
+bool json_equal (const struct json_type_desc *desc, const void *a, const void *b);
+
+/* 64-bit hash of ptr, the same for objects that json_equal considers equal */
+uint64_t json_hash (const struct json_type_desc *desc, const void *ptr);
+
+bool json_yajl_val_equal (yajl_val a, yajl_val b);
+
+/* RFC 7386 merge patch turning a into b, as a malloc'ed json string */
+char *json_diff (const struct json_type_desc *desc, const void *a, const void *b,
+                 const struct parser_context *ctx, parser_error *err);
+
+/* new object of type desc made of ptr with the merge patch applied */
+void *json_apply_merge_patch (const struct json_type_desc *desc, const void *ptr, const char *patch,
+                              const struct parser_context *ctx, parser_error *err);
+
+/* identifies the binary layout of desc, stored in the encoded data */
+uint64_t json_binary_schema_hash (const struct json_type_desc *desc);
+
+/* generic make_, free_ and gen_ of the object and map types, see
+   json_table.c.  With generate.py --tables the per-type functions are
+   wrappers of these.  */
+void *json_table_make (const struct json_type_desc *desc, yajl_val tree, const struct parser_context *ctx,
+                       parser_error *err);
+
+void json_table_free (const struct json_type_desc *desc, void *ptr);
+
+yajl_gen_status json_table_gen (const struct json_type_desc *desc, yajl_gen g, const void *ptr,
+                                const struct parser_context *ctx, parser_error *err);
+
+/* decodes val into the member slot of ptr, as lazy_make does.  ptr, or
+   NULL on failure.  */
+void *json_table_make_member (const struct json_type_desc *desc, void *ptr, int slot, yajl_val val,
+                              const struct parser_context *ctx, parser_error *err);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,777 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+
+/* Writer behind json_gen_to_string and the other json_gen_to_ helpers.  It
+   produces the same bytes as a yajl generator with the default indent, but
+   buffers them and calls the print callback once per buffer, copies the
+   constant keys of the generated code as they are, and escapes strings by
+   copying the runs without special characters whole.  The json_gen_
+   primitives tell a writer from a yajl handle by the writers open on the
+   calling thread, and forward anything else to yajl, so the gen_<type>
+   functions still accept the generator of their caller.
+
+   The unknown keys kept under OPT_PARSE_FULLKEY are the members of their
+   object as compact json text written by such a writer, which is copied
+   into the output as it is unless it has to be indented.  */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "json_common.h"
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* the limits of yajl */
+#define WRITER_MAX_DEPTH 128
+#define WRITER_BUF_SIZE 4096
+#define WRITER_INDENT "    "
+#define WRITER_INDENT_LEN 4
+
+enum writer_state
+{
+  WRITER_START,
+  WRITER_MAP_START,
+  WRITER_MAP_KEY,
+  WRITER_MAP_VAL,
+  WRITER_ARRAY_START,
+  WRITER_IN_ARRAY,
+  WRITER_COMPLETE,
+};
+
+struct json_writer
+{
+  /* the writer opened before this one on the same thread */
+  struct json_writer *prev;
+  yajl_print_t print;
+  void *ctx;
+  struct json_allocator *alloc;
+  bool beautify;
+  bool validate_utf8;
+  unsigned int depth;
+  unsigned char state[WRITER_MAX_DEPTH];
+  size_t used;
+  char buf[WRITER_BUF_SIZE];
+};
+
+static __thread struct json_writer *open_writers;
+
+/* output of a writer kept in a string */
+struct writer_string
+{
+  char *data;
+  size_t len;
+  size_t cap;
+  bool error;
+};
+
+/* bytes that yajl_string_encode replaces, with what it writes for them */
+static const char *const writer_escapes[256] = {
+  ['\b'] = "\\b",
+  ['\t'] = "\\t",
+  ['\n'] = "\\n",
+  ['\f'] = "\\f",
+  ['\r'] = "\\r",
+  ['"'] = "\\\"",
+  ['\\'] = "\\\\",
+};
+
+static inline struct json_writer *
+writer_of (yajl_gen g)
+{
+  struct json_writer *w;
+
+  for (w = open_writers; w != NULL; w = w->prev)
+    if ((void *) w == (void *) g)
+      return w;
+  return NULL;
+}
+
+static void
+writer_flush (struct json_writer *w)
+{
+  if (w->used == 0)
+    return;
+  w->print (w->ctx, w->buf, w->used);
+  w->used = 0;
+}
+
+static inline void
+writer_put (struct json_writer *w, const char *str, size_t len)
+{
+  if (len > WRITER_BUF_SIZE - w->used)
+    {
+      writer_flush (w);
+      if (len >= WRITER_BUF_SIZE)
+        {
+          w->print (w->ctx, str, len);
+          return;
+        }
+    }
+  (void) memcpy (w->buf + w->used, str, len);
+  w->used += len;
+}
+
+static inline void
+writer_putc (struct json_writer *w, char c)
+{
+  if (w->used == WRITER_BUF_SIZE)
+    writer_flush (w);
+  w->buf[w->used++] = c;
+}
+
+static void
+writer_indent (struct json_writer *w)
+{
+  unsigned int i;
+
+  for (i = 0; i < w->depth; i++)
+    writer_put (w, WRITER_INDENT, WRITER_INDENT_LEN);
+}
+
+/* the separator before a key or a value, then its indentation */
+static inline void
+writer_sep (struct json_writer *w)
+{
+  switch (w->state[w->depth])
+    {
+    case WRITER_MAP_KEY:
+    case WRITER_IN_ARRAY:
+      if (w->beautify)
+        writer_put (w, ",\n", 2);
+      else
+        writer_putc (w, ',');
+      break;
+    case WRITER_MAP_VAL:
+      if (w->beautify)
+        writer_put (w, ": ", 2);
+      else
+        writer_putc (w, ':');
+      return;
+    default:
+      break;
+    }
+  if (w->beautify)
+    writer_indent (w);
+}
+
+/* what yajl checks before a value other than a string */
+static inline yajl_gen_status
+writer_value_check (const struct json_writer *w)
+{
+  switch (w->state[w->depth])
+    {
+    case WRITER_COMPLETE:
+      return yajl_gen_generation_complete;
+    case WRITER_MAP_START:
+    case WRITER_MAP_KEY:
+      return yajl_gen_keys_must_be_strings;
+    default:
+      return yajl_gen_status_ok;
+    }
+}
+
+static inline void
+writer_value_end (struct json_writer *w)
+{
+  unsigned char *state = &w->state[w->depth];
+
+  switch (*state)
+    {
+    case WRITER_START:
+      *state = WRITER_COMPLETE;
+      break;
+    case WRITER_MAP_START:
+    case WRITER_MAP_KEY:
+      *state = WRITER_MAP_VAL;
+      break;
+    case WRITER_ARRAY_START:
+      *state = WRITER_IN_ARRAY;
+      break;
+    case WRITER_MAP_VAL:
+      *state = WRITER_MAP_KEY;
+      break;
+    default:
+      break;
+    }
+}
+
+/* a beautified document ends with a new line */
+static inline void
+writer_final_newline (struct json_writer *w)
+{
+  if (w->beautify && w->state[w->depth] == WRITER_COMPLETE)
+    writer_putc (w, '\n');
+}
+
+/* length of the prefix of str that is copied unescaped, i.e. without
+   control characters, quotes and backslashes */
+static inline size_t
+writer_clean_run (const unsigned char *str, size_t len)
+{
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8 ('"');
+  const __m128i backslash = _mm_set1_epi8 ('\\');
+  const __m128i control = _mm_set1_epi8 (0x1f);
+
+  for (; i + 16 <= len; i += 16)
+    {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) (str + i));
+      __m128i special = _mm_or_si128 (_mm_cmpeq_epi8 (v, quote), _mm_cmpeq_epi8 (v, backslash));
+      int mask;
+
+      /* unsigned v <= 0x1f */
+      special = _mm_or_si128 (special, _mm_cmpeq_epi8 (_mm_max_epu8 (v, control), control));
+      mask = _mm_movemask_epi8 (special);
+      if (mask != 0)
+        return i + (size_t) __builtin_ctz ((unsigned int) mask);
+    }
+#else
+  const uint64_t ones = 0x0101010101010101ULL;
+  const uint64_t highs = 0x8080808080808080ULL;
+
+  for (; i + 8 <= len; i += 8)
+    {
+      uint64_t v, quote, backslash;
+
+      (void) memcpy (&v, str + i, sizeof (v));
+      quote = v ^ (ones * '"');
+      backslash = v ^ (ones * '\\');
+      /* a byte below 0x20, or a zero byte after one of the xors */
+      if ((((v - ones * 0x20) & ~v) | ((quote - ones) & ~quote) | ((backslash - ones) & ~backslash)) & highs)
+        break;
+    }
+#endif
+  for (; i < len; i++)
+    if (str[i] < 0x20 || str[i] == '"' || str[i] == '\\')
+      break;
+  return i;
+}
+
+static void
+writer_escape (struct json_writer *w, const unsigned char *str, size_t len)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  size_t i = 0;
+
+  while (i < len)
+    {
+      size_t run = writer_clean_run (str + i, len - i);
+      const char *esc;
+
+      writer_put (w, (const char *) str + i, run);
+      i += run;
+      if (i == len)
+        break;
+      esc = writer_escapes[str[i]];
+      if (esc != NULL)
+        writer_put (w, esc, 2);
+      else
+        {
+          char u[6] = { '\\', 'u', '0', '0', hex[str[i] >> 4], hex[str[i] & 0x0f] };
+          writer_put (w, u, sizeof (u));
+        }
+      i++;
+    }
+}
+
+/* the check of yajl_string_validate_utf8, which looks at the lead and
+   continuation bits only */
+static bool
+writer_valid_utf8 (const unsigned char *str, size_t len)
+{
+  size_t i = 0;
+
+  if (str == NULL)
+    return len == 0;
+  while (i < len)
+    {
+      size_t n, k;
+
+#if defined(__SSE2__)
+      if (i + 16 <= len && _mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i *) (str + i))) == 0)
+        {
+          i += 16;
+          continue;
+        }
+#endif
+      if (str[i] <= 0x7f)
+        {
+          i++;
+          continue;
+        }
+      if ((str[i] >> 5) == 0x6)
+        n = 1;
+      else if ((str[i] >> 4) == 0xe)
+        n = 2;
+      else if ((str[i] >> 3) == 0x1e)
+        n = 3;
+      else
+        return false;
+      if (len - i - 1 < n)
+        return false;
+      for (k = 1; k <= n; k++)
+        if ((str[i + k] >> 6) != 0x2)
+          return false;
+      i += n + 1;
+    }
+  return true;
+}
+
+static yajl_gen_status
+writer_open (struct json_writer *w, unsigned char state, char c)
+{
+  yajl_gen_status stat = writer_value_check (w);
+
+  if (stat != yajl_gen_status_ok)
+    return stat;
+  writer_sep (w);
+  if (w->depth + 1 >= WRITER_MAX_DEPTH)
+    return yajl_max_depth_exceeded;
+  w->state[++w->depth] = state;
+  writer_putc (w, c);
+  if (w->beautify)
+    writer_putc (w, '\n');
+  return yajl_gen_status_ok;
+}
+
+static yajl_gen_status
+writer_close (struct json_writer *w, char c)
+{
+  if (w->state[w->depth] == WRITER_COMPLETE || w->depth == 0)
+    return yajl_gen_generation_complete;
+  w->depth--;
+  if (w->beautify)
+    writer_putc (w, '\n');
+  writer_value_end (w);
+  if (w->beautify && w->state[w->depth] != WRITER_MAP_VAL)
+    writer_indent (w);
+  writer_putc (w, c);
+  writer_final_newline (w);
+  return yajl_gen_status_ok;
+}
+
+/* a string which is already escaped */
+static yajl_gen_status
+writer_raw_string (struct json_writer *w, const char *str, size_t len)
+{
+  if (w->state[w->depth] == WRITER_COMPLETE)
+    return yajl_gen_generation_complete;
+  writer_sep (w);
+  writer_putc (w, '"');
+  writer_put (w, str, len);
+  writer_putc (w, '"');
+  writer_value_end (w);
+  writer_final_newline (w);
+  return yajl_gen_status_ok;
+}
+
+static yajl_gen_status
+writer_atom (struct json_writer *w, const char *str, size_t len)
+{
+  yajl_gen_status stat = writer_value_check (w);
+
+  if (stat != yajl_gen_status_ok)
+    return stat;
+  writer_sep (w);
+  writer_put (w, str, len);
+  writer_value_end (w);
+  writer_final_newline (w);
+  return yajl_gen_status_ok;
+}
+
+yajl_gen
+json_gen_writer_alloc (yajl_print_t print, void *ctx, bool beautify, bool validate_utf8,
+                       struct json_allocator *alloc)
+{
+  struct json_writer *w;
+
+  if (print == NULL)
+    return NULL;
+  w = json_alloc_calloc (alloc, 1, sizeof (*w));
+  if (w == NULL)
+    return NULL;
+  w->print = print;
+  w->ctx = ctx;
+  w->alloc = alloc;
+  w->beautify = beautify;
+  w->validate_utf8 = validate_utf8;
+  w->prev = open_writers;
+  open_writers = w;
+  return (yajl_gen) (void *) w;
+}
+
+void
+json_gen_writer_flush (yajl_gen g)
+{
+  struct json_writer *w = writer_of (g);
+
+  if (w != NULL)
+    writer_flush (w);
+}
+
+void
+json_gen_writer_free (yajl_gen g)
+{
+  struct json_writer **link;
+
+  for (link = &open_writers; *link != NULL; link = &(*link)->prev)
+    if ((void *) *link == (void *) g)
+      {
+        struct json_writer *w = *link;
+
+        *link = w->prev;
+        json_alloc_free (w->alloc, w);
+        return;
+      }
+}
+
+void
+json_gen_beautify (yajl_gen g, int on)
+{
+  struct json_writer *w = writer_of (g);
+
+  if (w == NULL)
+    {
+      (void) yajl_gen_config (g, yajl_gen_beautify, on);
+      return;
+    }
+  w->beautify = on != 0;
+}
+
+yajl_gen_status
+json_gen_map_open (yajl_gen g)
+{
+  struct json_writer *w = writer_of (g);
+
+  if (w == NULL)
+    return yajl_gen_map_open (g);
+  return writer_open (w, WRITER_MAP_START, '{');
+}
+
+yajl_gen_status
+json_gen_map_close (yajl_gen g)
+{
+  struct json_writer *w = writer_of (g);
+
+  if (w == NULL)
+    return yajl_gen_map_close (g);
+  return writer_close (w, '}');
+}
+
+yajl_gen_status
+json_gen_array_open (yajl_gen g)
+{
+  struct json_writer *w = writer_of (g);
+
+  if (w == NULL)
+    return yajl_gen_array_open (g);
+  return writer_open (w, WRITER_ARRAY_START, '[');
+}
+
+yajl_gen_status
+json_gen_array_close (yajl_gen g)
+{
+  struct json_writer *w = writer_of (g);
+
+  if (w == NULL)
+    return yajl_gen_array_close (g);
+  return writer_close (w, ']');
+}
+
+yajl_gen_status
+json_gen_null (yajl_gen g)
+{
+  struct json_writer *w = writer_of (g);
+
+  if (w == NULL)
+    return yajl_gen_null (g);
+  return writer_atom (w, "null", 4);
+}
+
+yajl_gen_status
+json_gen_bool (yajl_gen g, int boolean)
+{
+  struct json_writer *w = writer_of (g);
+
+  if (w == NULL)
+    return yajl_gen_bool (g, boolean);
+  return boolean ? writer_atom (w, "true", 4) : writer_atom (w, "false", 5);
+}
+
+yajl_gen_status
+json_gen_number (yajl_gen g, const char *str, size_t len)
+{
+  struct json_writer *w = writer_of (g);
+
+  if (w == NULL)
+    return yajl_gen_number (g, str, len);
+  return writer_atom (w, str, len);
+}
+
+yajl_gen_status
+json_gen_double (yajl_gen g, double number)
+{
+  struct json_writer *w = writer_of (g);
+  yajl_gen_status stat;
+  char str[32];
+  int len;
+
+  if (w == NULL)
+    return yajl_gen_double (g, number);
+  stat = writer_value_check (w);
+  if (stat != yajl_gen_status_ok)
+    return stat;
+  if (isnan (number) || isinf (number))
+    return yajl_gen_invalid_number;
+  len = snprintf (str, sizeof (str) - 2, "%.20g", number);
+  if (len < 0 || (size_t) len >= sizeof (str) - 2)
+    return yajl_gen_invalid_number;
+  if (strspn (str, "0123456789-") == (size_t) len)
+    {
+      (void) memcpy (str + len, ".0", 2);
+      len += 2;
+    }
+  return writer_atom (w, str, (size_t) len);
+}
+
+yajl_gen_status
+json_gen_string (yajl_gen g, const unsigned char *str, size_t len)
+{
+  struct json_writer *w = writer_of (g);
+
+  if (w == NULL)
+    return yajl_gen_string (g, str, len);
+  if (w->validate_utf8 && !writer_valid_utf8 (str, len))
+    return yajl_gen_invalid_string;
+  if (w->state[w->depth] == WRITER_COMPLETE)
+    return yajl_gen_generation_complete;
+  writer_sep (w);
+  writer_putc (w, '"');
+  writer_escape (w, str, len);
+  writer_putc (w, '"');
+  writer_value_end (w);
+  writer_final_newline (w);
+  return yajl_gen_status_ok;
+}
+
+yajl_gen_status
+json_gen_key (yajl_gen g, const char *key, size_t len)
+{
+  struct json_writer *w = writer_of (g);
+
+  if (w == NULL)
+    return yajl_gen_string (g, (const unsigned char *) key, len);
+  return writer_raw_string (w, key, len);
+}
+
+static void
+writer_string_print (void *ctx, const char *str, size_t len)
+{
+  struct writer_string *out = ctx;
+  size_t cap;
+  char *tmp;
+
+  if (out->error)
+    return;
+  if (out->cap - out->len <= len)
+    {
+      cap = out->cap != 0 ? out->cap : 256;
+      while (cap - out->len <= len)
+        cap *= 2;
+      tmp = realloc (out->data, cap);
+      if (tmp == NULL)
+        {
+          out->error = true;
+          return;
+        }
+      out->data = tmp;
+      out->cap = cap;
+    }
+  (void) memcpy (out->data + out->len, str, len);
+  out->len += len;
+  out->data[out->len] = '\0';
+}
+
+int
+json_residual_make (yajl_val tree, int (*field_index) (const char *key, size_t len),
+                    const struct parser_context *ctx, char **residual)
+{
+  struct writer_string out = { 0 };
+  parser_error err = NULL;
+  const char *key;
+  yajl_gen g;
+  size_t i;
+  int ret = -1;
+
+  *residual = NULL;
+  if (!YAJL_IS_OBJECT (tree))
+    return 0;
+  g = json_gen_writer_alloc (writer_string_print, &out, false, false, ctx != NULL ? ctx->allocator : NULL);
+  if (g == NULL)
+    return -1;
+  /* the members are written in an object, whose brace is dropped */
+  if (json_gen_map_open (g) != yajl_gen_status_ok)
+    goto out;
+  for (i = 0; i < tree->u.object.len; i++)
+    {
+      key = tree->u.object.keys[i];
+      if (key == NULL || (field_index != NULL && field_index (key, strlen (key)) >= 0))
+        continue;
+      if (json_gen_string (g, (const unsigned char *) key, strlen (key)) != yajl_gen_status_ok
+          || gen_yajl_val (tree->u.object.values[i], g, &err) != yajl_gen_status_ok)
+        goto out;
+    }
+  json_gen_writer_flush (g);
+  if (out.error)
+    goto out;
+  ret = 0;
+  if (out.len <= 1)
+    goto out;
+  if (ctx != NULL && ctx->arena != NULL)
+    {
+      *residual = json_ctx_strdup (ctx, out.data + 1);
+      ret = *residual != NULL ? 0 : -1;
+      goto out;
+    }
+  (void) memmove (out.data, out.data + 1, out.len);
+  *residual = out.data;
+  out.data = NULL;
+
+out:
+  json_gen_writer_free (g);
+  free (out.data);
+  free (err);
+  return ret;
+}
+
+yajl_val
+json_residual_tree (const char *residual)
+{
+  char errbuf[256];
+  char *text = NULL;
+  yajl_val tree;
+
+  if (residual == NULL || asprintf (&text, "{%s}", residual) < 0)
+    return NULL;
+  tree = yajl_tree_parse (text, errbuf, sizeof (errbuf));
+  free (text);
+  if (tree != NULL && !YAJL_IS_OBJECT (tree))
+    {
+      yajl_tree_free (tree);
+      return NULL;
+    }
+  return tree;
+}
+
+/* writes the members again through the writer, which indents them */
+static yajl_gen_status
+writer_replay (struct json_writer *w, const char *text)
+{
+  yajl_gen_status stat = yajl_gen_status_ok;
+  const char *p = text;
+  const char *end;
+
+  while (*p != '\0' && stat == yajl_gen_status_ok)
+    {
+      switch (*p)
+        {
+        case '{':
+          stat = writer_open (w, WRITER_MAP_START, '{');
+          p++;
+          break;
+        case '[':
+          stat = writer_open (w, WRITER_ARRAY_START, '[');
+          p++;
+          break;
+        case '}':
+        case ']':
+          stat = writer_close (w, *p);
+          p++;
+          break;
+        case ',':
+        case ':':
+          p++;
+          break;
+        case '"':
+          for (end = p + 1; *end != '"'; end++)
+            if (*end == '\0' || (*end == '\\' && *++end == '\0'))
+              return yajl_gen_in_error_state;
+          stat = writer_raw_string (w, p + 1, (size_t) (end - p - 1));
+          p = end + 1;
+          break;
+        default:
+          end = p + strcspn (p, ",:]}");
+          stat = writer_atom (w, p, (size_t) (end - p));
+          p = end;
+          break;
+        }
+    }
+  return stat;
+}
+
+yajl_gen_status
+json_gen_residual (yajl_gen g, const char *residual, parser_error *err)
+{
+  struct json_writer *w = writer_of (g);
+  yajl_gen_status stat;
+  yajl_val tree;
+
+  if (residual == NULL || *residual == '\0')
+    return yajl_gen_status_ok;
+  if (w == NULL)
+    {
+      tree = json_residual_tree (residual);
+      if (tree == NULL)
+        return yajl_gen_in_error_state;
+      stat = gen_yajl_object_residual (tree, g, err);
+      yajl_tree_free (tree);
+      return stat;
+    }
+  if (w->state[w->depth] != WRITER_MAP_START && w->state[w->depth] != WRITER_MAP_KEY)
+    return w->state[w->depth] == WRITER_COMPLETE ? yajl_gen_generation_complete : yajl_gen_in_error_state;
+  if (w->beautify)
+    return writer_replay (w, residual);
+  writer_sep (w);
+  writer_put (w, residual, strlen (residual));
+  w->state[w->depth] = WRITER_MAP_KEY;
+  return yajl_gen_status_ok;
+}
@@ -0,0 +1,229 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+
+
+/* Process wide pool of interned strings for the members marked "intern" in
+   the schema, parsed with OPT_PARSE_INTERN.  Such values come from a small
+   set (mount types and options, capability and syscall names), so every
+   container config shares one copy of them instead of a strdup each.  The
+   pool is split in shards by hash, each an open addressing set behind its
+   own mutex, and the strings are packed in chunks that live as long as the
+   process.  The chunks are also kept on a list that only ever grows, which
+   lets json_interned tell a pooled string apart without any lock.  */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "json_common.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERN_SHARD_BITS 4
+#define INTERN_SHARDS (1 << INTERN_SHARD_BITS)
+#define INTERN_CHUNK_SIZE 4096
+/* longer values hardly repeat, they are copied as usual */
+#define INTERN_MAX_LEN 255
+
+struct intern_chunk
+{
+  struct intern_chunk *next;
+  size_t used;
+  char data[INTERN_CHUNK_SIZE];
+};
+
+struct intern_shard
+{
+  pthread_mutex_t lock;
+  /* a power of two of slots, NULL when free */
+  const char **strs;
+  uint64_t *hashes;
+  size_t cap;
+  size_t len;
+  /* the chunk being filled */
+  struct intern_chunk *chunk;
+};
+
+static struct intern_shard shards[INTERN_SHARDS] = {
+  [0 ... INTERN_SHARDS - 1] = { .lock = PTHREAD_MUTEX_INITIALIZER },
+};
+
+/* every chunk of every shard, newest first */
+static struct intern_chunk *chunks;
+static size_t interned_strings;
+static size_t interned_bytes;
+
+static uint64_t
+intern_hash (const char *str, size_t len)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      hash ^= (unsigned char) str[i];
+      hash *= 0x100000001b3ULL;
+    }
+  return hash;
+}
+
+static bool
+shard_grow (struct intern_shard *shard)
+{
+  size_t cap = shard->cap != 0 ? shard->cap * 2 : 64;
+  const char **strs = calloc (cap, sizeof (*strs));
+  uint64_t *hashes = calloc (cap, sizeof (*hashes));
+  size_t i, j;
+
+  if (strs == NULL || hashes == NULL)
+    {
+      free (strs);
+      free (hashes);
+      return false;
+    }
+  for (i = 0; i < shard->cap; i++)
+    {
+      if (shard->strs[i] == NULL)
+        continue;
+      for (j = shard->hashes[i] & (cap - 1); strs[j] != NULL; j = (j + 1) & (cap - 1))
+        ;
+      strs[j] = shard->strs[i];
+      hashes[j] = shard->hashes[i];
+    }
+  free (shard->strs);
+  free (shard->hashes);
+  shard->strs = strs;
+  shard->hashes = hashes;
+  shard->cap = cap;
+  return true;
+}
+
+static char *
+shard_store (struct intern_shard *shard, const char *str, size_t len)
+{
+  struct intern_chunk *chunk = shard->chunk;
+  char *ret;
+
+  if (chunk == NULL || INTERN_CHUNK_SIZE - chunk->used < len + 1)
+    {
+      chunk = malloc (sizeof (*chunk));
+      if (chunk == NULL)
+        return NULL;
+      chunk->used = 0;
+      chunk->next = __atomic_load_n (&chunks, __ATOMIC_RELAXED);
+      while (!__atomic_compare_exchange_n (&chunks, &chunk->next, chunk, true, __ATOMIC_RELEASE,
+                                           __ATOMIC_RELAXED))
+        ;
+      shard->chunk = chunk;
+    }
+  ret = chunk->data + chunk->used;
+  (void) memcpy (ret, str, len);
+  ret[len] = '\0';
+  chunk->used += len + 1;
+  return ret;
+}
+
+const char *
+json_intern (const char *str, size_t len)
+{
+  uint64_t hash;
+  struct intern_shard *shard;
+  const char *ret = NULL;
+  size_t i;
+
+  if (str == NULL || len > INTERN_MAX_LEN || memchr (str, '\0', len) != NULL)
+    return NULL;
+  hash = intern_hash (str, len);
+  shard = &shards[hash >> (64 - INTERN_SHARD_BITS)];
+
+  (void) pthread_mutex_lock (&shard->lock);
+  if ((shard->len + 1) * 4 > shard->cap * 3 && !shard_grow (shard))
+    goto out;
+  for (i = hash & (shard->cap - 1); shard->strs[i] != NULL; i = (i + 1) & (shard->cap - 1))
+    if (shard->hashes[i] == hash && strncmp (shard->strs[i], str, len) == 0 && shard->strs[i][len] == '\0')
+      {
+        ret = shard->strs[i];
+        goto out;
+      }
+  ret = shard_store (shard, str, len);
+  if (ret == NULL)
+    goto out;
+  shard->strs[i] = ret;
+  shard->hashes[i] = hash;
+  shard->len++;
+  (void) __atomic_add_fetch (&interned_strings, 1, __ATOMIC_RELAXED);
+  (void) __atomic_add_fetch (&interned_bytes, len + 1, __ATOMIC_RELAXED);
+out:
+  (void) pthread_mutex_unlock (&shard->lock);
+  return ret;
+}
+
+bool
+json_interned (const void *ptr)
+{
+  const struct intern_chunk *chunk;
+
+  if (ptr == NULL)
+    return false;
+  for (chunk = __atomic_load_n (&chunks, __ATOMIC_ACQUIRE); chunk != NULL; chunk = chunk->next)
+    if ((const char *) ptr >= chunk->data && (const char *) ptr < chunk->data + INTERN_CHUNK_SIZE)
+      return true;
+  return false;
+}
+
+void
+json_intern_free (void *ptr)
+{
+  if (!json_interned (ptr))
+    free (ptr);
+}
+
+char *
+json_ctx_intern (const struct parser_context *ctx, const char *src)
+{
+  char *ret = NULL;
+
+  if (ctx != NULL && (ctx->options & OPT_PARSE_INTERN))
+    ret = (char *) json_intern (src, strlen (src));
+  return ret != NULL ? ret : json_ctx_strdup (ctx, src);
+}
+
+void
+json_intern_stats (size_t *strings, size_t *bytes)
+{
+  if (strings != NULL)
+    *strings = __atomic_load_n (&interned_strings, __ATOMIC_RELAXED);
+  if (bytes != NULL)
+    *bytes = __atomic_load_n (&interned_bytes, __ATOMIC_RELAXED);
+}
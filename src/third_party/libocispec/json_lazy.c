@@ -0,0 +1,310 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+/* Members marked "lazy" in the schema are not decoded by a parse with
+   OPT_PARSE_LAZY: their yajl trees move to the _lazy object of the parent
+   and get_<type>_<member> decodes them on first use.  The options of the
+   parse are kept with them, so that a later decode keeps the unknown keys
+   as the parse would have.  Until then gen_<type> writes the kept tree, or
+   a decoded view when simplifying, and the descriptor driven functions look
+   at a decoded view.  */
+
+#include "json_desc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* the object of the kept trees, with the options of the parse behind it;
+   yajl_tree_free releases it like any object */
+struct lazy_set
+{
+  struct yajl_val_s obj;
+  unsigned int options;
+};
+
+static unsigned int
+lazy_options (yajl_val lazy)
+{
+  return ((const struct lazy_set *) lazy)->options;
+}
+
+static size_t
+lazy_find (yajl_val lazy, const char *key)
+{
+  size_t i;
+
+  for (i = 0; i < lazy->u.object.len; i++)
+    if (lazy->u.object.keys[i] != NULL && strcmp (lazy->u.object.keys[i], key) == 0)
+      return i;
+  return lazy->u.object.len;
+}
+
+yajl_val
+json_lazy_get (yajl_val lazy, const char *key)
+{
+  size_t i;
+
+  if (!YAJL_IS_OBJECT (lazy) || key == NULL)
+    return NULL;
+  i = lazy_find (lazy, key);
+  return i < lazy->u.object.len ? lazy->u.object.values[i] : NULL;
+}
+
+int
+json_lazy_keep (yajl_val *lazy, const char *key, yajl_val tree, yajl_val val, const struct parser_context *ctx)
+{
+  yajl_val obj = *lazy;
+  const char **keys;
+  yajl_val *values;
+  size_t i, len;
+
+  if (obj == NULL)
+    {
+      struct lazy_set *set = calloc (1, sizeof (*set));
+
+      if (set == NULL)
+        return -1;
+      set->options = ctx->options;
+      obj = &set->obj;
+      obj->type = yajl_t_object;
+      /* like the unknown keys, the kept trees are released with the arena */
+      if (ctx->arena != NULL && json_arena_defer (ctx->arena, (void (*) (void *)) yajl_tree_free, obj) != 0)
+        {
+          free (obj);
+          return -1;
+        }
+      *lazy = obj;
+    }
+
+  len = obj->u.object.len;
+  keys = realloc (obj->u.object.keys, (len + 1) * sizeof (*keys));
+  if (keys == NULL)
+    return -1;
+  obj->u.object.keys = keys;
+  values = realloc (obj->u.object.values, (len + 1) * sizeof (*values));
+  if (values == NULL)
+    return -1;
+  obj->u.object.values = values;
+  keys[len] = strdup (key);
+  if (keys[len] == NULL)
+    return -1;
+  values[len] = val;
+  obj->u.object.len++;
+
+  /* the tree is released after the parse, without the kept value */
+  for (i = 0; i < tree->u.object.len; i++)
+    if (tree->u.object.values[i] == val)
+      {
+        tree->u.object.values[i] = NULL;
+        break;
+      }
+  return 0;
+}
+
+yajl_val
+json_lazy_clone (yajl_val lazy)
+{
+  struct lazy_set *set;
+  yajl_val obj;
+  size_t i, len;
+
+  if (!YAJL_IS_OBJECT (lazy))
+    return NULL;
+  set = calloc (1, sizeof (*set));
+  if (set == NULL)
+    return NULL;
+  set->options = lazy_options (lazy);
+  obj = &set->obj;
+  obj->type = yajl_t_object;
+  len = lazy->u.object.len;
+  obj->u.object.keys = calloc (len + 1, sizeof (const char *));
+  obj->u.object.values = calloc (len + 1, sizeof (yajl_val));
+  if (obj->u.object.keys == NULL || obj->u.object.values == NULL)
+    goto err_out;
+  for (i = 0; i < len; i++)
+    {
+      obj->u.object.keys[i] = strdup (lazy->u.object.keys[i]);
+      if (obj->u.object.keys[i] == NULL)
+        goto err_out;
+      obj->u.object.len++;
+      obj->u.object.values[i] = json_yajl_val_clone (lazy->u.object.values[i]);
+      if (obj->u.object.values[i] == NULL && lazy->u.object.values[i] != NULL)
+        goto err_out;
+    }
+  return obj;
+
+err_out:
+  yajl_tree_free (obj);
+  return NULL;
+}
+
+static void
+lazy_drop (yajl_val lazy, const char *key)
+{
+  size_t i = lazy_find (lazy, key);
+  size_t rest;
+
+  if (i == lazy->u.object.len)
+    return;
+  rest = lazy->u.object.len - i - 1;
+  free ((char *) lazy->u.object.keys[i]);
+  yajl_tree_free (lazy->u.object.values[i]);
+  (void) memmove (&lazy->u.object.keys[i], &lazy->u.object.keys[i + 1], rest * sizeof (const char *));
+  (void) memmove (&lazy->u.object.values[i], &lazy->u.object.values[i + 1], rest * sizeof (yajl_val));
+  lazy->u.object.len--;
+}
+
+/* the members of field in src, also given to dest */
+static void
+copy_member (const struct json_field_desc *field, char *dest, const char *src)
+{
+  *(void **) (dest + field->offset) = *(void *const *) (src + field->offset);
+  if (field->kind != JSON_KIND_ARRAY)
+    return;
+  *(size_t *) (dest + field->len_offset) = *(const size_t *) (src + field->len_offset);
+  if (field->flags & JSON_FIELD_DOUBLE_ARRAY)
+    *(size_t **) (dest + field->item_lens_offset) = *(size_t *const *) (src + field->item_lens_offset);
+}
+
+static void
+clear_member (const struct json_field_desc *field, char *base)
+{
+  *(void **) (base + field->offset) = NULL;
+  if (field->kind != JSON_KIND_ARRAY)
+    return;
+  *(size_t *) (base + field->len_offset) = 0;
+  if (field->flags & JSON_FIELD_DOUBLE_ARRAY)
+    *(size_t **) (base + field->item_lens_offset) = NULL;
+}
+
+int
+json_lazy_load (const struct json_type_desc *desc, void *ptr, int slot, const struct parser_context *ctx,
+                parser_error *err)
+{
+  struct parser_context tmp_ctx = { 0 };
+  const struct json_field_desc *field;
+  yajl_val lazy, val;
+  char *tmp;
+
+  if (desc == NULL || ptr == NULL || err == NULL || desc->lazy_make == NULL || slot < 0
+      || (size_t) slot >= desc->fields_len)
+    return -1;
+  *err = NULL;
+  field = &desc->fields[slot];
+  lazy = *(yajl_val *) ((char *) ptr + desc->lazy_offset);
+  val = json_lazy_get (lazy, field->name);
+  if (val == NULL)
+    return 0;
+  /* the arena of the caller, and the options of the parse on top of its own */
+  if (ctx != NULL)
+    tmp_ctx = *ctx;
+  tmp_ctx.options |= lazy_options (lazy);
+  ctx = &tmp_ctx;
+
+  /* decode in a scratch object, so that a failure leaves ptr as it was */
+  tmp = json_ctx_calloc (ctx, 1, 0, desc->size);
+  if (tmp == NULL)
+    {
+      *err = strdup ("error allocating memory");
+      return -1;
+    }
+  if (desc->lazy_make (tmp, slot, val, ctx, err) == NULL)
+    {
+      desc->free (tmp);
+      if (*err == NULL)
+        *err = strdup ("error allocating memory");
+      return -1;
+    }
+  copy_member (field, ptr, tmp);
+  clear_member (field, tmp);
+  desc->free (tmp);
+  lazy_drop (lazy, field->name);
+  return 0;
+}
+
+/* the view is a copy of ptr followed by the address of the object owning
+   the decoded members */
+const void *
+json_lazy_view (const struct json_type_desc *desc, const void *ptr)
+{
+  struct parser_context heap_ctx = { 0 };
+  yajl_val lazy;
+  char *view, *owner;
+  size_t i;
+
+  if (desc == NULL || ptr == NULL || desc->lazy_make == NULL)
+    return ptr;
+  lazy = *(const yajl_val *) ((const char *) ptr + desc->lazy_offset);
+  if (!YAJL_IS_OBJECT (lazy) || lazy->u.object.len == 0)
+    return ptr;
+
+  view = malloc (desc->size + sizeof (owner));
+  owner = calloc (1, desc->size);
+  if (view == NULL || owner == NULL)
+    {
+      free (view);
+      free (owner);
+      return ptr;
+    }
+  (void) memcpy (view, ptr, desc->size);
+  (void) memcpy (view + desc->size, &owner, sizeof (owner));
+  *(yajl_val *) (view + desc->lazy_offset) = NULL;
+  /* decoded as the parse would have, nested lazy members included */
+  heap_ctx.options = lazy_options (lazy) & ~OPT_PARSE_LAZY;
+
+  for (i = 0; i < desc->fields_len; i++)
+    {
+      const struct json_field_desc *field = &desc->fields[i];
+      parser_error err = NULL;
+      yajl_val val;
+
+      if (!(field->flags & JSON_FIELD_LAZY))
+        continue;
+      val = json_lazy_get (lazy, field->name);
+      if (val == NULL)
+        continue;
+      /* a member failing to decode is left out, as it would be by the parse */
+      if (desc->lazy_make (owner, (int) i, val, &heap_ctx, &err) != NULL)
+        copy_member (field, view, owner);
+      free (err);
+    }
+  return view;
+}
+
+void
+json_lazy_view_free (const struct json_type_desc *desc, const void *ptr, const void *view)
+{
+  char *owner;
+
+  if (view == NULL || view == ptr)
+    return;
+  (void) memcpy (&owner, (const char *) view + desc->size, sizeof (owner));
+  desc->free (owner);
+  free ((void *) view);
+}
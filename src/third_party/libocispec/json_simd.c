@@ -0,0 +1,858 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+/* OPT_PARSE_SIMD front end.  Stage one classifies the input 64 bytes at a
+   time with the vector compares of the cpu, finds the escaped quotes and
+   the spans of the strings with bit arithmetic, and records the offsets of
+   the structural characters, of both quotes of every string and of the
+   first byte of every number or literal.  Stage two walks these offsets
+   with an explicit stack and calls the yajl callbacks, so the decoders are
+   the same ones the yajl backend drives.  */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "json_simd.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef ENABLE_SIMD_JSON
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMD_NEON 1
+#endif
+
+#define SIMD_BLOCK 64
+
+/* one bit per byte of a block */
+struct simd_masks
+{
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t op;
+  uint64_t ws;
+  uint64_t slash;
+};
+
+enum
+{
+  CLASS_QUOTE = 1,
+  CLASS_BACKSLASH = 2,
+  CLASS_OP = 4,
+  CLASS_WS = 8,
+  CLASS_SLASH = 16,
+};
+
+/* the white space of yajl includes \v and \f */
+static const unsigned char simd_class[256] = {
+  ['"'] = CLASS_QUOTE,
+  ['\\'] = CLASS_BACKSLASH,
+  ['{'] = CLASS_OP,
+  ['}'] = CLASS_OP,
+  ['['] = CLASS_OP,
+  [']'] = CLASS_OP,
+  [':'] = CLASS_OP,
+  [','] = CLASS_OP,
+  [' '] = CLASS_WS,
+  ['\t'] = CLASS_WS,
+  ['\n'] = CLASS_WS,
+  ['\v'] = CLASS_WS,
+  ['\f'] = CLASS_WS,
+  ['\r'] = CLASS_WS,
+  ['/'] = CLASS_SLASH,
+};
+
+static inline void
+classify_scalar (const unsigned char *in, struct simd_masks *m)
+{
+  size_t i;
+
+  memset (m, 0, sizeof (*m));
+  for (i = 0; i < SIMD_BLOCK; i++)
+    {
+      uint64_t bit = (uint64_t) 1 << i;
+      unsigned char c = simd_class[in[i]];
+
+      m->quote |= (c & CLASS_QUOTE) ? bit : 0;
+      m->backslash |= (c & CLASS_BACKSLASH) ? bit : 0;
+      m->op |= (c & CLASS_OP) ? bit : 0;
+      m->ws |= (c & CLASS_WS) ? bit : 0;
+      m->slash |= (c & CLASS_SLASH) ? bit : 0;
+    }
+}
+
+#ifdef SIMD_X86
+/* SSE2 is part of x86_64, the byte compares are all that is needed */
+static inline void
+classify_sse2 (const unsigned char *in, struct simd_masks *m)
+{
+  size_t i;
+
+  memset (m, 0, sizeof (*m));
+  for (i = 0; i < SIMD_BLOCK / 16; i++)
+    {
+      __m128i v = _mm_loadu_si128 ((const __m128i *) (in + 16 * i));
+      /* '[' and ']' are '{' and '}' without 0x20 */
+      __m128i lower = _mm_or_si128 (v, _mm_set1_epi8 (0x20));
+      __m128i op = _mm_or_si128 (_mm_or_si128 (_mm_cmpeq_epi8 (lower, _mm_set1_epi8 ('{')),
+                                               _mm_cmpeq_epi8 (lower, _mm_set1_epi8 ('}'))),
+                                 _mm_or_si128 (_mm_cmpeq_epi8 (v, _mm_set1_epi8 (':')),
+                                               _mm_cmpeq_epi8 (v, _mm_set1_epi8 (','))));
+      /* \t \n \v \f \r are 9 to 13 */
+      __m128i ctl = _mm_sub_epi8 (v, _mm_set1_epi8 ('\t'));
+      __m128i ws = _mm_or_si128 (_mm_cmpeq_epi8 (_mm_min_epu8 (ctl, _mm_set1_epi8 (4)), ctl),
+                                 _mm_cmpeq_epi8 (v, _mm_set1_epi8 (' ')));
+      unsigned int shift = 16 * i;
+
+      m->quote |= (uint64_t) (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (v, _mm_set1_epi8 ('"'))) << shift;
+      m->backslash |= (uint64_t) (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (v, _mm_set1_epi8 ('\\'))) << shift;
+      m->op |= (uint64_t) (uint16_t) _mm_movemask_epi8 (op) << shift;
+      m->ws |= (uint64_t) (uint16_t) _mm_movemask_epi8 (ws) << shift;
+      m->slash |= (uint64_t) (uint16_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (v, _mm_set1_epi8 ('/'))) << shift;
+    }
+}
+
+__attribute__ ((target ("avx2"))) static inline void
+classify_avx2 (const unsigned char *in, struct simd_masks *m)
+{
+  size_t i;
+
+  memset (m, 0, sizeof (*m));
+  for (i = 0; i < SIMD_BLOCK / 32; i++)
+    {
+      __m256i v = _mm256_loadu_si256 ((const __m256i *) (in + 32 * i));
+      __m256i lower = _mm256_or_si256 (v, _mm256_set1_epi8 (0x20));
+      __m256i op = _mm256_or_si256 (_mm256_or_si256 (_mm256_cmpeq_epi8 (lower, _mm256_set1_epi8 ('{')),
+                                                     _mm256_cmpeq_epi8 (lower, _mm256_set1_epi8 ('}'))),
+                                    _mm256_or_si256 (_mm256_cmpeq_epi8 (v, _mm256_set1_epi8 (':')),
+                                                     _mm256_cmpeq_epi8 (v, _mm256_set1_epi8 (','))));
+      __m256i ctl = _mm256_sub_epi8 (v, _mm256_set1_epi8 ('\t'));
+      __m256i ws = _mm256_or_si256 (_mm256_cmpeq_epi8 (_mm256_min_epu8 (ctl, _mm256_set1_epi8 (4)), ctl),
+                                    _mm256_cmpeq_epi8 (v, _mm256_set1_epi8 (' ')));
+      unsigned int shift = 32 * i;
+
+      m->quote |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (v, _mm256_set1_epi8 ('"'))) << shift;
+      m->backslash |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (v, _mm256_set1_epi8 ('\\')))
+                      << shift;
+      m->op |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (op) << shift;
+      m->ws |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (ws) << shift;
+      m->slash |= (uint64_t) (uint32_t) _mm256_movemask_epi8 (_mm256_cmpeq_epi8 (v, _mm256_set1_epi8 ('/'))) << shift;
+    }
+}
+#endif
+
+#ifdef SIMD_NEON
+/* neon has no movemask: weight the lanes and add them up pairwise */
+static inline uint64_t
+neon_bits (uint8x16_t c0, uint8x16_t c1, uint8x16_t c2, uint8x16_t c3)
+{
+  const uint8x16_t weight = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+  uint8x16_t s0 = vpaddq_u8 (vandq_u8 (c0, weight), vandq_u8 (c1, weight));
+  uint8x16_t s1 = vpaddq_u8 (vandq_u8 (c2, weight), vandq_u8 (c3, weight));
+
+  s0 = vpaddq_u8 (s0, s1);
+  s0 = vpaddq_u8 (s0, s0);
+  return vgetq_lane_u64 (vreinterpretq_u64_u8 (s0), 0);
+}
+
+static inline void
+classify_neon (const unsigned char *in, struct simd_masks *m)
+{
+  uint8x16_t quote[4], backslash[4], op[4], ws[4], slash[4];
+  size_t i;
+
+  for (i = 0; i < 4; i++)
+    {
+      uint8x16_t v = vld1q_u8 (in + 16 * i);
+      uint8x16_t lower = vorrq_u8 (v, vdupq_n_u8 (0x20));
+      uint8x16_t ctl = vsubq_u8 (v, vdupq_n_u8 ('\t'));
+
+      quote[i] = vceqq_u8 (v, vdupq_n_u8 ('"'));
+      backslash[i] = vceqq_u8 (v, vdupq_n_u8 ('\\'));
+      op[i] = vorrq_u8 (vorrq_u8 (vceqq_u8 (lower, vdupq_n_u8 ('{')), vceqq_u8 (lower, vdupq_n_u8 ('}'))),
+                        vorrq_u8 (vceqq_u8 (v, vdupq_n_u8 (':')), vceqq_u8 (v, vdupq_n_u8 (','))));
+      ws[i] = vorrq_u8 (vcleq_u8 (ctl, vdupq_n_u8 (4)), vceqq_u8 (v, vdupq_n_u8 (' ')));
+      slash[i] = vceqq_u8 (v, vdupq_n_u8 ('/'));
+    }
+  m->quote = neon_bits (quote[0], quote[1], quote[2], quote[3]);
+  m->backslash = neon_bits (backslash[0], backslash[1], backslash[2], backslash[3]);
+  m->op = neon_bits (op[0], op[1], op[2], op[3]);
+  m->ws = neon_bits (ws[0], ws[1], ws[2], ws[3]);
+  m->slash = neon_bits (slash[0], slash[1], slash[2], slash[3]);
+}
+#endif
+
+/* bits of backslash sequences of odd length escape the byte after them */
+static inline uint64_t
+find_escaped (uint64_t backslash, uint64_t *prev_escaped)
+{
+  const uint64_t even = 0x5555555555555555ULL;
+  uint64_t follows, odd_starts, even_seqs;
+
+  backslash &= ~*prev_escaped;
+  follows = backslash << 1 | *prev_escaped;
+  odd_starts = backslash & ~even & ~follows;
+  even_seqs = odd_starts + backslash;
+  *prev_escaped = even_seqs < backslash;
+  return (even ^ (even_seqs << 1)) & follows;
+}
+
+/* every bit from an opening quote up to the byte before the closing one */
+static inline uint64_t
+prefix_xor (uint64_t x)
+{
+  x ^= x << 1;
+  x ^= x << 2;
+  x ^= x << 4;
+  x ^= x << 8;
+  x ^= x << 16;
+  x ^= x << 32;
+  return x;
+}
+
+struct simd_index
+{
+  uint32_t *pos;
+  size_t len;
+  size_t cap;
+};
+
+typedef void (*simd_classify_func) (const unsigned char *in, struct simd_masks *m);
+
+/* stage one, inlined in every kernel with its classifier */
+static inline __attribute__ ((always_inline)) int
+index_blocks (const unsigned char *data, size_t len, struct simd_index *idx, simd_classify_func classify)
+{
+  uint64_t prev_escaped = 0, prev_in_string = 0, prev_scalar = 0;
+  unsigned char tail[SIMD_BLOCK];
+  size_t off;
+
+  for (off = 0; off < len; off += SIMD_BLOCK)
+    {
+      const unsigned char *block = data + off;
+      struct simd_masks m;
+      uint64_t quote, in_string, scalar, bits;
+
+      if (len - off < SIMD_BLOCK)
+        {
+          memset (tail, ' ', sizeof (tail));
+          memcpy (tail, block, len - off);
+          block = tail;
+        }
+      classify (block, &m);
+
+      quote = m.quote & ~find_escaped (m.backslash, &prev_escaped);
+      in_string = prefix_xor (quote) ^ prev_in_string;
+      prev_in_string = (uint64_t) ((int64_t) in_string >> 63);
+      /* comments are left to yajl */
+      if (m.slash & ~in_string)
+        return 1;
+      scalar = ~(m.op | m.ws | quote | in_string);
+      bits = (m.op & ~in_string) | quote | (scalar & ~(scalar << 1 | prev_scalar));
+      prev_scalar = scalar >> 63;
+
+      if (idx->cap - idx->len < SIMD_BLOCK)
+        {
+          size_t cap = idx->cap * 2 + SIMD_BLOCK;
+          uint32_t *pos = realloc (idx->pos, cap * sizeof (*pos));
+          if (pos == NULL)
+            return -1;
+          idx->pos = pos;
+          idx->cap = cap;
+        }
+      while (bits != 0)
+        {
+          idx->pos[idx->len++] = (uint32_t) (off + __builtin_ctzll (bits));
+          bits &= bits - 1;
+        }
+    }
+  return 0;
+}
+
+static int
+index_scalar (const unsigned char *data, size_t len, struct simd_index *idx)
+{
+  return index_blocks (data, len, idx, classify_scalar);
+}
+
+#ifdef SIMD_X86
+static int
+index_sse2 (const unsigned char *data, size_t len, struct simd_index *idx)
+{
+  return index_blocks (data, len, idx, classify_sse2);
+}
+
+__attribute__ ((target ("avx2"))) static int
+index_avx2 (const unsigned char *data, size_t len, struct simd_index *idx)
+{
+  return index_blocks (data, len, idx, classify_avx2);
+}
+
+static bool
+cpu_has_avx2 (void)
+{
+  __builtin_cpu_init ();
+  return __builtin_cpu_supports ("avx2");
+}
+#endif
+
+#ifdef SIMD_NEON
+static int
+index_neon (const unsigned char *data, size_t len, struct simd_index *idx)
+{
+  return index_blocks (data, len, idx, classify_neon);
+}
+#endif
+
+struct simd_kernel
+{
+  const char *name;
+  int (*index) (const unsigned char *data, size_t len, struct simd_index *idx);
+  /* NULL when the kernel is always there */
+  bool (*available) (void);
+};
+
+/* best first */
+static const struct simd_kernel simd_kernels[] = {
+#ifdef SIMD_X86
+  { "avx2", index_avx2, cpu_has_avx2 },
+  { "sse2", index_sse2, NULL },
+#endif
+#ifdef SIMD_NEON
+  { "neon", index_neon, NULL },
+#endif
+  { "scalar", index_scalar, NULL },
+};
+
+static const struct simd_kernel *simd_current;
+
+static const struct simd_kernel *
+current_kernel (void)
+{
+  const struct simd_kernel *k = __atomic_load_n (&simd_current, __ATOMIC_ACQUIRE);
+  size_t i;
+
+  if (k != NULL)
+    return k;
+  for (i = 0; i < sizeof (simd_kernels) / sizeof (simd_kernels[0]); i++)
+    {
+      if (simd_kernels[i].available == NULL || simd_kernels[i].available ())
+        break;
+    }
+  k = &simd_kernels[i];
+  __atomic_store_n (&simd_current, k, __ATOMIC_RELEASE);
+  return k;
+}
+
+bool
+json_simd_supported (void)
+{
+  return true;
+}
+
+const char *
+json_simd_kernel (void)
+{
+  return current_kernel ()->name;
+}
+
+int
+json_simd_set_kernel (const char *name)
+{
+  size_t i;
+
+  if (name == NULL)
+    {
+      __atomic_store_n (&simd_current, NULL, __ATOMIC_RELEASE);
+      return 0;
+    }
+  for (i = 0; i < sizeof (simd_kernels) / sizeof (simd_kernels[0]); i++)
+    {
+      const struct simd_kernel *k = &simd_kernels[i];
+      if (strcmp (k->name, name) != 0)
+        continue;
+      if (k->available != NULL && !k->available ())
+        return -1;
+      __atomic_store_n (&simd_current, k, __ATOMIC_RELEASE);
+      return 0;
+    }
+  return -1;
+}
+
+struct simd_parser
+{
+  const yajl_callbacks *cb;
+  void *ctx;
+  const unsigned char *data;
+  size_t len;
+  bool writable;
+  const uint32_t *pos;
+  size_t npos;
+  /* next offset of pos */
+  size_t i;
+  /* unescaped strings when the input is read only */
+  unsigned char *scratch;
+  size_t scratch_cap;
+  char *err;
+};
+
+static int
+parser_error (struct simd_parser *p, const char *msg)
+{
+  if (p->err == NULL)
+    p->err = strdup (msg);
+  return -1;
+}
+
+static bool
+hex4 (const unsigned char *s, unsigned int *out)
+{
+  unsigned int v = 0;
+  size_t i;
+
+  for (i = 0; i < 4; i++)
+    {
+      unsigned char c = s[i];
+      v <<= 4;
+      if (c >= '0' && c <= '9')
+        v |= c - '0';
+      else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        v |= (c | 0x20) - 'a' + 10;
+      else
+        return false;
+    }
+  *out = v;
+  return true;
+}
+
+static size_t
+utf8_encode (unsigned int cp, unsigned char *out)
+{
+  if (cp < 0x80)
+    {
+      out[0] = cp;
+      return 1;
+    }
+  if (cp < 0x800)
+    {
+      out[0] = 0xc0 | (cp >> 6);
+      out[1] = 0x80 | (cp & 0x3f);
+      return 2;
+    }
+  if (cp < 0x10000)
+    {
+      out[0] = 0xe0 | (cp >> 12);
+      out[1] = 0x80 | ((cp >> 6) & 0x3f);
+      out[2] = 0x80 | (cp & 0x3f);
+      return 3;
+    }
+  out[0] = 0xf0 | (cp >> 18);
+  out[1] = 0x80 | ((cp >> 12) & 0x3f);
+  out[2] = 0x80 | ((cp >> 6) & 0x3f);
+  out[3] = 0x80 | (cp & 0x3f);
+  return 4;
+}
+
+/* length of the utf8 sequence led by c, checked the way the lexer of yajl does */
+static size_t
+utf8_len (unsigned char c)
+{
+  if ((c >> 5) == 0x6)
+    return 2;
+  if ((c >> 4) == 0xe)
+    return 3;
+  if ((c >> 3) == 0x1e)
+    return 4;
+  return 0;
+}
+
+/* the string between the quotes at the offsets i and i + 1; escapes are
+   decoded like yajl does: \u0000 is dropped and a high surrogate not
+   followed by a \u escape becomes '?'.  */
+static int
+parse_string (struct simd_parser *p, bool key)
+{
+  const unsigned char *s;
+  unsigned char *out;
+  size_t n, r, w;
+  int ok;
+
+  if (p->i + 1 >= p->npos)
+    return parser_error (p, "premature EOF");
+  s = p->data + p->pos[p->i] + 1;
+  n = p->data + p->pos[p->i + 1] - s;
+  p->i += 2;
+
+  for (r = 0; r < n; r++)
+    {
+      if (s[r] == '\\' || s[r] < 0x20 || s[r] >= 0x80)
+        break;
+    }
+  out = (unsigned char *) s;
+  if (r < n && !p->writable)
+    {
+      if (p->scratch_cap < n)
+        {
+          unsigned char *scratch = realloc (p->scratch, n);
+          if (scratch == NULL)
+            return parser_error (p, "error allocating memory");
+          p->scratch = scratch;
+          p->scratch_cap = n;
+        }
+      out = p->scratch;
+      (void) memcpy (out, s, r);
+    }
+
+  w = r;
+  while (r < n)
+    {
+      unsigned char c = s[r];
+      unsigned int cp, lo;
+      size_t k;
+
+      if (c < 0x20)
+        return parser_error (p, "invalid character inside string.");
+      if (c >= 0x80)
+        {
+          k = utf8_len (c);
+          if (k == 0 || r + k > n)
+            return parser_error (p, "invalid bytes in UTF8 string.");
+          out[w++] = s[r++];
+          for (; k > 1; k--)
+            {
+              if ((s[r] & 0xc0) != 0x80)
+                return parser_error (p, "invalid bytes in UTF8 string.");
+              out[w++] = s[r++];
+            }
+          continue;
+        }
+      if (c != '\\')
+        {
+          out[w++] = s[r++];
+          continue;
+        }
+
+      if (r + 1 >= n)
+        return parser_error (p, "premature EOF");
+      switch (s[r + 1])
+        {
+        case '"':
+        case '\\':
+        case '/':
+          out[w++] = s[r + 1];
+          break;
+        case 'b':
+          out[w++] = '\b';
+          break;
+        case 'f':
+          out[w++] = '\f';
+          break;
+        case 'n':
+          out[w++] = '\n';
+          break;
+        case 'r':
+          out[w++] = '\r';
+          break;
+        case 't':
+          out[w++] = '\t';
+          break;
+        case 'u':
+          if (r + 6 > n || !hex4 (s + r + 2, &cp))
+            return parser_error (p, "invalid (non-hex) character occurs after '\\u' inside string.");
+          r += 6;
+          if ((cp & 0xfc00) == 0xd800)
+            {
+              if (r + 6 > n || s[r] != '\\' || s[r + 1] != 'u' || !hex4 (s + r + 2, &lo))
+                {
+                  out[w++] = '?';
+                  continue;
+                }
+              cp = 0x10000 + ((cp & 0x3ff) << 10) + (lo & 0x3ff);
+              r += 6;
+            }
+          if (cp != 0)
+            w += utf8_encode (cp, out + w);
+          continue;
+        default:
+          return parser_error (p, "inside a JSON string, I expect '\"', '\\', '/', 'b', 'f', 'n', 'r', 't' or 'u'");
+        }
+      r += 2;
+    }
+
+  if (key)
+    ok = p->cb->yajl_map_key == NULL || p->cb->yajl_map_key (p->ctx, out, w);
+  else
+    ok = p->cb->yajl_string == NULL || p->cb->yajl_string (p->ctx, out, w);
+  return ok ? 0 : parser_error (p, "client cancelled parse via callback return value");
+}
+
+static size_t
+digits (const unsigned char *s, size_t n)
+{
+  size_t i = 0;
+
+  while (i < n && s[i] >= '0' && s[i] <= '9')
+    i++;
+  return i;
+}
+
+/* -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)? */
+static bool
+valid_number (const unsigned char *s, size_t n)
+{
+  size_t i = 0, d;
+
+  if (i < n && s[i] == '-')
+    i++;
+  if (i < n && s[i] == '0')
+    i++;
+  else if ((d = digits (s + i, n - i)) > 0)
+    i += d;
+  else
+    return false;
+  if (i < n && s[i] == '.')
+    {
+      i++;
+      if ((d = digits (s + i, n - i)) == 0)
+        return false;
+      i += d;
+    }
+  if (i < n && (s[i] | 0x20) == 'e')
+    {
+      i++;
+      if (i < n && (s[i] == '+' || s[i] == '-'))
+        i++;
+      if ((d = digits (s + i, n - i)) == 0)
+        return false;
+      i += d;
+    }
+  return i == n;
+}
+
+/* a number or literal, it runs up to the next structural or blank byte */
+static int
+parse_scalar (struct simd_parser *p)
+{
+  const unsigned char *s = p->data + p->pos[p->i++];
+  const unsigned char *end = p->data + p->len;
+  size_t n = 0;
+  int ok;
+
+  while (s + n < end && (simd_class[s[n]] & (CLASS_QUOTE | CLASS_OP | CLASS_WS)) == 0)
+    n++;
+
+  if (n == 4 && memcmp (s, "null", 4) == 0)
+    ok = p->cb->yajl_null == NULL || p->cb->yajl_null (p->ctx);
+  else if (n == 4 && memcmp (s, "true", 4) == 0)
+    ok = p->cb->yajl_boolean == NULL || p->cb->yajl_boolean (p->ctx, 1);
+  else if (n == 5 && memcmp (s, "false", 5) == 0)
+    ok = p->cb->yajl_boolean == NULL || p->cb->yajl_boolean (p->ctx, 0);
+  else if (valid_number (s, n))
+    ok = p->cb->yajl_number (p->ctx, (const char *) s, n);
+  else
+    return parser_error (p, (s[0] == '-' || (s[0] >= '0' && s[0] <= '9')) ? "malformed number" : "invalid string in json text.");
+  return ok ? 0 : parser_error (p, "client cancelled parse via callback return value");
+}
+
+#define SIMD_CALL(p, fn)                                                        \
+  do                                                                            \
+    {                                                                           \
+      if ((p)->cb->fn != NULL && !(p)->cb->fn ((p)->ctx))                       \
+        return parser_error ((p), "client cancelled parse via callback return value"); \
+    }                                                                           \
+  while (0)
+
+/* stage two, the grammar of yajl over the offsets */
+static int
+walk (struct simd_parser *p, unsigned char **stack, size_t *stack_cap)
+{
+  size_t depth = 0;
+  unsigned char c;
+
+value:
+  if (p->i >= p->npos)
+    return parser_error (p, "premature EOF");
+  c = p->data[p->pos[p->i]];
+  switch (c)
+    {
+    case '{':
+    case '[':
+      p->i++;
+      if (c == '{')
+        SIMD_CALL (p, yajl_start_map);
+      else
+        SIMD_CALL (p, yajl_start_array);
+      if (depth == *stack_cap)
+        {
+          size_t cap = *stack_cap * 2 + 16;
+          unsigned char *grown = realloc (*stack, cap);
+          if (grown == NULL)
+            return parser_error (p, "error allocating memory");
+          *stack = grown;
+          *stack_cap = cap;
+        }
+      (*stack)[depth++] = c;
+      if (p->i < p->npos && p->data[p->pos[p->i]] == c + 2)
+        {
+          p->i++;
+          goto close;
+        }
+      if (c == '{')
+        goto key;
+      goto value;
+    case '"':
+      if (parse_string (p, false) != 0)
+        return -1;
+      goto after;
+    case ':':
+    case ',':
+    case ']':
+    case '}':
+      return parser_error (p, "unallowed token at this point in JSON text");
+    default:
+      if (parse_scalar (p) != 0)
+        return -1;
+      goto after;
+    }
+
+key:
+  if (p->i >= p->npos)
+    return parser_error (p, "premature EOF");
+  if (p->data[p->pos[p->i]] != '"')
+    return parser_error (p, "invalid object key (must be a string)");
+  if (parse_string (p, true) != 0)
+    return -1;
+  if (p->i >= p->npos)
+    return parser_error (p, "premature EOF");
+  if (p->data[p->pos[p->i++]] != ':')
+    return parser_error (p, "object key and value must be separated by a colon (':')");
+  goto value;
+
+close:
+  if ((*stack)[--depth] == '{')
+    SIMD_CALL (p, yajl_end_map);
+  else
+    SIMD_CALL (p, yajl_end_array);
+
+after:
+  if (depth == 0)
+    return p->i < p->npos ? parser_error (p, "trailing garbage") : 0;
+  if (p->i >= p->npos)
+    return parser_error (p, "premature EOF");
+  c = p->data[p->pos[p->i++]];
+  if ((*stack)[depth - 1] == '{')
+    {
+      if (c == ',')
+        goto key;
+      if (c == '}')
+        goto close;
+      return parser_error (p, "after key and value, inside map, I expect ',' or '}'");
+    }
+  if (c == ',')
+    goto value;
+  if (c == ']')
+    goto close;
+  return parser_error (p, "after array element, I expect ',' or ']'");
+}
+
+int
+json_simd_parse (const yajl_callbacks *cb, void *ctx, const char *data, size_t len, bool writable,
+                 char **errmsg)
+{
+  struct simd_parser p = { 0 };
+  struct simd_index idx = { 0 };
+  unsigned char *stack = NULL;
+  size_t stack_cap = 0;
+  int ret;
+
+  /* offsets are 32 bits, and numbers go through yajl_number only */
+  if (len > UINT32_MAX || cb->yajl_number == NULL)
+    return 1;
+
+  ret = current_kernel ()->index ((const unsigned char *) data, len, &idx);
+  if (ret == 0)
+    {
+      p.cb = cb;
+      p.ctx = ctx;
+      p.data = (const unsigned char *) data;
+      p.len = len;
+      p.writable = writable;
+      p.pos = idx.pos;
+      p.npos = idx.len;
+      ret = walk (&p, &stack, &stack_cap);
+      if (ret != 0)
+        *errmsg = p.err != NULL ? p.err : strdup ("error allocating memory");
+      else
+        free (p.err);
+    }
+  else if (ret < 0)
+    *errmsg = strdup ("error allocating memory");
+
+  free (stack);
+  free (p.scratch);
+  free (idx.pos);
+  return ret;
+}
+
+#else
+
+bool
+json_simd_supported (void)
+{
+  return false;
+}
+
+const char *
+json_simd_kernel (void)
+{
+  return NULL;
+}
+
+int
+json_simd_set_kernel (const char *name)
+{
+  return -1;
+}
+
+int
+json_simd_parse (const yajl_callbacks *cb, void *ctx, const char *data, size_t len, bool writable,
+                 char **errmsg)
+{
+  return 1;
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+#ifndef __JSON_SIMD_H_
+#define __JSON_SIMD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <yajl/yajl_parse.h>
+
+/* Vectorized front end for the yajl callbacks (OPT_PARSE_SIMD): a first
+   pass classifies the input 64 bytes at a time and indexes its structural
+   characters, a second pass walks the index and calls cb on ctx the way
+   yajl_parse with comments allowed would.  It is built with
+   ENABLE_SIMD_JSON only.  */
+
+/* whether json_simd_parse can be used at all */
+bool json_simd_supported (void);
+
+/* name of the kernel in use: "scalar", "sse2", "avx2" or "neon" */
+const char *json_simd_kernel (void);
+
+/* force the kernel name, or the best one of the cpu if NULL; returns -1
+   when it is not available here */
+int json_simd_set_kernel (const char *name);
+
+/* parse the len bytes of data, whose strings are unescaped in place when
+   writable.  Returns 0 on success, -1 on error with a malloc'ed message in
+   *errmsg, and 1 without calling cb when the input needs yajl, i.e. it has
+   comments or the front end is not built.  */
+int json_simd_parse (const yajl_callbacks *cb, void *ctx, const char *data, size_t len, bool writable,
+                     char **errmsg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,1439 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+/* OPT_PARSE_STREAM backend: fills the generated structs straight from the
+   yajl callbacks, driven by the layout descriptors, without building the
+   yajl tree first.  The result is the same as the one of make_<type> on
+   the tree, including the handling of mismatched and duplicated keys.
+
+   json_stream_parse_paths restricts the parse to the members named by a
+   list of json pointers: the other members of the objects on the way are
+   skipped like unknown keys, and the parse stops as soon as every selected
+   member has been read.
+
+   json_stream_parser_new sets up the same parse for input that arrives in
+   pieces, each of them handed to yajl as it comes, so that only the
+   partial result and the token being read are held.  */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "json_desc.h"
+#include "json_simd.h"
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <yajl/yajl_parse.h>
+
+/* expectations which are not a field kind */
+#define STREAM_SKIP 0xfe
+#define STREAM_INNER_ARRAY 0xff
+
+enum stream_frame_kind
+{
+  FRAME_OBJECT = 0,
+  FRAME_MAP,
+  FRAME_ARRAY,
+};
+
+enum stream_where
+{
+  IN_ROOT = 0,
+  IN_FIELD,
+  IN_ITEM,
+  IN_MAP,
+};
+
+union stream_value
+{
+  void *ptr;
+  char *str;
+  size_t len;
+  bool b;
+  int i;
+  int64_t i64;
+  double d;
+};
+
+/* members of an object selected by json_stream_parse_paths, by slot: NULL
+   to skip the member, PROJECT_WHOLE to parse all of it, or the selection
+   in the object it holds */
+struct stream_projection
+{
+  const struct json_type_desc *type;
+  struct stream_projection **fields;
+};
+
+static struct stream_projection project_whole;
+#define PROJECT_WHOLE (&project_whole)
+
+/* pending item of an array, or entry of a map */
+struct stream_slot
+{
+  union stream_value key;
+  union stream_value val;
+};
+
+struct stream_frame
+{
+  unsigned char kind;
+  /* inner array of a double array */
+  bool inner;
+  /* object or mapStringObject being filled */
+  const struct json_type_desc *type;
+  /* array field, or basic map field */
+  const struct json_field_desc *field;
+  void *ptr;
+  /* field receiving the next value of an object, -1 to ignore it */
+  int slot;
+  /* selected members of an object, NULL for all */
+  const struct stream_projection *proj;
+  size_t unknown;
+  /* first slot of arrays and maps, seen bits of objects */
+  size_t base;
+};
+
+struct stream_ctx
+{
+  const struct parser_context *ctx;
+  const struct json_type_desc *desc;
+  void *root;
+  bool done;
+  char *err;
+  /* input buffer owned by the parse, strings are terminated in place */
+  char *insitu;
+  size_t insitu_len;
+  /* depth inside an ignored value */
+  size_t skip;
+  /* selection of the root object, and the PROJECT_WHOLE members not read yet */
+  const struct stream_projection *proj;
+  size_t pending;
+  /* every selected member is read, the rest of the input is not needed */
+  bool satisfied;
+
+  struct stream_frame *frames;
+  size_t frames_len;
+  size_t frames_cap;
+
+  struct stream_slot *slots;
+  size_t slots_len;
+  size_t slots_cap;
+
+  unsigned char *seen;
+  size_t seen_len;
+  size_t seen_cap;
+};
+
+struct stream_expect
+{
+  unsigned char where;
+  unsigned char kind;
+  unsigned char num;
+  unsigned char map;
+  const struct json_type_desc *type;
+  const struct json_field_desc *field;
+  /* where the value is stored */
+  void *dest;
+  size_t *len_dest;
+};
+
+static int
+stream_error (struct stream_ctx *s, const char *fmt, ...)
+{
+  va_list ap;
+
+  if (s->err != NULL)
+    return 0;
+  va_start (ap, fmt);
+  if (vasprintf (&s->err, fmt, ap) < 0)
+    s->err = strdup ("error allocating memory");
+  va_end (ap);
+  return 0;
+}
+
+static int
+stream_oom (struct stream_ctx *s)
+{
+  return stream_error (s, "error allocating memory");
+}
+
+/* data of the parsed objects, from the arena of the context if it has one */
+static void *
+stream_calloc (struct stream_ctx *s, size_t count, size_t unit_size)
+{
+  void *ret = json_ctx_calloc (s->ctx, count, 0, unit_size);
+  if (ret == NULL)
+    stream_oom (s);
+  return ret;
+}
+
+static void
+stream_free (struct stream_ctx *s, void *ptr)
+{
+  if (s->ctx->arena == NULL)
+    free (ptr);
+}
+
+static char *
+stream_strndup (struct stream_ctx *s, const unsigned char *str, size_t len)
+{
+  char *ret;
+
+  /* yajl hands out strings without escapes straight from the input, and
+     the closing quote is behind us already.  */
+  if (s->insitu != NULL && (const char *) str >= s->insitu && (const char *) str < s->insitu + s->insitu_len)
+    {
+      ret = (char *) str;
+      ret[len] = '\0';
+      return ret;
+    }
+
+  ret = json_ctx_calloc (s->ctx, len, 1, 1);
+  if (ret == NULL)
+    {
+      stream_oom (s);
+      return NULL;
+    }
+  (void) memcpy (ret, str, len);
+  ret[len] = '\0';
+  return ret;
+}
+
+/* scratch buffers of the parse, on the allocator of the context */
+static bool
+grow (struct stream_ctx *s, void **buf, size_t *cap, size_t need, size_t unit)
+{
+  size_t ncap;
+  void *tmp;
+
+  if (need <= *cap)
+    return true;
+  ncap = *cap > 0 ? *cap : 16;
+  while (ncap < need)
+    {
+      if (ncap > SIZE_MAX / 2 / unit)
+        return false;
+      ncap *= 2;
+    }
+  tmp = json_alloc_realloc (s->ctx->allocator, *buf, ncap * unit);
+  if (tmp == NULL)
+    return false;
+  *buf = tmp;
+  *cap = ncap;
+  return true;
+}
+
+static struct stream_frame *
+top (struct stream_ctx *s)
+{
+  return s->frames_len > 0 ? &s->frames[s->frames_len - 1] : NULL;
+}
+
+static struct stream_frame *
+push_frame (struct stream_ctx *s, unsigned char kind)
+{
+  struct stream_frame *f;
+
+  if (!grow (s, (void **) &s->frames, &s->frames_cap, s->frames_len + 1, sizeof (*s->frames)))
+    {
+      stream_oom (s);
+      return NULL;
+    }
+  f = &s->frames[s->frames_len++];
+  (void) memset (f, 0, sizeof (*f));
+  f->kind = kind;
+  f->slot = -1;
+  f->base = s->slots_len;
+  return f;
+}
+
+static struct stream_slot *
+push_slot (struct stream_ctx *s)
+{
+  struct stream_slot *slot;
+
+  if (!grow (s, (void **) &s->slots, &s->slots_cap, s->slots_len + 1, sizeof (*s->slots)))
+    {
+      stream_oom (s);
+      return NULL;
+    }
+  slot = &s->slots[s->slots_len++];
+  (void) memset (slot, 0, sizeof (*slot));
+  return slot;
+}
+
+/* whether the selected required members of the open objects are all set,
+   so that the checks at their end cannot fail any more */
+static bool
+projection_complete (struct stream_ctx *s)
+{
+  size_t i, j;
+
+  for (i = 0; i < s->frames_len; i++)
+    {
+      const struct stream_frame *f = &s->frames[i];
+
+      if (f->kind != FRAME_OBJECT || f->proj == NULL)
+        continue;
+      for (j = 0; j < f->type->fields_len; j++)
+        {
+          const struct json_field_desc *field = &f->type->fields[j];
+          if (f->proj->fields[j] != NULL && (field->flags & JSON_FIELD_REQUIRED)
+              && *(void **) ((char *) f->ptr + field->offset) == NULL)
+            return false;
+        }
+    }
+  return true;
+}
+
+static void
+value_done (struct stream_ctx *s)
+{
+  struct stream_frame *f = top (s);
+
+  if (f == NULL)
+    s->done = true;
+  /* a missing or mismatched required member is reported by the end of its
+     object, the parse goes on until there */
+  else if (f->kind == FRAME_OBJECT && f->proj != NULL && f->slot >= 0
+           && f->proj->fields[f->slot] == PROJECT_WHOLE && s->pending > 0 && --s->pending == 0
+           && projection_complete (s))
+    s->satisfied = s->done = true;
+}
+
+/* work out what the next value is and where it goes */
+static int
+expect (struct stream_ctx *s, struct stream_expect *e)
+{
+  struct stream_frame *f = top (s);
+  const struct json_field_desc *field;
+  struct stream_slot *slot;
+
+  (void) memset (e, 0, sizeof (*e));
+  if (f == NULL)
+    {
+      e->where = IN_ROOT;
+      if (s->desc->kind == JSON_TYPE_ARRAY)
+        {
+          e->kind = JSON_KIND_ARRAY;
+          e->field = &s->desc->fields[0];
+        }
+      else
+        {
+          e->kind = JSON_KIND_OBJECT;
+          e->type = s->desc;
+          e->dest = &s->root;
+        }
+      return 1;
+    }
+
+  switch (f->kind)
+    {
+    case FRAME_OBJECT:
+      if (f->slot < 0)
+        {
+          e->kind = STREAM_SKIP;
+          return 1;
+        }
+      field = &f->type->fields[f->slot];
+      e->where = IN_FIELD;
+      e->kind = field->kind;
+      e->num = field->num;
+      e->map = field->map;
+      e->type = field->type;
+      e->field = field;
+      e->dest = (char *) f->ptr + field->offset;
+      if (field->kind == JSON_KIND_BYTES)
+        e->len_dest = (size_t *) ((char *) f->ptr + field->len_offset);
+      return 1;
+    case FRAME_MAP:
+      e->where = IN_MAP;
+      e->dest = &s->slots[s->slots_len - 1].val;
+      if (f->type != NULL)
+        {
+          field = &f->type->fields[0];
+          e->kind = field->kind;
+          e->map = field->map;
+          e->type = field->type;
+          e->field = field;
+        }
+      else
+        {
+          e->kind = json_map_descs[f->field->map].kind;
+          e->num = json_map_descs[f->field->map].num;
+          e->field = f->field;
+        }
+      return 1;
+    default:
+      field = f->field;
+      slot = push_slot (s);
+      if (slot == NULL)
+        return 0;
+      e->where = IN_ITEM;
+      e->field = field;
+      e->dest = &slot->val;
+      if ((field->flags & JSON_FIELD_DOUBLE_ARRAY) && !f->inner)
+        {
+          e->kind = STREAM_INNER_ARRAY;
+          return 1;
+        }
+      e->kind = field->item;
+      e->num = field->num;
+      e->map = field->map;
+      e->type = field->type;
+      return 1;
+    }
+}
+
+static const char *
+map_key_name (struct stream_ctx *s, char *buf, size_t size)
+{
+  struct stream_frame *f = top (s);
+  struct stream_slot *slot = &s->slots[s->slots_len - 1];
+
+  if (f->type == NULL && json_map_descs[f->field->map].int_key)
+    {
+      (void) snprintf (buf, size, "%d", slot->key.i);
+      return buf;
+    }
+  return slot->key.str;
+}
+
+static int
+map_value_error (struct stream_ctx *s, const struct stream_expect *e, const char *reason)
+{
+  char buf[32];
+
+  return stream_error (s, "Value error for key '%s': Invalid value with type '%s' for key '%s'%s%s",
+                       e->field->name, json_map_descs[e->field->map].type,
+                       map_key_name (s, buf, sizeof (buf)), reason ? ": " : "", reason ? reason : "");
+}
+
+/* the required members of an object, those selected by proj if not NULL */
+static int
+check_required (struct stream_ctx *s, const struct json_type_desc *type, void *ptr,
+                const struct stream_projection *proj)
+{
+  size_t i;
+
+  for (i = 0; i < type->fields_len; i++)
+    {
+      const struct json_field_desc *field = &type->fields[i];
+      if (proj != NULL && proj->fields[i] == NULL)
+        continue;
+      if ((field->flags & JSON_FIELD_REQUIRED) && *(void **) ((char *) ptr + field->offset) == NULL)
+        return stream_error (s, "Required field '%s' not present", field->name);
+    }
+  return 1;
+}
+
+static void *
+alloc_object (struct stream_ctx *s, size_t size, void *dest)
+{
+  void *ptr = stream_calloc (s, 1, size);
+  if (ptr == NULL)
+    return NULL;
+  *(void **) dest = ptr;
+  return ptr;
+}
+
+/* the value does not have the expected json type */
+static int
+mismatch (struct stream_ctx *s, const struct stream_expect *e)
+{
+  void *ptr;
+
+  if (e->where == IN_FIELD || e->kind == STREAM_SKIP)
+    return 1;
+  if (e->where == IN_ROOT && e->kind == JSON_KIND_ARRAY)
+    return 1;
+  if (e->where == IN_MAP && e->type == NULL)
+    return e->kind == JSON_KIND_MAP ? stream_error (s, "Invalid value for key '%s'", e->field->name)
+                                    : map_value_error (s, e, NULL);
+
+  switch (e->kind)
+    {
+    case JSON_KIND_STRING:
+      *(char **) e->dest = json_ctx_strdup (s->ctx, "");
+      return *(char **) e->dest != NULL ? 1 : stream_oom (s);
+    case JSON_KIND_BOOL:
+      *(bool *) e->dest = false;
+      return 1;
+    case JSON_KIND_BOOL_PTR:
+      return alloc_object (s, sizeof (bool), e->dest) != NULL;
+    case JSON_KIND_OBJECT:
+      ptr = alloc_object (s, e->type->size, e->dest);
+      if (ptr == NULL)
+        return 0;
+      return e->type->kind == JSON_TYPE_OBJECT ? check_required (s, e->type, ptr, NULL) : 1;
+    case JSON_KIND_NUMBER:
+    case JSON_KIND_NUMBER_PTR:
+      return stream_error (s, "Invalid value '(null)' with type '%s%s' for key '%s': %s",
+                           json_number_names[e->num], e->kind == JSON_KIND_NUMBER_PTR ? "Pointer" : "",
+                           e->field->name, strerror (EINVAL));
+    default:
+      return stream_error (s, "Invalid value for key '%s'", e->field->name);
+    }
+}
+
+static int
+finish_scalar (struct stream_ctx *s, const struct stream_expect *e, bool matched)
+{
+  if (!matched && !mismatch (s, e))
+    return 0;
+  value_done (s);
+  return 1;
+}
+
+static int
+cb_null (void *ctx)
+{
+  struct stream_ctx *s = ctx;
+  struct stream_expect e;
+
+  if (s->skip > 0)
+    return 1;
+  if (!expect (s, &e))
+    return 0;
+  return finish_scalar (s, &e, false);
+}
+
+static int
+cb_boolean (void *ctx, int val)
+{
+  struct stream_ctx *s = ctx;
+  struct stream_expect e;
+  bool *ptr;
+
+  if (s->skip > 0)
+    return 1;
+  if (!expect (s, &e))
+    return 0;
+  if (e.kind == JSON_KIND_BOOL)
+    {
+      *(bool *) e.dest = val != 0;
+      return finish_scalar (s, &e, true);
+    }
+  if (e.kind == JSON_KIND_BOOL_PTR)
+    {
+      ptr = alloc_object (s, sizeof (bool), e.dest);
+      if (ptr == NULL)
+        return 0;
+      *ptr = val != 0;
+      return finish_scalar (s, &e, true);
+    }
+  return finish_scalar (s, &e, false);
+}
+
+static int
+cb_number (void *ctx, const char *text, size_t len)
+{
+  struct stream_ctx *s = ctx;
+  struct stream_expect e;
+  char buf[64];
+  char *numstr = buf;
+  void *dest;
+  int invalid;
+
+  if (s->skip > 0)
+    return 1;
+  if (!expect (s, &e))
+    return 0;
+  if (e.kind != JSON_KIND_NUMBER && e.kind != JSON_KIND_NUMBER_PTR)
+    return finish_scalar (s, &e, false);
+
+  if (len >= sizeof (buf))
+    {
+      numstr = strndup (text, len);
+      if (numstr == NULL)
+        return stream_oom (s);
+    }
+  else
+    {
+      (void) memcpy (buf, text, len);
+      buf[len] = '\0';
+    }
+
+  dest = e.dest;
+  if (e.kind == JSON_KIND_NUMBER_PTR)
+    dest = alloc_object (s, json_number_size (e.num), e.dest);
+  invalid = dest != NULL ? json_number_convert (e.num, numstr, dest) : -ENOMEM;
+  if (invalid && dest != NULL)
+    {
+      if (e.where == IN_MAP && e.type == NULL)
+        map_value_error (s, &e, strerror (-invalid));
+      else
+        stream_error (s, "Invalid value '%s' with type '%s%s' for key '%s': %s", numstr,
+                      json_number_names[e.num], e.kind == JSON_KIND_NUMBER_PTR ? "Pointer" : "",
+                      e.field->name, strerror (-invalid));
+    }
+  if (numstr != buf)
+    free (numstr);
+  return invalid ? 0 : finish_scalar (s, &e, true);
+}
+
+static int
+cb_string (void *ctx, const unsigned char *str, size_t len)
+{
+  struct stream_ctx *s = ctx;
+  struct stream_expect e;
+  char *val;
+
+  if (s->skip > 0)
+    return 1;
+  if (!expect (s, &e))
+    return 0;
+  if (e.kind != JSON_KIND_STRING && e.kind != JSON_KIND_BYTES)
+    return finish_scalar (s, &e, false);
+
+  val = NULL;
+  if (e.kind == JSON_KIND_STRING && (e.field->flags & JSON_FIELD_INTERN) && (s->ctx->options & OPT_PARSE_INTERN))
+    val = (char *) json_intern ((const char *) str, len);
+  if (val == NULL)
+    val = stream_strndup (s, str, len);
+  if (val == NULL)
+    return 0;
+  *(char **) e.dest = val;
+  if (e.kind == JSON_KIND_BYTES)
+    *e.len_dest = strlen (val);
+  return finish_scalar (s, &e, true);
+}
+
+static int
+cb_start_map (void *ctx)
+{
+  struct stream_ctx *s = ctx;
+  struct stream_expect e;
+  struct stream_frame *f;
+  void *ptr;
+
+  if (s->skip > 0)
+    {
+      s->skip++;
+      return 1;
+    }
+  if (!expect (s, &e))
+    return 0;
+
+  if (e.kind == JSON_KIND_OBJECT)
+    {
+      ptr = alloc_object (s, e.type->size, e.dest);
+      if (ptr == NULL)
+        return 0;
+      if (e.type->kind == JSON_TYPE_MAP)
+        {
+          f = push_frame (s, FRAME_MAP);
+          if (f == NULL)
+            return 0;
+        }
+      else
+        {
+          size_t bytes = (e.type->fields_len + 7) / 8;
+          const struct stream_projection *proj = NULL;
+
+          if (e.where == IN_ROOT)
+            proj = s->proj;
+          else if (e.where == IN_FIELD && top (s)->proj != NULL)
+            proj = top (s)->proj->fields[top (s)->slot];
+          f = push_frame (s, FRAME_OBJECT);
+          if (f == NULL)
+            return 0;
+          if (!grow (s, (void **) &s->seen, &s->seen_cap, s->seen_len + bytes, 1))
+            return stream_oom (s);
+          (void) memset (s->seen + s->seen_len, 0, bytes);
+          f->base = s->seen_len;
+          s->seen_len += bytes;
+          f->proj = proj != PROJECT_WHOLE ? proj : NULL;
+        }
+      f->type = e.type;
+      f->ptr = ptr;
+      return 1;
+    }
+  if (e.kind == JSON_KIND_MAP)
+    {
+      ptr = alloc_object (s, sizeof (struct json_map_layout), e.dest);
+      if (ptr == NULL)
+        return 0;
+      f = push_frame (s, FRAME_MAP);
+      if (f == NULL)
+        return 0;
+      f->field = e.field;
+      f->ptr = ptr;
+      return 1;
+    }
+
+  if (!mismatch (s, &e))
+    return 0;
+  s->skip = 1;
+  return 1;
+}
+
+static int
+cb_map_key (void *ctx, const unsigned char *key, size_t len)
+{
+  struct stream_ctx *s = ctx;
+  struct stream_frame *f = top (s);
+  struct stream_slot *slot;
+  char *str;
+  int idx;
+
+  if (s->skip > 0)
+    return 1;
+  if (s->satisfied)
+    return 0;
+
+  if (f->kind == FRAME_OBJECT)
+    {
+      idx = f->type->field_index != NULL ? f->type->field_index ((const char *) key, len) : -1;
+      f->slot = -1;
+      if (idx < 0)
+        f->unknown++;
+      /* a member left out by a projection is skipped, but is not unknown */
+      else if ((f->proj == NULL || f->proj->fields[idx] != NULL)
+               && !(s->seen[f->base + idx / 8] & (1 << (idx % 8))))
+        {
+          /* the first occurrence of a key wins, as with yajl_tree_get.  */
+          s->seen[f->base + idx / 8] |= 1 << (idx % 8);
+          f->slot = idx;
+        }
+      return 1;
+    }
+
+  str = stream_strndup (s, key, len);
+  if (str == NULL)
+    return 0;
+  slot = push_slot (s);
+  if (slot == NULL)
+    {
+      stream_free (s, str);
+      return 0;
+    }
+  if (f->type == NULL && json_map_descs[f->field->map].int_key)
+    {
+      int invalid = common_safe_int (str, &slot->key.i);
+      if (invalid)
+        stream_error (s, "Value error for key '%s': Invalid key '%s' with type 'int': %s",
+                      f->field->name, str, strerror (-invalid));
+      stream_free (s, str);
+      return invalid ? 0 : 1;
+    }
+  slot->key.str = str;
+  return 1;
+}
+
+static int
+close_map (struct stream_ctx *s, struct stream_frame *f)
+{
+  size_t n = s->slots_len - f->base;
+  size_t ksize, vsize, i;
+  char *keys, *values;
+
+  if (f->type != NULL)
+    {
+      const struct json_field_desc *field = &f->type->fields[0];
+      if (n == 0)
+        return 1;
+      ksize = sizeof (char *);
+      vsize = sizeof (void *);
+      keys = stream_calloc (s, n, ksize);
+      values = stream_calloc (s, n, vsize);
+      if (keys == NULL || values == NULL)
+        {
+          stream_free (s, keys);
+          stream_free (s, values);
+          return 0;
+        }
+      *(void **) ((char *) f->ptr + f->type->keys_offset) = keys;
+      *(void **) ((char *) f->ptr + field->offset) = values;
+      *(size_t *) ((char *) f->ptr + field->len_offset) = n;
+    }
+  else
+    {
+      struct json_map_layout *map = f->ptr;
+      ksize = json_map_descs[f->field->map].int_key ? sizeof (int) : sizeof (char *);
+      vsize = json_value_size (json_map_descs[f->field->map].kind, json_map_descs[f->field->map].num);
+      keys = stream_calloc (s, n, ksize);
+      values = stream_calloc (s, n, vsize);
+      if (keys == NULL || values == NULL)
+        {
+          stream_free (s, keys);
+          stream_free (s, values);
+          return 0;
+        }
+      map->keys = keys;
+      map->values = values;
+      map->len = n;
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      (void) memcpy (keys + i * ksize, &s->slots[f->base + i].key, ksize);
+      (void) memcpy (values + i * vsize, &s->slots[f->base + i].val, vsize);
+    }
+  s->slots_len = f->base;
+  return 1;
+}
+
+static int
+cb_end_map (void *ctx)
+{
+  struct stream_ctx *s = ctx;
+  struct stream_frame *f = top (s);
+
+  if (s->skip > 0)
+    {
+      if (--s->skip == 0)
+        value_done (s);
+      return 1;
+    }
+  if (s->satisfied)
+    return 0;
+
+  if (f->kind == FRAME_OBJECT)
+    {
+      /* members left out by a projection are not missing */
+      if (!check_required (s, f->type, f->ptr, f->proj))
+        return 0;
+      if (f->type->residual && f->unknown > 0 && (s->ctx->options & OPT_PARSE_STRICT) && s->ctx->errfile != NULL)
+        (void) fprintf (s->ctx->errfile, "WARNING: unknown key found\n");
+      s->seen_len = f->base;
+    }
+  else if (!close_map (s, f))
+    return 0;
+
+  s->frames_len--;
+  value_done (s);
+  return 1;
+}
+
+static int
+cb_start_array (void *ctx)
+{
+  struct stream_ctx *s = ctx;
+  struct stream_expect e;
+  struct stream_frame *f;
+
+  if (s->skip > 0)
+    {
+      s->skip++;
+      return 1;
+    }
+  if (!expect (s, &e))
+    return 0;
+
+  if (e.kind == JSON_KIND_ARRAY || e.kind == STREAM_INNER_ARRAY)
+    {
+      f = push_frame (s, FRAME_ARRAY);
+      if (f == NULL)
+        return 0;
+      f->field = e.field;
+      f->inner = e.kind == STREAM_INNER_ARRAY;
+      return 1;
+    }
+
+  if (!mismatch (s, &e))
+    return 0;
+  s->skip = 1;
+  return 1;
+}
+
+static int
+close_array (struct stream_ctx *s, struct stream_frame *f)
+{
+  const struct json_field_desc *field = f->field;
+  struct stream_frame *parent = f > s->frames ? f - 1 : NULL;
+  size_t n = s->slots_len - f->base;
+  size_t size, i;
+  char *items;
+  size_t *lens = NULL;
+  char *dest;
+
+  if (f->inner || !(field->flags & JSON_FIELD_DOUBLE_ARRAY))
+    size = json_value_size (field->item, field->num);
+  else
+    size = sizeof (void *);
+
+  if (n == 0 && !f->inner)
+    return 1;
+
+  items = stream_calloc (s, n + 1, size);
+  if (items == NULL)
+    return 0;
+  if (!f->inner && (field->flags & JSON_FIELD_DOUBLE_ARRAY))
+    {
+      lens = stream_calloc (s, n + 1, sizeof (size_t));
+      if (lens == NULL)
+        {
+          stream_free (s, items);
+          return 0;
+        }
+      for (i = 0; i < n; i++)
+        lens[i] = s->slots[f->base + i].key.len;
+    }
+  for (i = 0; i < n; i++)
+    (void) memcpy (items + i * size, &s->slots[f->base + i].val, size);
+
+  if (f->inner)
+    {
+      /* the slot of the outer array is the last one before ours */
+      s->slots[f->base - 1].val.ptr = items;
+      s->slots[f->base - 1].key.len = n;
+      s->slots_len = f->base;
+      return 1;
+    }
+
+  if (parent == NULL)
+    {
+      dest = stream_calloc (s, 1, s->desc->size);
+      if (dest == NULL)
+        {
+          stream_free (s, items);
+          stream_free (s, lens);
+          return 0;
+        }
+      s->root = dest;
+    }
+  else
+    dest = parent->ptr;
+
+  *(void **) (dest + field->offset) = items;
+  *(size_t *) (dest + field->len_offset) = n;
+  if (lens != NULL)
+    *(size_t **) (dest + field->item_lens_offset) = lens;
+  s->slots_len = f->base;
+  return 1;
+}
+
+static int
+cb_end_array (void *ctx)
+{
+  struct stream_ctx *s = ctx;
+
+  if (s->skip > 0)
+    {
+      if (--s->skip == 0)
+        value_done (s);
+      return 1;
+    }
+  if (s->satisfied)
+    return 0;
+  if (!close_array (s, top (s)))
+    return 0;
+  s->frames_len--;
+  value_done (s);
+  return 1;
+}
+
+static const yajl_callbacks stream_callbacks = {
+  .yajl_null = cb_null,
+  .yajl_boolean = cb_boolean,
+  .yajl_number = cb_number,
+  .yajl_string = cb_string,
+  .yajl_start_map = cb_start_map,
+  .yajl_map_key = cb_map_key,
+  .yajl_end_map = cb_end_map,
+  .yajl_start_array = cb_start_array,
+  .yajl_end_array = cb_end_array,
+};
+
+/* release whatever is still held by the open arrays and maps, and the root */
+static void
+stream_cleanup (struct stream_ctx *s)
+{
+  /* everything went to the arena, it is released with it */
+  if (s->ctx->arena != NULL)
+    {
+      s->frames_len = 0;
+      s->slots_len = 0;
+      s->root = NULL;
+      return;
+    }
+  while (s->frames_len > 0)
+    {
+      struct stream_frame *f = &s->frames[--s->frames_len];
+      const struct json_field_desc *field = f->field;
+      size_t i, j;
+
+      if (f->kind == FRAME_OBJECT)
+        continue;
+      for (i = f->base; i < s->slots_len; i++)
+        {
+          struct stream_slot *slot = &s->slots[i];
+          if (f->kind == FRAME_MAP)
+            {
+              if (f->type != NULL || !json_map_descs[field->map].int_key)
+                free (slot->key.str);
+              if (f->type != NULL)
+                json_value_free (f->type->fields[0].kind, &f->type->fields[0], slot->val.ptr);
+              else if (json_map_descs[field->map].kind == JSON_KIND_STRING)
+                free (slot->val.str);
+            }
+          else if ((field->flags & JSON_FIELD_DOUBLE_ARRAY) && !f->inner)
+            {
+              void **inner = slot->val.ptr;
+              for (j = 0; inner != NULL && j < slot->key.len; j++)
+                json_value_free (field->item, field, inner[j]);
+              free (inner);
+            }
+          else if (field->item != JSON_KIND_BOOL && field->item != JSON_KIND_NUMBER)
+            json_value_free (field->item, field, slot->val.ptr);
+        }
+      s->slots_len = f->base;
+    }
+  if (s->root != NULL && s->desc->free != NULL)
+    s->desc->free (s->root);
+  s->root = NULL;
+}
+
+/* hand the result, or the error of the parse, to the caller */
+static void *
+stream_finish (struct stream_ctx *s, bool ok, const char *msg, parser_error *err)
+{
+  if (ok && !s->done)
+    stream_error (s, "cannot parse the data: premature EOF");
+
+  if (!ok || s->err != NULL)
+    {
+      if (s->err != NULL)
+        *err = move_ptr (s->err);
+      else if (asprintf (err, "cannot parse the data: %s", msg != NULL ? msg : "") < 0)
+        *err = strdup ("error allocating memory");
+      stream_cleanup (s);
+    }
+
+  json_alloc_free (s->ctx->allocator, s->frames);
+  json_alloc_free (s->ctx->allocator, s->slots);
+  json_alloc_free (s->ctx->allocator, s->seen);
+  return s->root;
+}
+
+static size_t
+projection_pending (const struct stream_projection *proj)
+{
+  size_t i, n = 0;
+
+  if (proj == NULL || proj == PROJECT_WHOLE)
+    return proj != NULL;
+  for (i = 0; i < proj->type->fields_len; i++)
+    if (proj->fields[i] != NULL)
+      n += projection_pending (proj->fields[i]);
+  return n;
+}
+
+static void
+projection_free (struct stream_projection *proj)
+{
+  size_t i;
+
+  if (proj == NULL || proj == PROJECT_WHOLE)
+    return;
+  for (i = 0; i < proj->type->fields_len; i++)
+    projection_free (proj->fields[i]);
+  free (proj->fields);
+  free (proj);
+}
+
+static struct stream_projection *
+projection_new (const struct json_type_desc *type)
+{
+  struct stream_projection *proj = calloc (1, sizeof (*proj));
+
+  if (proj == NULL)
+    return NULL;
+  proj->type = type;
+  proj->fields = calloc (type->fields_len + 1, sizeof (*proj->fields));
+  if (proj->fields == NULL)
+    {
+      free (proj);
+      return NULL;
+    }
+  return proj;
+}
+
+/* the next reference token of a json pointer, with ~1 and ~0 decoded */
+static size_t
+pointer_token (const char **pointer, char *buf)
+{
+  const char *p = *pointer + 1;
+  size_t n = 0;
+
+  for (; *p != '\0' && *p != '/'; p++)
+    {
+      if (*p == '~' && (p[1] == '0' || p[1] == '1'))
+        buf[n++] = *++p == '0' ? '~' : '/';
+      else
+        buf[n++] = *p;
+    }
+  buf[n] = '\0';
+  *pointer = p;
+  return n;
+}
+
+/* add the member named by pointer to the selection *proj of an object of type */
+static int
+projection_add (struct stream_projection **proj, const struct json_type_desc *type, const char *pointer)
+{
+  __auto_free char *buf = strdup (pointer);
+  const struct json_field_desc *field;
+  size_t len;
+  int idx;
+
+  if (buf == NULL)
+    return -1;
+  while (*proj != PROJECT_WHOLE)
+    {
+      /* the pointer ends here, or goes into a value without a descriptor */
+      if (*pointer == '\0' || type == NULL)
+        {
+          projection_free (*proj);
+          *proj = PROJECT_WHOLE;
+          break;
+        }
+      if (*proj == NULL)
+        {
+          *proj = projection_new (type);
+          if (*proj == NULL)
+            return -1;
+        }
+      len = pointer_token (&pointer, buf);
+      idx = type->field_index != NULL ? type->field_index (buf, len) : -1;
+      /* not a member of the type, nothing to parse */
+      if (idx < 0)
+        break;
+      field = &type->fields[idx];
+      proj = &(*proj)->fields[idx];
+      type = field->kind == JSON_KIND_OBJECT && field->type->kind == JSON_TYPE_OBJECT ? field->type : NULL;
+    }
+  return 0;
+}
+
+static void *
+stream_parse (const char *jsondata, size_t len, const struct json_type_desc *desc,
+              const struct stream_projection *proj, const struct parser_context *ctx, char *insitu,
+              parser_error *err)
+{
+  struct stream_ctx s = { 0 };
+  yajl_alloc_funcs afs;
+  yajl_handle h;
+  yajl_status stat;
+  unsigned char *msg = NULL;
+  void *ret;
+
+  s.ctx = ctx;
+  s.desc = desc;
+  s.insitu = insitu;
+  s.insitu_len = insitu != NULL ? len : 0;
+  s.proj = proj != PROJECT_WHOLE ? proj : NULL;
+  s.pending = projection_pending (s.proj);
+
+  if (ctx->options & OPT_PARSE_SIMD)
+    {
+      char *simd_msg = NULL;
+      int simd = json_simd_parse (&stream_callbacks, &s, jsondata, len, insitu != NULL, &simd_msg);
+
+      /* 1: not built, or the input has comments */
+      if (simd != 1)
+        {
+          ret = stream_finish (&s, simd == 0 || s.satisfied, simd_msg, err);
+          free (simd_msg);
+          return ret;
+        }
+    }
+
+  h = yajl_alloc (&stream_callbacks, json_allocator_yajl (ctx->allocator, &afs), &s);
+  if (h == NULL)
+    {
+      *err = strdup ("error allocating memory");
+      return NULL;
+    }
+  (void) yajl_config (h, yajl_allow_comments, 1);
+
+  stat = yajl_parse (h, (const unsigned char *) jsondata, len);
+  if (stat == yajl_status_ok)
+    stat = yajl_complete_parse (h);
+  /* cancelled by a projection which has all it asked for */
+  if (s.satisfied)
+    stat = yajl_status_ok;
+  if (stat != yajl_status_ok && s.err == NULL)
+    msg = yajl_get_error (h, 1, (const unsigned char *) jsondata, len);
+
+  ret = stream_finish (&s, stat == yajl_status_ok, (const char *) msg, err);
+  if (msg != NULL)
+    yajl_free_error (h, msg);
+  yajl_free (h);
+  return ret;
+}
+
+void *
+json_stream_parse (const char *jsondata, size_t len, const struct json_type_desc *desc,
+                   const struct parser_context *ctx, parser_error *err)
+{
+  return stream_parse (jsondata, len, desc, NULL, ctx, NULL, err);
+}
+
+void *
+json_stream_parse_paths (const char *jsondata, size_t len, const struct json_type_desc *desc,
+                         const char **json_pointers, const struct parser_context *ctx, parser_error *err)
+{
+  struct stream_projection *proj = NULL;
+  void *ret = NULL;
+  size_t i;
+
+  /* the unknown keys and the lazy members are only kept from the whole tree */
+  if (ctx->options & (OPT_PARSE_FULLKEY | OPT_PARSE_LAZY))
+    {
+      *err = strdup ("cannot parse json pointers with OPT_PARSE_FULLKEY or OPT_PARSE_LAZY");
+      return NULL;
+    }
+  for (i = 0; json_pointers != NULL && json_pointers[i] != NULL; i++)
+    {
+      if (json_pointers[i][0] != '\0' && json_pointers[i][0] != '/')
+        {
+          if (asprintf (err, "invalid json pointer '%s'", json_pointers[i]) < 0)
+            *err = strdup ("error allocating memory");
+          goto out;
+        }
+      if (projection_add (&proj, desc->kind == JSON_TYPE_OBJECT ? desc : NULL, json_pointers[i]) != 0)
+        {
+          *err = strdup ("error allocating memory");
+          goto out;
+        }
+    }
+  /* nothing selected yet, the parse still checks the document */
+  if (proj == NULL && desc->kind == JSON_TYPE_OBJECT)
+    {
+      proj = projection_new (desc);
+      if (proj == NULL)
+        {
+          *err = strdup ("error allocating memory");
+          goto out;
+        }
+    }
+
+  ret = stream_parse (jsondata, len, desc, proj, ctx, NULL, err);
+
+out:
+  projection_free (proj);
+  return ret;
+}
+
+void *
+json_stream_parse_insitu (char *jsondata, size_t len, const struct json_type_desc *desc,
+                          const struct parser_context *ctx, parser_error *err)
+{
+  struct parser_context insitu_ctx = *ctx;
+  struct json_arena *arena = ctx->arena;
+  void *ret;
+
+  if (arena == NULL)
+    arena = json_arena_new_with (0, ctx->allocator);
+  if (arena == NULL || json_arena_adopt (arena, jsondata, len + 1) != 0)
+    {
+      if (arena != ctx->arena)
+        json_arena_free (arena);
+      free (jsondata);
+      *err = strdup ("error allocating memory");
+      return NULL;
+    }
+
+  insitu_ctx.arena = arena;
+  ret = stream_parse (jsondata, len, desc, NULL, &insitu_ctx, jsondata, err);
+  if (arena != ctx->arena)
+    {
+      /* a private arena lives as long as the result */
+      if (ret != NULL)
+        json_arena_bind (arena, ret);
+      else
+        json_arena_free (arena);
+    }
+  return ret;
+}
+
+/* read size of json_stream_parser_feed_fd */
+#define PARSER_READ_SIZE (64 * 1024)
+
+struct json_stream_parser
+{
+  struct stream_ctx s;
+  struct parser_context ctx;
+  /* stream_finish ran, the scratch buffers are gone */
+  bool finished;
+  yajl_alloc_funcs afs;
+  yajl_handle h;
+  size_t max_size;
+  size_t fed;
+  /* error of a failed feed, handed out again by finish */
+  char *err;
+  char buf[PARSER_READ_SIZE];
+};
+
+struct json_stream_parser *
+json_stream_parser_new (const struct json_type_desc *desc, size_t max_size, const struct parser_context *ctx)
+{
+  struct json_stream_parser *p = calloc (1, sizeof (*p));
+
+  if (p == NULL)
+    return NULL;
+  /* the unknown keys and the lazy members are only kept from the whole
+     tree, the first feed or finish fails */
+  if (ctx->options & (OPT_PARSE_FULLKEY | OPT_PARSE_LAZY))
+    {
+      p->err = strdup ("cannot push parse with OPT_PARSE_FULLKEY or OPT_PARSE_LAZY");
+      if (p->err == NULL)
+        {
+          free (p);
+          return NULL;
+        }
+      p->finished = true;
+      return p;
+    }
+  p->ctx = *ctx;
+  p->s.ctx = &p->ctx;
+  p->s.desc = desc;
+  p->max_size = max_size != 0 ? max_size : JSON_MAX_SIZE;
+  p->h = yajl_alloc (&stream_callbacks, json_allocator_yajl (ctx->allocator, &p->afs), &p->s);
+  if (p->h == NULL)
+    {
+      json_stream_parser_free (p);
+      return NULL;
+    }
+  (void) yajl_config (p->h, yajl_allow_comments, 1);
+  return p;
+}
+
+/* drop what was parsed so far, the error stays with the parser */
+static int
+parser_fail (struct json_stream_parser *p, const char *msg, parser_error *err)
+{
+  if (!p->finished)
+    {
+      (void) stream_finish (&p->s, false, msg, &p->err);
+      p->finished = true;
+    }
+  if (err != NULL)
+    *err = strdup (p->err != NULL ? p->err : "error allocating memory");
+  return -1;
+}
+
+int
+json_stream_parser_feed (struct json_stream_parser *p, const char *buf, size_t len, parser_error *err)
+{
+  unsigned char *msg;
+  int ret;
+
+  if (p->finished)
+    return parser_fail (p, NULL, err);
+  if (len == 0)
+    return 0;
+  if (len > p->max_size - p->fed)
+    {
+      stream_error (&p->s, "cannot parse the data with length exceeding %zu", p->max_size);
+      return parser_fail (p, NULL, err);
+    }
+  p->fed += len;
+
+  if (yajl_parse (p->h, (const unsigned char *) buf, len) == yajl_status_ok)
+    return 0;
+  msg = p->s.err == NULL ? yajl_get_error (p->h, 1, (const unsigned char *) buf, len) : NULL;
+  ret = parser_fail (p, (const char *) msg, err);
+  if (msg != NULL)
+    yajl_free_error (p->h, msg);
+  return ret;
+}
+
+int
+json_stream_parser_feed_fd (struct json_stream_parser *p, int fd, parser_error *err)
+{
+  ssize_t n;
+
+  for (;;)
+    {
+      n = read (fd, p->buf, sizeof (p->buf));
+      if (n > 0)
+        {
+          if (json_stream_parser_feed (p, p->buf, (size_t) n, err) != 0)
+            return -1;
+          continue;
+        }
+      if (n == 0)
+        return 1;
+      if (errno == EINTR)
+        continue;
+      if (errno == EAGAIN || errno == EWOULDBLOCK)
+        return 0;
+      if (!p->finished)
+        stream_error (&p->s, "cannot read the data: %s", strerror (errno));
+      return parser_fail (p, NULL, err);
+    }
+}
+
+void *
+json_stream_parser_finish (struct json_stream_parser *p, parser_error *err)
+{
+  unsigned char *msg = NULL;
+  yajl_status stat;
+  void *ret = NULL;
+
+  *err = NULL;
+  if (p->finished)
+    {
+      *err = p->err != NULL ? move_ptr (p->err) : strdup ("error allocating memory");
+      goto out;
+    }
+  stat = yajl_complete_parse (p->h);
+  if (stat != yajl_status_ok && p->s.err == NULL)
+    msg = yajl_get_error (p->h, 0, NULL, 0);
+  ret = stream_finish (&p->s, stat == yajl_status_ok, (const char *) msg, err);
+  p->finished = true;
+  if (msg != NULL)
+    yajl_free_error (p->h, msg);
+
+out:
+  json_stream_parser_free (p);
+  return ret;
+}
+
+void
+json_stream_parser_free (struct json_stream_parser *p)
+{
+  if (p == NULL)
+    return;
+  /* abandoned halfway, release the partial result */
+  if (!p->finished)
+    (void) parser_fail (p, NULL, NULL);
+  if (p->h != NULL)
+    yajl_free (p->h);
+  free (p->err);
+  free (p);
+}
@@ -0,0 +1,761 @@
+/*
+  libocispec - a C library for parsing OCI spec files.
+
+  Copyright (C) Huawei Technologies., Ltd. 2026. All rights reserved.
+
+  libocispec is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 3 of the License, or
+  (at your option) any later version.
+
+  libocispec is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with libocispec.  If not, see <http://www.gnu.org/licenses/>.
+
+  As a special exception, you may create a larger work that contains
+  part or all of the libocispec parser skeleton and distribute that work
+  under terms of your choice, so long as that work isn't itself a
+  parser generator using the skeleton or a modified version thereof
+  as a parser skeleton.  Alternatively, if you modify or redistribute
+  the parser skeleton itself, you may (at your option) remove this
+  special exception, which will cause the skeleton and the resulting
+  libocispec output files to be licensed under the GNU General Public
+  License without this special exception.
+*/
+
+/* Generic make_, free_ and gen_ of the object and map types, driven by
+   the layout descriptors.  With generate.py --tables the per-type
+   functions are wrappers of these, so that a single copy of the code
+   serves every type.  The behaviour is the one of the expanded
+   functions emitted by sources.py, error messages included.  */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include "json_desc.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* slots of the keys of an object on the stack, larger objects use the heap */
+#define TABLE_STACK_SLOTS 64
+
+#define TABLE_MEMBER(base, offset, type) ((type *) ((char *) (base) + (offset)))
+
+static int
+table_oom (parser_error *err)
+{
+  *err = strdup ("error allocating memory");
+  return -1;
+}
+
+static int
+table_number (const struct json_field_desc *field, bool pointer, yajl_val val, void *dest, parser_error *err)
+{
+  int invalid = json_number_convert (field->num, YAJL_GET_NUMBER (val), dest);
+
+  if (invalid == 0)
+    return 0;
+  if (asprintf (err, "Invalid value '%s' with type '%s%s' for key '%s': %s", YAJL_GET_NUMBER (val),
+                json_number_names[field->num], pointer ? "Pointer" : "", field->name, strerror (-invalid)) < 0)
+    *err = strdup ("error allocating memory");
+  return -1;
+}
+
+static int
+table_make_map (const struct json_field_desc *field, yajl_val val, void **dest, const struct parser_context *ctx,
+                parser_error *err)
+{
+  char *new_error = NULL;
+
+  *dest = json_map_descs[field->map].make (val, ctx, err);
+  if (*dest != NULL)
+    return 0;
+  if (asprintf (&new_error, "Value error for key '%s': %s", field->name, *err ? *err : "null") < 0)
+    new_error = strdup ("error allocating memory");
+  free (*err);
+  *err = new_error;
+  return -1;
+}
+
+/* a value of kind, an item of field or field itself, like read_val_generator */
+static int
+table_make_value (const struct json_field_desc *field, unsigned char kind, yajl_val val, void *dest,
+                  const struct parser_context *ctx, parser_error *err)
+{
+  const char *str;
+  void *ptr;
+
+  if (kind == JSON_KIND_OBJECT)
+    {
+      *(void **) dest = field->type->make (val, ctx, err);
+      return *(void **) dest != NULL ? 0 : -1;
+    }
+  if (val == NULL)
+    return 0;
+
+  switch (kind)
+    {
+    case JSON_KIND_STRING:
+      str = YAJL_GET_STRING (val);
+      if (field->flags & JSON_FIELD_INTERN)
+        *(char **) dest = json_ctx_intern (ctx, str ? str : "");
+      else
+        *(char **) dest = json_ctx_strdup (ctx, str ? str : "");
+      return *(char **) dest != NULL ? 0 : -1;
+    case JSON_KIND_BOOL:
+      *(bool *) dest = YAJL_IS_TRUE (val);
+      return 0;
+    case JSON_KIND_BOOL_PTR:
+      ptr = json_ctx_calloc (ctx, 1, 0, sizeof (bool));
+      if (ptr == NULL)
+        return -1;
+      *(bool *) ptr = YAJL_IS_TRUE (val);
+      *(void **) dest = ptr;
+      return 0;
+    case JSON_KIND_NUMBER:
+      return table_number (field, false, val, dest, err);
+    case JSON_KIND_NUMBER_PTR:
+      ptr = json_ctx_calloc (ctx, 1, 0, json_number_size (field->num));
+      if (ptr == NULL)
+        return -1;
+      *(void **) dest = ptr;
+      return table_number (field, true, val, ptr, err);
+    case JSON_KIND_MAP:
+      return table_make_map (field, val, (void **) dest, ctx, err);
+    default:
+      return 0;
+    }
+}
+
+static int
+table_make_array (const struct json_field_desc *field, char *base, yajl_val val, const struct parser_context *ctx,
+                  parser_error *err)
+{
+  size_t size = json_value_size (field->item, field->num);
+  size_t i, j, len, row_len;
+  yajl_val *values, row;
+  char *items, *row_items;
+  size_t *lens;
+
+  if (val == NULL || YAJL_GET_ARRAY (val) == NULL || val->u.array.len == 0)
+    return 0;
+  len = val->u.array.len;
+  values = val->u.array.values;
+  *TABLE_MEMBER (base, field->len_offset, size_t) = len;
+  if (!(field->flags & JSON_FIELD_DOUBLE_ARRAY))
+    {
+      items = json_ctx_calloc (ctx, len, 1, size);
+      *TABLE_MEMBER (base, field->offset, char *) = items;
+      if (items == NULL)
+        return -1;
+      for (i = 0; i < len; i++)
+        if (table_make_value (field, field->item, values[i], items + i * size, ctx, err) != 0)
+          return -1;
+      return 0;
+    }
+
+  items = json_ctx_calloc (ctx, len, 1, sizeof (char *));
+  *TABLE_MEMBER (base, field->offset, char *) = items;
+  if (items == NULL)
+    return -1;
+  lens = json_ctx_calloc (ctx, len, 1, sizeof (size_t));
+  *TABLE_MEMBER (base, field->item_lens_offset, size_t *) = lens;
+  if (lens == NULL)
+    return -1;
+  for (i = 0; i < len; i++)
+    {
+      row = values[i];
+      row_len = YAJL_GET_ARRAY (row) != NULL ? row->u.array.len : 0;
+      row_items = json_ctx_calloc (ctx, row_len, 1, size);
+      ((char **) items)[i] = row_items;
+      if (row_items == NULL)
+        return -1;
+      for (j = 0; j < row_len; j++)
+        {
+          if (table_make_value (field, field->item, row->u.array.values[j], row_items + j * size, ctx, err) != 0)
+            return -1;
+          lens[i]++;
+        }
+    }
+  return 0;
+}
+
+/* the member field of base from val, the value of its key in the object */
+static int
+table_make_field (const struct json_field_desc *field, char *base, yajl_val val, const struct parser_context *ctx,
+                  parser_error *err)
+{
+  void **dest = TABLE_MEMBER (base, field->offset, void *);
+  const char *str;
+
+  switch (field->kind)
+    {
+    case JSON_KIND_STRING:
+      val = get_typed_val (val, yajl_t_string);
+      break;
+    case JSON_KIND_NUMBER:
+    case JSON_KIND_NUMBER_PTR:
+      val = get_typed_val (val, yajl_t_number);
+      break;
+    case JSON_KIND_BOOL:
+    case JSON_KIND_BOOL_PTR:
+      if (!YAJL_IS_TRUE (val) && !YAJL_IS_FALSE (val))
+        val = NULL;
+      break;
+    case JSON_KIND_OBJECT:
+      /* a missing or mismatched value leaves the member NULL */
+      *dest = field->type->make (get_typed_val (val, yajl_t_object), ctx, err);
+      return *dest == NULL && *err != NULL ? -1 : 0;
+    case JSON_KIND_MAP:
+      val = get_typed_val (val, yajl_t_object);
+      break;
+    case JSON_KIND_BYTES:
+      val = get_typed_val (val, yajl_t_string);
+      if (val == NULL)
+        return 0;
+      str = YAJL_GET_STRING (val);
+      *dest = json_ctx_strdup (ctx, str ? str : "");
+      if (*dest == NULL)
+        return -1;
+      *TABLE_MEMBER (base, field->len_offset, size_t) = str != NULL ? strlen (str) : 0;
+      return 0;
+    case JSON_KIND_ARRAY:
+      return table_make_array (field, base, get_typed_val (val, yajl_t_array), ctx, err);
+    default:
+      return 0;
+    }
+  return table_make_value (field, field->kind, val, dest, ctx, err);
+}
+
+/* dispatches the keys of tree into vals by slot, the first occurrence of a
+   key wins as with yajl_tree_get.  The unknown keys are written to the
+   _residual member under OPT_PARSE_FULLKEY.  */
+static int
+table_dispatch (const struct json_type_desc *desc, char *base, yajl_val tree, yajl_val *vals,
+                const struct parser_context *ctx)
+{
+  size_t i, unknown = 0;
+  size_t cnt = tree->u.object.len;
+  const char **keys = tree->u.object.keys;
+  yajl_val *values = tree->u.object.values;
+  int slot;
+
+  for (i = 0; i < cnt; i++)
+    {
+      slot = desc->field_index (keys[i], strlen (keys[i]));
+      if (slot >= 0)
+        {
+          if (vals[slot] == NULL)
+            vals[slot] = values[i];
+          continue;
+        }
+      if (desc->residual)
+        unknown++;
+    }
+  if (unknown > 0 && (ctx->options & OPT_PARSE_FULLKEY)
+      && json_residual_make (tree, desc->field_index, ctx, TABLE_MEMBER (base, desc->residual_offset, char *)) != 0)
+    return -1;
+  if ((ctx->options & OPT_PARSE_STRICT) && unknown > 0 && ctx->errfile != NULL)
+    (void) fprintf (ctx->errfile, "WARNING: unknown key found\n");
+  return 0;
+}
+
+static int
+table_make_fields (const struct json_type_desc *desc, char *base, yajl_val tree, yajl_val *vals,
+                   const struct parser_context *ctx, parser_error *err)
+{
+  const struct json_field_desc *field;
+  yajl_val *lazy = TABLE_MEMBER (base, desc->lazy_offset, yajl_val);
+  size_t i;
+
+  if (YAJL_GET_OBJECT (tree) != NULL && table_dispatch (desc, base, tree, vals, ctx) != 0)
+    return -1;
+  for (i = 0; i < desc->fields_len; i++)
+    {
+      field = &desc->fields[i];
+      if ((field->flags & JSON_FIELD_LAZY) && (ctx->options & OPT_PARSE_LAZY))
+        {
+          if (get_typed_val (vals[i], field->kind == JSON_KIND_ARRAY || field->kind == JSON_KIND_BYTES ?
+                             yajl_t_array : yajl_t_object) != NULL
+              && json_lazy_keep (lazy, field->name, tree, vals[i], ctx) != 0)
+            return table_oom (err);
+          continue;
+        }
+      if (table_make_field (field, base, vals[i], ctx, err) != 0)
+        return -1;
+    }
+
+  for (i = 0; i < desc->fields_len; i++)
+    {
+      field = &desc->fields[i];
+      if (!(field->flags & JSON_FIELD_REQUIRED) || *TABLE_MEMBER (base, field->offset, void *) != NULL)
+        continue;
+      if ((field->flags & JSON_FIELD_LAZY) && json_lazy_get (*lazy, field->name) != NULL)
+        continue;
+      if (asprintf (err, "Required field '%s' not present", field->name) < 0)
+        *err = strdup ("error allocating memory");
+      return -1;
+    }
+  return 0;
+}
+
+/* the entries of a mapStringObject type */
+static int
+table_make_entries (const struct json_type_desc *desc, char *base, yajl_val tree, const struct parser_context *ctx,
+                    parser_error *err)
+{
+  const struct json_field_desc *field = &desc->fields[0];
+  size_t i, len;
+  char **keys;
+  void **values;
+
+  if (YAJL_GET_OBJECT (tree) == NULL || tree->u.object.len == 0)
+    return 0;
+  len = tree->u.object.len;
+  *TABLE_MEMBER (base, field->len_offset, size_t) = len;
+  keys = json_ctx_calloc (ctx, len, 1, sizeof (char *));
+  *TABLE_MEMBER (base, desc->keys_offset, char **) = keys;
+  if (keys == NULL)
+    return -1;
+  values = json_ctx_calloc (ctx, len, 1, sizeof (void *));
+  *TABLE_MEMBER (base, field->offset, void **) = values;
+  if (values == NULL)
+    return -1;
+  for (i = 0; i < len; i++)
+    {
+      keys[i] = json_ctx_strdup (ctx, tree->u.object.keys[i] ? tree->u.object.keys[i] : "");
+      if (keys[i] == NULL)
+        return -1;
+      if (field->type != NULL)
+        values[i] = field->type->make (tree->u.object.values[i], ctx, err);
+      else
+        values[i] = json_map_descs[field->map].make (tree->u.object.values[i], ctx, err);
+      if (values[i] == NULL)
+        return -1;
+    }
+  return 0;
+}
+
+void *
+json_table_make (const struct json_type_desc *desc, yajl_val tree, const struct parser_context *ctx,
+                 parser_error *err)
+{
+  yajl_val stack_vals[TABLE_STACK_SLOTS];
+  yajl_val *vals = stack_vals;
+  char *ret;
+  int rc;
+
+  *err = NULL;
+  if (tree == NULL)
+    return NULL;
+  ret = json_ctx_calloc (ctx, 1, 0, desc->size);
+  if (ret == NULL)
+    return NULL;
+
+  if (desc->kind == JSON_TYPE_MAP)
+    rc = table_make_entries (desc, ret, tree, ctx, err);
+  else if (desc->fields_len == 0)
+    rc = 0;
+  else
+    {
+      if (desc->fields_len > TABLE_STACK_SLOTS)
+        {
+          vals = calloc (desc->fields_len, sizeof (yajl_val));
+          if (vals == NULL)
+            {
+              json_table_free (desc, ret);
+              return NULL;
+            }
+        }
+      else
+        (void) memset (vals, 0, desc->fields_len * sizeof (yajl_val));
+      rc = table_make_fields (desc, ret, tree, vals, ctx, err);
+      if (vals != stack_vals)
+        free (vals);
+    }
+  if (rc != 0)
+    {
+      json_table_free (desc, ret);
+      return NULL;
+    }
+  return ret;
+}
+
+void *
+json_table_make_member (const struct json_type_desc *desc, void *ptr, int slot, yajl_val val,
+                        const struct parser_context *ctx, parser_error *err)
+{
+  if (slot < 0 || (size_t) slot >= desc->fields_len)
+    return NULL;
+  return table_make_field (&desc->fields[slot], ptr, val, ctx, err) == 0 ? ptr : NULL;
+}
+
+static void
+table_free_array (const struct json_field_desc *field, char *base)
+{
+  char *items = *TABLE_MEMBER (base, field->offset, char *);
+  size_t len = *TABLE_MEMBER (base, field->len_offset, size_t);
+  bool inline_items = field->item == JSON_KIND_NUMBER || field->item == JSON_KIND_BOOL;
+  size_t *lens;
+  void **row;
+  size_t i, j;
+
+  if (items == NULL)
+    return;
+  if (!(field->flags & JSON_FIELD_DOUBLE_ARRAY))
+    {
+      for (i = 0; !inline_items && i < len; i++)
+        json_value_free (field->item, field, ((void **) items)[i]);
+      free (items);
+      return;
+    }
+
+  lens = *TABLE_MEMBER (base, field->item_lens_offset, size_t *);
+  for (i = 0; i < len; i++)
+    {
+      row = ((void ***) items)[i];
+      for (j = 0; !inline_items && row != NULL && lens != NULL && j < lens[i]; j++)
+        json_value_free (field->item, field, row[j]);
+      free (row);
+    }
+  free (lens);
+  free (items);
+}
+
+void
+json_table_free (const struct json_type_desc *desc, void *ptr)
+{
+  const struct json_field_desc *field;
+  char *base = ptr;
+  char **keys;
+  void **values;
+  size_t i, len;
+
+  if (ptr == NULL || json_arena_release (ptr))
+    return;
+
+  if (desc->kind == JSON_TYPE_MAP)
+    {
+      field = &desc->fields[0];
+      keys = *TABLE_MEMBER (base, desc->keys_offset, char **);
+      values = *TABLE_MEMBER (base, field->offset, void **);
+      len = *TABLE_MEMBER (base, field->len_offset, size_t);
+      if (keys != NULL && values != NULL)
+        for (i = 0; i < len; i++)
+          {
+            free (keys[i]);
+            json_value_free (field->kind, field, values[i]);
+          }
+      free (keys);
+      free (values);
+    }
+  else
+    for (i = 0; i < desc->fields_len; i++)
+      {
+        field = &desc->fields[i];
+        switch (field->kind)
+          {
+          case JSON_KIND_BOOL:
+          case JSON_KIND_NUMBER:
+            break;
+          case JSON_KIND_BYTES:
+            free (*TABLE_MEMBER (base, field->offset, void *));
+            break;
+          case JSON_KIND_ARRAY:
+            table_free_array (field, base);
+            break;
+          default:
+            json_value_free (field->kind, field, *TABLE_MEMBER (base, field->offset, void *));
+            break;
+          }
+      }
+
+  if (desc->residual)
+    free (*TABLE_MEMBER (base, desc->residual_offset, char *));
+  if (desc->lazy_make != NULL)
+    yajl_tree_free (*TABLE_MEMBER (base, desc->lazy_offset, yajl_val));
+  free (ptr);
+}
+
+static yajl_gen_status
+table_gen_number (yajl_gen g, unsigned char num, const void *src)
+{
+  if (num == JSON_NUM_DOUBLE)
+    return json_gen_double (g, src != NULL ? *(const double *) src : 0);
+  if (num >= JSON_NUM_UID)
+    return map_uint (g, src != NULL ? json_number_load_unsigned (num, src) : 0);
+  return map_int (g, src != NULL ? json_number_load_signed (num, src) : 0);
+}
+
+/* an item of kind at src, like json_value_generator */
+static yajl_gen_status
+table_gen_item (yajl_gen g, const struct json_field_desc *field, const void *src, const struct parser_context *ctx,
+                parser_error *err)
+{
+  const char *str;
+
+  switch (field->item)
+    {
+    case JSON_KIND_OBJECT:
+      return field->type->gen (g, *(void *const *) src, ctx, err);
+    case JSON_KIND_MAP:
+      return json_map_descs[field->map].gen (g, *(void *const *) src, ctx, err);
+    case JSON_KIND_STRING:
+      str = *(const char *const *) src;
+      if (str == NULL)
+        str = "";
+      return json_gen_string (g, (const unsigned char *) str, strlen (str));
+    case JSON_KIND_NUMBER:
+      return table_gen_number (g, field->num, src);
+    case JSON_KIND_BOOL:
+      return json_gen_bool (g, *(const bool *) src);
+    default:
+      return yajl_gen_status_ok;
+    }
+}
+
+static yajl_gen_status
+table_gen_array (yajl_gen g, const struct json_field_desc *field, const char *base, const struct parser_context *ctx,
+                 parser_error *err)
+{
+  const char *items = base != NULL ? *TABLE_MEMBER (base, field->offset, const char *) : NULL;
+  size_t len = items != NULL ? *TABLE_MEMBER (base, field->len_offset, const size_t) : 0;
+  size_t size = json_value_size (field->item, field->num);
+  bool flat = !len && !(ctx->options & OPT_GEN_SIMPLIFY);
+  const size_t *lens = NULL;
+  const char *row;
+  yajl_gen_status stat;
+  size_t i, j;
+
+  if (len > 0 && (field->flags & JSON_FIELD_DOUBLE_ARRAY))
+    lens = *TABLE_MEMBER (base, field->item_lens_offset, size_t *const);
+  if (flat)
+    json_gen_beautify (g, 0);
+  stat = json_gen_array_open (g);
+  if (stat != yajl_gen_status_ok)
+    GEN_SET_ERROR_AND_RETURN (stat, err);
+  for (i = 0; i < len; i++)
+    {
+      if (!(field->flags & JSON_FIELD_DOUBLE_ARRAY))
+        {
+          stat = table_gen_item (g, field, items + i * size, ctx, err);
+          if (stat != yajl_gen_status_ok)
+            GEN_SET_ERROR_AND_RETURN (stat, err);
+          continue;
+        }
+      stat = json_gen_array_open (g);
+      if (stat != yajl_gen_status_ok)
+        GEN_SET_ERROR_AND_RETURN (stat, err);
+      row = ((char *const *) items)[i];
+      for (j = 0; lens != NULL && j < lens[i]; j++)
+        {
+          stat = table_gen_item (g, field, row + j * size, ctx, err);
+          if (stat != yajl_gen_status_ok)
+            GEN_SET_ERROR_AND_RETURN (stat, err);
+        }
+      stat = json_gen_array_close (g);
+      if (stat != yajl_gen_status_ok)
+        GEN_SET_ERROR_AND_RETURN (stat, err);
+    }
+  stat = json_gen_array_close (g);
+  if (flat)
+    json_gen_beautify (g, 1);
+  if (stat != yajl_gen_status_ok)
+    GEN_SET_ERROR_AND_RETURN (stat, err);
+  return yajl_gen_status_ok;
+}
+
+/* whether the expanded gen_ writes the member without OPT_GEN_KEY_VALUE */
+static bool
+table_field_is_set (const struct json_field_desc *field, const char *base)
+{
+  if (base == NULL)
+    return false;
+  switch (field->kind)
+    {
+    case JSON_KIND_ARRAY:
+      return *TABLE_MEMBER (base, field->offset, void *const) != NULL;
+    case JSON_KIND_BYTES:
+      return *TABLE_MEMBER (base, field->offset, void *const) != NULL
+             && *TABLE_MEMBER (base, field->len_offset, const size_t) > 0;
+    default:
+      return json_field_is_set (field, base);
+    }
+}
+
+static yajl_gen_status
+table_gen_field (const struct json_type_desc *desc, yajl_gen g, const struct json_field_desc *field,
+                 const char *base, const struct parser_context *ctx, parser_error *err)
+{
+  const void *src = base != NULL ? base + field->offset : NULL;
+  const void *val = src != NULL ? *(void *const *) src : NULL;
+  yajl_val kept = NULL;
+  yajl_gen_status stat;
+  const char *str;
+  size_t len;
+
+  if ((field->flags & JSON_FIELD_LAZY) && base != NULL)
+    kept = json_lazy_get (*TABLE_MEMBER (base, desc->lazy_offset, const yajl_val), field->name);
+  if (kept == NULL)
+    {
+      /* booleanPointer members are never written, number pointers only when set */
+      if (field->kind == JSON_KIND_BOOL_PTR)
+        return yajl_gen_status_ok;
+      if (!table_field_is_set (field, base)
+          && (field->kind == JSON_KIND_NUMBER_PTR || !(ctx->options & OPT_GEN_KEY_VALUE)))
+        return yajl_gen_status_ok;
+    }
+
+  stat = json_gen_string (g, (const unsigned char *) field->name, strlen (field->name));
+  if (stat != yajl_gen_status_ok)
+    GEN_SET_ERROR_AND_RETURN (stat, err);
+  if (kept != NULL)
+    {
+      stat = gen_yajl_val (kept, g, err);
+      if (stat != yajl_gen_status_ok)
+        GEN_SET_ERROR_AND_RETURN (stat, err);
+      return yajl_gen_status_ok;
+    }
+
+  switch (field->kind)
+    {
+    case JSON_KIND_STRING:
+      str = val != NULL ? val : "";
+      stat = json_gen_string (g, (const unsigned char *) str, strlen (str));
+      break;
+    case JSON_KIND_BOOL:
+      stat = json_gen_bool (g, src != NULL && *(const bool *) src);
+      break;
+    case JSON_KIND_NUMBER:
+      stat = table_gen_number (g, field->num, src);
+      break;
+    case JSON_KIND_NUMBER_PTR:
+      stat = table_gen_number (g, field->num, val);
+      break;
+    case JSON_KIND_OBJECT:
+      stat = field->type->gen (g, val, ctx, err);
+      break;
+    case JSON_KIND_MAP:
+      stat = json_map_descs[field->map].gen (g, val, ctx, err);
+      break;
+    case JSON_KIND_BYTES:
+      len = val != NULL ? *TABLE_MEMBER (base, field->len_offset, const size_t) : 0;
+      stat = json_gen_string (g, val != NULL ? val : (const unsigned char *) "", len);
+      break;
+    case JSON_KIND_ARRAY:
+      return table_gen_array (g, field, base, ctx, err);
+    default:
+      break;
+    }
+  if (stat != yajl_gen_status_ok)
+    GEN_SET_ERROR_AND_RETURN (stat, err);
+  return yajl_gen_status_ok;
+}
+
+static yajl_gen_status
+table_gen_entries (const struct json_type_desc *desc, yajl_gen g, const char *base, const struct parser_context *ctx,
+                   parser_error *err)
+{
+  const struct json_field_desc *field = &desc->fields[0];
+  size_t len = base != NULL ? *TABLE_MEMBER (base, field->len_offset, const size_t) : 0;
+  bool flat = !len && !(ctx->options & OPT_GEN_SIMPLIFY);
+  char *const *keys = NULL;
+  void *const *values = NULL;
+  yajl_gen_status stat;
+  const char *str;
+  size_t i;
+
+  if (len > 0)
+    {
+      keys = *TABLE_MEMBER (base, desc->keys_offset, char **const);
+      values = *TABLE_MEMBER (base, field->offset, void **const);
+    }
+  if (flat)
+    json_gen_beautify (g, 0);
+  stat = json_gen_map_open (g);
+  if (stat != yajl_gen_status_ok)
+    GEN_SET_ERROR_AND_RETURN (stat, err);
+  for (i = 0; i < len; i++)
+    {
+      str = keys[i] ? keys[i] : "";
+      stat = json_gen_string (g, (const unsigned char *) str, strlen (str));
+      if (stat != yajl_gen_status_ok)
+        GEN_SET_ERROR_AND_RETURN (stat, err);
+      if (field->type != NULL)
+        stat = field->type->gen (g, values[i], ctx, err);
+      else
+        stat = json_map_descs[field->map].gen (g, values[i], ctx, err);
+      if (stat != yajl_gen_status_ok)
+        GEN_SET_ERROR_AND_RETURN (stat, err);
+    }
+  stat = json_gen_map_close (g);
+  if (stat != yajl_gen_status_ok)
+    GEN_SET_ERROR_AND_RETURN (stat, err);
+  if (flat)
+    json_gen_beautify (g, 1);
+  return yajl_gen_status_ok;
+}
+
+yajl_gen_status
+json_table_gen (const struct json_type_desc *desc, yajl_gen g, const void *ptr, const struct parser_context *ctx,
+                parser_error *err)
+{
+  const char *base = ptr;
+  /* the types without members are written on one line */
+  bool flat = desc->fields_len == 0 && !desc->residual && !(ctx->options & OPT_GEN_SIMPLIFY);
+  const char *residual;
+  yajl_gen_status stat;
+  const void *view;
+  size_t i;
+
+  *err = NULL;
+  if (desc->kind == JSON_TYPE_MAP)
+    return table_gen_entries (desc, g, base, ctx, err);
+
+  /* the kept lazy trees still hold the default values simplify drops */
+  if (base != NULL && desc->lazy_make != NULL && (ctx->options & OPT_GEN_SIMPLIFY)
+      && *TABLE_MEMBER (base, desc->lazy_offset, const yajl_val) != NULL)
+    {
+      view = json_lazy_view (desc, ptr);
+      if (view != ptr)
+        {
+          stat = json_table_gen (desc, g, view, ctx, err);
+          json_lazy_view_free (desc, ptr, view);
+          return stat;
+        }
+    }
+
+  if (flat)
+    json_gen_beautify (g, 0);
+  stat = json_gen_map_open (g);
+  if (stat != yajl_gen_status_ok)
+    GEN_SET_ERROR_AND_RETURN (stat, err);
+  for (i = 0; i < desc->fields_len; i++)
+    {
+      stat = table_gen_field (desc, g, &desc->fields[i], base, ctx, err);
+      if (stat != yajl_gen_status_ok)
+        return stat;
+    }
+  residual = desc->residual && base != NULL ? *TABLE_MEMBER (base, desc->residual_offset, const char *) : NULL;
+  if (residual != NULL)
+    {
+      stat = json_gen_residual (g, residual, err);
+      if (stat != yajl_gen_status_ok)
+        GEN_SET_ERROR_AND_RETURN (stat, err);
+    }
+  stat = json_gen_map_close (g);
+  if (stat != yajl_gen_status_ok)
+    GEN_SET_ERROR_AND_RETURN (stat, err);
+  if (flat)
+    json_gen_beautify (g, 1);
+  return yajl_gen_status_ok;
+}
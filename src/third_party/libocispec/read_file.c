@@ -20,62 +20,203 @@
 #include <string.h>
 #include <limits.h>
 #include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #ifndef JSON_MAX_SIZE
 #define JSON_MAX_SIZE (10LL * 1024LL * 1024LL)
 #endif
 
+/* regular files from this size on are mapped by map_file */
+#define MAP_FILE_MIN (256 * 1024)
+
+/* double buf to hold more than off bytes plus the NUL */
+static char *
+grow_buffer (char *buf, size_t off, size_t *cap)
+{
+  char *tmpbuf;
+
+  if (off > JSON_MAX_SIZE)
+    {
+      free (buf);
+      return NULL;
+    }
+  *cap = *cap < BUFSIZ ? BUFSIZ : *cap * 2;
+  tmpbuf = realloc (buf, *cap);
+  if (tmpbuf == NULL)
+    free (buf);
+  return tmpbuf;
+}
+
+/* bytes left to read in a regular file, 0 if unknown */
+static size_t
+size_hint (int fd, off_t pos)
+{
+  struct stat st;
+
+  if (fstat (fd, &st) < 0 || !S_ISREG (st.st_mode) || pos < 0 || st.st_size <= pos
+      || st.st_size - pos > JSON_MAX_SIZE)
+    return 0;
+  return (size_t) (st.st_size - pos);
+}
+
 char *
 fread_file (FILE *stream, size_t *length)
 {
-  char *buf = NULL, *tmpbuf = NULL;
+  char *buf = NULL;
   size_t off = 0;
+  size_t cap;
+
+  /* start at the size of the file so the usual case reads it at once */
+  cap = size_hint (fileno (stream), ftello (stream));
+  cap = cap > 0 ? cap + 1 : BUFSIZ + 1;
+  buf = malloc (cap);
+  if (buf == NULL)
+    return NULL;
 
   while (1)
     {
-      size_t ret;
-      tmpbuf = realloc (buf, off + BUFSIZ + 1);
-      if (tmpbuf == NULL)
+      int c;
+
+      off += fread (buf + off, 1, cap - off - 1, stream);
+      if (ferror (stream))
         {
           free (buf);
           return NULL;
         }
-      buf = tmpbuf;
-      ret = fread (buf + off, 1, BUFSIZ, stream);
-      if (ret == 0 && ferror (stream))
+      /* a full buffer is usually the whole file, peek before growing it */
+      c = feof (stream) ? EOF : fgetc (stream);
+      if (c == EOF)
         {
-          free (buf);
-          return NULL;
+          if (ferror (stream))
+            {
+              free (buf);
+              return NULL;
+            }
+          *length = off + 1;
+          buf[off] = '\0';
+          return buf;
         }
-      if (ret < BUFSIZ || feof (stream))
+      if (off + 1 == cap)
         {
-          *length = off + ret + 1;
-          buf[*length - 1] = '\0';
-          return buf;
+          buf = grow_buffer (buf, off, &cap);
+          if (buf == NULL)
+            return NULL;
         }
-      if (off > JSON_MAX_SIZE)
+      buf[off++] = (char) c;
+    }
+}
+
+/* read fd to the end, a regular file of size bytes with a single read */
+static char *
+read_fd (int fd, size_t size, size_t *length)
+{
+  char *buf;
+  size_t off = 0;
+  size_t cap = size > 0 ? size + 1 : BUFSIZ + 1;
+
+  buf = malloc (cap);
+  if (buf == NULL)
+    return NULL;
+
+  while (size == 0 || off < size)
+    {
+      ssize_t ret;
+
+      if (off + 1 == cap)
+        {
+          buf = grow_buffer (buf, off, &cap);
+          if (buf == NULL)
+            return NULL;
+        }
+      ret = read (fd, buf + off, cap - off - 1);
+      if (ret < 0 && errno == EINTR)
+        continue;
+      if (ret < 0)
         {
           free (buf);
           return NULL;
         }
-      off += BUFSIZ;
+      if (ret == 0)
+        break;
+      off += (size_t) ret;
     }
+  buf[off] = '\0';
+  *length = off + 1;
+  return buf;
 }
 
 char *
 read_file (const char *path, size_t *length)
 {
-  FILE *f;
+  int fd;
   char *buf = NULL;
 
   if (!path || !length)
     return NULL;
 
-  f = fopen (path, "r");
-  if (f == NULL)
+  fd = open (path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
     return NULL;
 
-  buf = fread_file (f, length);
-  fclose (f);
+  buf = read_fd (fd, size_hint (fd, 0), length);
+  close (fd);
   return buf;
 }
+
+char *
+map_file (const char *path, size_t *length, bool *mapped)
+{
+  struct stat st;
+  long page = sysconf (_SC_PAGESIZE);
+  char *buf = NULL;
+  size_t len = 0;
+  int fd;
+
+  if (!path || !length || !mapped)
+    return NULL;
+
+  *mapped = false;
+  fd = open (path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+  if (fstat (fd, &st) < 0)
+    goto out;
+
+  /* the zeroed tail of the last page terminates the mapping, so files
+     filling their last page exactly are read */
+  if (S_ISREG (st.st_mode) && st.st_size >= MAP_FILE_MIN && st.st_size <= JSON_MAX_SIZE
+      && page > 0 && st.st_size % page != 0)
+    {
+      buf = mmap (NULL, (size_t) st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+      if (buf != MAP_FAILED)
+        {
+          (void) madvise (buf, (size_t) st.st_size, MADV_SEQUENTIAL);
+          *mapped = true;
+          *length = (size_t) st.st_size;
+          goto out;
+        }
+      buf = NULL;
+    }
+
+  buf = read_fd (fd, size_hint (fd, 0), &len);
+  if (buf != NULL)
+    *length = len - 1;
+out:
+  close (fd);
+  return buf;
+}
+
+void
+unmap_file (char *data, size_t length, bool mapped)
+{
+  if (data == NULL)
+    return;
+  if (mapped)
+    (void) munmap (data, length);
+  else
+    free (data);
+}
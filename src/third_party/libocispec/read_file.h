@@ -22,11 +22,20 @@ extern "C" {
 #endif
 
 #include <stdio.h>
+#include <stdbool.h>
 
+/* *length of the two readers counts the terminating NUL */
 char *fread_file (FILE *stream, size_t *length);
 
 char *read_file (const char *path, size_t *length);
 
+/* contents of path as a NUL terminated buffer of *length bytes, mapped
+   privately for large files; release it with unmap_file.  Truncating a
+   file while it is mapped makes the reads past its end fault.  */
+char *map_file (const char *path, size_t *length, bool *mapped);
+
+void unmap_file (char *data, size_t length, bool mapped);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,8 +28,12 @@
 # libocispec output files to be licensed under the GNU General Public
 # License without this special exception.
 
+import sys
 import helpers
 
+# make_, free_ and gen_ of objects are wrappers of json_table.c, set by generate.py --tables
+TABLE_MODE = False
+
 
 def append_c_code(obj, c_file, prefix):
     """
@@ -40,6 +44,7 @@ def append_c_code(obj, c_file, prefix):
     parse_json_to_c(obj, c_file, prefix)
     make_c_free (obj, c_file, prefix)
     get_c_json(obj, c_file, prefix)
+    make_c_desc(obj, c_file, prefix)
 
 
 def parse_map_string_obj(obj, c_file, prefix, obj_typename):
@@ -63,10 +68,10 @@ def parse_map_string_obj(obj, c_file, prefix, obj_typename):
     c_file.write('        const char **keys = YAJL_GET_OBJECT_NO_CHECK (tree)->keys;\n')
     c_file.write('        yajl_val *values = YAJL_GET_OBJECT_NO_CHECK (tree)->values;\n')
     c_file.write('        ret->len = len;\n')
-    c_file.write('        ret->keys = smart_calloc (len, 1, sizeof (*ret->keys));\n')
+    c_file.write('        ret->keys = json_ctx_calloc (ctx, len, 1, sizeof (*ret->keys));\n')
     c_file.write('        if (ret->keys == NULL)\n')
     c_file.write('          return NULL;\n')
-    c_file.write('        ret->%s = smart_calloc (len, 1, sizeof (*ret->%s));\n' % \
+    c_file.write('        ret->%s = json_ctx_calloc (ctx, len, 1, sizeof (*ret->%s));\n' % \
                  (child.fixname, child.fixname))
     c_file.write('        if (ret->%s == NULL)\n' % child.fixname)
     c_file.write('          {\n')
@@ -76,7 +81,7 @@ def parse_map_string_obj(obj, c_file, prefix, obj_typename):
     c_file.write('          {\n')
     c_file.write('            yajl_val val;\n')
     c_file.write('            const char *tmpkey = keys[i];\n')
-    c_file.write('            ret->keys[i] = strdup (tmpkey ? tmpkey : "");\n')
+    c_file.write('            ret->keys[i] = json_ctx_strdup (ctx, tmpkey ? tmpkey : "");\n')
     c_file.write('            if (ret->keys[i] == NULL)\n')
     c_file.write('              {\n')
     c_file.write("                return NULL;\n")
@@ -92,7 +97,7 @@ def parse_map_string_obj(obj, c_file, prefix, obj_typename):
     c_file.write('    }\n')
 
 
-def parse_obj_type_array(obj, c_file, prefix, obj_typename):
+def parse_obj_type_array(obj, c_file, prefix, obj_typename, slot):
     if obj.subtypobj or obj.subtyp == 'object':
         if obj.subtypname:
             typename = obj.subtypname
@@ -100,8 +105,7 @@ def parse_obj_type_array(obj, c_file, prefix, obj_typename):
             typename = helpers.get_name_substr(obj.name, prefix)
         c_file.write('    do\n')
         c_file.write('      {\n')
-        c_file.write('        yajl_val tmp = get_val (tree, "%s", yajl_t_array);\n' \
-                     % (obj.origname))
+        c_file.write('        yajl_val tmp = %s;\n' % field_val(slot, 'yajl_t_array'))
         c_file.write('        if (tmp != NULL && YAJL_GET_ARRAY (tmp) != NULL &&' \
                      ' YAJL_GET_ARRAY_NO_CHECK (tmp)->len > 0)\n')
         c_file.write('          {\n')
@@ -109,14 +113,14 @@ def parse_obj_type_array(obj, c_file, prefix, obj_typename):
         c_file.write('            size_t len = YAJL_GET_ARRAY_NO_CHECK (tmp)->len;\n')
         c_file.write('            yajl_val *values = YAJL_GET_ARRAY_NO_CHECK (tmp)->values;\n')
         c_file.write('            ret->%s_len = len;\n' % (obj.fixname))
-        c_file.write('            ret->%s = smart_calloc (len, 1, sizeof (*ret->%s));\n' % \
+        c_file.write('            ret->%s = json_ctx_calloc (ctx, len, 1, sizeof (*ret->%s));\n' % \
                      (obj.fixname, obj.fixname))
         c_file.write('            if (ret->%s == NULL)\n' % obj.fixname)
         c_file.write('              {\n')
         c_file.write('                return NULL;\n')
         c_file.write('              }\n')
         if obj.doublearray:
-            c_file.write('              ret->%s_item_lens = smart_calloc ( len, 1, sizeof (size_t));\n'
+            c_file.write('              ret->%s_item_lens = json_ctx_calloc (ctx, len, 1, sizeof (size_t));\n'
                     % (obj.fixname))
             c_file.write('              if (ret->%s_item_lens == NULL)\n' % (obj.fixname))
             c_file.write('                  return NULL;\n')
@@ -125,7 +129,7 @@ def parse_obj_type_array(obj, c_file, prefix, obj_typename):
         c_file.write('                yajl_val val = values[i];\n')
         if obj.doublearray:
             c_file.write('                size_t j;\n')
-            c_file.write('                ret->%s[i] = smart_calloc ( YAJL_GET_ARRAY_NO_CHECK(val)->len, 1, sizeof (**ret->%s));\n'
+            c_file.write('                ret->%s[i] = json_ctx_calloc (ctx, YAJL_GET_ARRAY_NO_CHECK(val)->len, 1, sizeof (**ret->%s));\n'
                     % (obj.fixname, obj.fixname))
             c_file.write('                if (ret->%s[i] == NULL)\n' % obj.fixname)
             c_file.write('                    return NULL;\n')
@@ -152,13 +156,12 @@ def parse_obj_type_array(obj, c_file, prefix, obj_typename):
     elif obj.subtyp == 'byte':
         c_file.write('    do\n')
         c_file.write('      {\n')
-        c_file.write('        yajl_val tmp = get_val (tree, "%s", yajl_t_string);\n' \
-                     % (obj.origname))
+        c_file.write('        yajl_val tmp = %s;\n' % field_val(slot, 'yajl_t_string'))
         c_file.write('        if (tmp != NULL)\n')
         c_file.write('          {\n')
         if obj.doublearray:
             c_file.write('                yajl_val *items = YAJL_GET_ARRAY_NO_CHECK(tmp)->values;\n')
-            c_file.write('                ret->%s = smart_calloc ( YAJL_GET_ARRAY_NO_CHECK(tmp)->len, 1, sizeof (*ret->%s));\n'
+            c_file.write('                ret->%s = json_ctx_calloc (ctx, YAJL_GET_ARRAY_NO_CHECK(tmp)->len, 1, sizeof (*ret->%s));\n'
                     % (obj.fixname, obj.fixname))
             c_file.write('                if (ret->%s[i] == NULL)\n' % obj.fixname)
             c_file.write('                    return NULL;\n')
@@ -166,14 +169,14 @@ def parse_obj_type_array(obj, c_file, prefix, obj_typename):
             c_file.write('                for (j = 0; j < YAJL_GET_ARRAY_NO_CHECK(tmp)->len; j++)\n')
             c_file.write('                  {\n')
             c_file.write('                    char *str = YAJL_GET_STRING (itmes[j]);\n')
-            c_file.write('                    ret->%s[j] = (uint8_t *)strdup (str ? str : "");\n' \
+            c_file.write('                    ret->%s[j] = (uint8_t *)json_ctx_strdup (ctx, str ? str : "");\n' \
                     % obj.fixname)
             c_file.write('                    if (ret->%s[j] == NULL)\n' % (obj.fixname))
             c_file.write("                        return NULL;\n")
             c_file.write('                };\n')
         else:
             c_file.write('            char *str = YAJL_GET_STRING (tmp);\n')
-            c_file.write('            ret->%s = (uint8_t *)strdup (str ? str : "");\n' \
+            c_file.write('            ret->%s = (uint8_t *)json_ctx_strdup (ctx, str ? str : "");\n' \
                          % obj.fixname)
             c_file.write('            if (ret->%s == NULL)\n' % obj.fixname)
             c_file.write('              return NULL;\n')
@@ -185,8 +188,7 @@ def parse_obj_type_array(obj, c_file, prefix, obj_typename):
     else:
         c_file.write('    do\n')
         c_file.write('      {\n')
-        c_file.write('        yajl_val tmp = get_val (tree, "%s", yajl_t_array);\n' \
-                     % (obj.origname))
+        c_file.write('        yajl_val tmp = %s;\n' % field_val(slot, 'yajl_t_array'))
         c_file.write('        if (tmp != NULL && YAJL_GET_ARRAY (tmp) != NULL &&'  \
                      ' YAJL_GET_ARRAY_NO_CHECK (tmp)->len > 0)\n')
         c_file.write('          {\n')
@@ -194,14 +196,14 @@ def parse_obj_type_array(obj, c_file, prefix, obj_typename):
         c_file.write('            size_t len = YAJL_GET_ARRAY_NO_CHECK (tmp)->len;\n')
         c_file.write('            yajl_val *values = YAJL_GET_ARRAY_NO_CHECK (tmp)->values;\n')
         c_file.write('            ret->%s_len = len;\n' % (obj.fixname))
-        c_file.write('            ret->%s = smart_calloc (len, 1, sizeof (*ret->%s));\n' \
+        c_file.write('            ret->%s = json_ctx_calloc (ctx, len, 1, sizeof (*ret->%s));\n' \
                      % (obj.fixname, obj.fixname))
         c_file.write('            if (ret->%s == NULL)\n' % obj.fixname)
         c_file.write('              {\n')
         c_file.write('                return NULL;\n')
         c_file.write('              }\n')
         if obj.doublearray:
-            c_file.write('              ret->%s_item_lens = smart_calloc ( len, 1, sizeof (size_t));\n'
+            c_file.write('              ret->%s_item_lens = json_ctx_calloc (ctx, len, 1, sizeof (size_t));\n'
                     % (obj.fixname))
             c_file.write('              if (ret->%s_item_lens == NULL)\n' % (obj.fixname))
             c_file.write('                  return NULL;\n')
@@ -209,7 +211,7 @@ def parse_obj_type_array(obj, c_file, prefix, obj_typename):
         c_file.write('              {\n')
         if obj.doublearray:
             c_file.write('                    yajl_val *items = YAJL_GET_ARRAY_NO_CHECK(values[i])->values;\n')
-            c_file.write('                    ret->%s[i] = smart_calloc ( YAJL_GET_ARRAY_NO_CHECK(values[i])->len, 1, sizeof (**ret->%s));\n'
+            c_file.write('                    ret->%s[i] = json_ctx_calloc (ctx, YAJL_GET_ARRAY_NO_CHECK(values[i])->len, 1, sizeof (**ret->%s));\n'
                     % (obj.fixname, obj.fixname))
             c_file.write('                    if (ret->%s[i] == NULL)\n' % obj.fixname)
             c_file.write('                        return NULL;\n')
@@ -217,18 +219,27 @@ def parse_obj_type_array(obj, c_file, prefix, obj_typename):
             c_file.write('                    for (j = 0; j < YAJL_GET_ARRAY_NO_CHECK(values[i])->len; j++)\n')
             c_file.write('                      {\n')
             read_val_generator(c_file, 5, 'items[j]', \
-                                "ret->%s[i][j]" % obj.fixname, obj.subtyp, obj.origname, obj_typename)
+                                "ret->%s[i][j]" % obj.fixname, obj.subtyp, obj.origname, obj_typename, obj.intern)
             c_file.write('                        ret->%s_item_lens[i] += 1;\n' % (obj.fixname))
             c_file.write('                    };\n')
         else:
             read_val_generator(c_file, 4, 'values[i]', \
-                                "ret->%s[i]" % obj.fixname, obj.subtyp, obj.origname, obj_typename)
+                                "ret->%s[i]" % obj.fixname, obj.subtyp, obj.origname, obj_typename, obj.intern)
         c_file.write('              }\n')
         c_file.write('        }\n')
         c_file.write('      }\n')
         c_file.write('    while (0);\n')
 
-def parse_obj_type(obj, c_file, prefix, obj_typename):
+def field_val(slot, yajl_type):
+    """
+    Description: c expression for the value dispatched into field slot, if of the given type
+    Interface: None
+    History: 2026-10-18
+    """
+    return 'get_typed_val (fields[%d], %s)' % (slot, yajl_type)
+
+
+def parse_obj_type(obj, c_file, prefix, obj_typename, slot):
     """
     Description: generate c language for parse object type
     Interface: None
@@ -237,35 +248,35 @@ def parse_obj_type(obj, c_file, prefix, obj_typename):
     if obj.typ == 'string':
         c_file.write('    do\n')
         c_file.write('      {\n')
-        read_val_generator(c_file, 2, 'get_val (tree, "%s", yajl_t_string)' % obj.origname, \
-                             "ret->%s" % obj.fixname, obj.typ, obj.origname, obj_typename)
+        read_val_generator(c_file, 2, field_val(slot, 'yajl_t_string'), \
+                             "ret->%s" % obj.fixname, obj.typ, obj.origname, obj_typename, obj.intern)
         c_file.write('      }\n')
         c_file.write('    while (0);\n')
     elif helpers.judge_data_type(obj.typ):
         c_file.write('    do\n')
         c_file.write('      {\n')
-        read_val_generator(c_file, 2, 'get_val (tree, "%s", yajl_t_number)' % obj.origname, \
+        read_val_generator(c_file, 2, field_val(slot, 'yajl_t_number'), \
                              "ret->%s" % obj.fixname, obj.typ, obj.origname, obj_typename)
         c_file.write('      }\n')
         c_file.write('    while (0);\n')
     elif helpers.judge_data_pointer_type(obj.typ):
         c_file.write('    do\n')
         c_file.write('      {\n')
-        read_val_generator(c_file, 2, 'get_val (tree, "%s", yajl_t_number)' % obj.origname, \
+        read_val_generator(c_file, 2, field_val(slot, 'yajl_t_number'), \
                              "ret->%s" % obj.fixname, obj.typ, obj.origname, obj_typename)
         c_file.write('      }\n')
         c_file.write('    while (0);\n')
     if obj.typ == 'boolean':
         c_file.write('    do\n')
         c_file.write('      {\n')
-        read_val_generator(c_file, 2, 'get_val (tree, "%s", yajl_t_true)' % obj.origname, \
+        read_val_generator(c_file, 2, field_val(slot, 'yajl_t_true'), \
                              "ret->%s" % obj.fixname, obj.typ, obj.origname, obj_typename)
         c_file.write('      }\n')
         c_file.write('    while (0);\n')
     if obj.typ == 'booleanPointer':
         c_file.write('    do\n')
         c_file.write('      {\n')
-        read_val_generator(c_file, 2, 'get_val (tree, "%s", yajl_t_true)' % obj.origname, \
+        read_val_generator(c_file, 2, field_val(slot, 'yajl_t_true'), \
                              "ret->%s" % obj.fixname, obj.typ, obj.origname, obj_typename)
         c_file.write('      }\n')
         c_file.write('    while (0);\n')
@@ -275,19 +286,18 @@ def parse_obj_type(obj, c_file, prefix, obj_typename):
         else:
             typename = helpers.get_prefixed_name(obj.name, prefix)
         c_file.write(
-            '    ret->%s = make_%s (get_val (tree, "%s", yajl_t_object), ctx, err);\n' \
-            % (obj.fixname, typename, obj.origname))
+            '    ret->%s = make_%s (%s, ctx, err);\n' \
+            % (obj.fixname, typename, field_val(slot, 'yajl_t_object')))
         c_file.write("    if (ret->%s == NULL && *err != 0)\n" % obj.fixname)
         c_file.write("      {\n")
         c_file.write("        return NULL;\n")
         c_file.write("      }\n")
     elif obj.typ == 'array':
-        parse_obj_type_array(obj, c_file, prefix, obj_typename)
+        parse_obj_type_array(obj, c_file, prefix, obj_typename, slot)
     elif helpers.valid_basic_map_name(obj.typ):
         c_file.write('    do\n')
         c_file.write('      {\n')
-        c_file.write('        yajl_val tmp = get_val (tree, "%s", yajl_t_object);\n' \
-                     % (obj.origname))
+        c_file.write('        yajl_val tmp = %s;\n' % field_val(slot, 'yajl_t_object'))
         c_file.write('        if (tmp != NULL)\n')
         c_file.write('          {\n')
         c_file.write('            ret->%s = make_%s (tmp, ctx, err);\n' \
@@ -307,6 +317,98 @@ def parse_obj_type(obj, c_file, prefix, obj_typename):
         c_file.write('      }\n')
         c_file.write('    while (0);\n')
 
+def c_char_literal(byte):
+    """
+    Description: c literal for a single byte
+    Interface: None
+    History: 2026-10-18
+    """
+    if byte in (ord("'"), ord('\\')):
+        return "'\\%c'" % byte
+    if 0x20 <= byte < 0x7f:
+        return "'%c'" % byte
+    return "%d" % byte
+
+
+def make_field_index(nodes, c_file, typename):
+    """
+    Description: generate the key to field slot dispatch function of an object,
+                 switching on the key length and first byte before comparing
+    Interface: None
+    History: 2026-10-18
+    """
+    buckets = {}
+    for slot, i in enumerate(nodes):
+        key = i.origname.encode('utf-8')
+        buckets.setdefault(len(key), {}).setdefault(key[:1], []).append((slot, i.origname))
+    c_file.write("static int\n%s_field_index (const char *key, size_t len)\n" % typename)
+    c_file.write("{\n")
+    c_file.write("    switch (len)\n")
+    c_file.write("      {\n")
+    for length in sorted(buckets):
+        c_file.write("        case %d:\n" % length)
+        c_file.write("          switch ((unsigned char) key[0])\n")
+        c_file.write("            {\n")
+        for first in sorted(buckets[length]):
+            c_file.write("              case %s:\n" % c_char_literal(first[0]))
+            for slot, name in buckets[length][first]:
+                c_file.write('                if (memcmp (key, "%s", %d) == 0)\n' % (name, length))
+                c_file.write("                  return %d;\n" % slot)
+            c_file.write("                break;\n")
+        c_file.write("            }\n")
+        c_file.write("          break;\n")
+    c_file.write("      }\n")
+    c_file.write("    return -1;\n")
+    c_file.write("}\n\n")
+
+
+def parse_obj_fields(obj, c_file, typename, nodes):
+    """
+    Description: generate c language for the single walk over the keys of an object,
+                 dispatching known keys into field slots and collecting unknown keys
+    Interface: None
+    History: 2026-10-18
+    """
+    residual = obj.typ == 'object'
+    c_file.write("    if (YAJL_GET_OBJECT (tree) != NULL)\n")
+    c_file.write("      {\n")
+    c_file.write("        size_t i;\n")
+    c_file.write("        size_t cnt = YAJL_GET_OBJECT_NO_CHECK (tree)->len;\n")
+    c_file.write("        const char **keys = YAJL_GET_OBJECT_NO_CHECK (tree)->keys;\n")
+    c_file.write("        yajl_val *values = YAJL_GET_OBJECT_NO_CHECK (tree)->values;\n")
+    if residual:
+        c_file.write("        size_t j = 0;\n")
+    c_file.write("        for (i = 0; i < cnt; i++)\n")
+    c_file.write("          {\n")
+    c_file.write("            int slot = %s_field_index (keys[i], strlen (keys[i]));\n" % typename)
+    c_file.write("            if (slot >= 0)\n")
+    c_file.write("              {\n")
+    c_file.write("                /* the first occurrence of a key wins, as with yajl_tree_get.  */\n")
+    c_file.write("                if (fields[slot] == NULL)\n")
+    c_file.write("                    fields[slot] = values[i];\n")
+    c_file.write("                continue;\n")
+    c_file.write("              }\n")
+    if residual:
+        c_file.write("""            j++;
+          }
+        /* the unknown keys are kept as json text, the tree stays with the caller */
+        if (j > 0 && (ctx->options & OPT_PARSE_FULLKEY)
+            && json_residual_make (tree, %s_field_index, ctx, &ret->_residual) != 0)
+          {
+            return NULL;
+          }
+        if (ctx->options & OPT_PARSE_STRICT)
+          {
+            if (j > 0 && ctx->errfile != NULL)
+                (void) fprintf (ctx->errfile, "WARNING: unknown key found\\n");
+          }
+      }
+""" % typename)
+    else:
+        c_file.write("          }\n")
+        c_file.write("      }\n")
+
+
 def parse_obj_arr_obj(obj, c_file, prefix, obj_typename):
     """
     Description: generate c language for parse object or array object
@@ -315,14 +417,23 @@ def parse_obj_arr_obj(obj, c_file, prefix, obj_typename):
     """
     nodes = obj.children if obj.typ == 'object' else obj.subtypobj
     required_to_check = []
-    for i in nodes or []:
+    if nodes:
+        parse_obj_fields(obj, c_file, obj_typename, nodes)
+    for slot, i in enumerate(nodes or []):
         if obj.required and i.origname in obj.required and \
                 not helpers.judge_data_type(i.typ) and i.typ != 'boolean':
             required_to_check.append(i)
-        parse_obj_type(i, c_file, prefix, obj_typename)
+        if i.lazy and obj.typ == 'object':
+            parse_lazy_member(i, c_file, obj_typename, slot)
+        else:
+            parse_obj_type(i, c_file, prefix, obj_typename, slot)
 
     for i in required_to_check:
-        c_file.write('    if (ret->%s == NULL)\n' % i.fixname)
+        if i.lazy and obj.typ == 'object':
+            c_file.write('    if (ret->%s == NULL && json_lazy_get (ret->_lazy, "%s") == NULL)\n' \
+                         % (i.fixname, i.origname))
+        else:
+            c_file.write('    if (ret->%s == NULL)\n' % i.fixname)
         c_file.write('      {\n')
         c_file.write('        if (asprintf (err, "Required field \'%%s\' not present", ' \
                      ' "%s") < 0)\n' % i.origname)
@@ -330,64 +441,63 @@ def parse_obj_arr_obj(obj, c_file, prefix, obj_typename):
         c_file.write("        return NULL;\n")
         c_file.write('      }\n')
 
-    if obj.typ == 'object' and obj.children is not None:
-        # O(n^2) complexity, but the objects should not really be big...
-        condition = "\n                && ".join( \
-            ['strcmp (tree->u.object.keys[i], "%s")' % i.origname for i in obj.children])
-        c_file.write("""
-    if (tree->type == yajl_t_object)
-      {
-        size_t i;
-        size_t j = 0;
-        size_t cnt = tree->u.object.len;
-        yajl_val resi = NULL;
 
-        if (ctx->options & OPT_PARSE_FULLKEY)
-          {
-            resi = smart_calloc (1, 0, sizeof(*tree));
-            if (resi == NULL)
-              {
-                return NULL;
-              }
-            resi->type = yajl_t_object;
-            resi->u.object.keys = smart_calloc (cnt, 0, sizeof (const char *));
-            if (resi->u.object.keys == NULL)
-              {
-                yajl_tree_free (resi);
-                return NULL;
-              }
-            resi->u.object.values = smart_calloc (cnt, 0, sizeof (yajl_val));
-            if (resi->u.object.values == NULL)
-              {
-                yajl_tree_free (resi);
-                return NULL;
-              }
-          }
+def make_lazy_members(obj, c_file, prefix, typename):
+    """
+    Description: generate the decoders of the members kept as yajl trees under OPT_PARSE_LAZY,
+                 and their dispatch by field slot for the layout descriptor
+    Interface: None
+    History: 2026-10-18
+    """
+    lazy = helpers.lazy_fields(obj)
+    if not lazy:
+        return
+    if TABLE_MODE:
+        c_file.write("static void *\nmake_lazy_%s (void *ptr, int slot, yajl_val val, "\
+            "const struct parser_context *ctx, parser_error *err)\n" % typename)
+        c_file.write("{\n")
+        c_file.write("    return json_table_make_member (&desc_%s, ptr, slot, val, ctx, err);\n" % typename)
+        c_file.write("}\n\n")
+        return
+    for _, i in lazy:
+        c_file.write("static %s *\nmake_lazy_%s_%s (%s *ret, yajl_val val, const struct parser_context *ctx, "\
+            "parser_error *err)\n" % (typename, typename, i.fixname, typename))
+        c_file.write("{\n")
+        c_file.write("    yajl_val fields[1] = { val };\n")
+        parse_obj_type(i, c_file, prefix, typename, 0)
+        c_file.write("    return ret;\n")
+        c_file.write("}\n\n")
+    c_file.write("static void *\nmake_lazy_%s (void *ptr, int slot, yajl_val val, const struct parser_context *ctx, "\
+        "parser_error *err)\n" % typename)
+    c_file.write("{\n")
+    c_file.write("    switch (slot)\n")
+    c_file.write("      {\n")
+    for slot, i in lazy:
+        c_file.write("        case %d:\n" % slot)
+        c_file.write("          return make_lazy_%s_%s (ptr, val, ctx, err);\n" % (typename, i.fixname))
+    c_file.write("      }\n")
+    c_file.write("    return NULL;\n")
+    c_file.write("}\n\n")
 
-        for (i = 0; i < tree->u.object.len; i++)
-          {
-            if (%s)
-              {
-                if (ctx->options & OPT_PARSE_FULLKEY)
-                  {
-                    resi->u.object.keys[j] = tree->u.object.keys[i];
-                    tree->u.object.keys[i] = NULL;
-                    resi->u.object.values[j] = tree->u.object.values[i];
-                    tree->u.object.values[i] = NULL;
-                    resi->u.object.len++;
-                  }
-                j++;
-              }
-          }
-        if (ctx->options & OPT_PARSE_STRICT)
-          {
-            if (j > 0 && ctx->errfile != NULL)
-                (void) fprintf (ctx->errfile, "WARNING: unknown key found\\n");
-          }
-        if (ctx->options & OPT_PARSE_FULLKEY)
-            ret->_residual = resi;
-      }
-""" % (condition))
+
+def parse_lazy_member(obj, c_file, obj_typename, slot):
+    """
+    Description: generate c language keeping the value of a lazy member for its accessor
+    Interface: None
+    History: 2026-10-18
+    """
+    c_file.write('    if (ctx->options & OPT_PARSE_LAZY)\n')
+    c_file.write('      {\n')
+    c_file.write('        if (%s != NULL && json_lazy_keep (&ret->_lazy, "%s", tree, fields[%d], ctx) != 0)\n' \
+                 % (field_val(slot, helpers.lazy_yajl_type(obj)), obj.origname, slot))
+    c_file.write('          {\n')
+    c_file.write('            *err = strdup ("error allocating memory");\n')
+    c_file.write('            return NULL;\n')
+    c_file.write('          }\n')
+    c_file.write('      }\n')
+    c_file.write('    else if (make_lazy_%s_%s (ret, fields[%d], ctx, err) == NULL)\n' \
+                 % (obj_typename, obj.fixname, slot))
+    c_file.write('      return NULL;\n')
 
 
 def parse_json_to_c(obj, c_file, prefix):
@@ -407,16 +517,30 @@ def parse_json_to_c(obj, c_file, prefix):
         objs = obj.subtypobj
         if objs is None or obj.subtypname:
             return
+    nodes = None
+    if obj.typ == 'object':
+        nodes = obj.children
+    elif obj.typ == 'array':
+        nodes = obj.subtypobj
+    if nodes:
+        make_field_index(nodes, c_file, typename)
+    make_lazy_members(obj, c_file, prefix, typename)
     c_file.write("define_cleaner_function (%s *, free_%s)\n" % (typename, typename))
     c_file.write("%s *\nmake_%s (yajl_val tree, const struct parser_context *ctx, "\
         "parser_error *err)\n" % (typename, typename))
     c_file.write("{\n")
+    if TABLE_MODE:
+        c_file.write("    return json_table_make (&desc_%s, tree, ctx, err);\n" % typename)
+        c_file.write("}\n\n")
+        return
     c_file.write("    __auto_cleanup(free_%s) %s *ret = NULL;\n" % (typename, typename))
+    if nodes:
+        c_file.write("    yajl_val fields[%d] = { NULL };\n" % len(nodes))
     c_file.write("    *err = NULL;\n")
     c_file.write("    (void) ctx;  /* Silence compiler warning.  */\n")
     c_file.write("    if (tree == NULL)\n")
     c_file.write("      return NULL;\n")
-    c_file.write("    ret = smart_calloc (1, 0, sizeof (*ret));\n")
+    c_file.write("    ret = json_ctx_calloc (ctx, 1, 0, sizeof (*ret));\n")
     c_file.write("    if (ret == NULL)\n")
     c_file.write("      return NULL;\n")
     if obj.typ == 'mapStringObject':
@@ -428,6 +552,21 @@ def parse_json_to_c(obj, c_file, prefix):
     c_file.write("}\n\n")
 
 
+def gen_key_call(name):
+    """
+    Description: c expression generating the constant key name, copied as it is
+                 by json_gen_key when json leaves it unchanged, escaped by
+                 json_gen_string otherwise
+    Interface: None
+    History: 2026-10-18
+    """
+    if all(0x20 <= ord(c) < 0x7f and c not in '"\\' for c in name):
+        return 'json_gen_key ((yajl_gen) g, "%s", %d /* strlen ("%s") */)' % (name, len(name), name)
+    raw = name.encode('utf-8')
+    literal = ''.join(chr(b) if 0x20 <= b < 0x7f and chr(b) not in '"\\' else '\\%03o' % b for b in raw)
+    return 'json_gen_string ((yajl_gen) g, (const unsigned char *)("%s"), %d)' % (literal, len(raw))
+
+
 def get_map_string_obj(obj, c_file, prefix):
     """
     Description: c language generate map string object
@@ -446,8 +585,8 @@ def get_map_string_obj(obj, c_file, prefix):
     c_file.write("    if (ptr != NULL)\n")
     c_file.write("        len = ptr->len;\n")
     c_file.write("    if (!len && !(ctx->options & OPT_GEN_SIMPLIFY))\n")
-    c_file.write('        yajl_gen_config (g, yajl_gen_beautify, 0);\n')
-    c_file.write("    stat = yajl_gen_map_open ((yajl_gen) g);\n")
+    c_file.write('        json_gen_beautify (g, 0);\n')
+    c_file.write("    stat = json_gen_map_open ((yajl_gen) g);\n")
     c_file.write("    if (stat != yajl_gen_status_ok)\n")
     c_file.write("        GEN_SET_ERROR_AND_RETURN (stat, err);\n")
     c_file.write('    if (len || (ptr != NULL && ptr->keys != NULL && ptr->%s != NULL))\n' \
@@ -456,7 +595,7 @@ def get_map_string_obj(obj, c_file, prefix):
     c_file.write('        for (i = 0; i < len; i++)\n')
     c_file.write('          {\n')
     c_file.write('            char *str = ptr->keys[i] ? ptr->keys[i] : "";\n')
-    c_file.write('            stat = yajl_gen_string ((yajl_gen) g, \
+    c_file.write('            stat = json_gen_string ((yajl_gen) g, \
 (const unsigned char *)str, strlen (str));\n')
     c_file.write("            if (stat != yajl_gen_status_ok)\n")
     c_file.write("                GEN_SET_ERROR_AND_RETURN (stat, err);\n")
@@ -466,15 +605,14 @@ def get_map_string_obj(obj, c_file, prefix):
     c_file.write("                GEN_SET_ERROR_AND_RETURN (stat, err);\n")
     c_file.write('        }\n')
     c_file.write('    }\n')
-    c_file.write("    stat = yajl_gen_map_close ((yajl_gen) g);\n")
+    c_file.write("    stat = json_gen_map_close ((yajl_gen) g);\n")
     c_file.write("    if (stat != yajl_gen_status_ok)\n")
     c_file.write("        GEN_SET_ERROR_AND_RETURN (stat, err);\n")
     c_file.write("    if (!len && !(ctx->options & OPT_GEN_SIMPLIFY))\n")
-    c_file.write('        yajl_gen_config (g, yajl_gen_beautify, 1);\n')
+    c_file.write('        json_gen_beautify (g, 1);\n')
 
 def get_obj_arr_obj_array(obj, c_file, prefix):
     if obj.subtypobj or obj.subtyp == 'object':
-        l = len(obj.origname)
         if obj.subtypname:
             typename = obj.subtypname
         else:
@@ -483,21 +621,20 @@ def get_obj_arr_obj_array(obj, c_file, prefix):
                      '(ptr != NULL && ptr->%s != NULL))\n' % obj.fixname)
         c_file.write('      {\n')
         c_file.write('        size_t len = 0, i;\n')
-        c_file.write('        stat = yajl_gen_string ((yajl_gen) g, \
-(const unsigned char *)("%s"), %d /* strlen ("%s") */);\n' % (obj.origname, l, obj.origname))
+        c_file.write('        stat = %s;\n' % gen_key_call(obj.origname))
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write("        if (ptr != NULL && ptr->%s != NULL)\n" % obj.fixname)
         c_file.write("            len = ptr->%s_len;\n" % obj.fixname)
         c_file.write("        if (!len && !(ctx->options & OPT_GEN_SIMPLIFY))\n")
-        c_file.write('            yajl_gen_config (g, yajl_gen_beautify, 0);\n')
-        c_file.write('        stat = yajl_gen_array_open ((yajl_gen) g);\n')
+        c_file.write('            json_gen_beautify (g, 0);\n')
+        c_file.write('        stat = json_gen_array_open ((yajl_gen) g);\n')
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write('        for (i = 0; i < len; i++)\n')
         c_file.write('          {\n')
         if obj.doublearray:
-            c_file.write('            stat = yajl_gen_array_open ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_open ((yajl_gen) g);\n')
             c_file.write("            if (stat != yajl_gen_status_ok)\n")
             c_file.write("                GEN_SET_ERROR_AND_RETURN (stat, err);\n")
             c_file.write("            size_t j;\n")
@@ -508,33 +645,31 @@ def get_obj_arr_obj_array(obj, c_file, prefix):
             c_file.write("                if (stat != yajl_gen_status_ok)\n")
             c_file.write("                    GEN_SET_ERROR_AND_RETURN (stat, err);\n")
             c_file.write('            }\n')
-            c_file.write('            stat = yajl_gen_array_close ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_close ((yajl_gen) g);\n')
         else:
             c_file.write('            stat = gen_%s (g, ptr->%s[i], ctx, err);\n' \
                          % (typename, obj.fixname))
             c_file.write("            if (stat != yajl_gen_status_ok)\n")
             c_file.write("                GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write('        }\n')
-        c_file.write('        stat = yajl_gen_array_close ((yajl_gen) g);\n')
+        c_file.write('        stat = json_gen_array_close ((yajl_gen) g);\n')
         c_file.write("        if (!len && !(ctx->options & OPT_GEN_SIMPLIFY))\n")
-        c_file.write('            yajl_gen_config (g, yajl_gen_beautify, 1);\n')
+        c_file.write('            json_gen_beautify (g, 1);\n')
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write('      }\n')
     elif obj.subtyp == 'byte':
-        l = len(obj.origname)
         c_file.write('    if ((ctx->options & OPT_GEN_KEY_VALUE) ||' \
                      ' (ptr != NULL && ptr->%s != NULL && ptr->%s_len))\n' \
                      % (obj.fixname, obj.fixname))
         c_file.write('      {\n')
         c_file.write('        const char *str = "";\n')
         c_file.write('        size_t len = 0;\n')
-        c_file.write('        stat = yajl_gen_string ((yajl_gen) g, \
-(const unsigned char *)("%s"), %d /* strlen ("%s") */);\n' % (obj.origname, l, obj.origname))
+        c_file.write('        stat = %s;\n' % gen_key_call(obj.origname))
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         if obj.doublearray:
-            c_file.write('            stat = yajl_gen_array_open ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_open ((yajl_gen) g);\n')
             c_file.write("            if (stat != yajl_gen_status_ok)\n")
             c_file.write("                GEN_SET_ERROR_AND_RETURN (stat, err);\n")
             c_file.write("        {\n")
@@ -545,37 +680,35 @@ def get_obj_arr_obj_array(obj, c_file, prefix):
             c_file.write("                    str = (const char *)ptr->%s[i];\n" % obj.fixname)
             c_file.write("                else ()\n")
             c_file.write("                    str = "";\n")
-            c_file.write('                stat = yajl_gen_string ((yajl_gen) g, \
+            c_file.write('                stat = json_gen_string ((yajl_gen) g, \
                     (const unsigned char *)str, strlen(str));\n')
             c_file.write("            }\n")
             c_file.write("        }\n")
-            c_file.write('            stat = yajl_gen_array_close ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_close ((yajl_gen) g);\n')
         else:
             c_file.write("        if (ptr != NULL && ptr->%s != NULL)\n" % obj.fixname)
             c_file.write("          {\n")
             c_file.write("            str = (const char *)ptr->%s;\n" % obj.fixname)
             c_file.write("            len = ptr->%s_len;\n" % obj.fixname)
             c_file.write("          }\n")
-            c_file.write('        stat = yajl_gen_string ((yajl_gen) g, \
+            c_file.write('        stat = json_gen_string ((yajl_gen) g, \
     (const unsigned char *)str, len);\n')
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write("      }\n")
     else:
-        l = len(obj.origname)
         c_file.write('    if ((ctx->options & OPT_GEN_KEY_VALUE) || ' \
                      '(ptr != NULL && ptr->%s != NULL))\n' % obj.fixname)
         c_file.write('      {\n')
         c_file.write('        size_t len = 0, i;\n')
-        c_file.write('        stat = yajl_gen_string ((yajl_gen) g, \
-(const unsigned char *)("%s"), %d /* strlen ("%s") */);\n' % (obj.origname, l, obj.origname))
+        c_file.write('        stat = %s;\n' % gen_key_call(obj.origname))
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write("        if (ptr != NULL && ptr->%s != NULL)\n" % obj.fixname)
         c_file.write("          len = ptr->%s_len;\n" % obj.fixname)
         c_file.write("        if (!len && !(ctx->options & OPT_GEN_SIMPLIFY))\n")
-        c_file.write('            yajl_gen_config (g, yajl_gen_beautify, 0);\n')
-        c_file.write('        stat = yajl_gen_array_open ((yajl_gen) g);\n')
+        c_file.write('            json_gen_beautify (g, 0);\n')
+        c_file.write('        stat = json_gen_array_open ((yajl_gen) g);\n')
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write('        for (i = 0; i < len; i++)\n')
@@ -583,7 +716,7 @@ def get_obj_arr_obj_array(obj, c_file, prefix):
 
         if obj.doublearray:
             typename = helpers.get_map_c_types(obj.subtyp)
-            c_file.write('            stat = yajl_gen_array_open ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_open ((yajl_gen) g);\n')
             c_file.write("            if (stat != yajl_gen_status_ok)\n")
             c_file.write("                GEN_SET_ERROR_AND_RETURN (stat, err);\n")
             c_file.write("            size_t j;\n")
@@ -591,16 +724,16 @@ def get_obj_arr_obj_array(obj, c_file, prefix):
             c_file.write('              {\n')
             json_value_generator(c_file, 4, "ptr->%s[i][j]" % obj.fixname, 'g', 'ctx', obj.subtyp)
             c_file.write('            }\n')
-            c_file.write('            stat = yajl_gen_array_close ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_close ((yajl_gen) g);\n')
         else:
             json_value_generator(c_file, 3, "ptr->%s[i]" % obj.fixname, 'g', 'ctx', obj.subtyp)
 
         c_file.write('          }\n')
-        c_file.write('        stat = yajl_gen_array_close ((yajl_gen) g);\n')
+        c_file.write('        stat = json_gen_array_close ((yajl_gen) g);\n')
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write("        if (!len && !(ctx->options & OPT_GEN_SIMPLIFY))\n")
-        c_file.write('            yajl_gen_config (g, yajl_gen_beautify, 1);\n')
+        c_file.write('            json_gen_beautify (g, 1);\n')
         c_file.write('      }\n')
 
 def get_obj_arr_obj(obj, c_file, prefix):
@@ -610,13 +743,11 @@ def get_obj_arr_obj(obj, c_file, prefix):
     History: 2019-06-17
     """
     if obj.typ == 'string':
-        l = len(obj.origname)
         c_file.write('    if ((ctx->options & OPT_GEN_KEY_VALUE) ||' \
                      ' (ptr != NULL && ptr->%s != NULL))\n' % obj.fixname)
         c_file.write('      {\n')
         c_file.write('        char *str = "";\n')
-        c_file.write('        stat = yajl_gen_string ((yajl_gen) g, \
-(const unsigned char *)("%s"), %d /* strlen ("%s") */);\n' % (obj.origname, l, obj.origname))
+        c_file.write('        stat = %s;\n' % gen_key_call(obj.origname))
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write("        if (ptr != NULL && ptr->%s != NULL)\n" % obj.fixname)
@@ -633,10 +764,8 @@ def get_obj_arr_obj(obj, c_file, prefix):
             numtyp = 'long long unsigned int'
         else:
             numtyp = 'long long int'
-        l = len(obj.origname)
         c_file.write('        %s num = 0;\n' % numtyp)
-        c_file.write('        stat = yajl_gen_string ((yajl_gen) g, \
-(const unsigned char *)("%s"), %d /* strlen ("%s") */);\n' % (obj.origname, l, obj.origname))
+        c_file.write('        stat = %s;\n' % gen_key_call(obj.origname))
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write("        if (ptr != NULL && ptr->%s)\n" % obj.fixname)
@@ -649,10 +778,8 @@ def get_obj_arr_obj(obj, c_file, prefix):
         numtyp = helpers.obtain_data_pointer_type(obj.typ)
         if numtyp == "":
             return
-        l = len(obj.origname)
         c_file.write('        %s num = 0;\n' % helpers.get_map_c_types(numtyp))
-        c_file.write('        stat = yajl_gen_string ((yajl_gen) g, \
-(const unsigned char *)("%s"), %d /* strlen ("%s") */);\n' % (obj.origname, l, obj.origname))
+        c_file.write('        stat = %s;\n' % gen_key_call(obj.origname))
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write("        if (ptr != NULL && ptr->%s != NULL)\n" % obj.fixname)
@@ -667,9 +794,7 @@ def get_obj_arr_obj(obj, c_file, prefix):
                      ' (ptr != NULL && ptr->%s))\n' % obj.fixname)
         c_file.write('      {\n')
         c_file.write('        bool b = false;\n')
-        l = len(obj.origname)
-        c_file.write('        stat = yajl_gen_string ((yajl_gen) g, \
-(const unsigned char *)("%s"), %d /* strlen ("%s") */);\n' % (obj.origname, l, obj.origname))
+        c_file.write('        stat = %s;\n' % gen_key_call(obj.origname))
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write("        if (ptr != NULL && ptr->%s)\n" % obj.fixname)
@@ -678,7 +803,6 @@ def get_obj_arr_obj(obj, c_file, prefix):
         json_value_generator(c_file, 2, "b", 'g', 'ctx', obj.typ)
         c_file.write("      }\n")
     elif obj.typ == 'object' or obj.typ == 'mapStringObject':
-        l = len(obj.origname)
         if obj.subtypname:
             typename = obj.subtypname
         else:
@@ -686,8 +810,7 @@ def get_obj_arr_obj(obj, c_file, prefix):
         c_file.write('    if ((ctx->options & OPT_GEN_KEY_VALUE) ||' \
                      ' (ptr != NULL && ptr->%s != NULL))\n' % obj.fixname)
         c_file.write("      {\n")
-        c_file.write('        stat = yajl_gen_string ((yajl_gen) g, \
-(const unsigned char *)("%s"), %d /* strlen ("%s") */);\n' % (obj.origname, l, obj.origname))
+        c_file.write('        stat = %s;\n' % gen_key_call(obj.origname))
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write('        stat = gen_%s (g, ptr != NULL ? ptr->%s : NULL, ctx, err);\n' \
@@ -698,12 +821,10 @@ def get_obj_arr_obj(obj, c_file, prefix):
     elif obj.typ == 'array':
         get_obj_arr_obj_array(obj, c_file, prefix)
     elif helpers.valid_basic_map_name(obj.typ):
-        l = len(obj.origname)
         c_file.write('    if ((ctx->options & OPT_GEN_KEY_VALUE) || ' \
                      '(ptr != NULL && ptr->%s != NULL))\n' % obj.fixname)
         c_file.write('      {\n')
-        c_file.write('        stat = yajl_gen_string ((yajl_gen) g, \
-(const unsigned char *)("%s"), %d /* strlen ("%s") */);\n' % (obj.origname, l, obj.origname))
+        c_file.write('        stat = %s;\n' % gen_key_call(obj.origname))
         c_file.write("        if (stat != yajl_gen_status_ok)\n")
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write('        stat = gen_%s (g, ptr ? ptr->%s : NULL, ctx, err);\n' \
@@ -712,6 +833,45 @@ def get_obj_arr_obj(obj, c_file, prefix):
         c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         c_file.write("      }\n")
 
+def get_lazy_member(obj, c_file):
+    """
+    Description: c language generate json of a lazy member still kept as a yajl tree,
+                 the generation of the decoded member follows as the else branch
+    Interface: None
+    History: 2026-10-18
+    """
+    c_file.write('    if (ptr != NULL && json_lazy_get (ptr->_lazy, "%s") != NULL)\n' % obj.origname)
+    c_file.write('      {\n')
+    c_file.write('        stat = %s;\n' % gen_key_call(obj.origname))
+    c_file.write('        if (stat != yajl_gen_status_ok)\n')
+    c_file.write('            GEN_SET_ERROR_AND_RETURN (stat, err);\n')
+    c_file.write('        stat = gen_yajl_val (json_lazy_get (ptr->_lazy, "%s"), g, err);\n' % obj.origname)
+    c_file.write('        if (stat != yajl_gen_status_ok)\n')
+    c_file.write('            GEN_SET_ERROR_AND_RETURN (stat, err);\n')
+    c_file.write('      }\n')
+    c_file.write('    else\n')
+
+
+def get_lazy_simplify(typename, c_file):
+    """
+    Description: c language generate json of an object with kept lazy members when
+                 simplifying, the kept trees still hold the default values the
+                 decoded members would drop, so generate from a decoded view
+    Interface: None
+    History: 2026-10-18
+    """
+    c_file.write('    if (ptr != NULL && ptr->_lazy != NULL && (ctx->options & OPT_GEN_SIMPLIFY))\n')
+    c_file.write('      {\n')
+    c_file.write('        const %s *view = json_lazy_view (&desc_%s, ptr);\n' % (typename, typename))
+    c_file.write('        if (view != ptr)\n')
+    c_file.write('          {\n')
+    c_file.write('            stat = gen_%s (g, view, ctx, err);\n' % typename)
+    c_file.write('            json_lazy_view_free (&desc_%s, ptr, view);\n' % typename)
+    c_file.write('            return stat;\n')
+    c_file.write('          }\n')
+    c_file.write('      }\n')
+
+
 def get_c_json(obj, c_file, prefix):
     """
     Description: c language generate json file
@@ -731,41 +891,49 @@ def get_c_json(obj, c_file, prefix):
         "yajl_gen_status\ngen_%s (yajl_gen g, const %s *ptr, const struct parser_context " \
         "*ctx, parser_error *err)\n" % (typename, typename))
     c_file.write("{\n")
+    if TABLE_MODE:
+        c_file.write("    return json_table_gen (&desc_%s, g, ptr, ctx, err);\n" % typename)
+        c_file.write("}\n\n")
+        return
     c_file.write("    yajl_gen_status stat = yajl_gen_status_ok;\n")
     c_file.write("    *err = NULL;\n")
     c_file.write("    (void) ptr;  /* Silence compiler warning.  */\n")
+    if obj.typ == 'object' and helpers.lazy_fields(obj):
+        get_lazy_simplify(typename, c_file)
     if obj.typ == 'mapStringObject':
         get_map_string_obj(obj, c_file, prefix)
     elif obj.typ == 'object' or (obj.typ == 'array' and obj.subtypobj):
         nodes = obj.children if obj.typ == 'object' else obj.subtypobj
         if nodes is None:
             c_file.write('    if (!(ctx->options & OPT_GEN_SIMPLIFY))\n')
-            c_file.write('        yajl_gen_config (g, yajl_gen_beautify, 0);\n')
+            c_file.write('        json_gen_beautify (g, 0);\n')
 
-        c_file.write("    stat = yajl_gen_map_open ((yajl_gen) g);\n")
+        c_file.write("    stat = json_gen_map_open ((yajl_gen) g);\n")
         c_file.write("    if (stat != yajl_gen_status_ok)\n")
         c_file.write("        GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         for i in nodes or []:
+            if i.lazy and obj.typ == 'object':
+                get_lazy_member(i, c_file)
             get_obj_arr_obj(i, c_file, prefix)
         if obj.typ == 'object':
             if obj.children is not None:
                 c_file.write("    if (ptr != NULL && ptr->_residual != NULL)\n")
                 c_file.write("    {\n")
-                c_file.write("        stat = gen_yajl_object_residual (ptr->_residual, g, err);\n")
+                c_file.write("        stat = json_gen_residual (g, ptr->_residual, err);\n")
                 c_file.write("        if (yajl_gen_status_ok != stat)\n")
                 c_file.write("            GEN_SET_ERROR_AND_RETURN (stat, err);\n")
                 c_file.write("    }\n")
-        c_file.write("    stat = yajl_gen_map_close ((yajl_gen) g);\n")
+        c_file.write("    stat = json_gen_map_close ((yajl_gen) g);\n")
         c_file.write("    if (stat != yajl_gen_status_ok)\n")
         c_file.write("        GEN_SET_ERROR_AND_RETURN (stat, err);\n")
         if nodes is None:
             c_file.write('    if (!(ctx->options & OPT_GEN_SIMPLIFY))\n')
-            c_file.write('        yajl_gen_config (g, yajl_gen_beautify, 1);\n')
+            c_file.write('        json_gen_beautify (g, 1);\n')
     c_file.write('    return yajl_gen_status_ok;\n')
     c_file.write("}\n\n")
 
 
-def read_val_generator(c_file, level, src, dest, typ, keyname, obj_typename):
+def read_val_generator(c_file, level, src, dest, typ, keyname, obj_typename, intern=False):
     """
     Description: read value generateor
     Interface: None
@@ -795,7 +963,8 @@ def read_val_generator(c_file, level, src, dest, typ, keyname, obj_typename):
         c_file.write('%sif (val != NULL)\n' % ('    ' * (level)))
         c_file.write('%s  {\n' % ('    ' * (level)))
         c_file.write('%schar *str = YAJL_GET_STRING (val);\n' % ('    ' * (level + 1)))
-        c_file.write('%s%s = strdup (str ? str : "");\n' % ('    ' * (level + 1), dest))
+        c_file.write('%s%s = %s (ctx, str ? str : "");\n' % ('    ' * (level + 1), dest, \
+                     'json_ctx_intern' if intern else 'json_ctx_strdup'))
         c_file.write('%sif (%s == NULL)\n' % ('    ' * (level + 1), dest))
         c_file.write('%s  {\n' % ('    ' * (level+1)))
         c_file.write('%s    return NULL;\n' % ('    ' * (level+1)))
@@ -832,7 +1001,7 @@ def read_val_generator(c_file, level, src, dest, typ, keyname, obj_typename):
         c_file.write('%syajl_val val = %s;\n' % ('    ' * (level), src))
         c_file.write('%sif (val != NULL)\n' % ('    ' * (level)))
         c_file.write('%s  {\n' % ('    ' * (level)))
-        c_file.write('%s%s = smart_calloc (1, 0, sizeof (%s));\n' %
+        c_file.write('%s%s = json_ctx_calloc (ctx, 1, 0, sizeof (%s));\n' %
                      ('    ' * (level + 1), dest, helpers.get_map_c_types(num_type)))
         c_file.write('%sif (%s == NULL)\n' % ('    ' * (level + 1), dest))
         c_file.write('%s    return NULL;\n' % ('    ' * (level + 1)))
@@ -867,18 +1036,18 @@ def read_val_generator(c_file, level, src, dest, typ, keyname, obj_typename):
         c_file.write('%syajl_val val = %s;\n' % ('    ' * (level), src))
         c_file.write('%sif (val != NULL)\n' % ('    ' * (level)))
         c_file.write('%s  {\n' % ('    ' * (level)))
-        c_file.write('%s%s = smart_calloc (1, 0, sizeof (bool));\n' % ('    ' * (level + 1), dest))
+        c_file.write('%s%s = json_ctx_calloc (ctx, 1, 0, sizeof (bool));\n' % ('    ' * (level + 1), dest))
         c_file.write('%sif (%s == NULL)\n' % ('    ' * (level + 1), dest))
         c_file.write('%s    return NULL;\n' % ('    ' * (level + 1)))
         c_file.write('%s*(%s) = YAJL_IS_TRUE(val);\n' % ('    ' * (level + 1), dest))
         c_file.write('%s  }\n' % ('    ' * (level)))
         c_file.write('%selse\n' % ('    ' * (level)))
         c_file.write('%s {\n' % ('    ' * (level)))
-        c_file.write('%sval = get_val (tree, "%s", yajl_t_false);\n' \
-                     % ('    ' * (level + 1), keyname))
+        c_file.write('%sval = %s;\n' \
+                     % ('    ' * (level + 1), src.replace('yajl_t_true', 'yajl_t_false')))
         c_file.write('%sif (val != NULL)\n' % ('    ' * (level + 1)))
         c_file.write('%s  {\n' % ('    ' * (level + 1)))
-        c_file.write('%s%s = smart_calloc (1, 0, sizeof (bool));\n' % ('    ' * (level + 2), dest))
+        c_file.write('%s%s = json_ctx_calloc (ctx, 1, 0, sizeof (bool));\n' % ('    ' * (level + 2), dest))
         c_file.write('%sif (%s == NULL)\n' % ('    ' * (level + 2), dest))
         c_file.write('%s  return NULL;\n' % ('    ' * (level + 2)))
         c_file.write('%s*(%s) = YAJL_IS_TRUE(val);\n' % ('    ' * (level + 2), dest))
@@ -898,13 +1067,13 @@ def json_value_generator(c_file, level, src, dst, ptx, typ):
         c_file.write("%sif (stat != yajl_gen_status_ok)\n" % ('    ' * (level)))
         c_file.write("%sGEN_SET_ERROR_AND_RETURN (stat, err);\n" % ('    ' * (level + 1)))
     elif typ == 'string':
-        c_file.write('%sstat = yajl_gen_string ((yajl_gen)%s, \
+        c_file.write('%sstat = json_gen_string ((yajl_gen)%s, \
 (const unsigned char *)(%s), strlen (%s));\n' % ('    ' * (level), dst, src, src))
         c_file.write("%sif (stat != yajl_gen_status_ok)\n" % ('    ' * (level)))
         c_file.write("%sGEN_SET_ERROR_AND_RETURN (stat, err);\n" % ('    ' * (level + 1)))
     elif helpers.judge_data_type(typ):
         if typ == 'double':
-            c_file.write('%sstat = yajl_gen_double ((yajl_gen)%s, %s);\n' \
+            c_file.write('%sstat = json_gen_double ((yajl_gen)%s, %s);\n' \
                          % ('    ' * (level), dst, src))
         elif typ.startswith("uint") or typ == 'GID' or typ == 'UID':
             c_file.write('%sstat = map_uint (%s, %s);\n' % ('    ' * (level), dst, src))
@@ -914,7 +1083,7 @@ def json_value_generator(c_file, level, src, dst, ptx, typ):
         c_file.write("%sGEN_SET_ERROR_AND_RETURN (stat, err);\n" \
                      % ('    ' * (level + 1)))
     elif typ == 'boolean':
-        c_file.write('%sstat = yajl_gen_bool ((yajl_gen)%s, (int)(%s));\n' \
+        c_file.write('%sstat = json_gen_bool ((yajl_gen)%s, (int)(%s));\n' \
                      % ('    ' * (level), dst, src))
         c_file.write("%sif (stat != yajl_gen_status_ok)\n" % ('    ' * (level)))
         c_file.write("%sGEN_SET_ERROR_AND_RETURN (stat, err);\n" % ('    ' * (level + 1)))
@@ -1016,7 +1185,11 @@ def make_c_free (obj, c_file, prefix):
             typename = helpers.get_name_substr(obj.name, prefix)
     c_file.write("void\nfree_%s (%s *ptr)\n" % (typename, typename))
     c_file.write("{\n")
-    c_file.write("    if (ptr == NULL)\n")
+    if TABLE_MODE:
+        c_file.write("    json_table_free (&desc_%s, ptr);\n" % typename)
+        c_file.write("}\n\n")
+        return
+    c_file.write("    if (ptr == NULL || json_arena_release (ptr))\n")
     c_file.write("        return;\n")
     if obj.typ == 'mapStringObject':
         child = obj.children[0]
@@ -1047,7 +1220,7 @@ def make_c_free (obj, c_file, prefix):
             typename = helpers.get_prefixed_name(i.name, prefix)
             if i.typ == 'string' or i.typ == 'booleanPointer' or \
                     helpers.judge_data_pointer_type(i.typ):
-                c_file.write("    free (ptr->%s);\n" % (i.fixname))
+                c_file.write("    %s (ptr->%s);\n" % ('json_intern_free' if i.intern else 'free', i.fixname))
                 c_file.write("    ptr->%s = NULL;\n" % (i.fixname))
             elif i.typ == 'object':
                 if i.subtypname is not None:
@@ -1059,8 +1232,11 @@ def make_c_free (obj, c_file, prefix):
                 c_file.write("      }\n")
     if obj.typ == 'object':
         if obj.children is not None:
-            c_file.write("    yajl_tree_free (ptr->_residual);\n")
+            c_file.write("    free (ptr->_residual);\n")
             c_file.write("    ptr->_residual = NULL;\n")
+        if helpers.lazy_fields(obj):
+            c_file.write("    yajl_tree_free (ptr->_lazy);\n")
+            c_file.write("    ptr->_lazy = NULL;\n")
     c_file.write("    free (ptr);\n")
     c_file.write("}\n\n")
 
@@ -1098,16 +1274,18 @@ def c_file_str(c_file, i):
     c_file.write("        size_t i;\n")
     c_file.write("        for (i = 0; i < ptr->%s_len; i++)\n" % i.fixname)
     c_file.write("          {\n")
+    free_func = 'json_intern_free' if i.intern else 'free'
     if i.doublearray:
         c_file.write("            size_t j;\n")
         c_file.write("            for (j = 0; j < ptr->%s_item_lens[i]; j++)\n" % (i.fixname))
         c_file.write("              {\n")
-        c_file.write("                free (ptr->%s[i][j]);\n" % (i.fixname))
+        c_file.write("                %s (ptr->%s[i][j]);\n" % (free_func, i.fixname))
         c_file.write("                ptr->%s[i][j] = NULL;\n" % (i.fixname))
         c_file.write("            }\n")
+        free_func = 'free'
     c_file.write("            if (ptr->%s[i] != NULL)\n" % (i.fixname))
     c_file.write("              {\n")
-    c_file.write("                free (ptr->%s[i]);\n" % (i.fixname))
+    c_file.write("                %s (ptr->%s[i]);\n" % (free_func, i.fixname))
     c_file.write("                ptr->%s[i] = NULL;\n" % (i.fixname))
     c_file.write("              }\n")
     c_file.write("          }\n")
@@ -1119,6 +1297,253 @@ def c_file_str(c_file, i):
     c_file.write("    }\n")
 
 
+def desc_number_type(typ):
+    """
+    Description: json_number_type enumerator of a numeric schema type
+    Interface: None
+    History: 2026-10-18
+    """
+    if typ == 'integer':
+        return 'JSON_NUM_INT'
+    if typ in ('UID', 'GID', 'double') or \
+            (typ.startswith('int') or typ.startswith('uint')) and helpers.get_map_c_types(typ) != "":
+        return 'JSON_NUM_%s' % typ.upper()
+    print('Unsupported number type: %s' % typ)
+    sys.exit(1)
+
+
+def desc_value_kind(typ):
+    """
+    Description: field kind, number type and map kind of a scalar or map schema type
+    Interface: None
+    History: 2026-10-18
+    """
+    if typ == 'string':
+        return ('JSON_KIND_STRING', None, None)
+    if typ == 'boolean':
+        return ('JSON_KIND_BOOL', None, None)
+    if typ == 'booleanPointer':
+        return ('JSON_KIND_BOOL_PTR', None, None)
+    if helpers.judge_data_type(typ):
+        return ('JSON_KIND_NUMBER', desc_number_type(typ), None)
+    if helpers.judge_data_pointer_type(typ):
+        return ('JSON_KIND_NUMBER_PTR', desc_number_type(helpers.obtain_data_pointer_type(typ)), None)
+    if helpers.valid_basic_map_name(typ):
+        return ('JSON_KIND_MAP', None, helpers.make_basic_map_name(typ)[len('json_map_'):].upper())
+    print('Unsupported type for the layout descriptor: %s' % typ)
+    sys.exit(1)
+
+
+def desc_field(i, c_file, prefix, typename, required, lazy=False):
+    """
+    Description: generate the layout descriptor entry of one member
+    Interface: None
+    History: 2026-10-18
+    """
+    member = {'name': '"%s"' % i.origname, 'offset': 'offsetof (%s, %s)' % (typename, i.fixname)}
+    flags = []
+    if required:
+        flags.append('JSON_FIELD_REQUIRED')
+    if lazy:
+        flags.append('JSON_FIELD_LAZY')
+    if i.intern:
+        flags.append('JSON_FIELD_INTERN')
+    if i.typ == 'object' or i.typ == 'mapStringObject':
+        member['kind'] = 'JSON_KIND_OBJECT'
+        member['type'] = '&desc_%s' % (i.subtypname or helpers.get_prefixed_name(i.name, prefix))
+    elif i.typ == 'array' and i.subtyp == 'byte':
+        member['kind'] = 'JSON_KIND_BYTES'
+        member['len_offset'] = 'offsetof (%s, %s_len)' % (typename, i.fixname)
+    elif i.typ == 'array':
+        member['kind'] = 'JSON_KIND_ARRAY'
+        member['len_offset'] = 'offsetof (%s, %s_len)' % (typename, i.fixname)
+        if i.doublearray:
+            flags.append('JSON_FIELD_DOUBLE_ARRAY')
+            member['item_lens_offset'] = 'offsetof (%s, %s_item_lens)' % (typename, i.fixname)
+        if i.subtypobj or i.subtyp == 'object':
+            member['item'] = 'JSON_KIND_OBJECT'
+            member['type'] = '&desc_%s' % (i.subtypname or helpers.get_name_substr(i.name, prefix))
+        else:
+            member['item'], member['num'], member['map'] = desc_value_kind(i.subtyp)
+    else:
+        member['kind'], member['num'], member['map'] = desc_value_kind(i.typ)
+    if member.get('map'):
+        member['map'] = 'JSON_MAP_%s' % member['map']
+    if flags:
+        member['flags'] = ' | '.join(flags)
+    order = ('name', 'offset', 'len_offset', 'item_lens_offset', 'type', 'kind', 'item', 'num',
+             'map', 'flags')
+    c_file.write('    { %s },\n' % ', '.join('.%s = %s' % (k, member[k]) for k in order \
+                                            if member.get(k)))
+
+
+def make_c_desc(obj, c_file, prefix):
+    """
+    Description: generate the layout descriptor of a type, used by the OPT_PARSE_STREAM parser
+    Interface: None
+    History: 2026-10-18
+    """
+    if not helpers.judge_complex(obj.typ) or obj.subtypname:
+        return
+    if obj.typ == 'array':
+        if obj.subtypobj is None:
+            return
+        typename = helpers.get_name_substr(obj.name, prefix)
+        nodes = obj.subtypobj
+    else:
+        typename = helpers.get_prefixed_name(obj.name, prefix)
+        nodes = obj.children or []
+    if obj.typ == 'mapStringObject':
+        c_file.write('static const struct json_field_desc %s_fields[] = {\n' % typename)
+        child = obj.children[0]
+        if helpers.valid_basic_map_name(child.typ):
+            kind, _, mapkind = desc_value_kind(child.typ)
+            c_file.write('    { .name = "%s", .offset = offsetof (%s, %s), .len_offset = offsetof (%s, len), '\
+                         '.kind = %s, .map = JSON_MAP_%s },\n' \
+                         % (child.origname, typename, child.fixname, typename, kind, mapkind))
+        else:
+            childname = child.subtypname or helpers.get_prefixed_name(child.name, prefix)
+            c_file.write('    { .name = "%s", .offset = offsetof (%s, %s), .len_offset = offsetof (%s, len), '\
+                         '.type = &desc_%s, .kind = JSON_KIND_OBJECT },\n' \
+                         % (child.origname, typename, child.fixname, typename, childname))
+        c_file.write('};\n\n')
+    elif nodes:
+        c_file.write('static const struct json_field_desc %s_fields[] = {\n' % typename)
+        for i in nodes:
+            required = obj.required and i.origname in obj.required and \
+                not helpers.judge_data_type(i.typ) and i.typ != 'boolean'
+            desc_field(i, c_file, prefix, typename, required, i.lazy and obj.typ == 'object')
+        c_file.write('};\n\n')
+
+    residual = obj.typ == 'object' and obj.children is not None
+    c_file.write('const struct json_type_desc desc_%s = {\n' % typename)
+    c_file.write('    .name = "%s",\n' % typename)
+    c_file.write('    .kind = %s,\n' % ('JSON_TYPE_MAP' if obj.typ == 'mapStringObject' else 'JSON_TYPE_OBJECT'))
+    c_file.write('    .size = sizeof (%s),\n' % typename)
+    if residual:
+        c_file.write('    .residual = true,\n')
+        c_file.write('    .residual_offset = offsetof (%s, _residual),\n' % typename)
+    if helpers.lazy_fields(obj):
+        c_file.write('    .lazy_offset = offsetof (%s, _lazy),\n' % typename)
+        c_file.write('    .lazy_make = make_lazy_%s,\n' % typename)
+    if obj.typ == 'mapStringObject':
+        c_file.write('    .keys_offset = offsetof (%s, keys),\n' % typename)
+        c_file.write('    .fields = %s_fields,\n' % typename)
+        c_file.write('    .fields_len = 1,\n')
+    elif nodes:
+        c_file.write('    .fields = %s_fields,\n' % typename)
+        c_file.write('    .fields_len = %d,\n' % len(nodes))
+        c_file.write('    .field_index = %s_field_index,\n' % typename)
+    c_file.write('    .free = (void (*) (void *)) free_%s,\n' % typename)
+    c_file.write('    .gen = (json_gen_func) gen_%s,\n' % typename)
+    c_file.write('    .make = (void *(*) (yajl_val, const struct parser_context *, parser_error *)) make_%s,\n' \
+                 % typename)
+    c_file.write('};\n\n')
+    make_c_clone(typename, c_file)
+    make_c_compare(typename, c_file)
+    for slot, i in helpers.lazy_fields(obj):
+        c_file.write("""int
+get_%s_%s (%s *ptr, const struct parser_context *ctx, parser_error *err)
+{
+    return json_lazy_load (&desc_%s, ptr, %d, ctx, err);
+}
+
+""" % (typename, i.fixname, typename, typename, slot))
+
+
+def make_c_clone(typename, c_file):
+    """
+    Description: generate the deep copy function of a type with a layout descriptor
+    Interface: None
+    History: 2026-10-18
+    """
+    c_file.write("""
+%s *
+clone_%s (const %s *src)
+{
+    return json_clone (&desc_%s, src, NULL);
+}
+
+""" % (typename, typename, typename, typename))
+
+
+def make_c_compare(typename, c_file):
+    """
+    Description: generate the equality, hash and merge patch functions of a type with a layout descriptor
+    Interface: None
+    History: 2026-10-18
+    """
+    c_file.write("""bool
+equal_%s (const %s *a, const %s *b)
+{
+    return json_equal (&desc_%s, a, b);
+}
+
+uint64_t
+hash_%s (const %s *ptr)
+{
+    return json_hash (&desc_%s, ptr);
+}
+
+char *
+diff_%s (const %s *a, const %s *b, const struct parser_context *ctx, parser_error *err)
+{
+    return json_diff (&desc_%s, a, b, ctx, err);
+}
+
+%s *
+apply_merge_patch_%s (const %s *ptr, const char *patch, const struct parser_context *ctx, parser_error *err)
+{
+    return json_apply_merge_patch (&desc_%s, ptr, patch, ctx, err);
+}
+
+""" % ((typename,) * 15))
+
+
+def make_c_array_desc(obj, c_file, prefix):
+    """
+    Description: generate the layout descriptor of a top level array container
+    Interface: None
+    History: 2026-10-18
+    """
+    if not helpers.desc_supported_top_array(obj):
+        return False
+    typename = helpers.get_top_array_type_name(obj.name, prefix)
+    member = '.name = "%s", .offset = offsetof (%s, items), .len_offset = offsetof (%s, len)' \
+        % (obj.origname, typename, typename)
+    if obj.doublearray:
+        member += ', .item_lens_offset = offsetof (%s, subitem_lens)' % typename
+    if obj.subtypobj or obj.subtyp == 'object':
+        member += ', .type = &desc_%s, .kind = JSON_KIND_ARRAY, .item = JSON_KIND_OBJECT' \
+            % (obj.subtypname or helpers.get_name_substr(obj.name, prefix))
+    else:
+        kind, num, mapkind = desc_value_kind(obj.subtyp)
+        member += ', .kind = JSON_KIND_ARRAY, .item = %s' % kind
+        if num:
+            member += ', .num = %s' % num
+        if mapkind:
+            member += ', .map = JSON_MAP_%s' % mapkind
+    if obj.doublearray:
+        member += ', .flags = JSON_FIELD_DOUBLE_ARRAY'
+    c_file.write('\nstatic const struct json_field_desc %s_fields[] = {\n' % typename)
+    c_file.write('    { %s },\n' % member)
+    c_file.write('};\n\n')
+    c_file.write('const struct json_type_desc desc_%s = {\n' % typename)
+    c_file.write('    .name = "%s",\n' % typename)
+    c_file.write('    .kind = JSON_TYPE_ARRAY,\n')
+    c_file.write('    .size = sizeof (%s),\n' % typename)
+    c_file.write('    .fields = %s_fields,\n' % typename)
+    c_file.write('    .fields_len = 1,\n')
+    c_file.write('    .free = (void (*) (void *)) free_%s,\n' % typename)
+    c_file.write('    .gen = (json_gen_func) gen_%s,\n' % typename)
+    c_file.write('    .make = (void *(*) (yajl_val, const struct parser_context *, parser_error *)) make_%s,\n' \
+                 % typename)
+    c_file.write('};\n')
+    make_c_clone(typename, c_file)
+    make_c_compare(typename, c_file)
+    return True
+
+
 def src_reflect(structs, schema_info, c_file, root_typ):
     """
     Description: reflect code
@@ -1131,7 +1556,9 @@ def src_reflect(structs, schema_info, c_file, root_typ):
     c_file.write("#define _GNU_SOURCE\n")
     c_file.write("#endif\n")
     c_file.write('#include <string.h>\n')
+    c_file.write('#include <stddef.h>\n')
     c_file.write('#include <read_file.h>\n')
+    c_file.write('#include <json_desc.h>\n')
     c_file.write('#include "%s"\n\n' % schema_info.header.basename)
     c_file.write('#define YAJL_GET_ARRAY_NO_CHECK(v) (&(v)->u.array)\n')
     c_file.write('#define YAJL_GET_OBJECT_NO_CHECK(v) (&(v)->u.object)\n')
@@ -1163,17 +1590,17 @@ define_cleaner_function (%s *, free_%s)\n
     alen = YAJL_GET_ARRAY_NO_CHECK (tree)->len;
     if (alen == 0)
       return NULL;
-    ptr = smart_calloc (1, 0, sizeof (%s));
+    ptr = json_ctx_calloc (ctx, 1, 0, sizeof (%s));
     if (ptr == NULL)
       return NULL;
-    ptr->items = smart_calloc (alen, 1, sizeof(*ptr->items));
+    ptr->items = json_ctx_calloc (ctx, alen, 1, sizeof(*ptr->items));
     if (ptr->items == NULL)
       return NULL;
     ptr->len = alen;
 """ % (typename, typename, typename, typename, typename, typename, typename))
 
     if obj.doublearray:
-        c_file.write('    ptr->subitem_lens = smart_calloc ( alen, 1, sizeof (size_t));\n')
+        c_file.write('    ptr->subitem_lens = json_ctx_calloc (ctx, alen, 1, sizeof (size_t));\n')
         c_file.write('    if (ptr->subitem_lens == NULL)\n')
         c_file.write('        return NULL;')
 
@@ -1191,7 +1618,7 @@ define_cleaner_function (%s *, free_%s)\n
 
         if obj.doublearray:
             c_file.write('        size_t j;\n')
-            c_file.write('        ptr->items[i] = smart_calloc ( YAJL_GET_ARRAY_NO_CHECK(work)->len, 1, sizeof (**ptr->items));\n')
+            c_file.write('        ptr->items[i] = json_ctx_calloc (ctx, YAJL_GET_ARRAY_NO_CHECK(work)->len, 1, sizeof (**ptr->items));\n')
             c_file.write('        if (ptr->items[i] == NULL)\n')
             c_file.write('           return NULL;\n')
             c_file.write('        yajl_val *tmps = YAJL_GET_ARRAY_NO_CHECK(work)->values;\n')
@@ -1211,7 +1638,7 @@ define_cleaner_function (%s *, free_%s)\n
     elif obj.subtyp == 'byte':
         if obj.doublearray:
             c_file.write('        char *str = YAJL_GET_STRING (work);\n')
-            c_file.write('        ptr->items[j] = (uint8_t *)strdup (str ? str : "");\n')
+            c_file.write('        ptr->items[j] = (uint8_t *)json_ctx_strdup (ctx, str ? str : "");\n')
             c_file.write('        if (ptr->items[j] == NULL)\n')
             c_file.write("            return NULL;\n")
         else:
@@ -1220,7 +1647,7 @@ define_cleaner_function (%s *, free_%s)\n
             c_file.write('        break;\n')
     else:
         if obj.doublearray:
-            c_file.write('        ptr->items[i] = smart_calloc ( YAJL_GET_ARRAY_NO_CHECK(work)->len, 1, sizeof (**ptr->items));\n')
+            c_file.write('        ptr->items[i] = json_ctx_calloc (ctx, YAJL_GET_ARRAY_NO_CHECK(work)->len, 1, sizeof (**ptr->items));\n')
             c_file.write('        if (ptr->items[i] == NULL)\n')
             c_file.write('            return NULL;\n')
             c_file.write('        size_t j;\n')
@@ -1255,7 +1682,7 @@ void free_%s (%s *ptr)
 {
     size_t i;
 
-    if (ptr == NULL)
+    if (ptr == NULL || json_arena_release (ptr))
         return;
 
     for (i = 0; i < ptr->len; i++)
@@ -1353,7 +1780,7 @@ yajl_gen_status gen_%s (yajl_gen g, const %s *ptr, const struct parser_context *
 
     if obj.subtypobj or obj.subtyp == 'object':
         c_file.write("""\n
-    stat = yajl_gen_array_open ((yajl_gen) g);
+    stat = json_gen_array_open ((yajl_gen) g);
     if (stat != yajl_gen_status_ok)
         GEN_SET_ERROR_AND_RETURN (stat, err);
     for (i = 0; i < ptr->len; i++)
@@ -1366,7 +1793,7 @@ yajl_gen_status gen_%s (yajl_gen g, const %s *ptr, const struct parser_context *
             subtypename = helpers.get_name_substr(obj.name, prefix)
         c_file.write('      {\n')
         if obj.doublearray:
-            c_file.write('            stat = yajl_gen_array_open ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_open ((yajl_gen) g);\n')
             c_file.write("            if (stat != yajl_gen_status_ok)\n")
             c_file.write("                GEN_SET_ERROR_AND_RETURN (stat, err);\n")
             c_file.write("            size_t j;\n")
@@ -1377,7 +1804,7 @@ yajl_gen_status gen_%s (yajl_gen g, const %s *ptr, const struct parser_context *
             c_file.write("                if (stat != yajl_gen_status_ok)\n")
             c_file.write("                    GEN_SET_ERROR_AND_RETURN (stat, err);\n")
             c_file.write('              }\n')
-            c_file.write('            stat = yajl_gen_array_close ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_close ((yajl_gen) g);\n')
         else:
             c_file.write('            stat = gen_%s (g, ptr->items[i], ctx, err);\n' \
                          % (subtypename))
@@ -1386,13 +1813,13 @@ yajl_gen_status gen_%s (yajl_gen g, const %s *ptr, const struct parser_context *
         c_file.write("""\n
             }
       }
-    stat = yajl_gen_array_close ((yajl_gen) g);
+    stat = json_gen_array_close ((yajl_gen) g);
 """)
     elif obj.subtyp == 'byte':
         c_file.write('    {\n')
         c_file.write('            const char *str = NULL;\n')
         if obj.doublearray:
-            c_file.write('            stat = yajl_gen_array_open ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_open ((yajl_gen) g);\n')
             c_file.write("            if (stat != yajl_gen_status_ok)\n")
             c_file.write("                GEN_SET_ERROR_AND_RETURN (stat, err);\n")
             c_file.write("            {\n")
@@ -1403,22 +1830,22 @@ yajl_gen_status gen_%s (yajl_gen g, const %s *ptr, const struct parser_context *
             c_file.write("                        str = (const char *)ptr->items[i];\n")
             c_file.write("                    else ()\n")
             c_file.write("                        str = "";\n")
-            c_file.write('                    stat = yajl_gen_string ((yajl_gen) g, \
+            c_file.write('                    stat = json_gen_string ((yajl_gen) g, \
                     (const unsigned char *)str, strlen(str));\n')
             c_file.write("                 }\n")
             c_file.write("            }\n")
-            c_file.write('            stat = yajl_gen_array_close ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_close ((yajl_gen) g);\n')
         else:
             c_file.write("        if (ptr != NULL && ptr->items != NULL)\n")
             c_file.write("          {\n")
             c_file.write("            str = (const char *)ptr->items;\n")
             c_file.write("          }\n")
-            c_file.write('        stat = yajl_gen_string ((yajl_gen) g, \
+            c_file.write('        stat = json_gen_string ((yajl_gen) g, \
     (const unsigned char *)str, ptr->len);\n')
         c_file.write('    }\n')
     else:
         c_file.write("""\n
-    stat = yajl_gen_array_open ((yajl_gen) g);
+    stat = json_gen_array_open ((yajl_gen) g);
     if (stat != yajl_gen_status_ok)
         GEN_SET_ERROR_AND_RETURN (stat, err);
     for (i = 0; i < ptr->len; i++)
@@ -1426,7 +1853,7 @@ yajl_gen_status gen_%s (yajl_gen g, const %s *ptr, const struct parser_context *
 """)
         c_file.write('        {\n')
         if obj.doublearray:
-            c_file.write('            stat = yajl_gen_array_open ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_open ((yajl_gen) g);\n')
             c_file.write("            if (stat != yajl_gen_status_ok)\n")
             c_file.write("                GEN_SET_ERROR_AND_RETURN (stat, err);\n")
             c_file.write("            size_t j;\n")
@@ -1434,20 +1861,20 @@ yajl_gen_status gen_%s (yajl_gen g, const %s *ptr, const struct parser_context *
             c_file.write('              {\n')
             json_value_generator(c_file, 4, "ptr->items[i][j]", 'g', 'ctx', obj.subtyp)
             c_file.write('            }\n')
-            c_file.write('            stat = yajl_gen_array_close ((yajl_gen) g);\n')
+            c_file.write('            stat = json_gen_array_close ((yajl_gen) g);\n')
         else:
             json_value_generator(c_file, 3, "ptr->items[i]", 'g', 'ctx', obj.subtyp)
 
         c_file.write("""\n
             }
       }
-    stat = yajl_gen_array_close ((yajl_gen) g);
+    stat = json_gen_array_close ((yajl_gen) g);
 """)
 
 
     c_file.write("""\n
     if (ptr->len > 0 && !(ctx->options & OPT_GEN_SIMPLIFY))
-        yajl_gen_config (g, yajl_gen_beautify, 1);
+        json_gen_beautify (g, 1);
     if (stat != yajl_gen_status_ok)
         GEN_SET_ERROR_AND_RETURN (stat, err);
     return yajl_gen_status_ok;
@@ -1460,6 +1887,7 @@ def get_c_epilog_for_array(c_file, prefix, typ, obj):
     get_c_epilog_for_array_make_parse(c_file, prefix, typ, obj)
     get_c_epilog_for_array_make_free(c_file, prefix, typ, obj)
     get_c_epilog_for_array_make_gen(c_file, prefix, typ, obj)
+    return make_c_array_desc(obj, c_file, prefix)
 
 
 def get_c_epilog(c_file, prefix, typ, obj):
@@ -1471,9 +1899,54 @@ def get_c_epilog(c_file, prefix, typ, obj):
     typename = prefix
     if typ != 'array' and typ != 'object':
         return
+    stream = True
     if typ == 'array':
         typename = helpers.get_top_array_type_name(obj.name, prefix)
-        get_c_epilog_for_array(c_file, prefix, typ, obj)
+        stream = get_c_epilog_for_array(c_file, prefix, typ, obj)
+
+    c_file.write("""
+define_cleaner_function (yajl_val, yajl_tree_free)
+
+/* parse the len bytes of jsondata, terminated tells whether jsondata[len] is a NUL */
+static %s *
+parse_data_len_%s (const char *jsondata, size_t len, bool terminated, const struct parser_context *ctx,
+                   parser_error *err)
+{
+    %s *ptr = NULL;
+    __auto_cleanup(yajl_tree_free) yajl_val tree = NULL;
+    char errbuf[1024];
+    struct parser_context tmp_ctx = { 0 };
+
+    *err = NULL;
+    if (len >= JSON_MAX_SIZE) {
+        if (asprintf(err, "cannot parse the data with length exceeding %%llu", JSON_MAX_SIZE) < 0) {
+            *err = safe_strdup("error allocating memory");
+        }
+        return NULL;
+    }
+
+    if (ctx == NULL)
+     ctx = (const struct parser_context *)(&tmp_ctx);
+""" % (typename, typename, typename))
+    if stream:
+        c_file.write("""
+    /* the stream parser builds no tree: make_%s prints the unknown keys back to text
+       from the tree, and lazy members keep their subtree until they are loaded */
+    if ((ctx->options & OPT_PARSE_STREAM) && !(ctx->options & (OPT_PARSE_FULLKEY | OPT_PARSE_LAZY)))
+      return json_stream_parse (jsondata, len, &desc_%s, ctx, err);
+""" % (typename, typename))
+    c_file.write("""
+    tree = json_tree_parse (jsondata, len, terminated, errbuf, sizeof (errbuf));
+    if (tree == NULL)
+      {
+        if (asprintf (err, "cannot parse the data: %%s", errbuf) < 0)
+            *err = strdup ("error allocating memory");
+        return NULL;
+      }
+    ptr = make_%s (tree, ctx, err);
+    return ptr;
+}
+""" % typename)
 
     c_file.write("""
 %s *
@@ -1481,24 +1954,41 @@ def get_c_epilog(c_file, prefix, typ, obj):
 {
     %s *ptr = NULL;
     size_t filesize;
-    __auto_free char *content = NULL;
+    bool mapped;
+    char *content = NULL;
 
     if (filename == NULL || err == NULL)
       return NULL;
 
     *err = NULL;
-    content = read_file (filename, &filesize);
+    content = map_file (filename, &filesize, &mapped);
     if (content == NULL)
       {
         if (asprintf (err, "cannot read the file: %%s", filename) < 0)
             *err = strdup ("error allocating memory");
         return NULL;
       }
-    ptr = %s_parse_data (content, ctx, err);
+    ptr = parse_data_len_%s (content, filesize, true, ctx, err);
+    unmap_file (content, filesize, mapped);
     return ptr;
 }
 """ % (typename, typename, typename, typename))
 
+    c_file.write("""
+static void *
+parse_file_any_%s (const char *filename, const struct parser_context *ctx, parser_error *err)
+{
+    return %s_parse_file (filename, ctx, err);
+}
+
+int
+%s_parse_files_parallel (const char **paths, size_t n, size_t nthreads, const struct parser_context *ctx,
+                         %s **out, parser_error *errs)
+{
+    return json_parse_files_parallel (paths, n, nthreads, parse_file_any_%s, ctx, (void **) out, errs);
+}
+""" % (typename, typename, typename, typename, typename))
+
     c_file.write("""
 %s *
 %s_parse_file_stream (FILE *stream, const struct parser_context *ctx, parser_error *err)
@@ -1517,106 +2007,174 @@ def get_c_epilog(c_file, prefix, typ, obj):
         *err = strdup ("cannot read the file");
         return NULL;
       }
-    ptr = %s_parse_data (content, ctx, err);
+    /* filesize counts the NUL */
+    ptr = parse_data_len_%s (content, filesize - 1, true, ctx, err);
     return ptr;
 }
 """ % (typename, typename, typename, typename))
 
     c_file.write("""
-define_cleaner_function (yajl_val, yajl_tree_free)
-
 %s *
 %s_parse_data (const char *jsondata, const struct parser_context *ctx, parser_error *err)
+{
+    if (jsondata == NULL || err == NULL)
+      return NULL;
+
+    return parse_data_len_%s (jsondata, strlen (jsondata), true, ctx, err);
+}
+
+%s *
+%s_parse_data_len (const char *jsondata, size_t len, const struct parser_context *ctx, parser_error *err)
+{
+    if (jsondata == NULL || err == NULL)
+      return NULL;
+
+    return parse_data_len_%s (jsondata, len, false, ctx, err);
+}
+""" % (typename, typename, typename, typename, typename, typename))
+    if stream:
+        c_file.write("""
+%s *
+%s_parse_data_insitu (char *jsondata, const struct parser_context *ctx, parser_error *err)
 {
     %s *ptr = NULL;
-    __auto_cleanup(yajl_tree_free) yajl_val tree = NULL;
-    char errbuf[1024];
     struct parser_context tmp_ctx = { 0 };
+    size_t len;
+
+    if (jsondata == NULL || err == NULL)
+      {
+        free (jsondata);
+        return NULL;
+      }
+
+    *err = NULL;
+    if (ctx == NULL)
+     ctx = (const struct parser_context *)(&tmp_ctx);
+    len = strlen (jsondata);
+    /* oversized data gets the error of the tree parser, and only make_%s sees
+       the unknown keys and keeps the lazy subtrees */
+    if (len >= JSON_MAX_SIZE || (ctx->options & (OPT_PARSE_FULLKEY | OPT_PARSE_LAZY)))
+      {
+        ptr = parse_data_len_%s (jsondata, len, true, ctx, err);
+        free (jsondata);
+        return ptr;
+      }
+    return json_stream_parse_insitu (jsondata, len, &desc_%s, ctx, err);
+}
+""" % (typename, typename, typename, typename, typename, typename))
+    if stream and typ == 'object':
+        c_file.write("""
+%s *
+%s_parse_data_paths (const char *jsondata, const char **json_pointers, const struct parser_context *ctx,
+                     parser_error *err)
+{
+    struct parser_context tmp_ctx = { 0 };
+    size_t len;
 
     if (jsondata == NULL || err == NULL)
       return NULL;
 
     *err = NULL;
-    if (strlen(jsondata) >= JSON_MAX_SIZE) {
+    if (ctx == NULL)
+     ctx = (const struct parser_context *)(&tmp_ctx);
+    len = strlen (jsondata);
+    if (len >= JSON_MAX_SIZE) {
         if (asprintf(err, "cannot parse the data with length exceeding %%llu", JSON_MAX_SIZE) < 0) {
             *err = safe_strdup("error allocating memory");
         }
         return NULL;
     }
+    return json_stream_parse_paths (jsondata, len, &desc_%s, json_pointers, ctx, err);
+}
+""" % (typename, typename, typename))
+
+    if stream:
+        c_file.write("""
+int
+%s_encode_binary (const %s *ptr, uint8_t **data, size_t *len, parser_error *err)
+{
+    return json_binary_encode (&desc_%s, ptr, data, len, err);
+}
+
+%s *
+%s_decode_binary (const uint8_t *data, size_t len, const struct parser_context *ctx, parser_error *err)
+{
+    return json_binary_decode (data, len, &desc_%s, ctx, err);
+}
+
+%s *
+%s_decode_binary_file (const char *path, const struct parser_context *ctx, parser_error *err)
+{
+    return json_binary_decode_file (path, &desc_%s, ctx, err);
+}
+""" % tuple([typename] * 9))
+        c_file.write("""
+struct json_stream_parser *
+%s_parser_new (const struct parser_context *ctx, size_t max_size)
+{
+    struct parser_context tmp_ctx = { 0 };
 
     if (ctx == NULL)
      ctx = (const struct parser_context *)(&tmp_ctx);
+    return json_stream_parser_new (&desc_%s, max_size, ctx);
+}
 
-    tree = yajl_tree_parse (jsondata, errbuf, sizeof (errbuf));
-    if (tree == NULL)
+int
+%s_parser_feed (struct json_stream_parser *parser, const char *buf, size_t len, parser_error *err)
+{
+    if (parser == NULL || (buf == NULL && len > 0))
+      return -1;
+    return json_stream_parser_feed (parser, buf, len, err);
+}
+
+int
+%s_parser_feed_fd (struct json_stream_parser *parser, int fd, parser_error *err)
+{
+    if (parser == NULL || fd < 0)
+      return -1;
+    return json_stream_parser_feed_fd (parser, fd, err);
+}
+
+%s *
+%s_parser_finish (struct json_stream_parser *parser, parser_error *err)
+{
+    if (parser == NULL || err == NULL)
       {
-        if (asprintf (err, "cannot parse the data: %%s", errbuf) < 0)
-            *err = strdup ("error allocating memory");
+        json_stream_parser_free (parser);
         return NULL;
       }
-    ptr = make_%s (tree, ctx, err);
-    return ptr;
+    return json_stream_parser_finish (parser, err);
 }
-""" % (typename, typename, typename, typename))
+""" % tuple([typename] * 6))
 
-    c_file.write("""\nstatic void\ncleanup_yajl_gen (yajl_gen g)
+    c_file.write("""
+static yajl_gen_status
+gen_%s_any (yajl_gen g, const void *ptr, const struct parser_context *ctx, parser_error *err)
 {
-    if (!g)
-      return;
-    yajl_gen_clear (g);
-    yajl_gen_free (g);
+    return gen_%s (g, (const %s *) ptr, ctx, err);
 }
 
-define_cleaner_function (yajl_gen, cleanup_yajl_gen)
-
-""")
-
-    c_file.write("""
 char *
 %s_generate_json (const %s *ptr, const struct parser_context *ctx, parser_error *err)
 {
-    __auto_cleanup(cleanup_yajl_gen) yajl_gen g = NULL;
-    struct parser_context tmp_ctx = { 0 };
-    const unsigned char *gen_buf = NULL;
-    char *json_buf = NULL;
-    size_t gen_len = 0;
-
-    if (ptr == NULL || err == NULL)
-      return NULL;
-
-    *err = NULL;
-    if (ctx == NULL)
-        ctx = (const struct parser_context *)(&tmp_ctx);
-
-    if (!json_gen_init(&g, ctx))
-      {
-        *err = strdup ("Json_gen init failed");
-        return json_buf;
-      }
-
-    if (yajl_gen_status_ok != gen_%s (g, ptr, ctx, err))
-      {
-        if (*err == NULL)
-            *err = strdup ("Failed to generate json");
-        return json_buf;
-      }
+    return json_gen_to_string (gen_%s_any, ptr, ctx, err);
+}
 
-    yajl_gen_get_buf (g, &gen_buf, &gen_len);
-    if (gen_buf == NULL)
-      {
-        *err = strdup ("Error to get generated json");
-        return json_buf;
-      }
+int
+%s_generate_json_fd (const %s *ptr, int fd, const struct parser_context *ctx, parser_error *err)
+{
+    return json_gen_to_fd (gen_%s_any, ptr, fd, ctx, err);
+}
 
-    json_buf = smart_calloc (gen_len, 1, 1);
-    if (json_buf == NULL)
-      {
-        *err = strdup ("Cannot allocate memory");
-        return json_buf;
-      }
-    (void) memcpy (json_buf, gen_buf, gen_len);
-    json_buf[gen_len] = '\\0';
+int
+%s_generate_json_to_buffer (const %s *ptr, struct __isula_buffer *buf, const struct parser_context *ctx, parser_error *err)
+{
+    return json_gen_to_buffer (gen_%s_any, ptr, buf, ctx, err);
+}
 
-    return json_buf;
+int
+%s_generate_json_file_atomic (const %s *ptr, const char *path, mode_t mode, const struct parser_context *ctx, parser_error *err)
+{
+    return json_gen_to_file_atomic (gen_%s_any, ptr, path, mode, ctx, err);
 }
-""" % (typename, typename, typename))
+""" % tuple([typename] * 15))
@@ -22,9 +22,19 @@
  ********************************************************************************/
 #include "utils_cgroup.h"
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <sys/vfs.h>
 
 #include "log.h"
+#include "utils_memory.h"
 
 /* swap in oci is memoy+swap, so here we need to get real swap */
 int lcr_util_get_real_swap(int64_t memory, int64_t memory_swap, int64_t *swap)
@@ -95,4 +105,691 @@ int lcr_util_get_cgroup_version(void)
     } else {
         return CGROUP_VERSION_1;
     }
-}
\ No newline at end of file
+}
+
+enum cgroup_ctrl {
+    CGROUP_CTRL_CPU,
+    CGROUP_CTRL_CPUACCT,
+    CGROUP_CTRL_MEMORY,
+    CGROUP_CTRL_BLKIO,
+    CGROUP_CTRL_PIDS,
+    CGROUP_CTRL_NUM,
+};
+
+static const char *g_cgroup_ctrl_names[CGROUP_CTRL_NUM] = { "cpu", "cpuacct", "memory", "blkio", "pids" };
+
+// scale of a key given in clock ticks
+#define METRICS_SCALE_TICKS 0
+
+struct metrics_key {
+    const char *key;
+    size_t offset;
+    uint64_t scale;
+};
+
+#define METRICS_KEY(k, field, s) { k, offsetof(struct isula_cgroup_metrics, field), s }
+
+struct metrics_file;
+// parse buf into metrics, false if it held no value
+typedef bool (*metrics_parse_t)(const isula_cgroup_reader_t *reader, const struct metrics_file *file,
+                                const char *buf, const char *end, struct isula_cgroup_metrics *metrics);
+
+struct metrics_file {
+    int ctrl;
+    const char *name;
+    metrics_parse_t parse;
+    // field of a single value file
+    size_t offset;
+    // keys of a keyed file, ending with a NULL key
+    const struct metrics_key *keys;
+    // files of the same non zero group are alternatives in order of preference,
+    // only the first one holding a value is used
+    int group;
+};
+
+#define CGROUP_METRICS_MAX_FILES 24
+// memory.stat and io.stat of a busy host fit, bigger files grow the buffer
+#define CGROUP_METRICS_BUF_SIZE 4096
+#define CGROUP_METRICS_BUF_MAX (1024 * 1024)
+
+// a systemd init moves itself into this child of the container cgroup
+#define CGROUP_INIT_SCOPE "/init.scope"
+
+struct isula_cgroup_reader {
+    pid_t pid;
+    const struct metrics_file *files;
+    size_t nfiles;
+    int fds[CGROUP_METRICS_MAX_FILES];
+    uint64_t nanos_per_tick;
+    // cgroup v1 shows no limit as LLONG_MAX rounded down to the page size
+    uint64_t v1_unlimited;
+    char *buf;
+    size_t buf_size;
+};
+
+static inline uint64_t *metrics_field(struct isula_cgroup_metrics *metrics, size_t offset)
+{
+    return (uint64_t *)((char *)metrics + offset);
+}
+
+static inline bool metrics_space(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+// next whitespace separated token of [p, end), NULL at the end
+static const char *metrics_token(const char *p, const char *end, size_t *len)
+{
+    const char *start = NULL;
+
+    while (p < end && metrics_space(*p)) {
+        p++;
+    }
+    if (p == end) {
+        return NULL;
+    }
+    start = p;
+    while (p < end && !metrics_space(*p)) {
+        p++;
+    }
+    *len = (size_t)(p - start);
+    return start;
+}
+
+// decimal value at p, 0 for "max" and other words
+static uint64_t metrics_ull(const char *p, const char *end)
+{
+    uint64_t val = 0;
+
+    for (; p < end && *p >= '0' && *p <= '9'; p++) {
+        val = val * 10 + (uint64_t)(*p - '0');
+    }
+    return val;
+}
+
+static const struct metrics_key *metrics_find_key(const struct metrics_key *keys, const struct metrics_key *from,
+                                                  const char *key, size_t len)
+{
+    const struct metrics_key *k = from != NULL ? from + 1 : keys;
+
+    for (; k->key != NULL; k++) {
+        if (strlen(k->key) == len && memcmp(k->key, key, len) == 0) {
+            return k;
+        }
+    }
+    return NULL;
+}
+
+static uint64_t metrics_scale(const isula_cgroup_reader_t *reader, const struct metrics_key *key, uint64_t val)
+{
+    return val * (key->scale == METRICS_SCALE_TICKS ? reader->nanos_per_tick : key->scale);
+}
+
+static const char *metrics_line_end(const char *line, const char *end)
+{
+    const char *eol = memchr(line, '\n', (size_t)(end - line));
+
+    return eol != NULL ? eol : end;
+}
+
+static bool parse_single(const isula_cgroup_reader_t *reader, const struct metrics_file *file, const char *buf,
+                         const char *end, struct isula_cgroup_metrics *metrics)
+{
+    size_t len = 0;
+    const char *tok = metrics_token(buf, end, &len);
+
+    if (tok == NULL) {
+        return false;
+    }
+    *metrics_field(metrics, file->offset) = metrics_ull(tok, tok + len);
+    return true;
+}
+
+// cgroup v1 limit, no limit is 0 as in cgroup v2
+static bool parse_limit(const isula_cgroup_reader_t *reader, const struct metrics_file *file, const char *buf,
+                        const char *end, struct isula_cgroup_metrics *metrics)
+{
+    uint64_t *limit = metrics_field(metrics, file->offset);
+
+    if (!parse_single(reader, file, buf, end, metrics)) {
+        return false;
+    }
+    if (*limit >= reader->v1_unlimited) {
+        *limit = 0;
+    }
+    return true;
+}
+
+// "key value" lines, a key may feed several fields
+static bool parse_keyed(const isula_cgroup_reader_t *reader, const struct metrics_file *file, const char *buf,
+                        const char *end, struct isula_cgroup_metrics *metrics)
+{
+    const char *line = NULL;
+    const char *eol = NULL;
+    const char *key = NULL;
+    const char *val = NULL;
+    const struct metrics_key *k = NULL;
+    size_t key_len = 0;
+    size_t val_len = 0;
+    bool found = false;
+
+    for (line = buf; line < end; line = eol + 1) {
+        eol = metrics_line_end(line, end);
+        key = metrics_token(line, eol, &key_len);
+        if (key == NULL) {
+            continue;
+        }
+        val = metrics_token(key + key_len, eol, &val_len);
+        if (val == NULL) {
+            continue;
+        }
+        for (k = metrics_find_key(file->keys, NULL, key, key_len); k != NULL;
+             k = metrics_find_key(file->keys, k, key, key_len)) {
+            *metrics_field(metrics, k->offset) = metrics_scale(reader, k, metrics_ull(val, val + val_len));
+            found = true;
+        }
+    }
+    return found;
+}
+
+// cgroup v1 blkio "major:minor Op value" lines summed over devices, the closing "Total value" is skipped
+static bool parse_blkio(const isula_cgroup_reader_t *reader, const struct metrics_file *file, const char *buf,
+                        const char *end, struct isula_cgroup_metrics *metrics)
+{
+    const char *line = NULL;
+    const char *eol = NULL;
+    const char *dev = NULL;
+    const char *op = NULL;
+    const char *val = NULL;
+    const struct metrics_key *k = NULL;
+    size_t len = 0;
+    size_t op_len = 0;
+    bool found = false;
+
+    for (line = buf; line < end; line = eol + 1) {
+        eol = metrics_line_end(line, end);
+        dev = metrics_token(line, eol, &len);
+        if (dev == NULL || memchr(dev, ':', len) == NULL) {
+            continue;
+        }
+        op = metrics_token(dev + len, eol, &op_len);
+        if (op == NULL) {
+            continue;
+        }
+        val = metrics_token(op + op_len, eol, &len);
+        k = metrics_find_key(file->keys, NULL, op, op_len);
+        if (val != NULL && k != NULL) {
+            *metrics_field(metrics, k->offset) += metrics_ull(val, val + len);
+            found = true;
+        }
+    }
+    return found;
+}
+
+// cgroup v2 io.stat "major:minor key=value ..." lines summed over devices
+static bool parse_io_stat(const isula_cgroup_reader_t *reader, const struct metrics_file *file, const char *buf,
+                          const char *end, struct isula_cgroup_metrics *metrics)
+{
+    const char *line = NULL;
+    const char *eol = NULL;
+    const char *tok = NULL;
+    const char *eq = NULL;
+    const struct metrics_key *k = NULL;
+    size_t len = 0;
+    bool found = false;
+
+    for (line = buf; line < end; line = eol + 1) {
+        eol = metrics_line_end(line, end);
+        tok = metrics_token(line, eol, &len);
+        if (tok == NULL) {
+            continue;
+        }
+        while ((tok = metrics_token(tok + len, eol, &len)) != NULL) {
+            eq = memchr(tok, '=', len);
+            if (eq == NULL) {
+                continue;
+            }
+            k = metrics_find_key(file->keys, NULL, tok, (size_t)(eq - tok));
+            if (k != NULL) {
+                *metrics_field(metrics, k->offset) += metrics_ull(eq + 1, tok + len);
+                found = true;
+            }
+        }
+    }
+    return found;
+}
+
+static const struct metrics_key g_v1_cpuacct_stat_keys[] = {
+    METRICS_KEY("user", cpu_use_user, METRICS_SCALE_TICKS),
+    METRICS_KEY("system", cpu_use_sys, METRICS_SCALE_TICKS),
+    { NULL, 0, 0 },
+};
+
+static const struct metrics_key g_v1_cpu_stat_keys[] = {
+    METRICS_KEY("nr_periods", cpu_nr_periods, 1),
+    METRICS_KEY("nr_throttled", cpu_nr_throttled, 1),
+    METRICS_KEY("throttled_time", cpu_throttled_nanos, 1),
+    { NULL, 0, 0 },
+};
+
+static const struct metrics_key g_v1_memory_stat_keys[] = {
+    METRICS_KEY("total_rss", rss_bytes, 1),
+    METRICS_KEY("total_pgfault", page_faults, 1),
+    METRICS_KEY("total_pgmajfault", major_page_faults, 1),
+    METRICS_KEY("cache", cache, 1),
+    METRICS_KEY("total_cache", cache_total, 1),
+    METRICS_KEY("total_inactive_file", inactive_file_total, 1),
+    { NULL, 0, 0 },
+};
+
+static const struct metrics_key g_v1_io_bytes_keys[] = {
+    METRICS_KEY("Read", io_read_bytes, 1),
+    METRICS_KEY("Write", io_write_bytes, 1),
+    METRICS_KEY("Total", io_total_bytes, 1),
+    { NULL, 0, 0 },
+};
+
+static const struct metrics_key g_v1_io_ops_keys[] = {
+    METRICS_KEY("Read", io_read_ops, 1),
+    METRICS_KEY("Write", io_write_ops, 1),
+    METRICS_KEY("Total", io_total_ops, 1),
+    { NULL, 0, 0 },
+};
+
+#define METRICS_SINGLE(ctrl, name, field) { ctrl, name, parse_single, offsetof(struct isula_cgroup_metrics, field), NULL }
+#define METRICS_LIMIT(ctrl, name, field) { ctrl, name, parse_limit, offsetof(struct isula_cgroup_metrics, field), NULL }
+#define METRICS_BLKIO(name, keys, group) { CGROUP_CTRL_BLKIO, name, parse_blkio, 0, keys, group }
+
+static const struct metrics_file g_v1_metrics_files[] = {
+    METRICS_SINGLE(CGROUP_CTRL_CPUACCT, "cpuacct.usage", cpu_use_nanos),
+    { CGROUP_CTRL_CPUACCT, "cpuacct.stat", parse_keyed, 0, g_v1_cpuacct_stat_keys },
+    { CGROUP_CTRL_CPU, "cpu.stat", parse_keyed, 0, g_v1_cpu_stat_keys },
+    METRICS_SINGLE(CGROUP_CTRL_PIDS, "pids.current", pids_current),
+    METRICS_SINGLE(CGROUP_CTRL_PIDS, "pids.max", pids_limit),
+    METRICS_SINGLE(CGROUP_CTRL_MEMORY, "memory.usage_in_bytes", mem_used),
+    METRICS_LIMIT(CGROUP_CTRL_MEMORY, "memory.limit_in_bytes", mem_limit),
+    METRICS_SINGLE(CGROUP_CTRL_MEMORY, "memory.kmem.usage_in_bytes", kmem_used),
+    METRICS_LIMIT(CGROUP_CTRL_MEMORY, "memory.kmem.limit_in_bytes", kmem_limit),
+    { CGROUP_CTRL_MEMORY, "memory.stat", parse_keyed, 0, g_v1_memory_stat_keys },
+    // as lxc: the CFQ and BFQ counters of the whole subtree, the throttling ones
+    // if no such scheduler is in use
+    METRICS_BLKIO("blkio.io_service_bytes_recursive", g_v1_io_bytes_keys, 1),
+    METRICS_BLKIO("blkio.bfq.io_service_bytes_recursive", g_v1_io_bytes_keys, 1),
+    METRICS_BLKIO("blkio.throttle.io_service_bytes_recursive", g_v1_io_bytes_keys, 1),
+    METRICS_BLKIO("blkio.throttle.io_service_bytes", g_v1_io_bytes_keys, 1),
+    METRICS_BLKIO("blkio.io_serviced_recursive", g_v1_io_ops_keys, 2),
+    METRICS_BLKIO("blkio.bfq.io_serviced_recursive", g_v1_io_ops_keys, 2),
+    METRICS_BLKIO("blkio.throttle.io_serviced_recursive", g_v1_io_ops_keys, 2),
+    METRICS_BLKIO("blkio.throttle.io_serviced", g_v1_io_ops_keys, 2),
+};
+
+static const struct metrics_key g_v2_cpu_stat_keys[] = {
+    METRICS_KEY("usage_usec", cpu_use_nanos, 1000),
+    METRICS_KEY("user_usec", cpu_use_user, 1000),
+    METRICS_KEY("system_usec", cpu_use_sys, 1000),
+    METRICS_KEY("nr_periods", cpu_nr_periods, 1),
+    METRICS_KEY("nr_throttled", cpu_nr_throttled, 1),
+    METRICS_KEY("throttled_usec", cpu_throttled_nanos, 1000),
+    { NULL, 0, 0 },
+};
+
+static const struct metrics_key g_v2_memory_stat_keys[] = {
+    METRICS_KEY("anon", rss_bytes, 1),
+    METRICS_KEY("pgfault", page_faults, 1),
+    METRICS_KEY("pgmajfault", major_page_faults, 1),
+    METRICS_KEY("file", cache, 1),
+    METRICS_KEY("file", cache_total, 1),
+    METRICS_KEY("inactive_file", inactive_file_total, 1),
+    METRICS_KEY("kernel", kmem_used, 1),
+    { NULL, 0, 0 },
+};
+
+static const struct metrics_key g_v2_io_stat_keys[] = {
+    METRICS_KEY("rbytes", io_read_bytes, 1),
+    METRICS_KEY("wbytes", io_write_bytes, 1),
+    METRICS_KEY("rios", io_read_ops, 1),
+    METRICS_KEY("wios", io_write_ops, 1),
+    { NULL, 0, 0 },
+};
+
+// in cgroup v2 every file lives in the one unified directory, ctrl is unused
+static const struct metrics_file g_v2_metrics_files[] = {
+    { CGROUP_CTRL_CPU, "cpu.stat", parse_keyed, 0, g_v2_cpu_stat_keys },
+    METRICS_SINGLE(CGROUP_CTRL_PIDS, "pids.current", pids_current),
+    METRICS_SINGLE(CGROUP_CTRL_PIDS, "pids.max", pids_limit),
+    METRICS_SINGLE(CGROUP_CTRL_MEMORY, "memory.current", mem_used),
+    METRICS_SINGLE(CGROUP_CTRL_MEMORY, "memory.max", mem_limit),
+    { CGROUP_CTRL_MEMORY, "memory.stat", parse_keyed, 0, g_v2_memory_stat_keys },
+    { CGROUP_CTRL_BLKIO, "io.stat", parse_io_stat, 0, g_v2_io_stat_keys },
+};
+
+static bool ctrl_in_list(const char *list, const char *ctrl)
+{
+    size_t len = strlen(ctrl);
+    const char *p = list;
+
+    while (p != NULL) {
+        if (strncmp(p, ctrl, len) == 0 && (p[len] == ',' || p[len] == '\0')) {
+            return true;
+        }
+        p = strchr(p, ',');
+        if (p != NULL) {
+            p++;
+        }
+    }
+    return false;
+}
+
+// the container cgroup of the init scope a systemd init runs in, path itself otherwise
+static void cgroup_strip_init_scope(char *path)
+{
+    size_t len = strlen(path);
+    size_t scope_len = strlen(CGROUP_INIT_SCOPE);
+
+    // "/init.scope" alone is the init of the host
+    if (len > scope_len && strcmp(path + len - scope_len, CGROUP_INIT_SCOPE) == 0) {
+        path[len - scope_len] = '\0';
+    }
+}
+
+/*
+ * Fill dirs with the directory of each controller from the lines
+ * "id:controllers:path" of proc_cgroup, for v2 only the "0::path" line counts.
+ * A nested init scope stands for the container cgroup holding it.
+ */
+static int cgroup_ctrl_dirs(int version, const char *mountpoint, const char *proc_cgroup,
+                            char dirs[CGROUP_CTRL_NUM][PATH_MAX])
+{
+    FILE *fp = NULL;
+    char *line = NULL;
+    size_t len = 0;
+    char *ctrls = NULL;
+    char *path = NULL;
+    int i;
+    int nret;
+    int found = 0;
+
+    fp = fopen(proc_cgroup, "re");
+    if (fp == NULL) {
+        SYSERROR("Failed to open %s", proc_cgroup);
+        return -1;
+    }
+
+    while (getline(&line, &len, fp) != -1) {
+        line[strcspn(line, "\n")] = '\0';
+        ctrls = strchr(line, ':');
+        if (ctrls == NULL) {
+            continue;
+        }
+        *ctrls++ = '\0';
+        path = strchr(ctrls, ':');
+        if (path == NULL) {
+            continue;
+        }
+        *path++ = '\0';
+        cgroup_strip_init_scope(path);
+
+        if (version == CGROUP_VERSION_2) {
+            if (strcmp(line, "0") != 0 || ctrls[0] != '\0') {
+                continue;
+            }
+            nret = snprintf(dirs[0], PATH_MAX, "%s%s", mountpoint, path);
+            if (nret < 0 || nret >= PATH_MAX) {
+                ERROR("Cgroup path too long: %s", path);
+                continue;
+            }
+            for (i = 1; i < CGROUP_CTRL_NUM; i++) {
+                (void)strcpy(dirs[i], dirs[0]);
+            }
+            found = CGROUP_CTRL_NUM;
+            break;
+        }
+
+        for (i = 0; i < CGROUP_CTRL_NUM; i++) {
+            if (dirs[i][0] != '\0' || !ctrl_in_list(ctrls, g_cgroup_ctrl_names[i])) {
+                continue;
+            }
+            nret = snprintf(dirs[i], PATH_MAX, "%s/%s%s", mountpoint, ctrls, path);
+            if (nret < 0 || nret >= PATH_MAX) {
+                ERROR("Cgroup path too long: %s", path);
+                dirs[i][0] = '\0';
+                continue;
+            }
+            found++;
+        }
+    }
+
+    free(line);
+    fclose(fp);
+    return found;
+}
+
+static uint64_t cgroup_nanos_per_tick(void)
+{
+    long ticks = sysconf(_SC_CLK_TCK);
+
+    return ticks > 0 ? (uint64_t)(1000000000 / ticks) : 10000000;
+}
+
+static uint64_t cgroup_v1_unlimited(void)
+{
+    long page_size = sysconf(_SC_PAGESIZE);
+
+    return (uint64_t)LLONG_MAX & ~(uint64_t)(page_size > 0 ? page_size - 1 : 4095);
+}
+
+uint64_t isula_cgroup_v1_ticks_to_nanos(uint64_t ticks)
+{
+    return ticks * cgroup_nanos_per_tick();
+}
+
+uint64_t isula_cgroup_v1_limit(uint64_t limit)
+{
+    return limit >= cgroup_v1_unlimited() ? 0 : limit;
+}
+
+int isula_cgroup_host_version(void)
+{
+    // the cgroup version of the host does not change, detect it once
+    static int detected = 0;
+    int v = __atomic_load_n(&detected, __ATOMIC_RELAXED);
+
+    if (v == 0) {
+        v = lcr_util_get_cgroup_version();
+        if (v < 0) {
+            return -1;
+        }
+        __atomic_store_n(&detected, v, __ATOMIC_RELAXED);
+    }
+    return v;
+}
+
+isula_cgroup_reader_t *isula_cgroup_reader_new(int version, const char *mountpoint, const char *proc_cgroup)
+{
+    isula_cgroup_reader_t *reader = NULL;
+    char (*dirs)[PATH_MAX] = NULL;
+    int dirfds[CGROUP_CTRL_NUM];
+    size_t opened = 0;
+    size_t i;
+    int ctrl;
+
+    if (mountpoint == NULL || proc_cgroup == NULL ||
+        (version != CGROUP_VERSION_1 && version != CGROUP_VERSION_2)) {
+        ERROR("Invalid cgroup reader arguments");
+        return NULL;
+    }
+
+    dirs = isula_smart_calloc_s(PATH_MAX, CGROUP_CTRL_NUM);
+    reader = isula_common_calloc_s(sizeof(*reader));
+    if (dirs == NULL || reader == NULL) {
+        ERROR("Out of memory");
+        goto err_out;
+    }
+    reader->files = version == CGROUP_VERSION_2 ? g_v2_metrics_files : g_v1_metrics_files;
+    reader->nfiles = version == CGROUP_VERSION_2 ? sizeof(g_v2_metrics_files) / sizeof(g_v2_metrics_files[0]) :
+                     sizeof(g_v1_metrics_files) / sizeof(g_v1_metrics_files[0]);
+    for (i = 0; i < CGROUP_METRICS_MAX_FILES; i++) {
+        reader->fds[i] = -1;
+    }
+    reader->nanos_per_tick = cgroup_nanos_per_tick();
+    reader->v1_unlimited = cgroup_v1_unlimited();
+    reader->buf_size = CGROUP_METRICS_BUF_SIZE;
+    reader->buf = isula_common_calloc_s(reader->buf_size);
+    if (reader->buf == NULL) {
+        ERROR("Out of memory");
+        goto err_out;
+    }
+
+    if (cgroup_ctrl_dirs(version, mountpoint, proc_cgroup, dirs) <= 0) {
+        ERROR("No cgroup found in %s", proc_cgroup);
+        goto err_out;
+    }
+
+    // every directory is opened once, the files are opened relative to it
+    for (ctrl = 0; ctrl < CGROUP_CTRL_NUM; ctrl++) {
+        dirfds[ctrl] = -1;
+        if (dirs[ctrl][0] != '\0') {
+            dirfds[ctrl] = open(dirs[ctrl], O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        }
+    }
+    for (i = 0; i < reader->nfiles; i++) {
+        ctrl = version == CGROUP_VERSION_2 ? 0 : reader->files[i].ctrl;
+        if (dirfds[ctrl] < 0) {
+            continue;
+        }
+        reader->fds[i] = openat(dirfds[ctrl], reader->files[i].name, O_RDONLY | O_CLOEXEC);
+        if (reader->fds[i] >= 0) {
+            opened++;
+        }
+    }
+    for (ctrl = 0; ctrl < CGROUP_CTRL_NUM; ctrl++) {
+        if (dirfds[ctrl] >= 0) {
+            close(dirfds[ctrl]);
+        }
+    }
+
+    if (opened == 0) {
+        ERROR("No cgroup metrics file found in %s", proc_cgroup);
+        goto err_out;
+    }
+
+    free(dirs);
+    return reader;
+
+err_out:
+    free(dirs);
+    isula_cgroup_reader_free(reader);
+    return NULL;
+}
+
+isula_cgroup_reader_t *isula_cgroup_reader_new_pid(int version, pid_t pid)
+{
+    isula_cgroup_reader_t *reader = NULL;
+    char proc_cgroup[PATH_MAX] = { 0 };
+    int v = version;
+    int nret;
+
+    if (pid <= 0) {
+        ERROR("Invalid pid %d", pid);
+        return NULL;
+    }
+
+    if (v == 0) {
+        v = isula_cgroup_host_version();
+        if (v < 0) {
+            return NULL;
+        }
+    }
+
+    nret = snprintf(proc_cgroup, sizeof(proc_cgroup), "/proc/%d/cgroup", pid);
+    if (nret < 0 || (size_t)nret >= sizeof(proc_cgroup)) {
+        return NULL;
+    }
+
+    reader = isula_cgroup_reader_new(v, CGROUP_MOUNTPOINT, proc_cgroup);
+    if (reader != NULL) {
+        reader->pid = pid;
+    }
+    return reader;
+}
+
+pid_t isula_cgroup_reader_pid(const isula_cgroup_reader_t *reader)
+{
+    return reader != NULL ? reader->pid : 0;
+}
+
+// whole content of fd from offset 0 into the reader buffer, growing it if the file does not fit
+static ssize_t cgroup_reader_pread(isula_cgroup_reader_t *reader, int fd)
+{
+    ssize_t n;
+    char *buf = NULL;
+
+    for (;;) {
+        n = pread(fd, reader->buf, reader->buf_size - 1, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 || (size_t)n < reader->buf_size - 1 || reader->buf_size >= CGROUP_METRICS_BUF_MAX) {
+            return n;
+        }
+        buf = isula_common_calloc_s(reader->buf_size * 2);
+        if (buf == NULL) {
+            return n;
+        }
+        free(reader->buf);
+        reader->buf = buf;
+        reader->buf_size *= 2;
+    }
+}
+
+int isula_cgroup_reader_read(isula_cgroup_reader_t *reader, struct isula_cgroup_metrics *metrics)
+{
+    const struct metrics_file *file = NULL;
+    ssize_t n;
+    size_t i;
+    int done_group = 0;
+
+    if (reader == NULL || metrics == NULL) {
+        ERROR("Invalid arguments");
+        return -1;
+    }
+
+    (void)memset(metrics, 0, sizeof(*metrics));
+    for (i = 0; i < reader->nfiles; i++) {
+        file = &reader->files[i];
+        if (reader->fds[i] < 0 || (file->group != 0 && file->group == done_group)) {
+            continue;
+        }
+        n = cgroup_reader_pread(reader, reader->fds[i]);
+        if (n < 0) {
+            // ENODEV once the cgroup is removed
+            SYSDEBUG("Failed to read cgroup file %s", file->name);
+            return -1;
+        }
+        if (file->parse(reader, file, reader->buf, reader->buf + n, metrics) && file->group != 0) {
+            done_group = file->group;
+        }
+    }
+
+    if (reader->files == g_v2_metrics_files) {
+        metrics->io_total_bytes = metrics->io_read_bytes + metrics->io_write_bytes;
+        metrics->io_total_ops = metrics->io_read_ops + metrics->io_write_ops;
+    }
+    return 0;
+}
+
+void isula_cgroup_reader_free(isula_cgroup_reader_t *reader)
+{
+    size_t i;
+
+    if (reader == NULL) {
+        return;
+    }
+    for (i = 0; i < CGROUP_METRICS_MAX_FILES; i++) {
+        if (reader->fds[i] >= 0) {
+            close(reader->fds[i]);
+        }
+    }
+    free(reader->buf);
+    free(reader);
+}
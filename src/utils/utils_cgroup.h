@@ -57,6 +57,66 @@ uint64_t lcr_util_trans_blkio_weight_to_io_weight(int weight);
 uint64_t lcr_util_trans_blkio_weight_to_io_bfq_weight(int weight);
 int lcr_util_get_cgroup_version(void);
 
+// metrics of one cgroup, times in nanoseconds, unlimited limits are 0
+struct isula_cgroup_metrics {
+    uint64_t cpu_use_nanos;
+    uint64_t cpu_use_user;
+    uint64_t cpu_use_sys;
+    uint64_t cpu_nr_periods;
+    uint64_t cpu_nr_throttled;
+    uint64_t cpu_throttled_nanos;
+
+    uint64_t pids_current;
+    uint64_t pids_limit;
+
+    uint64_t mem_used;
+    uint64_t mem_limit;
+    uint64_t kmem_used;
+    uint64_t kmem_limit;
+    uint64_t rss_bytes;
+    uint64_t page_faults;
+    uint64_t major_page_faults;
+    uint64_t cache;
+    uint64_t cache_total;
+    uint64_t inactive_file_total;
+
+    uint64_t io_read_bytes;
+    uint64_t io_write_bytes;
+    uint64_t io_total_bytes;
+    uint64_t io_read_ops;
+    uint64_t io_write_ops;
+    uint64_t io_total_ops;
+};
+
+typedef struct isula_cgroup_reader isula_cgroup_reader_t;
+
+// open the metrics files of the cgroups listed in proc_cgroup (a /proc/<pid>/cgroup file)
+// under mountpoint; the files stay open and are re-read in place on every read.
+// A path ending in init.scope, where a systemd init of the container moves itself,
+// is read from its parent, the cgroup of the whole container
+isula_cgroup_reader_t *isula_cgroup_reader_new(int version, const char *mountpoint, const char *proc_cgroup);
+
+// same for the cgroups of process pid on this host, version is the cgroup version
+// of the host as given by lcr_util_get_cgroup_version, 0 to detect it
+isula_cgroup_reader_t *isula_cgroup_reader_new_pid(int version, pid_t pid);
+
+// pid the reader was opened for, 0 if it was not opened by pid
+pid_t isula_cgroup_reader_pid(const isula_cgroup_reader_t *reader);
+
+// sample the metrics, fails once the cgroup is gone
+int isula_cgroup_reader_read(isula_cgroup_reader_t *reader, struct isula_cgroup_metrics *metrics);
+
+void isula_cgroup_reader_free(isula_cgroup_reader_t *reader);
+
+// cgroup version of this host as given by lcr_util_get_cgroup_version, detected once
+int isula_cgroup_host_version(void);
+
+// cgroup v1 cpuacct.stat clock ticks in nanoseconds
+uint64_t isula_cgroup_v1_ticks_to_nanos(uint64_t ticks);
+
+// cgroup v1 limit_in_bytes value, 0 for no limit as in struct isula_cgroup_metrics
+uint64_t isula_cgroup_v1_limit(uint64_t limit);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,208 @@
+/******************************************************************************
+ * isula: worker pool utils
+ *
+ * Copyright (c) Huawei Technologies Co., Ltd. 2023. All rights reserved.
+ *
+ * Authors:
+ * Haozi007 <liuhao27@huawei.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ********************************************************************************/
+#include "utils_workpool.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "utils_memory.h"
+
+struct isula_workpool {
+    pthread_mutex_t lock;
+    // signals a new run, or stop
+    pthread_cond_t work_cond;
+    // signals the last worker leaving a run
+    pthread_cond_t done_cond;
+    pthread_mutex_t run_lock;
+
+    pthread_t *threads;
+    size_t nthreads;
+    bool stop;
+
+    // the current run, workers join it under lock and count themselves in running
+    uint64_t generation;
+    size_t running;
+    isula_workpool_task_t task;
+    void *data;
+    size_t n;
+    size_t next;
+};
+
+static void workpool_drain(isula_workpool_t *pool, isula_workpool_task_t task, void *data, size_t n)
+{
+    size_t i;
+
+    for (;;) {
+        i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+        if (i >= n) {
+            return;
+        }
+        task(i, data);
+    }
+}
+
+static void *workpool_worker(void *arg)
+{
+    isula_workpool_t *pool = (isula_workpool_t *)arg;
+    uint64_t seen = 0;
+    isula_workpool_task_t task;
+    void *data;
+    size_t n;
+
+    (void)pthread_mutex_lock(&pool->lock);
+    for (;;) {
+        while (!pool->stop && pool->generation == seen) {
+            (void)pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        if (pool->stop) {
+            break;
+        }
+        seen = pool->generation;
+        task = pool->task;
+        data = pool->data;
+        n = pool->n;
+        pool->running++;
+        (void)pthread_mutex_unlock(&pool->lock);
+
+        workpool_drain(pool, task, data, n);
+
+        (void)pthread_mutex_lock(&pool->lock);
+        pool->running--;
+        if (pool->running == 0) {
+            (void)pthread_cond_broadcast(&pool->done_cond);
+        }
+    }
+    (void)pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+static void workpool_stop(isula_workpool_t *pool)
+{
+    size_t i;
+
+    (void)pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    (void)pthread_cond_broadcast(&pool->work_cond);
+    (void)pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->nthreads; i++) {
+        (void)pthread_join(pool->threads[i], NULL);
+    }
+    pool->nthreads = 0;
+}
+
+isula_workpool_t *isula_workpool_new(size_t nthreads)
+{
+    isula_workpool_t *pool = NULL;
+    sigset_t all, old;
+    long cpus;
+
+    if (nthreads == 0) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = cpus > 0 ? (size_t)cpus : 1;
+    }
+
+    pool = isula_common_calloc_s(sizeof(*pool));
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->threads = isula_smart_calloc_s(sizeof(pthread_t), nthreads);
+    if (pool->threads == NULL) {
+        free(pool);
+        return NULL;
+    }
+    (void)pthread_mutex_init(&pool->lock, NULL);
+    (void)pthread_mutex_init(&pool->run_lock, NULL);
+    (void)pthread_cond_init(&pool->work_cond, NULL);
+    (void)pthread_cond_init(&pool->done_cond, NULL);
+
+    // signals are for the threads of the caller, not for the workers
+    (void)sigfillset(&all);
+    (void)pthread_sigmask(SIG_SETMASK, &all, &old);
+    for (; pool->nthreads < nthreads; pool->nthreads++) {
+        if (pthread_create(&pool->threads[pool->nthreads], NULL, workpool_worker, pool) != 0) {
+            break;
+        }
+    }
+    (void)pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (pool->nthreads < nthreads) {
+        isula_workpool_free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+int isula_workpool_run(isula_workpool_t *pool, size_t n, isula_workpool_task_t task, void *data)
+{
+    if (pool == NULL || task == NULL) {
+        return -1;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    (void)pthread_mutex_lock(&pool->run_lock);
+    (void)pthread_mutex_lock(&pool->lock);
+    // a worker that joined the previous run late may still be claiming indexes
+    while (pool->running > 0) {
+        (void)pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    pool->task = task;
+    pool->data = data;
+    pool->n = n;
+    pool->next = 0;
+    pool->generation++;
+    (void)pthread_cond_broadcast(&pool->work_cond);
+    (void)pthread_mutex_unlock(&pool->lock);
+
+    workpool_drain(pool, task, data, n);
+
+    // every index is claimed, wait for the calls still running
+    (void)pthread_mutex_lock(&pool->lock);
+    while (pool->running > 0) {
+        (void)pthread_cond_wait(&pool->done_cond, &pool->lock);
+    }
+    (void)pthread_mutex_unlock(&pool->lock);
+    (void)pthread_mutex_unlock(&pool->run_lock);
+    return 0;
+}
+
+void isula_workpool_free(isula_workpool_t *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+
+    workpool_stop(pool);
+    (void)pthread_cond_destroy(&pool->work_cond);
+    (void)pthread_cond_destroy(&pool->done_cond);
+    (void)pthread_mutex_destroy(&pool->run_lock);
+    (void)pthread_mutex_destroy(&pool->lock);
+    free(pool->threads);
+    free(pool);
+}
@@ -0,0 +1,50 @@
+/******************************************************************************
+ * isula: worker pool utils
+ *
+ * Copyright (c) Huawei Technologies Co., Ltd. 2023. All rights reserved.
+ *
+ * Authors:
+ * Haozi007 <liuhao27@huawei.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ********************************************************************************/
+#ifndef _ISULA_UTILS_UTILS_WORKPOOL_H
+#define _ISULA_UTILS_UTILS_WORKPOOL_H
+
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void (*isula_workpool_task_t)(size_t index, void *data);
+
+typedef struct isula_workpool isula_workpool_t;
+
+// start nthreads workers, one per online cpu if nthreads is 0
+extern isula_workpool_t *isula_workpool_new(size_t nthreads);
+
+// call task(i, data) for every i below n on the workers and the calling thread,
+// returning once all calls are done; runs of one pool are serialized
+extern int isula_workpool_run(isula_workpool_t *pool, size_t n, isula_workpool_task_t task, void *data);
+
+// stop and join the workers
+extern void isula_workpool_free(isula_workpool_t *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,491 @@
+/******************************************************************************
+ * iSula-libutils: ut for lcrcontainer.c and lcrcontainer_stats.c
+ *
+ * Copyright (c) Huawei Technologies Co., Ltd. 2023. All rights reserved.
+ *
+ * Authors:
+ * Haozi007 <liuhao27@huawei.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ********************************************************************************/
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <lxc/lxccontainer.h>
+
+#include "lcrcontainer.h"
+#include "lcrcontainer_stats.h"
+
+// above the largest pid_max, so the cgroup reader fails and the states come from lxc
+#define FAKE_INIT_PID 999999999
+
+/*
+ * lxc is replaced by fake containers (linked with --wrap), their metrics are
+ * looked up by name in g_fakes.
+ */
+struct fake_config {
+    bool defined;
+    bool control;
+    pid_t init;
+    uint64_t cpu_use_nanos;
+    // added to the cpu time on each metrics call
+    uint64_t cpu_step;
+    size_t metrics_calls;
+};
+
+struct fake_container {
+    struct lxc_container c;
+    int refs;
+};
+
+static std::mutex g_fake_lock;
+static std::map<std::string, fake_config> g_fakes;
+static int g_live_containers;
+static size_t g_new_containers;
+
+static void fake_register(const std::string &name, pid_t init, uint64_t cpu_use_nanos, uint64_t cpu_step = 0)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    g_fakes[name] = fake_config { true, true, init, cpu_use_nanos, cpu_step, 0 };
+}
+
+static fake_config &fake_lookup(struct lxc_container *c)
+{
+    return g_fakes.at(c->name);
+}
+
+static bool fake_is_defined(struct lxc_container *c)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    return fake_lookup(c).defined;
+}
+
+static bool fake_may_control(struct lxc_container *c)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    return fake_lookup(c).control;
+}
+
+static pid_t fake_init_pid(struct lxc_container *c)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    return fake_lookup(c).init > 0 ? fake_lookup(c).init : -1;
+}
+
+static const char *fake_state(struct lxc_container *c)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    return fake_lookup(c).init > 0 ? "RUNNING" : "STOPPED";
+}
+
+static bool fake_get_container_metrics(struct lxc_container *c, struct lxc_container_metrics *metrics)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    fake_config &config = fake_lookup(c);
+
+    config.metrics_calls++;
+    config.cpu_use_nanos += config.cpu_step;
+    metrics->state = config.init > 0 ? "RUNNING" : "STOPPED";
+    metrics->init = config.init > 0 ? config.init : -1;
+    metrics->cpu_use_nanos = config.cpu_use_nanos;
+    return true;
+}
+
+extern "C" {
+struct lxc_container *__wrap_lxc_container_new(const char *name, const char *configpath);
+int __wrap_lxc_container_get(struct lxc_container *c);
+int __wrap_lxc_container_put(struct lxc_container *c);
+}
+
+struct lxc_container *__wrap_lxc_container_new(const char *name, const char *configpath)
+{
+    struct fake_container *fake = nullptr;
+
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    if (name == nullptr || g_fakes.count(name) == 0) {
+        return nullptr;
+    }
+    fake = (struct fake_container *)calloc(1, sizeof(*fake));
+    if (fake == nullptr) {
+        return nullptr;
+    }
+    fake->c.name = strdup(name);
+    fake->c.is_defined = fake_is_defined;
+    fake->c.may_control = fake_may_control;
+    fake->c.init_pid = fake_init_pid;
+    fake->c.state = fake_state;
+    fake->c.get_container_metrics = fake_get_container_metrics;
+    fake->refs = 1;
+    g_live_containers++;
+    g_new_containers++;
+    return &fake->c;
+}
+
+int __wrap_lxc_container_get(struct lxc_container *c)
+{
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    ((struct fake_container *)c)->refs++;
+    return 1;
+}
+
+int __wrap_lxc_container_put(struct lxc_container *c)
+{
+    struct fake_container *fake = (struct fake_container *)c;
+
+    if (c == nullptr) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> guard(g_fake_lock);
+    if (--fake->refs > 0) {
+        return 0;
+    }
+    free(c->name);
+    free(fake);
+    g_live_containers--;
+    return 1;
+}
+
+class lcrcontainer_testcase : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        char tmpl[] = "/tmp/lcrcontainer_ut_XXXXXX";
+
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        lcrpath = tmpl;
+        std::lock_guard<std::mutex> guard(g_fake_lock);
+        g_fakes.clear();
+        g_live_containers = 0;
+        g_new_containers = 0;
+    }
+
+    void TearDown() override
+    {
+        for (const std::string &name : dirs) {
+            (void)unlink((lcrpath + "/" + name + "/config").c_str());
+            (void)rmdir((lcrpath + "/" + name).c_str());
+        }
+        EXPECT_EQ(rmdir(lcrpath.c_str()), 0);
+        EXPECT_EQ(g_live_containers, 0);
+    }
+
+    void write_config(const std::string &name, const std::string &content)
+    {
+        std::string dir = lcrpath + "/" + name;
+        FILE *fp = nullptr;
+
+        (void)mkdir(dir.c_str(), 0700);
+        dirs.push_back(name);
+        fp = fopen((dir + "/config").c_str(), "w");
+        ASSERT_NE(fp, nullptr);
+        ASSERT_EQ(fwrite(content.data(), 1, content.size(), fp), content.size());
+        ASSERT_EQ(fclose(fp), 0);
+    }
+
+    std::string lcrpath;
+    std::vector<std::string> dirs;
+};
+
+TEST(lcrcontainer_stats_testcase, test_lcr_stats_compute)
+{
+    struct lcr_container_state prev = { 0 };
+    struct lcr_container_state cur = { 0 };
+    struct lcr_container_stats stats = { 0 };
+
+    prev.init = 100;
+    prev.cpu_use_nanos = 1000000000;
+    prev.cpu_use_user = 200000000;
+    prev.cpu_use_sys = 100000000;
+    prev.cpu_throttled_nanos = 5000;
+    prev.io_service_bytes = { 4096, 0, 4096 };
+    prev.io_serviced = { 10, 5, 15 };
+    prev.page_faults = 100;
+    prev.major_page_faults = 1;
+
+    cur = prev;
+    cur.cpu_use_nanos = 1500000000;
+    cur.cpu_use_user = 450000000;
+    cur.cpu_use_sys = 200000000;
+    cur.cpu_throttled_nanos = 8000;
+    cur.io_service_bytes = { 12288, 1048576, 1060864 };
+    cur.io_serviced = { 30, 15, 45 };
+    cur.page_faults = 300;
+    cur.major_page_faults = 3;
+
+    // half a second with half a second of cpu is one full cpu
+    ASSERT_TRUE(lcr_stats_compute(&prev, &cur, 500000000, &stats));
+    EXPECT_EQ(stats.interval_nanos, 500000000);
+    EXPECT_EQ(stats.cpu_use_nanos, 500000000);
+    EXPECT_EQ(stats.cpu_use_user, 250000000);
+    EXPECT_EQ(stats.cpu_use_sys, 100000000);
+    EXPECT_EQ(stats.cpu_throttled_nanos, 3000);
+    EXPECT_EQ(stats.io_service_bytes.read, 8192);
+    EXPECT_EQ(stats.io_service_bytes.write, 1048576);
+    EXPECT_EQ(stats.io_service_bytes.total, 1056768);
+    EXPECT_EQ(stats.io_serviced.read, 20);
+    EXPECT_EQ(stats.io_serviced.write, 10);
+    EXPECT_EQ(stats.io_serviced.total, 30);
+    EXPECT_EQ(stats.page_faults, 200);
+    EXPECT_EQ(stats.major_page_faults, 2);
+    EXPECT_DOUBLE_EQ(stats.cpu_percent, 100.0);
+    EXPECT_DOUBLE_EQ(stats.cpu_user_percent, 50.0);
+    EXPECT_DOUBLE_EQ(stats.cpu_sys_percent, 20.0);
+    EXPECT_DOUBLE_EQ(stats.read_bytes_per_sec, 16384.0);
+    EXPECT_DOUBLE_EQ(stats.write_bytes_per_sec, 2097152.0);
+    EXPECT_DOUBLE_EQ(stats.read_iops, 40.0);
+    EXPECT_DOUBLE_EQ(stats.write_iops, 20.0);
+    EXPECT_DOUBLE_EQ(stats.page_faults_per_sec, 400.0);
+    EXPECT_DOUBLE_EQ(stats.major_page_faults_per_sec, 4.0);
+
+    // an idle container has zero rates
+    ASSERT_TRUE(lcr_stats_compute(&cur, &cur, 1000000000, &stats));
+    EXPECT_EQ(stats.cpu_use_nanos, 0);
+    EXPECT_DOUBLE_EQ(stats.cpu_percent, 0.0);
+    EXPECT_DOUBLE_EQ(stats.read_bytes_per_sec, 0.0);
+
+    // the first sample of a container has no interval
+    EXPECT_FALSE(lcr_stats_compute(&prev, &cur, 0, &stats));
+
+    // stopped
+    cur.init = 0;
+    EXPECT_FALSE(lcr_stats_compute(&prev, &cur, 500000000, &stats));
+    cur.init = -1;
+    EXPECT_FALSE(lcr_stats_compute(&prev, &cur, 500000000, &stats));
+
+    // restarted, the counters are of another run
+    cur.init = 101;
+    EXPECT_FALSE(lcr_stats_compute(&prev, &cur, 500000000, &stats));
+    cur.init = prev.init;
+    ASSERT_TRUE(lcr_stats_compute(&prev, &cur, 500000000, &stats));
+
+    // a counter going back means the cgroup was recreated
+    struct lcr_container_state reset = cur;
+    reset.cpu_use_nanos = prev.cpu_use_nanos - 1;
+    EXPECT_FALSE(lcr_stats_compute(&prev, &reset, 500000000, &stats));
+    reset = cur;
+    reset.io_serviced.write = prev.io_serviced.write - 1;
+    EXPECT_FALSE(lcr_stats_compute(&prev, &reset, 500000000, &stats));
+    reset = cur;
+    reset.io_service_bytes.total = 0;
+    EXPECT_FALSE(lcr_stats_compute(&prev, &reset, 500000000, &stats));
+    reset = cur;
+    reset.major_page_faults = 0;
+    EXPECT_FALSE(lcr_stats_compute(&prev, &reset, 500000000, &stats));
+}
+
+TEST_F(lcrcontainer_testcase, test_lcr_state_batch)
+{
+    const size_t n = 64;
+    std::vector<std::string> storage(n);
+    std::vector<const char *> names(n);
+    std::vector<struct lcr_container_state> out(n);
+    bool success[n];
+
+    for (size_t i = 0; i < n; i++) {
+        storage[i] = "c" + std::to_string(i);
+        fake_register(storage[i], FAKE_INIT_PID, i * 1000 + 1);
+        names[i] = storage[i].c_str();
+    }
+    // failures of single containers do not stop the others
+    g_fakes["c5"].defined = false;
+    g_fakes["c9"].control = false;
+    names[13] = "missing";
+    names[20] = nullptr;
+
+    // the results are in the order of the names, with any number of threads
+    for (size_t nthreads : { (size_t)1, (size_t)4, (size_t)0, (size_t)100 }) {
+        ASSERT_FALSE(lcr_state_batch(names.data(), n, lcrpath.c_str(), out.data(), success, nthreads));
+        EXPECT_STREQ(lcr_get_errmsg(), "Failed to get state of 4 of 64 containers");
+        for (size_t i = 0; i < n; i++) {
+            if (i == 5 || i == 9 || i == 13 || i == 20) {
+                EXPECT_FALSE(success[i]);
+                EXPECT_EQ(out[i].name, nullptr);
+                continue;
+            }
+            EXPECT_TRUE(success[i]);
+            EXPECT_STREQ(out[i].name, names[i]);
+            EXPECT_STREQ(out[i].state, "RUNNING");
+            EXPECT_EQ(out[i].init, FAKE_INIT_PID);
+            EXPECT_EQ(out[i].cpu_use_nanos, i * 1000 + 1);
+        }
+        for (size_t i = 0; i < n; i++) {
+            lcr_container_state_free(&out[i]);
+        }
+        EXPECT_EQ(g_live_containers, 0);
+    }
+
+    names[5] = "c6";
+    names[9] = "c10";
+    names[13] = "c14";
+    names[20] = "c21";
+    g_fakes["c5"].defined = true;
+    ASSERT_TRUE(lcr_state_batch(names.data(), n, lcrpath.c_str(), out.data(), success, 4));
+    for (size_t i = 0; i < n; i++) {
+        EXPECT_TRUE(success[i]);
+        EXPECT_STREQ(out[i].name, names[i]);
+        lcr_container_state_free(&out[i]);
+    }
+
+    // the states are cleared even when the batch fails as a whole
+    out[0].init = 1;
+    success[0] = true;
+    std::string missing_path = lcrpath + "/nonexistent";
+    ASSERT_FALSE(lcr_state_batch(names.data(), n, missing_path.c_str(), out.data(), success, 4));
+    EXPECT_EQ(std::string(lcr_get_errmsg()), "Invalid lcr path: " + missing_path);
+    EXPECT_EQ(out[0].init, 0);
+    EXPECT_FALSE(success[0]);
+    // the missing name and the NULL one load nothing
+    EXPECT_EQ(g_new_containers, 4 * (n - 2) + n);
+
+    EXPECT_TRUE(lcr_state_batch(names.data(), 0, lcrpath.c_str(), out.data(), success, 4));
+    EXPECT_FALSE(lcr_state_batch(nullptr, n, lcrpath.c_str(), out.data(), success, 4));
+    EXPECT_FALSE(lcr_state_batch(names.data(), n, lcrpath.c_str(), nullptr, success, 4));
+    EXPECT_FALSE(lcr_state_batch(names.data(), n, lcrpath.c_str(), out.data(), nullptr, 4));
+}
+
+TEST_F(lcrcontainer_testcase, test_lcr_handle)
+{
+    struct lcr_container_state state = { 0 };
+    lcr_handle_t *handle = nullptr;
+
+    fake_register("h", FAKE_INIT_PID, 42);
+    write_config("h", "lxc.uts.name = h\n");
+
+    handle = lcr_open("h", lcrpath.c_str());
+    ASSERT_NE(handle, nullptr);
+    EXPECT_EQ(g_new_containers, 1);
+
+    // the container is loaded once while its config is the same
+    for (int i = 0; i < 3; i++) {
+        ASSERT_TRUE(lcr_handle_state(handle, &state));
+        EXPECT_STREQ(state.name, "h");
+        EXPECT_STREQ(state.state, "RUNNING");
+        EXPECT_EQ(state.cpu_use_nanos, 42);
+        lcr_container_state_free(&state);
+    }
+    EXPECT_EQ(g_new_containers, 1);
+    EXPECT_EQ(g_live_containers, 1);
+
+    // and reloaded after the config changed
+    write_config("h", "lxc.uts.name = h2\n");
+    ASSERT_TRUE(lcr_handle_state(handle, &state));
+    lcr_container_state_free(&state);
+    EXPECT_EQ(g_new_containers, 2);
+    EXPECT_EQ(g_live_containers, 1);
+    ASSERT_TRUE(lcr_handle_state(handle, &state));
+    lcr_container_state_free(&state);
+    EXPECT_EQ(g_new_containers, 2);
+
+    // without a config file there is no version to compare, every call reloads
+    ASSERT_EQ(unlink((lcrpath + "/h/config").c_str()), 0);
+    ASSERT_TRUE(lcr_handle_state(handle, &state));
+    lcr_container_state_free(&state);
+    ASSERT_TRUE(lcr_handle_state(handle, &state));
+    lcr_container_state_free(&state);
+    EXPECT_EQ(g_new_containers, 4);
+
+    g_fakes["h"].defined = false;
+    EXPECT_FALSE(lcr_handle_state(handle, &state));
+    lcr_container_state_free(&state);
+    g_fakes["h"].defined = true;
+
+    // the container lives until the last reference is closed
+    EXPECT_EQ(lcr_handle_get(handle), handle);
+    lcr_close(handle);
+    EXPECT_EQ(g_live_containers, 1);
+    lcr_close(handle);
+    EXPECT_EQ(g_live_containers, 0);
+
+    EXPECT_EQ(lcr_open("missing", lcrpath.c_str()), nullptr);
+    EXPECT_EQ(lcr_open(nullptr, lcrpath.c_str()), nullptr);
+    EXPECT_FALSE(lcr_handle_state(nullptr, &state));
+    lcr_close(nullptr);
+}
+
+struct stats_record {
+    std::mutex lock;
+    std::map<std::string, size_t> calls;
+    struct lcr_container_stats last;
+    bool state_matches { true };
+};
+
+static void record_stats(const struct lcr_container_stats *stats, void *data)
+{
+    struct stats_record *record = (struct stats_record *)data;
+
+    std::lock_guard<std::mutex> guard(record->lock);
+    record->calls[stats->name]++;
+    record->last = *stats;
+    record->last.state = nullptr;
+    if (stats->state == nullptr || strcmp(stats->state->name, stats->name) != 0) {
+        record->state_matches = false;
+    }
+}
+
+TEST_F(lcrcontainer_testcase, test_lcr_stats_subscribe)
+{
+    const char *names[] = { "running", "stopped" };
+    struct stats_record record;
+    lcr_stats_subscription_t *sub = nullptr;
+    size_t running_calls = 0;
+
+    fake_register("running", FAKE_INIT_PID, 0, 1000000);
+    fake_register("stopped", 0, 0);
+
+    sub = lcr_stats_subscribe(names, 2, lcrpath.c_str(), 5, record_stats, &record);
+    ASSERT_NE(sub, nullptr);
+    for (int i = 0; i < 500; i++) {
+        {
+            std::lock_guard<std::mutex> guard(record.lock);
+            if (record.calls["running"] >= 3) {
+                break;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    lcr_stats_unsubscribe(sub);
+
+    {
+        std::lock_guard<std::mutex> guard(g_fake_lock);
+        running_calls = g_fakes["running"].metrics_calls;
+    }
+    // the first sample only primes the next one, a stopped container is never reported
+    EXPECT_GE(record.calls["running"], 3);
+    EXPECT_EQ(record.calls["running"], running_calls - 1);
+    EXPECT_EQ(record.calls["stopped"], 0);
+    EXPECT_TRUE(record.state_matches);
+    EXPECT_EQ(record.last.cpu_use_nanos, 1000000);
+    EXPECT_GT(record.last.interval_nanos, 0);
+    EXPECT_GT(record.last.cpu_percent, 0.0);
+
+    const char *missing[] = { "running", "missing" };
+    EXPECT_EQ(lcr_stats_subscribe(missing, 2, lcrpath.c_str(), 5, record_stats, &record), nullptr);
+    EXPECT_EQ(lcr_stats_subscribe(names, 0, lcrpath.c_str(), 5, record_stats, &record), nullptr);
+    EXPECT_EQ(lcr_stats_subscribe(names, 2, lcrpath.c_str(), 0, record_stats, &record), nullptr);
+    EXPECT_EQ(lcr_stats_subscribe(names, 2, lcrpath.c_str(), 5, nullptr, &record), nullptr);
+    lcr_stats_unsubscribe(nullptr);
+}
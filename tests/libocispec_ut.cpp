@@ -22,13 +22,37 @@
  ********************************************************************************/
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <iostream>
+#include <random>
+#include <string>
+#include <vector>
 
+#include <fcntl.h>
+#include <limits.h>
+#include <ftw.h>
+#include <stddef.h>
 #include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
 #include <unistd.h>
 
+#include "cdi_hook.h"
+#include "cni_array_of_strings.h"
+#include "cni_cached_info.h"
+#include "cni_ip_ranges_array.h"
+#include "cni_net_conf.h"
+#include "container_version_request.h"
+#include "defs_process.h"
+#include "isulad_daemon_configs.h"
+#include "json_desc.h"
+#include "json_simd.h"
+#include "logger_json_file.h"
 #include "oci_runtime_hooks.h"
+#include "oci_runtime_spec.h"
 #include "read_file.h"
+#include "utils_buffer.h"
+#include "utils_mainloop.h"
 
 TEST(libocispec_testcase, test_oci_runtime_spec_hooks) {
   const char *fname = "./ocihook.json";
@@ -98,3 +122,2174 @@ TEST(libocispec_testcase, test_json_readfile) {
   jstr = read_file(nullptr, nullptr);
   ASSERT_EQ(jstr, nullptr);
 }
+
+TEST(libocispec_testcase, test_parse_field_dispatch) {
+  const char *data = "{\"hookName\": \"prestart\", \"path\": \"first.sh\", \"timeout\": \"1\", \"path\": \"second.sh\", "
+                     "\"args\": [\"a\", \"b\"], \"unknown\": {\"k\": [1, 2]}, \"pat\": 1}";
+  struct parser_context ctx = { OPT_PARSE_FULLKEY | OPT_GEN_SIMPLIFY, stderr };
+  cdi_hook *hook = nullptr;
+  parser_error jerr = nullptr;
+  char *jstr = nullptr;
+
+  hook = cdi_hook_parse_data(data, &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr) << "parse hook failed: " << jerr;
+  ASSERT_NE(hook, nullptr);
+  EXPECT_STREQ(hook->path, "first.sh");
+  // mistyped values are ignored like missing keys
+  EXPECT_EQ(hook->timeout, 0);
+  ASSERT_EQ(hook->args_len, 2);
+  EXPECT_STREQ(hook->args[1], "b");
+  // the unknown keys are kept as compact json text
+  EXPECT_STREQ(hook->_residual, "\"unknown\":{\"k\":[1,2]},\"pat\":1");
+
+  jstr = cdi_hook_generate_json(hook, &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  EXPECT_STREQ(jstr, "{\"hookName\":\"prestart\",\"path\":\"first.sh\",\"args\":[\"a\",\"b\"],\"unknown\":{\"k\":[1,2]},\"pat\":1}");
+
+  free_cdi_hook(hook);
+  free(jstr);
+}
+
+template <typename T>
+static void expect_same_parse(T *(*parse)(const char *, const struct parser_context *, parser_error *),
+                              char *(*generate)(const T *, const struct parser_context *, parser_error *),
+                              void (*release)(T *), const char *data)
+{
+  struct parser_context tree_ctx = { OPT_GEN_SIMPLIFY, stderr };
+  struct parser_context stream_ctx = { OPT_GEN_SIMPLIFY | OPT_PARSE_STREAM, stderr };
+  parser_error tree_err = nullptr;
+  parser_error stream_err = nullptr;
+  T *tree_ptr = parse(data, &tree_ctx, &tree_err);
+  T *stream_ptr = parse(data, &stream_ctx, &stream_err);
+
+  EXPECT_EQ(tree_err == nullptr, stream_err == nullptr) << data << ": " << (tree_err ? tree_err : stream_err);
+  EXPECT_EQ(tree_ptr == nullptr, stream_ptr == nullptr) << data;
+  if (tree_ptr != nullptr && stream_ptr != nullptr) {
+    parser_error gen_err = nullptr;
+    char *tree_json = generate(tree_ptr, &tree_ctx, &gen_err);
+    ASSERT_EQ(gen_err, nullptr);
+    char *stream_json = generate(stream_ptr, &tree_ctx, &gen_err);
+    ASSERT_EQ(gen_err, nullptr);
+    EXPECT_STREQ(tree_json, stream_json) << data;
+    free(tree_json);
+    free(stream_json);
+  }
+  release(tree_ptr);
+  release(stream_ptr);
+  free(tree_err);
+  free(stream_err);
+}
+
+TEST(libocispec_testcase, test_parse_stream) {
+  const char *spec = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"box\", "
+                     "\"process\": {\"terminal\": true, \"user\": {\"uid\": 1, \"gid\": 2, \"additionalGids\": [3, 4]}, "
+                     "\"args\": [\"sh\", \"-c\"], \"env\": [], \"cwd\": \"/\", \"noNewPrivileges\": false, "
+                     "\"capabilities\": {\"bounding\": [\"CAP_KILL\"]}, \"rlimits\": [{\"type\": \"RLIMIT_NOFILE\", \"hard\": 1024, \"soft\": 1024}]}, "
+                     "\"root\": {\"path\": \"rootfs\", \"readonly\": true}, "
+                     "\"mounts\": [{\"destination\": \"/proc\", \"type\": \"proc\", \"source\": \"proc\", \"options\": [\"nosuid\", \"noexec\"]}], "
+                     "\"hooks\": {\"prestart\": [{\"path\": \"/bin/true\", \"args\": [\"true\"], \"timeout\": 5}]}, "
+                     "\"annotations\": {\"a\": \"1\", \"b\": \"2\", \"a\": \"3\"}, "
+                     "\"linux\": {\"uidMappings\": [{\"containerID\": 0, \"hostID\": 1000, \"size\": 65536}], "
+                     "\"sysctl\": {\"net.ipv4.ip_forward\": \"1\"}, "
+                     "\"resources\": {\"memory\": {\"limit\": 1048576, \"swappiness\": 10}, \"cpu\": {\"shares\": 1024, \"cpus\": \"0-1\"}, "
+                     "\"devices\": [{\"allow\": false, \"access\": \"rwm\"}]}, "
+                     "\"seccomp\": {\"defaultAction\": \"SCMP_ACT_ERRNO\", \"architectures\": [\"SCMP_ARCH_X86_64\"], "
+                     "\"syscalls\": [{\"names\": [\"clone\"], \"action\": \"SCMP_ACT_ALLOW\", \"args\": [{\"index\": 0, \"value\": 2114060288, \"op\": \"SCMP_CMP_MASKED_EQ\"}]}]}, "
+                     "\"namespaces\": [{\"type\": \"pid\"}, {\"type\": \"mount\", \"path\": \"\"}], \"maskedPaths\": [\"/proc/kcore\"]}}";
+  const char *daemon = "{\"log-opts\": {\"max-size\": \"30KB\"}, \"default-ulimits\": {\"nofile\": {\"Name\": \"nofile\", \"Hard\": 64, \"Soft\": 32}}, "
+                       "\"cri-sandboxers\": {}, \"hosts\": [\"unix:///var/run/isulad.sock\"], \"selinux-enabled\": true, \"unknown\": [1, {\"x\": null}]}";
+  char *content = nullptr;
+  size_t len = 0;
+
+  content = read_file("./ocihook.json", &len);
+  ASSERT_NE(content, nullptr);
+  std::string hooks_spec = std::string("{\"ociVersion\": \"1.0.2\", \"hooks\": ") + content + "}";
+  expect_same_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec, hooks_spec.c_str());
+  free(content);
+  content = read_file("./process.json", &len);
+  ASSERT_NE(content, nullptr);
+  expect_same_parse(defs_process_parse_data, defs_process_generate_json, free_defs_process, content);
+  free(content);
+
+  expect_same_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec, spec);
+  expect_same_parse(isulad_daemon_configs_parse_data, isulad_daemon_configs_generate_json, free_isulad_daemon_configs, daemon);
+  expect_same_parse(cni_net_conf_parse_data, cni_net_conf_generate_json, free_cni_net_conf,
+                    "{\"cniVersion\": \"1.0.0\", \"name\": \"net\", \"type\": \"bridge\", \"capabilities\": {\"portMappings\": true}}");
+  expect_same_parse(cni_ip_ranges_array_container_parse_data, cni_ip_ranges_array_container_generate_json,
+                    free_cni_ip_ranges_array_container, "[[{\"subnet\": \"10.1.0.0/16\"}, {\"subnet\": \"10.2.0.0/16\"}], []]");
+  expect_same_parse(cni_array_of_strings_container_parse_data, cni_array_of_strings_container_generate_json,
+                    free_cni_array_of_strings_container, "[\"a\", 1, null, {\"b\": 2}, [\"c\"]]");
+
+  // mistyped, duplicated and unknown keys, non-object elements and empty containers
+  expect_same_parse(cdi_hook_parse_data, cdi_hook_generate_json, free_cdi_hook,
+                    "/* comment */ {\"hookName\": \"a\", \"path\": null, \"path\": \"p\", \"args\": [\"x\", 1, [2], {}], \"env\": \"e\", \"timeout\": true}");
+  expect_same_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec,
+                    "{\"ociVersion\": \"1\", \"hooks\": {\"prestart\": [{\"path\": \"a\", \"path\": 2}], \"poststart\": [], \"poststop\": {}}}");
+  expect_same_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec, "[1, 2]");
+  expect_same_parse(cni_ip_ranges_array_container_parse_data, cni_ip_ranges_array_container_generate_json,
+                    free_cni_ip_ranges_array_container, "[]");
+  expect_same_parse(cni_ip_ranges_array_container_parse_data, cni_ip_ranges_array_container_generate_json,
+                    free_cni_ip_ranges_array_container, "{}");
+
+  // errors
+  expect_same_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec,
+                    "{\"ociVersion\": \"1\", \"hooks\": {\"prestart\": [{\"path\": \"a\"}, 1]}}");
+  expect_same_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec,
+                    "{\"ociVersion\": \"1\", \"hooks\": {\"prestart\": [{\"path\": \"a\", \"timeout\": 1.5}]}}");
+  expect_same_parse(isulad_daemon_configs_parse_data, isulad_daemon_configs_generate_json, free_isulad_daemon_configs,
+                    "{\"log-opts\": {\"a\": \"b\", \"c\": 1}}");
+  expect_same_parse(isulad_daemon_configs_parse_data, isulad_daemon_configs_generate_json, free_isulad_daemon_configs,
+                    "{\"default-ulimits\": {\"nofile\": {\"Name\": \"nofile\"}}}");
+  expect_same_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec,
+                    "{\"ociVersion\": \"1.0.2\", \"process\": {\"args\": [\"sh\"], \"cwd\": \"/\", \"user\": {\"additionalGids\": [1, \"x\"]}}}");
+  expect_same_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec,
+                    "{\"ociVersion\": \"1.0.2\", \"mounts\": [{\"destination\": \"/a\"");
+}
+
+TEST(libocispec_testcase, test_parse_stream_error) {
+  struct parser_context ctx = { OPT_PARSE_STREAM, stderr };
+  parser_error jerr = nullptr;
+  oci_runtime_spec *spec = nullptr;
+
+  spec = oci_runtime_spec_parse_data("{\"ociVersion\": \"1\", \"hooks\": {\"poststop\": [{\"args\": [\"a\"]}]}}", &ctx, &jerr);
+  EXPECT_EQ(spec, nullptr);
+  EXPECT_STREQ(jerr, "Required field 'path' not present");
+  free(jerr);
+  jerr = nullptr;
+
+  spec = oci_runtime_spec_parse_data("{\"ociVersion\": \"1\", \"hooks\": {\"prestart\": "
+                                     "[{\"path\": \"a\", \"timeout\": \"1\", \"timeout\": 2}]}}", &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  ASSERT_NE(spec, nullptr);
+  ASSERT_NE(spec->hooks, nullptr);
+  ASSERT_EQ(spec->hooks->prestart_len, 1);
+  EXPECT_EQ(spec->hooks->prestart[0]->timeout, 0);
+  free_oci_runtime_spec(spec);
+
+  oci_runtime_spec_hooks *hooks = oci_runtime_spec_hooks_parse_file("./ocihook.json", &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  ASSERT_NE(hooks, nullptr);
+  ASSERT_EQ(hooks->poststop_len, 1);
+  EXPECT_STREQ(hooks->poststop[0]->path, "poststop.sh");
+  free_oci_runtime_spec_hooks(hooks);
+}
+
+TEST(libocispec_testcase, test_parse_arena) {
+  const char *data = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"box\", \"x-unknown\": {\"a\": [1, 2]}, "
+                     "\"process\": {\"args\": [\"sh\", \"-c\", \"a rather long argument that does not fit in a small chunk\"], "
+                     "\"cwd\": \"/\", \"user\": {\"uid\": 0, \"gid\": 0, \"additionalGids\": [1, 2]}}, "
+                     "\"annotations\": {\"a\": \"1\", \"b\": \"2\"}, \"mounts\": [{\"destination\": \"/proc\", \"options\": [\"ro\"]}], "
+                     "\"linux\": {\"resources\": {\"memory\": {\"limit\": 1024}}, \"sysctl\": {\"k\": \"v\"}}}";
+  const unsigned int options[] = { OPT_GEN_SIMPLIFY, OPT_GEN_SIMPLIFY | OPT_PARSE_STREAM,
+                                   OPT_GEN_SIMPLIFY | OPT_PARSE_FULLKEY };
+  struct parser_context heap_ctx = { OPT_GEN_SIMPLIFY | OPT_PARSE_FULLKEY, stderr };
+  parser_error jerr = nullptr;
+  oci_runtime_spec *expect = oci_runtime_spec_parse_data(data, &heap_ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  ASSERT_NE(expect, nullptr);
+  EXPECT_FALSE(json_arena_owns(expect));
+
+  for (size_t chunk_size : { (size_t)0, (size_t)64 }) {
+    struct json_arena *arena = json_arena_new(chunk_size);
+    ASSERT_NE(arena, nullptr);
+    for (unsigned int opt : options) {
+      struct parser_context ctx = { opt, stderr, arena };
+      oci_runtime_spec *spec = oci_runtime_spec_parse_data(data, &ctx, &jerr);
+      ASSERT_EQ(jerr, nullptr);
+      ASSERT_NE(spec, nullptr);
+      EXPECT_TRUE(json_arena_owns(spec));
+      EXPECT_TRUE(json_arena_owns(spec->process->args[2]));
+      EXPECT_TRUE(json_arena_owns(spec->annotations->keys));
+      EXPECT_FALSE(json_arena_owns(expect->process));
+
+      struct parser_context gen_ctx = { opt & ~OPT_PARSE_STREAM, stderr };
+      char *expect_json = oci_runtime_spec_generate_json(expect, &gen_ctx, &jerr);
+      ASSERT_EQ(jerr, nullptr);
+      char *json = oci_runtime_spec_generate_json(spec, &gen_ctx, &jerr);
+      ASSERT_EQ(jerr, nullptr);
+      if (opt & OPT_PARSE_FULLKEY) {
+        EXPECT_STREQ(json, expect_json);
+      }
+      free(expect_json);
+      free(json);
+
+      // left to the arena
+      free_oci_runtime_spec(spec);
+      json_arena_reset(arena);
+    }
+
+    // failed parses leave their leftovers in the arena as well
+    struct parser_context ctx = { OPT_PARSE_STREAM, stderr, arena };
+    EXPECT_EQ(oci_runtime_spec_parse_data("{\"ociVersion\": \"1\", \"process\": {\"args\": [\"a\", 1", &ctx, &jerr), nullptr);
+    EXPECT_NE(jerr, nullptr);
+    free(jerr);
+    jerr = nullptr;
+    ctx.options = 0;
+    EXPECT_EQ(isulad_daemon_configs_parse_data("{\"log-opts\": {\"a\": \"b\", \"c\": 1}}", &ctx, &jerr), nullptr);
+    EXPECT_NE(jerr, nullptr);
+    free(jerr);
+    jerr = nullptr;
+    json_arena_free(arena);
+  }
+  free_oci_runtime_spec(expect);
+
+  // ownership among many live arenas and chunks, up to the last byte of each
+  std::vector<struct json_arena *> arenas;
+  std::vector<char *> blocks;
+  for (size_t i = 0; i < 300; i++) {
+    struct json_arena *arena = json_arena_new(64);
+    ASSERT_NE(arena, nullptr);
+    arenas.push_back(arena);
+    for (size_t size : { (size_t)16, (size_t)48, (size_t)4096 }) {
+      char *block = (char *)json_arena_alloc(arena, size);
+      ASSERT_NE(block, nullptr);
+      blocks.push_back(block);
+      EXPECT_TRUE(json_arena_owns(block + size - 1));
+    }
+  }
+  char *heap = (char *)malloc(64);
+  EXPECT_FALSE(json_arena_owns(heap));
+  for (char *block : blocks) {
+    EXPECT_TRUE(json_arena_owns(block));
+  }
+  for (size_t i = 0; i < arenas.size(); i += 2) {
+    json_arena_free(arenas[i]);
+  }
+  for (size_t i = 0; i < blocks.size(); i++) {
+    EXPECT_EQ(json_arena_owns(blocks[i]), (i / 3) % 2 == 1);
+  }
+  for (size_t i = 1; i < arenas.size(); i += 2) {
+    json_arena_free(arenas[i]);
+  }
+  EXPECT_FALSE(json_arena_owns(blocks.back()));
+  free(heap);
+}
+
+TEST(libocispec_testcase, test_parse_insitu) {
+  const char *data = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"quote\\\"d \\u00e9\", \"x-unknown\": \"y\", "
+                     "\"process\": {\"args\": [\"sh\", \"-c\", \"echo\\tok\"], \"env\": [\"PATH=/bin\"], \"cwd\": \"/\", "
+                     "\"user\": {\"uid\": 0, \"gid\": 0}}, \"annotations\": {\"a\": \"1\", \"b\\n\": \"2\"}, "
+                     "\"mounts\": [{\"destination\": \"/proc\", \"options\": [\"ro\", \"nosuid\"]}]}";
+  parser_error jerr = nullptr;
+
+  for (unsigned int opt : { (unsigned int)OPT_GEN_SIMPLIFY, (unsigned int)(OPT_GEN_SIMPLIFY | OPT_PARSE_FULLKEY) }) {
+    struct parser_context ctx = { opt, stderr };
+    oci_runtime_spec *expect = oci_runtime_spec_parse_data(data, &ctx, &jerr);
+    ASSERT_EQ(jerr, nullptr);
+    char *expect_json = oci_runtime_spec_generate_json(expect, &ctx, &jerr);
+    ASSERT_EQ(jerr, nullptr);
+
+    // a private arena goes away with the object
+    oci_runtime_spec *spec = oci_runtime_spec_parse_data_insitu(strdup(data), &ctx, &jerr);
+    ASSERT_EQ(jerr, nullptr);
+    ASSERT_NE(spec, nullptr);
+    EXPECT_STREQ(spec->hostname, "quote\"d \xc3\xa9");
+    EXPECT_STREQ(spec->process->args[2], "echo\tok");
+    EXPECT_STREQ(spec->annotations->keys[1], "b\n");
+    char *json = oci_runtime_spec_generate_json(spec, &ctx, &jerr);
+    ASSERT_EQ(jerr, nullptr);
+    EXPECT_STREQ(json, expect_json);
+    free(json);
+    free_oci_runtime_spec(spec);
+
+    // or the buffer joins the arena of the caller
+    ctx.arena = json_arena_new(0);
+    ASSERT_NE(ctx.arena, nullptr);
+    char *buf = strdup(data);
+    spec = oci_runtime_spec_parse_data_insitu(buf, &ctx, &jerr);
+    ASSERT_EQ(jerr, nullptr);
+    ASSERT_NE(spec, nullptr);
+    EXPECT_TRUE(json_arena_owns(spec->process->env[0]));
+    if (!(opt & OPT_PARSE_FULLKEY)) {
+      // strings without escapes are not copied
+      EXPECT_TRUE(spec->process->env[0] > buf && spec->process->env[0] < buf + strlen(data));
+    }
+    json = oci_runtime_spec_generate_json(spec, &ctx, &jerr);
+    ASSERT_EQ(jerr, nullptr);
+    EXPECT_STREQ(json, expect_json);
+    free(json);
+    free_oci_runtime_spec(spec);
+    EXPECT_EQ(oci_runtime_spec_parse_data_insitu(strdup("{\"ociVersion\": [}"), &ctx, &jerr), nullptr);
+    EXPECT_NE(jerr, nullptr);
+    free(jerr);
+    jerr = nullptr;
+    json_arena_free(ctx.arena);
+
+    free(expect_json);
+    free_oci_runtime_spec(expect);
+  }
+
+  struct parser_context ctx = { 0, stderr };
+  cni_array_of_strings_container *strs = cni_array_of_strings_container_parse_data_insitu(strdup("[\"a\", \"b\\\\c\"]"),
+                                                                                          &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  ASSERT_NE(strs, nullptr);
+  ASSERT_EQ(strs->len, 2);
+  EXPECT_STREQ(strs->items[0], "a");
+  EXPECT_STREQ(strs->items[1], "b\\c");
+  free_cni_array_of_strings_container(strs);
+  EXPECT_EQ(cni_array_of_strings_container_parse_data_insitu(strdup("[]"), &ctx, &jerr), nullptr);
+  EXPECT_EQ(jerr, nullptr);
+  EXPECT_EQ(oci_runtime_spec_parse_data_insitu(strdup("{\"hostname\": \"h\"}"), &ctx, &jerr), nullptr);
+  EXPECT_STREQ(jerr, "Required field 'ociVersion' not present");
+  free(jerr);
+}
+
+TEST(libocispec_testcase, test_generate_json_output) {
+  std::string data = "{\"ociVersion\": \"1.0.0\", \"hostname\": \"h\", \"annotations\": {\"big\": \"";
+  // more than the staging buffer, so that it is flushed several times
+  data += std::string(20000, 'x');
+  data += "\"}, \"process\": {\"cwd\": \"/\", \"args\": [\"sh\"], \"env\": [\"A=1\"]}}";
+  parser_error jerr = nullptr;
+  struct parser_context ctx = { OPT_GEN_SIMPLIFY, stderr };
+
+  oci_runtime_spec *spec = oci_runtime_spec_parse_data(data.c_str(), &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  ASSERT_NE(spec, nullptr);
+  char *expect = oci_runtime_spec_generate_json(spec, &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  ASSERT_NE(expect, nullptr);
+  EXPECT_NE(strstr(expect, std::string(20000, 'x').c_str()), nullptr);
+
+  char path[] = "/tmp/libocispec_gen_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(oci_runtime_spec_generate_json_fd(spec, fd, &ctx, &jerr), 0);
+  ASSERT_EQ(jerr, nullptr);
+  close(fd);
+  size_t len = 0;
+  char *content = read_file(path, &len);
+  ASSERT_NE(content, nullptr);
+  EXPECT_STREQ(content, expect);
+  free(content);
+
+  isula_buffer *buf = isula_buffer_alloc(16);
+  ASSERT_NE(buf, nullptr);
+  ASSERT_EQ(buf->append(buf, "spec="), 0);
+  ASSERT_EQ(oci_runtime_spec_generate_json_to_buffer(spec, buf, &ctx, &jerr), 0);
+  ASSERT_EQ(jerr, nullptr);
+  EXPECT_EQ(std::string(buf->contents), std::string("spec=") + expect);
+  isula_buffer_free(buf);
+
+  // the file is replaced with the requested mode
+  ASSERT_EQ(oci_runtime_spec_generate_json_file_atomic(spec, path, 0600, &ctx, &jerr), 0);
+  ASSERT_EQ(jerr, nullptr);
+  struct stat st;
+  ASSERT_EQ(stat(path, &st), 0);
+  EXPECT_EQ(st.st_mode & 0777, 0600);
+  content = read_file(path, &len);
+  ASSERT_NE(content, nullptr);
+  EXPECT_STREQ(content, expect);
+  free(content);
+  unlink(path);
+
+  // a bare file name syncs the current directory
+  char cwd[PATH_MAX];
+  char tmpdir[] = "/tmp/libocispec_atomic_XXXXXX";
+  ASSERT_NE(getcwd(cwd, sizeof(cwd)), nullptr);
+  ASSERT_NE(mkdtemp(tmpdir), nullptr);
+  ASSERT_EQ(chdir(tmpdir), 0);
+  EXPECT_EQ(oci_runtime_spec_generate_json_file_atomic(spec, "config.json", 0600, &ctx, &jerr), 0);
+  EXPECT_EQ(jerr, nullptr);
+  EXPECT_EQ(unlink("config.json"), 0);
+  ASSERT_EQ(chdir(cwd), 0);
+  EXPECT_EQ(rmdir(tmpdir), 0);
+
+  EXPECT_EQ(oci_runtime_spec_generate_json_fd(spec, -1, &ctx, &jerr), -1);
+  EXPECT_NE(jerr, nullptr);
+  free(jerr);
+  jerr = nullptr;
+  EXPECT_EQ(oci_runtime_spec_generate_json_file_atomic(spec, "/nonexistent/dir/config.json", 0600, &ctx, &jerr), -1);
+  EXPECT_NE(jerr, nullptr);
+  free(jerr);
+  jerr = nullptr;
+
+  cni_array_of_strings_container *strs = cni_array_of_strings_container_parse_data("[\"a\", \"b\"]", &ctx, &jerr);
+  ASSERT_NE(strs, nullptr);
+  char *json = cni_array_of_strings_container_generate_json(strs, &ctx, &jerr);
+  ASSERT_NE(json, nullptr);
+  EXPECT_STREQ(json, "[\"a\",\"b\"]");
+  buf = isula_buffer_alloc(16);
+  ASSERT_NE(buf, nullptr);
+  ASSERT_EQ(cni_array_of_strings_container_generate_json_to_buffer(strs, buf, &ctx, &jerr), 0);
+  EXPECT_STREQ(buf->contents, json);
+  isula_buffer_free(buf);
+  free(json);
+  free_cni_array_of_strings_container(strs);
+
+  free(expect);
+  free_oci_runtime_spec(spec);
+}
+
+template <typename T>
+static void expect_binary_round_trip(T *(*parse)(const char *, const struct parser_context *, parser_error *),
+                                     char *(*generate)(const T *, const struct parser_context *, parser_error *),
+                                     int (*encode)(const T *, uint8_t **, size_t *, parser_error *),
+                                     T *(*decode)(const uint8_t *, size_t, const struct parser_context *, parser_error *),
+                                     void (*release)(T *), const char *data, unsigned int options)
+{
+  struct parser_context ctx = { options | OPT_GEN_SIMPLIFY, stderr };
+  parser_error jerr = nullptr;
+
+  T *ptr = parse(data, &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr) << data;
+  ASSERT_NE(ptr, nullptr) << data;
+  char *expect = generate(ptr, &ctx, &jerr);
+  ASSERT_NE(expect, nullptr);
+
+  uint8_t *bin = nullptr;
+  size_t len = 0;
+  ASSERT_EQ(encode(ptr, &bin, &len, &jerr), 0) << jerr;
+  EXPECT_LT(len, strlen(expect)) << data;
+
+  T *copy = decode(bin, len, &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr) << jerr;
+  ASSERT_NE(copy, nullptr);
+  char *json = generate(copy, &ctx, &jerr);
+  EXPECT_STREQ(json, expect);
+  free(json);
+  release(copy);
+
+  // every truncation is reported
+  for (size_t i = 0; i < len; i++) {
+    EXPECT_EQ(decode(bin, i, &ctx, &jerr), nullptr);
+    EXPECT_NE(jerr, nullptr);
+    free(jerr);
+    jerr = nullptr;
+  }
+
+  free(bin);
+  free(expect);
+  release(ptr);
+}
+
+TEST(libocispec_testcase, test_binary_encoding) {
+  const char *spec = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"box\", "
+                     "\"process\": {\"terminal\": true, \"user\": {\"uid\": 4294967295, \"gid\": 2, \"additionalGids\": [3, 4]}, "
+                     "\"args\": [\"sh\", \"-c\", \"sh\"], \"env\": [], \"cwd\": \"/\", \"oomScoreAdj\": -1000, "
+                     "\"rlimits\": [{\"type\": \"RLIMIT_NOFILE\", \"hard\": 18446744073709551615, \"soft\": 1024}]}, "
+                     "\"mounts\": [{\"destination\": \"/proc\", \"type\": \"proc\", \"source\": \"proc\", \"options\": [\"nosuid\", \"noexec\"]}], "
+                     "\"annotations\": {\"a\": \"1\", \"b\": \"\"}, "
+                     "\"linux\": {\"resources\": {\"memory\": {\"limit\": -1, \"swappiness\": 10}, \"cpu\": {\"shares\": 1024}, "
+                     "\"devices\": [{\"allow\": false, \"access\": \"rwm\"}]}, "
+                     "\"seccomp\": {\"defaultAction\": \"SCMP_ACT_ERRNO\", \"syscalls\": [{\"names\": [\"clone\"], \"action\": \"SCMP_ACT_ALLOW\", "
+                     "\"args\": [{\"index\": 0, \"value\": 2114060288, \"op\": \"SCMP_CMP_MASKED_EQ\"}]}]}}, "
+                     "\"unknown\": {\"k\": [1, 2.5, null, \"s\"]}}";
+  const char *daemon = "{\"log-opts\": {\"max-size\": \"30KB\"}, \"default-ulimits\": {\"nofile\": {\"Name\": \"nofile\", \"Hard\": 64, \"Soft\": 32}}, "
+                       "\"hosts\": [\"unix:///var/run/isulad.sock\"], \"selinux-enabled\": true}";
+
+  expect_binary_round_trip(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, oci_runtime_spec_encode_binary,
+                           oci_runtime_spec_decode_binary, free_oci_runtime_spec, spec, 0);
+  expect_binary_round_trip(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, oci_runtime_spec_encode_binary,
+                           oci_runtime_spec_decode_binary, free_oci_runtime_spec, spec, OPT_PARSE_FULLKEY);
+  expect_binary_round_trip(isulad_daemon_configs_parse_data, isulad_daemon_configs_generate_json,
+                           isulad_daemon_configs_encode_binary, isulad_daemon_configs_decode_binary,
+                           free_isulad_daemon_configs, daemon, 0);
+  expect_binary_round_trip(cni_ip_ranges_array_container_parse_data, cni_ip_ranges_array_container_generate_json,
+                           cni_ip_ranges_array_container_encode_binary, cni_ip_ranges_array_container_decode_binary,
+                           free_cni_ip_ranges_array_container,
+                           "[[{\"subnet\": \"10.1.0.0/16\"}, {\"subnet\": \"10.2.0.0/16\"}], [], [{\"subnet\": \"10.1.0.0/16\"}]]", 0);
+
+  parser_error jerr = nullptr;
+  struct parser_context ctx = { OPT_GEN_SIMPLIFY, stderr };
+  oci_runtime_spec *ptr = oci_runtime_spec_parse_data(spec, &ctx, &jerr);
+  ASSERT_NE(ptr, nullptr);
+  char *expect = oci_runtime_spec_generate_json(ptr, &ctx, &jerr);
+  uint8_t *bin = nullptr;
+  size_t len = 0;
+  ASSERT_EQ(oci_runtime_spec_encode_binary(ptr, &bin, &len, &jerr), 0);
+
+  // another schema, a newer version or garbage are refused
+  EXPECT_EQ(isulad_daemon_configs_decode_binary(bin, len, &ctx, &jerr), nullptr);
+  EXPECT_STREQ(jerr, "Binary data does not match the schema of 'isulad_daemon_configs'");
+  free(jerr);
+  jerr = nullptr;
+  bin[4]++;
+  EXPECT_EQ(oci_runtime_spec_decode_binary(bin, len, &ctx, &jerr), nullptr);
+  EXPECT_NE(jerr, nullptr);
+  free(jerr);
+  jerr = nullptr;
+  bin[4]--;
+  std::string garbage(reinterpret_cast<char *>(bin), len);
+  garbage[len / 2] = '\xff';
+  oci_runtime_spec *bad = oci_runtime_spec_decode_binary(reinterpret_cast<const uint8_t *>(garbage.data()), len, &ctx, &jerr);
+  if (bad != nullptr) {
+    free_oci_runtime_spec(bad);
+  }
+  free(jerr);
+  jerr = nullptr;
+
+  // straight from the mapped file, into an arena
+  char path[] = "/tmp/libocispec_bin_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(write(fd, bin, len), (ssize_t)len);
+  close(fd);
+  ctx.arena = json_arena_new(0);
+  oci_runtime_spec *copy = oci_runtime_spec_decode_binary_file(path, &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  ASSERT_NE(copy, nullptr);
+  EXPECT_TRUE(json_arena_owns(copy->process->args[0]));
+  char *json = oci_runtime_spec_generate_json(copy, &ctx, &jerr);
+  EXPECT_STREQ(json, expect);
+  free(json);
+  free_oci_runtime_spec(copy);
+  json_arena_free(ctx.arena);
+  ctx.arena = nullptr;
+  unlink(path);
+  EXPECT_EQ(oci_runtime_spec_decode_binary_file(path, &ctx, &jerr), nullptr);
+  EXPECT_NE(jerr, nullptr);
+  free(jerr);
+
+  free(bin);
+  free(expect);
+  free_oci_runtime_spec(ptr);
+}
+
+TEST(libocispec_testcase, test_clone) {
+  const char *spec = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"box\", "
+                     "\"process\": {\"terminal\": true, \"user\": {\"uid\": 1, \"gid\": 2, \"additionalGids\": [3, 4]}, "
+                     "\"args\": [\"sh\", \"-c\"], \"env\": [], \"cwd\": \"/\", \"oomScoreAdj\": -1000, "
+                     "\"rlimits\": [{\"type\": \"RLIMIT_NOFILE\", \"hard\": 1024, \"soft\": 1024}]}, "
+                     "\"annotations\": {\"a\": \"1\", \"b\": \"\"}, "
+                     "\"linux\": {\"resources\": {\"memory\": {\"limit\": -1, \"swappiness\": 10}, "
+                     "\"devices\": [{\"allow\": false, \"access\": \"rwm\"}]}, \"sysctl\": {\"k\": \"v\"}}, "
+                     "\"unknown\": {\"k\": [1, 2.5, null, \"s\", true]}}";
+  struct parser_context ctx = { OPT_PARSE_FULLKEY | OPT_GEN_SIMPLIFY, stderr };
+  parser_error jerr = nullptr;
+
+  EXPECT_EQ(clone_oci_runtime_spec(nullptr), nullptr);
+
+  oci_runtime_spec *src = oci_runtime_spec_parse_data(spec, &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  ASSERT_NE(src, nullptr);
+  char *expect = oci_runtime_spec_generate_json(src, &ctx, &jerr);
+  ASSERT_NE(expect, nullptr);
+  EXPECT_NE(strstr(expect, "\"unknown\""), nullptr);
+
+  oci_runtime_spec *copy = clone_oci_runtime_spec(src);
+  ASSERT_NE(copy, nullptr);
+  EXPECT_NE(copy->process, src->process);
+  EXPECT_NE(copy->process->args[0], src->process->args[0]);
+  EXPECT_NE(copy->_residual, src->_residual);
+  // the copy owns all of its data
+  free_oci_runtime_spec(src);
+  char *json = oci_runtime_spec_generate_json(copy, &ctx, &jerr);
+  EXPECT_STREQ(json, expect);
+  free(json);
+
+  // per container specs derived from one template
+  ctx.arena = json_arena_new(0);
+  ASSERT_NE(ctx.arena, nullptr);
+  oci_runtime_spec *derived = static_cast<oci_runtime_spec *>(json_clone(&desc_oci_runtime_spec, copy, &ctx));
+  ASSERT_NE(derived, nullptr);
+  EXPECT_TRUE(json_arena_owns(derived->process->user));
+  derived->hostname = json_ctx_strdup(&ctx, "other");
+  json = oci_runtime_spec_generate_json(copy, &ctx, &jerr);
+  EXPECT_STREQ(json, expect);
+  free(json);
+  free_oci_runtime_spec(derived);
+  json_arena_free(ctx.arena);
+  ctx.arena = nullptr;
+  free_oci_runtime_spec(copy);
+  free(expect);
+
+  cni_ip_ranges_array_container *ranges = cni_ip_ranges_array_container_parse_data(
+      "[[{\"subnet\": \"10.1.0.0/16\"}, {\"subnet\": \"10.2.0.0/16\"}], []]", &ctx, &jerr);
+  ASSERT_NE(ranges, nullptr);
+  cni_ip_ranges_array_container *ranges_copy = clone_cni_ip_ranges_array_container(ranges);
+  ASSERT_NE(ranges_copy, nullptr);
+  ASSERT_EQ(ranges_copy->len, 2);
+  ASSERT_EQ(ranges_copy->subitem_lens[0], 2);
+  EXPECT_EQ(ranges_copy->subitem_lens[1], 0);
+  EXPECT_STREQ(ranges_copy->items[0][1]->subnet, "10.2.0.0/16");
+  free_cni_ip_ranges_array_container(ranges);
+  free_cni_ip_ranges_array_container(ranges_copy);
+
+  json_map_string_string *map = (json_map_string_string *)calloc(1, sizeof(json_map_string_string));
+  ASSERT_NE(map, nullptr);
+  ASSERT_EQ(append_json_map_string_string(map, "a", "1"), 0);
+  ASSERT_EQ(append_json_map_string_string(map, "b", "2"), 0);
+  json_map_string_string *map_copy = clone_json_map_string_string(map);
+  ASSERT_NE(map_copy, nullptr);
+  ASSERT_EQ(map_copy->len, 2);
+  EXPECT_STREQ(map_copy->keys[1], "b");
+  EXPECT_STREQ(map_copy->values[1], "2");
+  EXPECT_NE(map_copy->values[1], map->values[1]);
+  free_json_map_string_string(map_copy);
+  free_json_map_string_string(map);
+
+  json_map_int_bool *bmap = (json_map_int_bool *)calloc(1, sizeof(json_map_int_bool));
+  ASSERT_NE(bmap, nullptr);
+  ASSERT_EQ(append_json_map_int_bool(bmap, 7, true), 0);
+  json_map_int_bool *bmap_copy = clone_json_map_int_bool(bmap);
+  ASSERT_NE(bmap_copy, nullptr);
+  ASSERT_EQ(bmap_copy->len, 1);
+  EXPECT_EQ(bmap_copy->keys[0], 7);
+  EXPECT_TRUE(bmap_copy->values[0]);
+  free_json_map_int_bool(bmap_copy);
+  free_json_map_int_bool(bmap);
+}
+
+TEST(libocispec_testcase, test_compare_and_merge_patch) {
+  const char *spec_a = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"box\", "
+                       "\"process\": {\"user\": {\"uid\": 1, \"gid\": 2}, \"args\": [\"sh\"], \"cwd\": \"/\"}, "
+                       "\"annotations\": {\"a\": \"1\", \"b\": \"2\"}, "
+                       "\"linux\": {\"sysctl\": {\"k\": \"v\"}}, \"unknown\": {\"x\": 1, \"y\": [true]}}";
+  // same document with the map entries and the unknown keys reordered
+  const char *spec_a2 = "{\"unknown\": {\"y\": [true], \"x\": 1}, \"ociVersion\": \"1.0.2\", \"hostname\": \"box\", "
+                        "\"annotations\": {\"b\": \"2\", \"a\": \"1\"}, \"linux\": {\"sysctl\": {\"k\": \"v\"}}, "
+                        "\"process\": {\"cwd\": \"/\", \"args\": [\"sh\"], \"user\": {\"gid\": 2, \"uid\": 1}}}";
+  const char *spec_b = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"other\", "
+                       "\"process\": {\"user\": {\"uid\": 0, \"gid\": 2}, \"args\": [\"sh\", \"-c\"], \"cwd\": \"/\"}, "
+                       "\"annotations\": {\"a\": \"1\", \"c\": \"3\"}, \"unknown\": {\"x\": 1, \"y\": [false]}}";
+  struct parser_context ctx = { OPT_PARSE_FULLKEY | OPT_GEN_SIMPLIFY, stderr };
+  parser_error jerr = nullptr;
+
+  oci_runtime_spec *a = oci_runtime_spec_parse_data(spec_a, &ctx, &jerr);
+  oci_runtime_spec *a2 = oci_runtime_spec_parse_data(spec_a2, &ctx, &jerr);
+  oci_runtime_spec *b = oci_runtime_spec_parse_data(spec_b, &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  ASSERT_NE(a, nullptr);
+  ASSERT_NE(a2, nullptr);
+  ASSERT_NE(b, nullptr);
+
+  EXPECT_TRUE(equal_oci_runtime_spec(a, a2));
+  EXPECT_EQ(hash_oci_runtime_spec(a), hash_oci_runtime_spec(a2));
+  EXPECT_NE(hash_oci_runtime_spec(a), 0);
+  EXPECT_FALSE(equal_oci_runtime_spec(a, b));
+  EXPECT_NE(hash_oci_runtime_spec(a), hash_oci_runtime_spec(b));
+  EXPECT_FALSE(equal_oci_runtime_spec(a, nullptr));
+  EXPECT_TRUE(equal_oci_runtime_spec(nullptr, nullptr));
+
+  char *patch = diff_oci_runtime_spec(a, a2, &ctx, &jerr);
+  ASSERT_NE(patch, nullptr);
+  EXPECT_STREQ(patch, "{}");
+  free(patch);
+
+  patch = diff_oci_runtime_spec(a, b, &ctx, &jerr);
+  ASSERT_NE(patch, nullptr);
+  EXPECT_EQ(strstr(patch, "ociVersion"), nullptr);
+  EXPECT_NE(strstr(patch, "\"hostname\":\"other\""), nullptr);
+  EXPECT_NE(strstr(patch, "\"user\":{\"uid\":null}"), nullptr);
+  EXPECT_NE(strstr(patch, "\"args\":[\"sh\",\"-c\"]"), nullptr);
+  EXPECT_NE(strstr(patch, "\"annotations\":{\"c\":\"3\",\"b\":null}"), nullptr);
+  EXPECT_NE(strstr(patch, "\"linux\":null"), nullptr);
+  EXPECT_NE(strstr(patch, "\"unknown\":{\"y\":[false]}"), nullptr);
+
+  oci_runtime_spec *patched = apply_merge_patch_oci_runtime_spec(a, patch, &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  ASSERT_NE(patched, nullptr);
+  EXPECT_TRUE(equal_oci_runtime_spec(patched, b));
+  EXPECT_EQ(hash_oci_runtime_spec(patched), hash_oci_runtime_spec(b));
+  free_oci_runtime_spec(patched);
+  free(patch);
+
+  // the patch from nothing is the whole document
+  patch = diff_oci_runtime_spec(nullptr, b, &ctx, &jerr);
+  ASSERT_NE(patch, nullptr);
+  patched = apply_merge_patch_oci_runtime_spec(nullptr, patch, &ctx, &jerr);
+  ASSERT_NE(patched, nullptr);
+  EXPECT_TRUE(equal_oci_runtime_spec(patched, b));
+  free_oci_runtime_spec(patched);
+  free(patch);
+
+  EXPECT_EQ(apply_merge_patch_oci_runtime_spec(a, "{\"hostname\": ", &ctx, &jerr), nullptr);
+  EXPECT_NE(jerr, nullptr);
+  free(jerr);
+  jerr = nullptr;
+  EXPECT_EQ(apply_merge_patch_oci_runtime_spec(a, "null", &ctx, &jerr), nullptr);
+  EXPECT_NE(jerr, nullptr);
+  free(jerr);
+  jerr = nullptr;
+
+  free_oci_runtime_spec(a);
+  free_oci_runtime_spec(a2);
+  free_oci_runtime_spec(b);
+
+  // arrays are replaced as a whole
+  cni_ip_ranges_array_container *ranges = cni_ip_ranges_array_container_parse_data(
+      "[[{\"subnet\": \"10.1.0.0/16\"}], []]", &ctx, &jerr);
+  cni_ip_ranges_array_container *ranges2 = cni_ip_ranges_array_container_parse_data(
+      "[[{\"subnet\": \"10.1.0.0/16\"}], [{\"subnet\": \"10.2.0.0/16\"}]]", &ctx, &jerr);
+  ASSERT_NE(ranges, nullptr);
+  ASSERT_NE(ranges2, nullptr);
+  EXPECT_FALSE(equal_cni_ip_ranges_array_container(ranges, ranges2));
+  patch = diff_cni_ip_ranges_array_container(ranges, ranges2, &ctx, &jerr);
+  ASSERT_NE(patch, nullptr);
+  cni_ip_ranges_array_container *ranges3 = apply_merge_patch_cni_ip_ranges_array_container(ranges, patch, &ctx, &jerr);
+  ASSERT_NE(ranges3, nullptr);
+  EXPECT_TRUE(equal_cni_ip_ranges_array_container(ranges3, ranges2));
+  EXPECT_EQ(hash_cni_ip_ranges_array_container(ranges3), hash_cni_ip_ranges_array_container(ranges2));
+  free(patch);
+  free_cni_ip_ranges_array_container(ranges);
+  free_cni_ip_ranges_array_container(ranges2);
+  free_cni_ip_ranges_array_container(ranges3);
+}
+
+TEST(libocispec_testcase, test_parse_lazy) {
+  const char *spec = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"box\", "
+                     "\"hooks\": {\"prestart\": [{\"path\": \"/bin/true\", \"args\": [\"true\"]}]}, "
+                     "\"mounts\": [{\"destination\": \"/proc\", \"type\": \"proc\"}, "
+                     "{\"destination\": \"/dev\", \"options\": [\"nosuid\"]}], "
+                     "\"process\": {\"args\": [\"sh\"], \"cwd\": \"/\"}, "
+                     "\"linux\": {\"seccomp\": {\"defaultAction\": \"SCMP_ACT_ERRNO\", "
+                     "\"syscalls\": [{\"names\": [\"read\"], \"action\": \"SCMP_ACT_ALLOW\"}]}, "
+                     "\"resources\": {\"devices\": [{\"allow\": false, \"access\": \"rwm\"}]}}}";
+  struct parser_context eager_ctx = { OPT_GEN_SIMPLIFY, stderr };
+  struct parser_context ctx = { OPT_PARSE_LAZY | OPT_GEN_SIMPLIFY, stderr };
+  parser_error jerr = nullptr;
+
+  oci_runtime_spec *eager = oci_runtime_spec_parse_data(spec, &eager_ctx, &jerr);
+  ASSERT_NE(eager, nullptr);
+  char *expect = oci_runtime_spec_generate_json(eager, &eager_ctx, &jerr);
+  ASSERT_NE(expect, nullptr);
+
+  oci_runtime_spec *lazy = oci_runtime_spec_parse_data(spec, &ctx, &jerr);
+  ASSERT_EQ(jerr, nullptr);
+  ASSERT_NE(lazy, nullptr);
+  EXPECT_EQ(lazy->mounts, nullptr);
+  EXPECT_EQ(lazy->hooks, nullptr);
+  EXPECT_NE(json_lazy_get(lazy->_lazy, "mounts"), nullptr);
+  ASSERT_NE(lazy->linux, nullptr);
+  EXPECT_EQ(lazy->linux->seccomp, nullptr);
+  ASSERT_NE(lazy->linux->resources, nullptr);
+  EXPECT_EQ(lazy->linux->resources->devices, nullptr);
+  EXPECT_STREQ(lazy->process->args[0], "sh");
+
+  // the kept trees are written, compared and copied like the decoded members
+  char *json = oci_runtime_spec_generate_json(lazy, &ctx, &jerr);
+  EXPECT_STREQ(json, expect);
+  free(json);
+  EXPECT_TRUE(equal_oci_runtime_spec(lazy, eager));
+  EXPECT_EQ(hash_oci_runtime_spec(lazy), hash_oci_runtime_spec(eager));
+  char *patch = diff_oci_runtime_spec(eager, lazy, &ctx, &jerr);
+  EXPECT_STREQ(patch, "{}");
+  free(patch);
+  uint8_t *data = nullptr;
+  size_t len = 0;
+  uint8_t *eager_data = nullptr;
+  size_t eager_len = 0;
+  ASSERT_EQ(oci_runtime_spec_encode_binary(lazy, &data, &len, &jerr), 0);
+  ASSERT_EQ(oci_runtime_spec_encode_binary(eager, &eager_data, &eager_len, &jerr), 0);
+  ASSERT_EQ(len, eager_len);
+  EXPECT_EQ(memcmp(data, eager_data, len), 0);
+  free(data);
+  free(eager_data);
+  oci_runtime_spec *copy = clone_oci_runtime_spec(lazy);
+  ASSERT_NE(copy, nullptr);
+  EXPECT_NE(json_lazy_get(copy->_lazy, "hooks"), nullptr);
+  EXPECT_TRUE(equal_oci_runtime_spec(copy, eager));
+  free_oci_runtime_spec(copy);
+
+  // decoded on first access, then cached
+  ASSERT_EQ(get_oci_runtime_spec_mounts(lazy, &ctx, &jerr), 0);
+  ASSERT_EQ(lazy->mounts_len, 2);
+  EXPECT_STREQ(lazy->mounts[1]->destination, "/dev");
+  EXPECT_EQ(json_lazy_get(lazy->_lazy, "mounts"), nullptr);
+  defs_mount **mounts = lazy->mounts;
+  ASSERT_EQ(get_oci_runtime_spec_mounts(lazy, &ctx, &jerr), 0);
+  EXPECT_EQ(lazy->mounts, mounts);
+  ASSERT_EQ(get_oci_runtime_config_linux_seccomp(lazy->linux, &ctx, &jerr), 0);
+  ASSERT_NE(lazy->linux->seccomp, nullptr);
+  EXPECT_STREQ(lazy->linux->seccomp->default_action, "SCMP_ACT_ERRNO");
+  ASSERT_EQ(get_defs_resources_devices(lazy->linux->resources, &ctx, &jerr), 0);
+  ASSERT_EQ(lazy->linux->resources->devices_len, 1);
+  EXPECT_STREQ(lazy->linux->resources->devices[0]->access, "rwm");
+  json = oci_runtime_spec_generate_json(lazy, &ctx, &jerr);
+  EXPECT_STREQ(json, expect);
+  free(json);
+  free_oci_runtime_spec(lazy);
+
+  // a bad member fails its accessor, and stays kept
+  lazy = oci_runtime_spec_parse_data("{\"ociVersion\": \"1.0.2\", \"mounts\": [{\"type\": \"proc\"}]}", &ctx, &jerr);
+  ASSERT_NE(lazy, nullptr);
+  EXPECT_NE(get_oci_runtime_spec_mounts(lazy, &ctx, &jerr), 0);
+  EXPECT_NE(jerr, nullptr);
+  free(jerr);
+  jerr = nullptr;
+  EXPECT_EQ(lazy->mounts, nullptr);
+  EXPECT_NE(json_lazy_get(lazy->_lazy, "mounts"), nullptr);
+  free_oci_runtime_spec(lazy);
+
+  // with an arena, and through the stream parser option
+  ctx.options |= OPT_PARSE_STREAM;
+  ctx.arena = json_arena_new(0);
+  ASSERT_NE(ctx.arena, nullptr);
+  lazy = oci_runtime_spec_parse_data(spec, &ctx, &jerr);
+  ASSERT_NE(lazy, nullptr);
+  EXPECT_EQ(lazy->hooks, nullptr);
+  ASSERT_EQ(get_oci_runtime_spec_hooks(lazy, &ctx, &jerr), 0);
+  ASSERT_NE(lazy->hooks, nullptr);
+  EXPECT_TRUE(json_arena_owns(lazy->hooks));
+  ASSERT_EQ(lazy->hooks->prestart_len, 1);
+  EXPECT_STREQ(lazy->hooks->prestart[0]->path, "/bin/true");
+  EXPECT_TRUE(equal_oci_runtime_spec(lazy, eager));
+  free_oci_runtime_spec(lazy);
+  json_arena_free(ctx.arena);
+  ctx.arena = nullptr;
+
+  free_oci_runtime_spec(eager);
+  free(expect);
+}
+
+TEST(libocispec_testcase, test_json_map_index) {
+  json_map_string_string *map = (json_map_string_string *)calloc(1, sizeof(json_map_string_string));
+  ASSERT_NE(map, nullptr);
+  char key[32];
+  char val[32];
+
+  for (int i = 0; i < 3000; i++) {
+    (void)snprintf(key, sizeof(key), "label.%d", i);
+    (void)snprintf(val, sizeof(val), "v%d", i);
+    ASSERT_EQ(append_json_map_string_string(map, key, val), 0);
+  }
+  ASSERT_EQ(map->len, 3000);
+  EXPECT_STREQ(map->keys[1234], "label.1234");
+  EXPECT_STREQ(json_map_string_string_get(map, "label.2999"), "v2999");
+  EXPECT_NE(map->_state, nullptr);
+  EXPECT_EQ(json_map_string_string_get(map, "label.3000"), nullptr);
+
+  // put replaces in place, append keeps its replacing behaviour
+  ASSERT_EQ(json_map_string_string_put(map, "label.7", "seven"), 0);
+  ASSERT_EQ(append_json_map_string_string(map, "label.8", "eight"), 0);
+  EXPECT_EQ(map->len, 3000);
+  EXPECT_STREQ(map->values[7], "seven");
+  EXPECT_STREQ(json_map_string_string_get(map, "label.8"), "eight");
+
+  // del keeps the order of the remaining entries
+  ASSERT_EQ(json_map_string_string_del(map, "label.0"), 0);
+  EXPECT_EQ(json_map_string_string_del(map, "label.0"), -1);
+  ASSERT_EQ(map->len, 2999);
+  EXPECT_STREQ(map->keys[0], "label.1");
+  EXPECT_STREQ(json_map_string_string_get(map, "label.2999"), "v2999");
+  EXPECT_EQ(json_map_string_string_get(map, "label.0"), nullptr);
+  ASSERT_EQ(json_map_string_string_put(map, "label.0", "back"), 0);
+  EXPECT_STREQ(map->keys[2999], "label.0");
+  EXPECT_STREQ(json_map_string_string_get(map, "label.0"), "back");
+
+  json_map_string_string *copy = clone_json_map_string_string(map);
+  ASSERT_NE(copy, nullptr);
+  EXPECT_EQ(copy->_state, nullptr);
+  EXPECT_STREQ(json_map_string_string_get(copy, "label.1500"), "v1500");
+  free_json_map_string_string(copy);
+
+  // arrays resized or replaced by hand drop the capacity and the index
+  char **keys = (char **)realloc(map->keys, map->len * sizeof(char *));
+  ASSERT_NE(keys, nullptr);
+  map->keys = keys;
+  char **values = (char **)realloc(map->values, map->len * sizeof(char *));
+  ASSERT_NE(values, nullptr);
+  map->values = values;
+  ASSERT_EQ(json_map_string_string_put(map, "label.new", "new"), 0);
+  EXPECT_STREQ(json_map_string_string_get(map, "label.new"), "new");
+  EXPECT_STREQ(json_map_string_string_get(map, "label.1"), "v1");
+  for (size_t i = map->len - 1; i >= 2000; i--) {
+    free(map->keys[i]);
+    free(map->values[i]);
+  }
+  map->len = 2000;
+  keys = (char **)calloc(2000, sizeof(char *));
+  ASSERT_NE(keys, nullptr);
+  memcpy(keys, map->keys, 2000 * sizeof(char *));
+  free(map->keys);
+  map->keys = keys;
+  free(keys[5]);
+  keys[5] = strdup("swapped");
+  EXPECT_STREQ(json_map_string_string_get(map, "swapped"), "v6");
+  EXPECT_EQ(json_map_string_string_get(map, "label.2500"), nullptr);
+  ASSERT_EQ(append_json_map_string_string(map, "label.2500", "back"), 0);
+  EXPECT_EQ(map->len, 2001);
+  EXPECT_STREQ(json_map_string_string_get(map, "label.2500"), "back");
+  free_json_map_string_string(map);
+
+  // small maps grow geometrically without an index
+  json_map_int_int *imap = (json_map_int_int *)calloc(1, sizeof(json_map_int_int));
+  ASSERT_NE(imap, nullptr);
+  for (int i = 0; i < 100; i++) {
+    ASSERT_EQ(append_json_map_int_int(imap, i, i * 2), 0);
+  }
+  EXPECT_EQ(imap->len, 100);
+  EXPECT_NE(imap->_state, nullptr);
+  EXPECT_EQ(imap->values[99], 198);
+  free_json_map_int_int(imap);
+}
+
+TEST(libocispec_testcase, test_parse_files_parallel) {
+  char dir[] = "/tmp/lcr_parallel_XXXXXX";
+  ASSERT_NE(mkdtemp(dir), nullptr);
+  const size_t n = 64;
+  std::string names[n];
+  const char *paths[n];
+
+  for (size_t i = 0; i < n; i++) {
+    names[i] = std::string(dir) + "/spec" + std::to_string(i) + ".json";
+    paths[i] = names[i].c_str();
+    if (i == 17) {
+      continue;
+    }
+    FILE *fp = fopen(paths[i], "w");
+    ASSERT_NE(fp, nullptr);
+    if (i == 40) {
+      fputs("{\"ociVersion\": ", fp);
+    } else {
+      fprintf(fp, "{\"ociVersion\": \"1.0.%zu\", \"hostname\": \"h%zu\"}", i, i);
+    }
+    fclose(fp);
+  }
+
+  // the second run of 4 threads gets the workers kept by the first
+  for (size_t nthreads : { (size_t)0, (size_t)1, (size_t)4, (size_t)4, (size_t)100 }) {
+    oci_runtime_spec *out[n];
+    parser_error errs[n];
+    struct parser_context ctx = { OPT_PARSE_STRICT, stderr };
+
+    EXPECT_EQ(oci_runtime_spec_parse_files_parallel(paths, n, nthreads, &ctx, out, errs), -1);
+    for (size_t i = 0; i < n; i++) {
+      if (i == 17 || i == 40) {
+        EXPECT_EQ(out[i], nullptr);
+        EXPECT_NE(errs[i], nullptr);
+        free(errs[i]);
+        continue;
+      }
+      ASSERT_NE(out[i], nullptr);
+      EXPECT_EQ(errs[i], nullptr);
+      EXPECT_EQ(std::string(out[i]->hostname), "h" + std::to_string(i));
+      free_oci_runtime_spec(out[i]);
+    }
+  }
+
+  // a forked child does not use the kept workers of its parent, which it
+  // asks for the same number of
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    oci_runtime_spec *child_out[n];
+    int ok = oci_runtime_spec_parse_files_parallel(paths, n, 100, nullptr, child_out, nullptr) == -1;
+    ok = ok && child_out[3] != nullptr && strcmp(child_out[3]->hostname, "h3") == 0;
+    _exit(ok ? 0 : 1);
+  }
+  int status = 0;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+  // results are owned by the caller even with an arena in the context
+  struct json_arena *arena = json_arena_new(0);
+  struct parser_context actx = { 0, stderr, arena };
+  oci_runtime_spec *out[2];
+  EXPECT_EQ(oci_runtime_spec_parse_files_parallel(paths, 2, 2, &actx, out, nullptr), 0);
+  EXPECT_FALSE(json_arena_owns(out[0]));
+  EXPECT_STREQ(out[1]->oci_version, "1.0.1");
+  free_oci_runtime_spec(out[0]);
+  free_oci_runtime_spec(out[1]);
+  json_arena_free(arena);
+  EXPECT_EQ(oci_runtime_spec_parse_files_parallel(paths, 0, 4, nullptr, out, nullptr), 0);
+
+  for (size_t i = 0; i < n; i++) {
+    (void)unlink(paths[i]);
+  }
+  (void)rmdir(dir);
+}
+
+TEST(libocispec_testcase, test_parse_data_len_and_map_file) {
+  // the length bounds the parse, no terminator is needed
+  const char *data = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"box\"}garbage";
+  size_t len = strlen("{\"ociVersion\": \"1.0.2\", \"hostname\": \"box\"}");
+  for (unsigned int options : { 0u, (unsigned int)OPT_PARSE_STREAM }) {
+    struct parser_context ctx = { options, stderr };
+    parser_error err = nullptr;
+    oci_runtime_spec *spec = oci_runtime_spec_parse_data_len(data, len, &ctx, &err);
+    ASSERT_NE(spec, nullptr) << err;
+    EXPECT_STREQ(spec->hostname, "box");
+    free_oci_runtime_spec(spec);
+    spec = oci_runtime_spec_parse_data(data, &ctx, &err);
+    EXPECT_EQ(spec, nullptr);
+    free(err);
+  }
+
+  // large files are mapped, files ending on a page boundary are read
+  char path[] = "/tmp/lcr_map_XXXXXX";
+  int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  long page = sysconf(_SC_PAGESIZE);
+  for (size_t size : { (size_t)300 * 1024 + 7, (size_t)page * 80, (size_t)100 }) {
+    std::string json = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"";
+    json += std::string(size - json.size() - 2, 'x') + "\"}";
+    ASSERT_EQ(json.size(), size);
+    ASSERT_EQ(ftruncate(fd, 0), 0);
+    ASSERT_EQ(pwrite(fd, json.c_str(), json.size(), 0), (ssize_t)json.size());
+
+    size_t flen = 0;
+    bool mapped = false;
+    char *content = map_file(path, &flen, &mapped);
+    ASSERT_NE(content, nullptr);
+    EXPECT_EQ(flen, size);
+    EXPECT_EQ(mapped, size == (size_t)300 * 1024 + 7);
+    EXPECT_EQ(content[flen], '\0');
+    EXPECT_EQ(memcmp(content, json.c_str(), size), 0);
+    unmap_file(content, flen, mapped);
+
+    content = read_file(path, &flen);
+    ASSERT_NE(content, nullptr);
+    EXPECT_EQ(flen, size + 1);
+    free(content);
+
+    FILE *fp = fopen(path, "r");
+    ASSERT_NE(fp, nullptr);
+    content = fread_file(fp, &flen);
+    fclose(fp);
+    ASSERT_NE(content, nullptr);
+    EXPECT_EQ(flen, size + 1);
+    EXPECT_EQ(strlen(content), size);
+    free(content);
+
+    parser_error err = nullptr;
+    oci_runtime_spec *spec = oci_runtime_spec_parse_file(path, nullptr, &err);
+    ASSERT_NE(spec, nullptr) << err;
+    EXPECT_EQ(strlen(spec->hostname), size - json.find('x') - 2);
+    free_oci_runtime_spec(spec);
+  }
+  close(fd);
+  (void)unlink(path);
+
+  // streams of unknown size grow their buffer
+  FILE *pipe = popen("yes | head -c 20000", "r");
+  ASSERT_NE(pipe, nullptr);
+  size_t plen = 0;
+  char *content = fread_file(pipe, &plen);
+  pclose(pipe);
+  ASSERT_NE(content, nullptr);
+  EXPECT_EQ(plen, 20001);
+  free(content);
+}
+
+static int record_null(void *ctx)
+{
+  static_cast<std::string *>(ctx)->append("n,");
+  return 1;
+}
+
+static int record_boolean(void *ctx, int val)
+{
+  static_cast<std::string *>(ctx)->append(val ? "t," : "f,");
+  return 1;
+}
+
+static int record_number(void *ctx, const char *s, size_t len)
+{
+  static_cast<std::string *>(ctx)->append("#").append(s, len).append(",");
+  return 1;
+}
+
+static int record_string(void *ctx, const unsigned char *s, size_t len)
+{
+  static_cast<std::string *>(ctx)->append("s" + std::to_string(len) + ":").append((const char *)s, len);
+  return 1;
+}
+
+static int record_map_key(void *ctx, const unsigned char *s, size_t len)
+{
+  static_cast<std::string *>(ctx)->append("k" + std::to_string(len) + ":").append((const char *)s, len);
+  return 1;
+}
+
+static int record_start_map(void *ctx)
+{
+  static_cast<std::string *>(ctx)->append("{");
+  return 1;
+}
+
+static int record_end_map(void *ctx)
+{
+  static_cast<std::string *>(ctx)->append("}");
+  return 1;
+}
+
+static int record_start_array(void *ctx)
+{
+  static_cast<std::string *>(ctx)->append("[");
+  return 1;
+}
+
+static int record_end_array(void *ctx)
+{
+  static_cast<std::string *>(ctx)->append("]");
+  return 1;
+}
+
+static const yajl_callbacks record_callbacks = {
+  record_null, record_boolean, nullptr, nullptr, record_number, record_string,
+  record_start_map, record_map_key, record_end_map, record_start_array, record_end_array,
+};
+
+// the events of yajl and of the simd front end, read only and in place, are the same
+static void expect_same_simd_events(const std::string &doc)
+{
+  std::string expect;
+  yajl_handle h = yajl_alloc(&record_callbacks, nullptr, &expect);
+  ASSERT_NE(h, nullptr);
+  (void)yajl_config(h, yajl_allow_comments, 1);
+  yajl_status stat = yajl_parse(h, (const unsigned char *)doc.data(), doc.size());
+  if (stat == yajl_status_ok) {
+    stat = yajl_complete_parse(h);
+  }
+  yajl_free(h);
+
+  for (bool writable : { false, true }) {
+    std::string copy = doc;
+    std::string events;
+    char *msg = nullptr;
+    int ret = json_simd_parse(&record_callbacks, &events, copy.data(), copy.size(), writable, &msg);
+    if (ret == 1) {
+      // comments are left to yajl
+      EXPECT_NE(doc.find('/'), std::string::npos) << doc;
+      EXPECT_TRUE(events.empty());
+      continue;
+    }
+    EXPECT_EQ(ret == 0, stat == yajl_status_ok) << json_simd_kernel() << ": " << doc << ": " << (msg ? msg : "");
+    EXPECT_EQ(ret == 0, msg == nullptr);
+    if (ret == 0 && stat == yajl_status_ok) {
+      EXPECT_EQ(events, expect) << json_simd_kernel() << ": " << doc;
+    }
+    free(msg);
+  }
+}
+
+template <typename T>
+static void expect_same_simd_parse(T *(*parse)(const char *, const struct parser_context *, parser_error *),
+                                   char *(*generate)(const T *, const struct parser_context *, parser_error *),
+                                   void (*release)(T *), const std::string &doc)
+{
+  for (unsigned int options : { 0u, (unsigned int)OPT_PARSE_FULLKEY }) {
+    struct parser_context ctx = { OPT_GEN_SIMPLIFY | OPT_PARSE_STREAM | options, stderr };
+    struct parser_context simd_ctx = { OPT_GEN_SIMPLIFY | OPT_PARSE_STREAM | OPT_PARSE_SIMD | options, stderr };
+    parser_error err = nullptr;
+    parser_error simd_err = nullptr;
+    T *ptr = parse(doc.c_str(), &ctx, &err);
+    T *simd_ptr = parse(doc.c_str(), &simd_ctx, &simd_err);
+
+    EXPECT_EQ(err == nullptr, simd_err == nullptr) << doc << ": " << (err ? err : simd_err);
+    EXPECT_EQ(ptr == nullptr, simd_ptr == nullptr) << doc;
+    if (ptr != nullptr && simd_ptr != nullptr) {
+      parser_error gen_err = nullptr;
+      char *json = generate(ptr, &ctx, &gen_err);
+      ASSERT_EQ(gen_err, nullptr);
+      char *simd_json = generate(simd_ptr, &ctx, &gen_err);
+      ASSERT_EQ(gen_err, nullptr);
+      EXPECT_STREQ(json, simd_json) << doc;
+      free(json);
+      free(simd_json);
+    }
+    release(ptr);
+    release(simd_ptr);
+    free(err);
+    free(simd_err);
+  }
+}
+
+static std::vector<std::string> corpus_files;
+
+static int collect_json_file(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+  size_t len = strlen(path);
+
+  if (flag == FTW_F && len > 5 && strcmp(path + len - 5, ".json") == 0) {
+    corpus_files.push_back(path);
+  }
+  return 0;
+}
+
+// every json file under dir, in a stable order
+static std::vector<std::string> json_files(const char *dir)
+{
+  corpus_files.clear();
+  EXPECT_EQ(nftw(dir, collect_json_file, 16, FTW_PHYS), 0) << dir;
+  std::sort(corpus_files.begin(), corpus_files.end());
+  return corpus_files;
+}
+
+// a fixture through the stream parser of the generated type it holds
+static void expect_same_simd_fixture(const std::string &path, const std::string &doc)
+{
+  std::string name = path.substr(path.rfind('/') + 1);
+
+  if (name == "process.json") {
+    expect_same_simd_parse(defs_process_parse_data, defs_process_generate_json, free_defs_process, doc);
+  } else if (name == "ocihook.json") {
+    expect_same_simd_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec,
+                           "{\"ociVersion\": \"1.0.2\", \"hooks\": " + doc + "}");
+  } else if (name == "oci.config.json") {
+    expect_same_simd_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec, doc);
+  } else {
+    ADD_FAILURE() << "no generated type for the fixture " << path;
+  }
+}
+
+TEST(libocispec_testcase, test_parse_simd) {
+  if (!json_simd_supported()) {
+    GTEST_SKIP() << "built without ENABLE_SIMD_JSON";
+  }
+
+  std::vector<std::string> docs = {
+    "{\"a\": 1, \"b\": [true, false, null], \"c\": {\"d\": \"e\"}, \"f\": {}, \"g\": []}",
+    "[0, -0, 1.5, -1.5e10, 1E+2, 2e-3, 123456789012345678901234567890, 0.0e0]",
+    "[01]", "[1.]", "[-]", "[1e]", "[.5]", "[+1]", "[1.5.5]", "[1e+]", "[-01]", "[1x]", "[1\\]",
+    "[\"\\\"\\\\\\/\\b\\f\\n\\r\\t\", \"\\u00e9\\u4E2D\\ud83d\\ude00\\udc00\", \"a\\\\\", \"\\\\\\\\\\\"\"]",
+    "[\"\\x\"]", "[\"\\u12g4\"]", "[\"\\u12\"]", "[\"a", "[\"a\\", "\"\x01\"", "\"\t\"", "\"\xff\"", "\"\xc3\"",
+    "\"\xe4\xb8\"", "\"\xc3\xa9\xe4\xb8\xad\xf0\x9f\x98\x80\"", "\"\x80\"", "\"\xf8\x80\x80\x80\x80\"",
+    "tru", "nul", "truex", "true", "false", "null", "1", "-2.5", "\"s\"", "", "   ", "\n\r\t ",
+    "[true false]", "{\"a\" 1}", "{\"a\":}", "{1: 2}", "[1,]", "{\"a\":1,}", "]", "}", ":", ",",
+    "{}}", "[]]", "\"a\" \"b\"", "1 2", "[1]x", "[1]\"", "{\"a\": 1 \"b\": 2}", "[[[]]", "{\"a\": [}",
+    "{\"a\" : 1 , \"b\" :[ 2 ,3 ] }", "[\"{[:,]}\", \"/not a comment\", \"*/\"]",
+    "/* c */ {\"a\": 1}", "{\"a\": 1} // x", "[1, /* c */ 2]", "[1 /2]",
+  };
+  std::string deep;
+  for (int i = 0; i < 1000; i++) {
+    deep += i % 2 ? "[" : "{\"a\":";
+  }
+  docs.push_back(deep);
+  for (int i = 999; i >= 0; i--) {
+    deep += i % 2 ? "]" : "}";
+  }
+  docs.push_back(deep);
+  // quotes and backslash runs around the 64 byte blocks
+  for (size_t pad = 0; pad < 70; pad++) {
+    for (size_t run : { 0, 1, 31, 32, 33, 63, 64, 65 }) {
+      std::string str = std::string(pad, ' ') + "[\"" + std::string(run, 'x') + std::string(2 * run, '\\');
+      docs.push_back(str + "\\\"x\"]");
+      docs.push_back(str + "\"]");
+      docs.push_back(str + "\\\"]");
+      docs.push_back(std::string(pad, ' ') + "[" + std::string(run + 1, '1') + ", true,\"\\u00e9\"]");
+    }
+  }
+
+  size_t len = 0;
+  char *content = read_file("./ocihook.json", &len);
+  ASSERT_NE(content, nullptr);
+  std::string hooks = content;
+  free(content);
+  content = read_file("./process.json", &len);
+  ASSERT_NE(content, nullptr);
+  std::string process = content;
+  free(content);
+  std::string spec = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"h\\u00e9\", \"process\": " + process +
+                     ", \"hooks\": " + hooks + ", \"annotations\": {\"a\": \"1\", \"b\\n\": \"\\\"2\\\"\"}, "
+                     "\"linux\": {\"sysctl\": {\"k\": \"v\"}, \"resources\": {\"memory\": {\"limit\": 1048576}}}, "
+                     "\"x-unknown\": [1.5, {\"y\": null}]}";
+  docs.push_back(hooks);
+  docs.push_back(process);
+  docs.push_back(spec);
+
+  // the fixtures of the tests, and the schemas the types are generated from
+  std::vector<std::pair<std::string, std::string>> fixtures;
+  for (const char *dir : { TEST_DATA_DIR, TEST_CONTRIB_DIR, TEST_SCHEMA_DIR }) {
+    std::vector<std::string> files = json_files(dir);
+    EXPECT_FALSE(files.empty()) << dir;
+    for (const std::string &file : files) {
+      content = read_file(file.c_str(), &len);
+      ASSERT_NE(content, nullptr) << file;
+      std::string doc(content, len);
+      free(content);
+      if (strcmp(dir, TEST_SCHEMA_DIR) != 0) {
+        fixtures.emplace_back(file, doc);
+      }
+      docs.push_back(doc);
+    }
+  }
+
+  // mutations of the valid documents, without the escapes which the yajl builds disagree on
+  std::mt19937 rng(20261018);
+  const std::string alphabet = "{}[]:,\"\\ a1-.eE0tfnu/\n";
+  size_t valid = docs.size();
+  for (size_t i = 0; i < 3000; i++) {
+    std::string doc = docs[rng() % valid];
+    if (doc.empty()) {
+      continue;
+    }
+    for (size_t edits = 1 + rng() % 3; edits > 0; edits--) {
+      size_t at = rng() % doc.size();
+      switch (rng() % 3) {
+        case 0:
+          doc[at] = alphabet[rng() % alphabet.size()];
+          break;
+        case 1:
+          doc.erase(at, 1 + rng() % 4);
+          break;
+        default:
+          doc.insert(at, 1, alphabet[rng() % alphabet.size()]);
+          break;
+      }
+      if (doc.empty()) {
+        break;
+      }
+    }
+    if (doc.find("\\u0000") != std::string::npos || doc.find("\\ud8") != std::string::npos) {
+      continue;
+    }
+    docs.push_back(doc);
+  }
+
+  for (const char *kernel : { "scalar", "sse2", "avx2", "neon" }) {
+    if (json_simd_set_kernel(kernel) != 0) {
+      continue;
+    }
+    EXPECT_STREQ(json_simd_kernel(), kernel);
+    for (const std::string &doc : docs) {
+      expect_same_simd_events(doc);
+    }
+    expect_same_simd_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec, spec);
+    expect_same_simd_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec,
+                           "{\"ociVersion\": \"1.0.2\", \"hooks\": " + hooks + "}");
+    expect_same_simd_parse(defs_process_parse_data, defs_process_generate_json, free_defs_process, process);
+    expect_same_simd_parse(cni_array_of_strings_container_parse_data, cni_array_of_strings_container_generate_json,
+                           free_cni_array_of_strings_container, "[\"a\", 1, null, {\"b\": 2}, [\"c\\t\"]]");
+    for (size_t i = valid; i < docs.size(); i += 10) {
+      expect_same_simd_parse(oci_runtime_spec_parse_data, oci_runtime_spec_generate_json, free_oci_runtime_spec, docs[i]);
+    }
+    for (const auto &fixture : fixtures) {
+      expect_same_simd_fixture(fixture.first, fixture.second);
+    }
+
+    // in place, strings are unescaped inside the buffer
+    struct parser_context ctx = { OPT_GEN_SIMPLIFY | OPT_PARSE_SIMD, stderr };
+    parser_error err = nullptr;
+    oci_runtime_spec *parsed = oci_runtime_spec_parse_data_insitu(strdup(spec.c_str()), &ctx, &err);
+    ASSERT_NE(parsed, nullptr) << err;
+    EXPECT_STREQ(parsed->hostname, "h\xc3\xa9");
+    EXPECT_STREQ(parsed->annotations->keys[1], "b\n");
+    EXPECT_STREQ(parsed->annotations->values[1], "\"2\"");
+    free_oci_runtime_spec(parsed);
+  }
+  EXPECT_EQ(json_simd_set_kernel("none"), -1);
+  EXPECT_EQ(json_simd_set_kernel(nullptr), 0);
+}
+
+TEST(libocispec_testcase, test_parse_lazy_fullkey) {
+  const char *spec = "{\"ociVersion\": \"1.0.2\", "
+                     "\"hooks\": {\"prestart\": [{\"path\": \"a\", \"zz\": 1}], \"qq\": [true]}, "
+                     "\"mounts\": [{\"destination\": \"/proc\", \"yy\": {\"k\": \"v\"}}], "
+                     "\"linux\": {\"seccomp\": {\"defaultAction\": \"SCMP_ACT_ERRNO\", \"ww\": \"x\"}}}";
+  struct parser_context full_ctx = { OPT_PARSE_FULLKEY | OPT_GEN_SIMPLIFY, stderr };
+  struct parser_context ctx = { OPT_PARSE_LAZY | OPT_PARSE_FULLKEY | OPT_GEN_SIMPLIFY, stderr };
+  parser_error jerr = nullptr;
+
+  oci_runtime_spec *full = oci_runtime_spec_parse_data(spec, &full_ctx, &jerr);
+  ASSERT_NE(full, nullptr);
+  char *expect = oci_runtime_spec_generate_json(full, &full_ctx, &jerr);
+  ASSERT_NE(expect, nullptr);
+  for (const char *key : { "\"zz\"", "\"qq\"", "\"yy\"", "\"ww\"" }) {
+    EXPECT_NE(strstr(expect, key), nullptr) << key;
+  }
+
+  // the simplified output decodes the kept members with the options of the parse
+  oci_runtime_spec *lazy = oci_runtime_spec_parse_data(spec, &ctx, &jerr);
+  ASSERT_NE(lazy, nullptr);
+  EXPECT_EQ(lazy->hooks, nullptr);
+  char *json = oci_runtime_spec_generate_json(lazy, &ctx, &jerr);
+  EXPECT_STREQ(json, expect);
+  free(json);
+
+  // and so does a copy
+  oci_runtime_spec *copy = clone_oci_runtime_spec(lazy);
+  ASSERT_NE(copy, nullptr);
+  json = oci_runtime_spec_generate_json(copy, &ctx, &jerr);
+  EXPECT_STREQ(json, expect);
+  free(json);
+  free_oci_runtime_spec(copy);
+
+  // an accessor without a context keeps the unknown keys too
+  ASSERT_EQ(get_oci_runtime_config_linux_seccomp(lazy->linux, nullptr, &jerr), 0);
+  ASSERT_NE(lazy->linux->seccomp, nullptr);
+  ASSERT_NE(lazy->linux->seccomp->_residual, nullptr);
+  EXPECT_NE(strstr(lazy->linux->seccomp->_residual, "\"ww\""), nullptr);
+  ASSERT_EQ(get_oci_runtime_spec_hooks(lazy, nullptr, &jerr), 0);
+  ASSERT_EQ(get_oci_runtime_spec_mounts(lazy, nullptr, &jerr), 0);
+  json = oci_runtime_spec_generate_json(lazy, &ctx, &jerr);
+  EXPECT_STREQ(json, expect);
+  free(json);
+
+  free_oci_runtime_spec(lazy);
+  free_oci_runtime_spec(full);
+  free(expect);
+}
+
+static const struct json_type_desc *table_gen_desc;
+
+static yajl_gen_status table_gen(yajl_gen g, const void *ptr, const struct parser_context *ctx, parser_error *err)
+{
+  return json_table_gen(table_gen_desc, g, ptr, ctx, err);
+}
+
+// the generic functions of json_table.c against the functions of the type
+static void expect_same_table(const struct json_type_desc *desc, const std::string &doc)
+{
+  for (unsigned int options : { 0u, (unsigned int)OPT_PARSE_FULLKEY, (unsigned int)OPT_PARSE_LAZY,
+                                (unsigned int)(OPT_PARSE_FULLKEY | OPT_PARSE_LAZY) }) {
+    struct parser_context ctx = { options, stderr };
+    char errbuf[256];
+    parser_error err = nullptr;
+    parser_error table_err = nullptr;
+    yajl_val tree = json_tree_parse(doc.c_str(), doc.size(), true, errbuf, sizeof(errbuf));
+    yajl_val table_tree = json_tree_parse(doc.c_str(), doc.size(), true, errbuf, sizeof(errbuf));
+    ASSERT_NE(tree, nullptr) << doc;
+    ASSERT_NE(table_tree, nullptr) << doc;
+
+    void *ptr = desc->make(tree, &ctx, &err);
+    void *table_ptr = json_table_make(desc, table_tree, &ctx, &table_err);
+    EXPECT_STREQ(err, table_err) << doc;
+    EXPECT_EQ(ptr == nullptr, table_ptr == nullptr) << doc;
+    if (ptr != nullptr && table_ptr != nullptr) {
+      EXPECT_TRUE(json_equal(desc, ptr, table_ptr)) << doc;
+      table_gen_desc = desc;
+      for (unsigned int gen_options : { 0u, (unsigned int)OPT_GEN_SIMPLIFY, (unsigned int)OPT_GEN_KEY_VALUE }) {
+        struct parser_context gen_ctx = { options | gen_options, stderr };
+        parser_error gen_err = nullptr;
+        char *json = json_gen_to_string(desc->gen, ptr, &gen_ctx, &gen_err);
+        ASSERT_NE(json, nullptr) << gen_err;
+        char *table_json = json_gen_to_string(table_gen, table_ptr, &gen_ctx, &gen_err);
+        ASSERT_NE(table_json, nullptr) << gen_err;
+        EXPECT_STREQ(json, table_json) << doc;
+        free(json);
+        free(table_json);
+      }
+    }
+    desc->free(ptr);
+    json_table_free(desc, table_ptr);
+    free(err);
+    free(table_err);
+    yajl_tree_free(tree);
+    yajl_tree_free(table_tree);
+  }
+}
+
+TEST(libocispec_testcase, test_table_driven) {
+  const char *spec = "{\"ociVersion\": \"1.0.2\", \"hostname\": \"box\", \"x-unknown\": {\"a\": [1, 2]}, "
+                     "\"process\": {\"terminal\": true, \"user\": {\"uid\": 1, \"gid\": 2, \"additionalGids\": [3, 4]}, "
+                     "\"args\": [\"sh\", \"-c\"], \"env\": [], \"cwd\": \"/\", \"oomScoreAdj\": -1000}, "
+                     "\"mounts\": [{\"destination\": \"/proc\", \"type\": \"proc\", \"options\": [\"nosuid\"]}], "
+                     "\"hooks\": {\"prestart\": [{\"path\": \"/bin/true\", \"timeout\": 5}]}, "
+                     "\"annotations\": {\"a\": \"1\", \"b\": \"\"}, "
+                     "\"linux\": {\"resources\": {\"memory\": {\"limit\": -1, \"swappiness\": 10}, "
+                     "\"devices\": [{\"allow\": false, \"access\": \"rwm\"}]}, \"sysctl\": {}}}";
+  char *content = nullptr;
+  size_t len = 0;
+
+  expect_same_table(&desc_oci_runtime_spec, spec);
+  content = read_file("./process.json", &len);
+  ASSERT_NE(content, nullptr);
+  expect_same_table(&desc_defs_process, content);
+  free(content);
+  content = read_file("./ocihook.json", &len);
+  ASSERT_NE(content, nullptr);
+  expect_same_table(&desc_oci_runtime_spec_hooks, content);
+  free(content);
+
+  // pointers, maps and mapStringObject types
+  expect_same_table(&desc_isulad_daemon_configs,
+                    "{\"use-decrypted-key\": false, \"log-opts\": {\"max-size\": \"30KB\"}, \"hosts\": [\"unix:///a\"], "
+                    "\"default-ulimits\": {\"nofile\": {\"Name\": \"nofile\", \"Hard\": 64, \"Soft\": 32}}, "
+                    "\"cri-sandboxers\": {}, \"selinux-enabled\": true, \"unknown\": [1, {\"x\": null}]}");
+  expect_same_table(&desc_isulad_daemon_configs_default_ulimits, "{\"nofile\": {\"Name\": \"nofile\"}, \"core\": {}}");
+  expect_same_table(&desc_isulad_daemon_configs_default_ulimits, "{}");
+  // double arrays, bytes and types without members
+  expect_same_table(&desc_cni_cached_info,
+                    "{\"kind\": \"cniCacheV1\", \"ipRanges\": [[{\"subnet\": \"10.1.0.0/16\"}, {\"subnet\": \"10.2.0.0/16\"}], []], "
+                    "\"ips\": [\"a\", 2, null], \"cniArgs\": {\"k\": \"v\"}}");
+  expect_same_table(&desc_logger_json_file, "{\"log\": \"hello\\n\", \"stream\": \"stdout\", \"attrs\": \"\", \"time\": 1}");
+  expect_same_table(&desc_container_version_request, "{\"a\": 1}");
+
+  // mismatched, duplicated and missing values, and errors
+  expect_same_table(&desc_oci_runtime_spec, "[1, 2]");
+  expect_same_table(&desc_oci_runtime_spec, "{\"ociVersion\": 1, \"hostname\": [], \"process\": \"p\", \"mounts\": {}}");
+  expect_same_table(&desc_defs_hook, "{\"path\": \"a\", \"timeout\": \"1\", \"timeout\": 2, \"path\": \"b\"}");
+  expect_same_table(&desc_defs_hook, "{\"path\": \"a\", \"timeout\": 1.5}");
+  expect_same_table(&desc_defs_hook, "{\"args\": [\"a\"]}");
+  expect_same_table(&desc_oci_runtime_spec, "{\"hooks\": {\"prestart\": [{\"path\": \"a\"}, 1]}}");
+  expect_same_table(&desc_isulad_daemon_configs, "{\"log-opts\": {\"a\": \"b\", \"c\": 1}}");
+  expect_same_table(&desc_defs_process, "{\"user\": {\"additionalGids\": [1, \"x\"]}}");
+}
+
+// the json of gen through a plain yajl generator, which the json_gen_ primitives forward to
+static std::string yajl_gen_json(json_gen_func gen, const void *ptr, const struct parser_context *ctx,
+                                 yajl_gen_status *stat)
+{
+  yajl_gen g = nullptr;
+  parser_error err = nullptr;
+  const unsigned char *buf = nullptr;
+  size_t len = 0;
+  std::string json;
+
+  if (!json_gen_init(&g, ctx)) {
+    *stat = yajl_gen_in_error_state;
+    return json;
+  }
+  *stat = gen(g, ptr, ctx, &err);
+  if (*stat == yajl_gen_status_ok && yajl_gen_get_buf(g, &buf, &len) == yajl_gen_status_ok) {
+    json.assign((const char *)buf, len);
+  }
+  free(err);
+  yajl_gen_free(g);
+  return json;
+}
+
+static void expect_same_gen(json_gen_func gen, const void *ptr)
+{
+  for (unsigned int options : { 0u, (unsigned int)OPT_GEN_SIMPLIFY, (unsigned int)OPT_GEN_KEY_VALUE,
+                                (unsigned int)(OPT_GEN_SIMPLIFY | OPT_GEN_KEY_VALUE),
+                                (unsigned int)OPT_GEN_NO_VALIDATE_UTF8 }) {
+    struct parser_context ctx = { options, stderr };
+    parser_error err = nullptr;
+    yajl_gen_status stat;
+    std::string expect = yajl_gen_json(gen, ptr, &ctx, &stat);
+    char *json = json_gen_to_string(gen, ptr, &ctx, &err);
+
+    EXPECT_EQ(stat == yajl_gen_status_ok, json != nullptr) << options;
+    if (json != nullptr) {
+      EXPECT_EQ(expect, std::string(json)) << options;
+    }
+    free(json);
+    free(err);
+  }
+}
+
+static void record_print(void *ctx, const char *str, size_t len)
+{
+  ((std::string *)ctx)->append(str, len);
+}
+
+TEST(libocispec_testcase, test_gen_writer) {
+  std::string data = "{\"ociVersion\": \"1.0.0\", \"hostname\": \"tab\\there \\\"quoted\\\" back\\\\slash\", "
+                     "\"annotations\": {\"ctl\": \"\\u0001\\u001f\\b\\f\\n\\r/\", \"utf8\": \"h\\u00e9llo \\u4e16\\ud83d\\ude00\", "
+                     "\"new\\nline key\": \"\", \"long\": \"";
+  // clean runs longer than the vector width and than the writer buffer, and a special byte at the end
+  data += std::string(40, 'a') + "\\\"" + std::string(9000, 'b') + "\\n";
+  data += "\"}, \"process\": {\"cwd\": \"/\", \"args\": [\"sh\", \"\"], \"env\": [], \"user\": {\"uid\": 0, \"gid\": 4294967295}, "
+          "\"oomScoreAdj\": -1000, \"terminal\": true}, \"linux\": {\"sysctl\": {}, \"resources\": {\"cpu\": {\"shares\": 1024}}}}";
+  parser_error jerr = nullptr;
+  struct parser_context ctx = { 0, stderr };
+  char *content = nullptr;
+  size_t len = 0;
+
+  oci_runtime_spec *spec = oci_runtime_spec_parse_data(data.c_str(), &ctx, &jerr);
+  ASSERT_NE(spec, nullptr) << jerr;
+  expect_same_gen(desc_oci_runtime_spec.gen, spec);
+
+  // invalid utf8 fails unless it is not validated
+  free(spec->hostname);
+  spec->hostname = strdup("bad \xff utf8");
+  expect_same_gen(desc_oci_runtime_spec.gen, spec);
+  char *json = oci_runtime_spec_generate_json(spec, &ctx, &jerr);
+  EXPECT_EQ(json, nullptr);
+  EXPECT_NE(jerr, nullptr);
+  free(jerr);
+  jerr = nullptr;
+  ctx.options = OPT_GEN_NO_VALIDATE_UTF8;
+  json = oci_runtime_spec_generate_json(spec, &ctx, &jerr);
+  ASSERT_NE(json, nullptr);
+  EXPECT_NE(strstr(json, "bad \xff utf8"), nullptr);
+  free(json);
+  free_oci_runtime_spec(spec);
+
+  content = read_file("./process.json", &len);
+  ASSERT_NE(content, nullptr);
+  defs_process *process = defs_process_parse_data(content, nullptr, &jerr);
+  ASSERT_NE(process, nullptr) << jerr;
+  expect_same_gen(desc_defs_process.gen, process);
+  free_defs_process(process);
+  free(content);
+
+  isulad_daemon_configs *conf = isulad_daemon_configs_parse_data(
+      "{\"log-opts\": {\"max-size\": \"30KB\"}, \"hosts\": [\"unix:///a\"], \"cri-sandboxers\": {}, "
+      "\"default-ulimits\": {\"nofile\": {\"Name\": \"nofile\", \"Hard\": 64, \"Soft\": 32}}}", nullptr, &jerr);
+  ASSERT_NE(conf, nullptr) << jerr;
+  expect_same_gen(desc_isulad_daemon_configs.gen, conf);
+  free_isulad_daemon_configs(conf);
+
+  // the states and errors of yajl, on a writer and on a yajl generator
+  std::string out;
+  yajl_gen w = json_gen_writer_alloc(record_print, &out, true, true, nullptr);
+  yajl_gen y = yajl_gen_alloc(nullptr);
+  ASSERT_NE(w, nullptr);
+  ASSERT_NE(y, nullptr);
+  yajl_gen_config(y, yajl_gen_beautify, 1);
+  yajl_gen_config(y, yajl_gen_validate_utf8, 1);
+  // yajl is left with a broken depth there
+  EXPECT_EQ(json_gen_map_close(w), yajl_gen_generation_complete);
+  for (yajl_gen g : { w, y }) {
+    EXPECT_EQ(json_gen_map_open(g), yajl_gen_status_ok);
+    EXPECT_EQ(json_gen_null(g), yajl_gen_keys_must_be_strings);
+    EXPECT_EQ(json_gen_double(g, 1), yajl_gen_keys_must_be_strings);
+    EXPECT_EQ(json_gen_key(g, "d", 1), yajl_gen_status_ok);
+    EXPECT_EQ(json_gen_double(g, 1.0 / 0.0), yajl_gen_invalid_number);
+    EXPECT_EQ(json_gen_array_open(g), yajl_gen_status_ok);
+    EXPECT_EQ(json_gen_double(g, 3), yajl_gen_status_ok);
+    EXPECT_EQ(json_gen_double(g, -0.25), yajl_gen_status_ok);
+    EXPECT_EQ(json_gen_double(g, 1e300), yajl_gen_status_ok);
+    EXPECT_EQ(json_gen_bool(g, 0), yajl_gen_status_ok);
+    json_gen_beautify(g, 0);
+    EXPECT_EQ(json_gen_array_open(g), yajl_gen_status_ok);
+    EXPECT_EQ(json_gen_array_close(g), yajl_gen_status_ok);
+    json_gen_beautify(g, 1);
+    EXPECT_EQ(json_gen_array_close(g), yajl_gen_status_ok);
+    EXPECT_EQ(json_gen_string(g, (const unsigned char *)"k", 1), yajl_gen_status_ok);
+    EXPECT_EQ(json_gen_number(g, "-12", 3), yajl_gen_status_ok);
+    EXPECT_EQ(json_gen_map_close(g), yajl_gen_status_ok);
+    EXPECT_EQ(json_gen_null(g), yajl_gen_generation_complete);
+  }
+  json_gen_writer_flush(w);
+  const unsigned char *buf = nullptr;
+  ASSERT_EQ(yajl_gen_get_buf(y, &buf, &len), yajl_gen_status_ok);
+  EXPECT_EQ(out, std::string((const char *)buf, len));
+  json_gen_writer_free(w);
+  yajl_gen_free(y);
+}
+
+TEST(libocispec_testcase, test_residual_text) {
+  const char *data = "{\"ociVersion\": \"1.0.0\", \"x-new\": {\"empty\": {}, \"list\": [], \"deep\": [{\"a\": 1.50}, 1e3, null]}, "
+                     "\"process\": {\"args\": [\"sh\"], \"cwd\": \"/\", \"x-esc\": \"tab\\t\\\"q\\\" \\u00e9\\/\", \"x-bool\": false}, "
+                     "\"x-last\": -0}";
+  struct parser_context ctx = { OPT_PARSE_FULLKEY, stderr };
+  parser_error jerr = nullptr;
+
+  oci_runtime_spec *spec = oci_runtime_spec_parse_data(data, &ctx, &jerr);
+  ASSERT_NE(spec, nullptr) << jerr;
+  ASSERT_NE(spec->process, nullptr);
+  EXPECT_STREQ(spec->_residual,
+               "\"x-new\":{\"empty\":{},\"list\":[],\"deep\":[{\"a\":1.50},1e3,null]},\"x-last\":-0");
+  EXPECT_STREQ(spec->process->_residual, "\"x-esc\":\"tab\\t\\\"q\\\" \xc3\xa9/\",\"x-bool\":false");
+  // copied or indented by the writer, as yajl writes the trees
+  expect_same_gen(desc_oci_runtime_spec.gen, spec);
+
+  // the generated text gives the same unknown keys back
+  for (unsigned int options : { 0u, (unsigned int)OPT_GEN_SIMPLIFY }) {
+    struct parser_context gen_ctx = { OPT_PARSE_FULLKEY | options, stderr };
+    char *json = oci_runtime_spec_generate_json(spec, &gen_ctx, &jerr);
+    ASSERT_NE(json, nullptr) << jerr;
+    oci_runtime_spec *again = oci_runtime_spec_parse_data(json, &gen_ctx, &jerr);
+    ASSERT_NE(again, nullptr) << jerr;
+    EXPECT_STREQ(again->_residual, spec->_residual);
+    EXPECT_STREQ(again->process->_residual, spec->process->_residual);
+    EXPECT_TRUE(json_equal(&desc_oci_runtime_spec, spec, again));
+    free_oci_runtime_spec(again);
+    free(json);
+  }
+
+  // the text lives in the arena with the rest of the object
+  struct json_arena *arena = json_arena_new(0);
+  ASSERT_NE(arena, nullptr);
+  struct parser_context arena_ctx = { OPT_PARSE_FULLKEY, stderr, arena };
+  oci_runtime_spec *in_arena = oci_runtime_spec_parse_data(data, &arena_ctx, &jerr);
+  ASSERT_NE(in_arena, nullptr) << jerr;
+  EXPECT_TRUE(json_arena_owns(in_arena->_residual));
+  EXPECT_TRUE(json_equal(&desc_oci_runtime_spec, spec, in_arena));
+  free_oci_runtime_spec(in_arena);
+  json_arena_free(arena);
+
+  // members in another order are the same unknown keys
+  oci_runtime_spec *other = oci_runtime_spec_parse_data(
+      "{\"ociVersion\": \"1.0.0\", \"x-last\": -0, \"x-new\": {\"list\": [], \"empty\": {}, \"deep\": [{\"a\": 1.50}, 1e3, null]}, "
+      "\"process\": {\"x-bool\": false, \"args\": [\"sh\"], \"cwd\": \"/\", \"x-esc\": \"tab\\t\\\"q\\\" \xc3\xa9/\"}}", &ctx, &jerr);
+  ASSERT_NE(other, nullptr) << jerr;
+  EXPECT_TRUE(json_equal(&desc_oci_runtime_spec, spec, other));
+  EXPECT_EQ(json_hash(&desc_oci_runtime_spec, spec), json_hash(&desc_oci_runtime_spec, other));
+  free(other->process->_residual);
+  other->process->_residual = strdup("\"x-bool\":true");
+  EXPECT_FALSE(json_equal(&desc_oci_runtime_spec, spec, other));
+  char *patch = json_diff(&desc_oci_runtime_spec, spec, other, nullptr, &jerr);
+  ASSERT_NE(patch, nullptr) << jerr;
+  EXPECT_STREQ(patch, "{\"process\":{\"x-bool\":true,\"x-esc\":null}}");
+  free(patch);
+  free_oci_runtime_spec(other);
+  free_oci_runtime_spec(spec);
+}
+
+struct hook_calls {
+  size_t mallocs;
+  size_t callocs;
+  size_t reallocs;
+  size_t frees;
+};
+
+static void *hook_malloc(void *opaque, size_t size)
+{
+  ((struct hook_calls *)opaque)->mallocs++;
+  return malloc(size);
+}
+
+static void *hook_calloc(void *opaque, size_t count, size_t size)
+{
+  ((struct hook_calls *)opaque)->callocs++;
+  return calloc(count, size);
+}
+
+static void *hook_realloc(void *opaque, void *ptr, size_t size)
+{
+  ((struct hook_calls *)opaque)->reallocs++;
+  return realloc(ptr, size);
+}
+
+static void hook_free(void *opaque, void *ptr)
+{
+  ((struct hook_calls *)opaque)->frees++;
+  free(ptr);
+}
+
+TEST(libocispec_testcase, test_allocator_accounting) {
+  const char *data = "{\"ociVersion\": \"1.0.0\", \"hostname\": \"h\", "
+                     "\"process\": {\"args\": [\"sh\", \"-c\"], \"cwd\": \"/\", \"env\": [\"A=1\", \"B=2\"]}, "
+                     "\"annotations\": {\"a\": \"1\", \"b\": \"2\"}}";
+  unsigned int opts[] = { 0, OPT_PARSE_STREAM, OPT_PARSE_FULLKEY };
+  parser_error jerr = nullptr;
+
+  for (unsigned int opt : opts) {
+    struct hook_calls calls = { 0 };
+    struct json_allocator alloc = { hook_malloc, hook_calloc, hook_realloc, hook_free, &calls };
+    struct parser_context ctx = { opt, stderr, nullptr, &alloc };
+
+    // the parse gives back all it took from the allocator, and the object
+    // is ordinary heap memory its owner may free and realloc
+    oci_runtime_spec *spec = oci_runtime_spec_parse_data(data, &ctx, &jerr);
+    ASSERT_NE(spec, nullptr) << jerr;
+    EXPECT_FALSE(json_arena_owns(spec->process->env[1]));
+    EXPECT_EQ(alloc.bytes, 0);
+    if (opt == OPT_PARSE_STREAM) {
+      EXPECT_GT(alloc.count, 0);
+      EXPECT_GT(alloc.peak, 0);
+      EXPECT_GT(calls.mallocs + calls.callocs + calls.reallocs, 0);
+    }
+    free(spec->process->env[1]);
+    spec->process->env[1] = strdup("B=3");
+    spec->hostname = (char *)realloc(spec->hostname, 64);
+    ASSERT_NE(spec->hostname, nullptr);
+
+    // the generators allocate from it as well, and give it all back
+    json_allocator_reset(&alloc);
+    EXPECT_EQ(alloc.count, 0);
+    char *json = oci_runtime_spec_generate_json(spec, &ctx, &jerr);
+    ASSERT_NE(json, nullptr) << jerr;
+    EXPECT_NE(strstr(json, "B=3"), nullptr);
+    EXPECT_GT(alloc.count, 0);
+    EXPECT_GT(alloc.peak, 0);
+    EXPECT_EQ(alloc.bytes, 0);
+    free(json);
+
+    free_oci_runtime_spec(spec);
+    EXPECT_EQ(alloc.bytes, 0);
+    EXPECT_EQ(calls.mallocs + calls.callocs, calls.frees);
+
+    // objects on the allocator need an arena on it
+    struct json_arena *arena = json_arena_new_with(0, &alloc);
+    ASSERT_NE(arena, nullptr);
+    struct parser_context arena_ctx = { opt, stderr, arena, &alloc };
+    spec = oci_runtime_spec_parse_data(data, &arena_ctx, &jerr);
+    ASSERT_NE(spec, nullptr) << jerr;
+    EXPECT_TRUE(json_arena_owns(spec->process->env[1]));
+    EXPECT_GT(alloc.bytes, 0);
+    free_oci_runtime_spec(spec);
+    json_arena_free(arena);
+    EXPECT_EQ(alloc.bytes, 0);
+
+    // a failed parse leaves nothing behind
+    EXPECT_EQ(oci_runtime_spec_parse_data("{\"ociVersion\": [}", &ctx, &jerr), nullptr);
+    EXPECT_NE(jerr, nullptr);
+    free(jerr);
+    jerr = nullptr;
+    EXPECT_EQ(alloc.bytes, 0);
+  }
+
+  // libc behind the counters, for in situ parses and yajl generators too
+  struct json_allocator counting = { 0 };
+  struct parser_context ctx = { 0, stderr, nullptr, &counting };
+  oci_runtime_spec *spec = oci_runtime_spec_parse_data_insitu(strdup(data), &ctx, &jerr);
+  ASSERT_NE(spec, nullptr) << jerr;
+  EXPECT_GT(counting.bytes, 0);
+  free_oci_runtime_spec(spec);
+  EXPECT_EQ(counting.bytes, 0);
+
+  yajl_gen g = nullptr;
+  ASSERT_TRUE(json_gen_init(&g, &ctx));
+  EXPECT_GT(counting.bytes, 0);
+  EXPECT_EQ(yajl_gen_string(g, (const unsigned char *)"x", 1), yajl_gen_status_ok);
+  yajl_gen_free(g);
+  EXPECT_EQ(counting.bytes, 0);
+
+  void *p = json_alloc_malloc(&counting, 10);
+  ASSERT_NE(p, nullptr);
+  p = json_alloc_realloc(&counting, p, 100);
+  ASSERT_NE(p, nullptr);
+  EXPECT_EQ(counting.bytes, 100);
+  json_alloc_free(&counting, p);
+  EXPECT_EQ(counting.bytes, 0);
+  EXPECT_GE(counting.peak, 100);
+}
+
+TEST(libocispec_testcase, test_parse_data_paths) {
+  const char *data = "{\"ociVersion\": \"1.0.0\", \"hostname\": \"h\", \"root\": {\"path\": \"rootfs\", \"readonly\": true}, "
+                     "\"process\": {\"args\": [\"sh\"], \"cwd\": \"/\", \"env\": [\"A=1\"], \"user\": {\"uid\": 1, \"gid\": 0}}, "
+                     "\"annotations\": {\"a/b\": \"1\", \"c\": \"2\"}, \"mounts\": [{\"destination\": \"/m\"}]}";
+  unsigned int opts[] = { 0, OPT_PARSE_SIMD };
+  parser_error jerr = nullptr;
+
+  for (unsigned int opt : opts) {
+    struct parser_context ctx = { opt, stderr };
+
+    // only the selected members, their required siblings stay out
+    const char *cwd[] = { "/process/cwd", "/root/readonly", nullptr };
+    oci_runtime_spec *spec = oci_runtime_spec_parse_data_paths(data, cwd, &ctx, &jerr);
+    ASSERT_NE(spec, nullptr) << jerr;
+    EXPECT_EQ(spec->oci_version, nullptr);
+    EXPECT_EQ(spec->hostname, nullptr);
+    EXPECT_EQ(spec->annotations, nullptr);
+    EXPECT_EQ(spec->mounts, nullptr);
+    ASSERT_NE(spec->process, nullptr);
+    EXPECT_STREQ(spec->process->cwd, "/");
+    EXPECT_EQ(spec->process->args, nullptr);
+    EXPECT_EQ(spec->process->user, nullptr);
+    ASSERT_NE(spec->root, nullptr);
+    EXPECT_EQ(spec->root->path, nullptr);
+    EXPECT_TRUE(spec->root->readonly);
+    free_oci_runtime_spec(spec);
+
+    // a whole object is checked as a full parse would, maps and arrays are taken whole
+    const char *whole[] = { "/process", "/annotations/a~1b", "/mounts/0/destination", nullptr };
+    spec = oci_runtime_spec_parse_data_paths(data, whole, &ctx, &jerr);
+    ASSERT_NE(spec, nullptr) << jerr;
+    EXPECT_EQ(spec->hostname, nullptr);
+    ASSERT_NE(spec->process, nullptr);
+    ASSERT_EQ(spec->process->args_len, 1);
+    ASSERT_NE(spec->process->user, nullptr);
+    EXPECT_EQ(spec->process->user->uid, 1);
+    ASSERT_NE(spec->annotations, nullptr);
+    EXPECT_EQ(spec->annotations->len, 2);
+    ASSERT_EQ(spec->mounts_len, 1);
+    EXPECT_STREQ(spec->mounts[0]->destination, "/m");
+    free_oci_runtime_spec(spec);
+    const char *process[] = { "/process", nullptr };
+    EXPECT_EQ(oci_runtime_spec_parse_data_paths("{\"process\": {\"cwd\": \"/\"}}", process, &ctx, &jerr), nullptr);
+    EXPECT_STREQ(jerr, "Required field 'args' not present");
+    free(jerr);
+    jerr = nullptr;
+
+    // the parse stops once it has every selected member
+    const char *host[] = { "/hostname", "/nothing", nullptr };
+    spec = oci_runtime_spec_parse_data_paths("{\"hostname\": \"h\", \"process\": [", host, &ctx, &jerr);
+    ASSERT_NE(spec, nullptr) << jerr;
+    EXPECT_STREQ(spec->hostname, "h");
+    free_oci_runtime_spec(spec);
+    EXPECT_EQ(oci_runtime_spec_parse_data_paths("{\"process\": [", host, &ctx, &jerr), nullptr);
+    EXPECT_NE(jerr, nullptr);
+    free(jerr);
+    jerr = nullptr;
+
+    // the empty pointer is the whole document
+    const char *all[] = { "", nullptr };
+    spec = oci_runtime_spec_parse_data_paths(data, all, &ctx, &jerr);
+    ASSERT_NE(spec, nullptr) << jerr;
+    oci_runtime_spec *full = oci_runtime_spec_parse_data(data, &ctx, &jerr);
+    ASSERT_NE(full, nullptr) << jerr;
+    EXPECT_TRUE(json_equal(&desc_oci_runtime_spec, spec, full));
+    free_oci_runtime_spec(full);
+    free_oci_runtime_spec(spec);
+
+    const char *bad[] = { "hostname", nullptr };
+    EXPECT_EQ(oci_runtime_spec_parse_data_paths(data, bad, &ctx, &jerr), nullptr);
+    EXPECT_STREQ(jerr, "invalid json pointer 'hostname'");
+    free(jerr);
+    jerr = nullptr;
+
+    // a selected required member is missing or mismatched as for parse_data, even once the rest is read
+    const char *version[] = { "/ociVersion", "/hostname", nullptr };
+    for (const char *doc : { "{}", "{\"ociVersion\": 256}", "{\"ociVersion\": true}", "{\"ociVersion\": [\"a\"]}",
+                             "{\"ociVersion\": {\"a\": 1}}", "{\"ociVersion\": null, \"hostname\": \"h\"}",
+                             "{\"hostname\": \"h\", \"ociVersion\": 1.5}" }) {
+      EXPECT_EQ(oci_runtime_spec_parse_data(doc, &ctx, &jerr), nullptr) << doc;
+      EXPECT_STREQ(jerr, "Required field 'ociVersion' not present") << doc;
+      free(jerr);
+      jerr = nullptr;
+      EXPECT_EQ(oci_runtime_spec_parse_data_paths(doc, version, &ctx, &jerr), nullptr) << doc;
+      EXPECT_STREQ(jerr, "Required field 'ociVersion' not present") << doc;
+      free(jerr);
+      jerr = nullptr;
+    }
+
+    // the unknown keys and the lazy members need the whole document
+    for (unsigned int whole_opt : { OPT_PARSE_FULLKEY, OPT_PARSE_LAZY }) {
+      struct parser_context whole_ctx = { opt | whole_opt, stderr };
+      EXPECT_EQ(oci_runtime_spec_parse_data_paths(data, cwd, &whole_ctx, &jerr), nullptr);
+      EXPECT_STREQ(jerr, "cannot parse json pointers with OPT_PARSE_FULLKEY or OPT_PARSE_LAZY");
+      free(jerr);
+      jerr = nullptr;
+    }
+  }
+
+  // the allocator takes the scratch of the parse, not the object
+  struct json_allocator counting = { 0 };
+  struct parser_context ctx = { 0, stderr, nullptr, &counting };
+  const char *cwd[] = { "/process/cwd", nullptr };
+  oci_runtime_spec *spec = oci_runtime_spec_parse_data_paths(data, cwd, &ctx, &jerr);
+  ASSERT_NE(spec, nullptr) << jerr;
+  EXPECT_FALSE(json_arena_owns(spec->process->cwd));
+  EXPECT_GT(counting.count, 0);
+  EXPECT_EQ(counting.bytes, 0);
+  free_oci_runtime_spec(spec);
+  EXPECT_EQ(counting.bytes, 0);
+}
+
+struct push_source {
+  struct json_stream_parser *parser;
+  int wfd;
+  const char *rest;
+  oci_runtime_spec *spec;
+  parser_error err;
+};
+
+static int push_source_ready(int fd, uint32_t event, void *data, isula_epoll_descr_t *descr)
+{
+  struct push_source *src = (struct push_source *)data;
+  int ret = oci_runtime_spec_parser_feed_fd(src->parser, fd, &src->err);
+
+  if (ret == 0 && src->rest != nullptr) {
+    // the peer sends the rest later
+    if (write(src->wfd, src->rest, strlen(src->rest)) < 0) {
+      return EPOLL_LOOP_HANDLE_CLOSE;
+    }
+    close(src->wfd);
+    src->rest = nullptr;
+    return EPOLL_LOOP_HANDLE_CONTINUE;
+  }
+  if (ret == 0) {
+    return EPOLL_LOOP_HANDLE_CONTINUE;
+  }
+  if (ret > 0) {
+    src->spec = oci_runtime_spec_parser_finish(src->parser, &src->err);
+  } else {
+    json_stream_parser_free(src->parser);
+  }
+  src->parser = nullptr;
+  return EPOLL_LOOP_HANDLE_CLOSE;
+}
+
+TEST(libocispec_testcase, test_push_parser) {
+  std::string data = "{\"ociVersion\": \"1.0.0\", \"hostname\": \"h\\u00e9\", "
+                     "\"process\": {\"args\": [\"sh\", \"-c\", \"a long argument\"], \"cwd\": \"/\", \"env\": [\"A=1\"]}, "
+                     "/* comment */ \"annotations\": {\"a\": \"1\", \"b\": \"2\"}, \"mounts\": [{\"destination\": \"/m\"}]}";
+  struct parser_context ctx = { 0, stderr };
+  parser_error jerr = nullptr;
+
+  oci_runtime_spec *expect = oci_runtime_spec_parse_data(data.c_str(), &ctx, &jerr);
+  ASSERT_NE(expect, nullptr) << jerr;
+
+  // any split of the input gives the same result
+  for (size_t step : { (size_t)1, (size_t)7, data.size() }) {
+    struct json_stream_parser *parser = oci_runtime_spec_parser_new(&ctx, 0);
+    ASSERT_NE(parser, nullptr);
+    for (size_t off = 0; off < data.size(); off += step) {
+      ASSERT_EQ(oci_runtime_spec_parser_feed(parser, data.c_str() + off, std::min(step, data.size() - off), &jerr), 0)
+          << jerr;
+    }
+    oci_runtime_spec *spec = oci_runtime_spec_parser_finish(parser, &jerr);
+    ASSERT_NE(spec, nullptr) << jerr;
+    EXPECT_TRUE(json_equal(&desc_oci_runtime_spec, spec, expect));
+    free_oci_runtime_spec(spec);
+  }
+
+  // the limit is on the whole input
+  struct json_stream_parser *parser = oci_runtime_spec_parser_new(&ctx, 32);
+  ASSERT_NE(parser, nullptr);
+  EXPECT_EQ(oci_runtime_spec_parser_feed(parser, data.c_str(), 20, &jerr), 0);
+  EXPECT_EQ(oci_runtime_spec_parser_feed(parser, data.c_str() + 20, 20, &jerr), -1);
+  EXPECT_STREQ(jerr, "cannot parse the data with length exceeding 32");
+  free(jerr);
+  jerr = nullptr;
+  EXPECT_EQ(oci_runtime_spec_parser_finish(parser, &jerr), nullptr);
+  EXPECT_STREQ(jerr, "cannot parse the data with length exceeding 32");
+  free(jerr);
+  jerr = nullptr;
+
+  // bad and short input, and parsers dropped halfway
+  parser = oci_runtime_spec_parser_new(&ctx, 0);
+  ASSERT_NE(parser, nullptr);
+  // yajl may only see the error once the input is complete
+  if (oci_runtime_spec_parser_feed(parser, "{\"hostname\": ]", 14, &jerr) != 0) {
+    EXPECT_NE(jerr, nullptr);
+    free(jerr);
+    jerr = nullptr;
+    EXPECT_EQ(oci_runtime_spec_parser_feed(parser, "}", 1, &jerr), -1);
+    free(jerr);
+    jerr = nullptr;
+  }
+  EXPECT_EQ(oci_runtime_spec_parser_finish(parser, &jerr), nullptr);
+  EXPECT_NE(jerr, nullptr);
+  free(jerr);
+  jerr = nullptr;
+  parser = oci_runtime_spec_parser_new(&ctx, 0);
+  ASSERT_NE(parser, nullptr);
+  EXPECT_EQ(oci_runtime_spec_parser_feed(parser, data.c_str(), data.size() / 2, &jerr), 0);
+  EXPECT_EQ(oci_runtime_spec_parser_finish(parser, &jerr), nullptr);
+  EXPECT_NE(jerr, nullptr);
+  free(jerr);
+  jerr = nullptr;
+  parser = oci_runtime_spec_parser_new(&ctx, 0);
+  ASSERT_NE(parser, nullptr);
+  EXPECT_EQ(oci_runtime_spec_parser_feed(parser, data.c_str(), data.size() / 2, &jerr), 0);
+  json_stream_parser_free(parser);
+
+  // the parser lives on the allocator, the object on the heap
+  struct json_allocator counting = { 0 };
+  struct parser_context alloc_ctx = { 0, stderr, nullptr, &counting };
+  parser = oci_runtime_spec_parser_new(&alloc_ctx, 0);
+  ASSERT_NE(parser, nullptr);
+  ASSERT_EQ(oci_runtime_spec_parser_feed(parser, data.c_str(), data.size(), &jerr), 0);
+  EXPECT_GT(counting.bytes, 0);
+  oci_runtime_spec *spec = oci_runtime_spec_parser_finish(parser, &jerr);
+  ASSERT_NE(spec, nullptr) << jerr;
+  EXPECT_FALSE(json_arena_owns(spec->hostname));
+  EXPECT_EQ(counting.bytes, 0);
+  free_oci_runtime_spec(spec);
+  EXPECT_EQ(counting.bytes, 0);
+
+  // driven by a main loop as the bytes arrive
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  ASSERT_EQ(fcntl(fds[0], F_SETFL, O_NONBLOCK), 0);
+  size_t half = data.size() / 2;
+  ASSERT_EQ(write(fds[1], data.c_str(), half), (ssize_t)half);
+  std::string rest = data.substr(half);
+  struct push_source src = { oci_runtime_spec_parser_new(&ctx, 0), fds[1], rest.c_str(), nullptr, nullptr };
+  ASSERT_NE(src.parser, nullptr);
+  isula_epoll_descr_t descr = { 0 };
+  ASSERT_EQ(isula_epoll_open(&descr), 0);
+  ASSERT_EQ(isula_epoll_add_handler(&descr, fds[0], push_source_ready, &src), 0);
+  EXPECT_EQ(isula_epoll_loop(&descr, 1000), 0);
+  isula_epoll_close(&descr);
+  close(fds[0]);
+  ASSERT_NE(src.spec, nullptr) << src.err;
+  EXPECT_TRUE(json_equal(&desc_oci_runtime_spec, src.spec, expect));
+  free_oci_runtime_spec(src.spec);
+
+  free_oci_runtime_spec(expect);
+
+  // unknown keys and lazy members need the tree, the push parser refuses them
+  const char *unknown = "{\"ociVersion\": \"1.0.0\", \"process\": {\"args\": [\"sh\"], \"cwd\": \"/\", "
+                        "\"user\": {\"uid\": 0, \"gid\": 0, \"umask\": 18}}}";
+  for (unsigned int opt : { OPT_PARSE_FULLKEY, OPT_PARSE_LAZY }) {
+    struct parser_context whole_ctx = { opt, stderr };
+    parser = oci_runtime_spec_parser_new(&whole_ctx, 0);
+    ASSERT_NE(parser, nullptr);
+    EXPECT_EQ(oci_runtime_spec_parser_feed(parser, unknown, strlen(unknown), &jerr), -1);
+    EXPECT_STREQ(jerr, "cannot push parse with OPT_PARSE_FULLKEY or OPT_PARSE_LAZY");
+    free(jerr);
+    jerr = nullptr;
+    EXPECT_EQ(oci_runtime_spec_parser_finish(parser, &jerr), nullptr);
+    EXPECT_STREQ(jerr, "cannot push parse with OPT_PARSE_FULLKEY or OPT_PARSE_LAZY");
+    free(jerr);
+    jerr = nullptr;
+  }
+
+  // while the whole document keeps them through a round trip
+  struct parser_context full_ctx = { OPT_PARSE_FULLKEY | OPT_GEN_SIMPLIFY, stderr };
+  spec = oci_runtime_spec_parse_data(unknown, &full_ctx, &jerr);
+  ASSERT_NE(spec, nullptr) << jerr;
+  char *json = oci_runtime_spec_generate_json(spec, &full_ctx, &jerr);
+  ASSERT_NE(json, nullptr) << jerr;
+  EXPECT_NE(strstr(json, "\"umask\":18"), nullptr) << json;
+  oci_runtime_spec *again = oci_runtime_spec_parse_data(json, &full_ctx, &jerr);
+  ASSERT_NE(again, nullptr) << jerr;
+  EXPECT_TRUE(json_equal(&desc_oci_runtime_spec, spec, again));
+  free_oci_runtime_spec(again);
+  free(json);
+  free_oci_runtime_spec(spec);
+}
+
+TEST(libocispec_testcase, test_struct_layout) {
+  // pointers and lengths come first, the narrow members share the tail
+  EXPECT_GT(offsetof(defs_process, oom_score_adj), offsetof(defs_process, rlimits_len));
+  EXPECT_GT(offsetof(defs_process, oom_score_adj), offsetof(defs_process, _residual));
+  EXPECT_EQ(offsetof(defs_process, terminal), offsetof(defs_process, oom_score_adj) + sizeof(int));
+  EXPECT_EQ(offsetof(defs_process, no_new_privileges), offsetof(defs_process, terminal) + sizeof(bool));
+  EXPECT_LT(sizeof(defs_process) - offsetof(defs_process, no_new_privileges), alignof(void *) + 1);
+
+  // the order of the struct members does not leak into the json
+  struct parser_context ctx = { OPT_GEN_SIMPLIFY, stderr };
+  parser_error jerr = nullptr;
+  const char *data = "{\"args\":[\"sh\"],\"cwd\":\"/\",\"terminal\":true,\"oomScoreAdj\":-17,"
+                     "\"noNewPrivileges\":true}";
+  defs_process *process = defs_process_parse_data(data, &ctx, &jerr);
+  ASSERT_NE(process, nullptr) << jerr;
+  EXPECT_TRUE(process->terminal);
+  EXPECT_TRUE(process->no_new_privileges);
+  EXPECT_EQ(process->oom_score_adj, -17);
+  char *json = defs_process_generate_json(process, &ctx, &jerr);
+  ASSERT_NE(json, nullptr) << jerr;
+  EXPECT_STREQ(json, data);
+  free(json);
+  free_defs_process(process);
+}
+
+TEST(libocispec_testcase, test_string_interning) {
+  const char *data = "{\"ociVersion\":\"1.0.0\",\"process\":{\"args\":[\"sh\"],\"cwd\":\"/\","
+                     "\"capabilities\":{\"bounding\":[\"CAP_CHOWN\",\"CAP_KILL\"],\"effective\":[\"CAP_CHOWN\"]}},"
+                     "\"mounts\":[{\"destination\":\"/proc\",\"type\":\"proc\",\"source\":\"proc\","
+                     "\"options\":[\"nosuid\",\"noexec\"]},{\"destination\":\"/sys\",\"type\":\"sysfs\","
+                     "\"source\":\"sysfs\",\"options\":[\"nosuid\",\"ro\"]}],"
+                     "\"linux\":{\"seccomp\":{\"defaultAction\":\"SCMP_ACT_ERRNO\",\"architectures\":[\"SCMP_ARCH_X86_64\"],"
+                     "\"syscalls\":[{\"names\":[\"read\",\"write\"],\"action\":\"SCMP_ACT_ALLOW\"}]}}}";
+  struct parser_context plain_ctx = { 0, stderr };
+  parser_error jerr = nullptr;
+
+  // without the option every value is a copy of its own
+  oci_runtime_spec *plain = oci_runtime_spec_parse_data(data, &plain_ctx, &jerr);
+  ASSERT_NE(plain, nullptr) << jerr;
+  EXPECT_FALSE(json_interned(plain->mounts[0]->type));
+  EXPECT_FALSE(json_interned(plain->linux->seccomp->syscalls[0]->names[0]));
+
+  for (unsigned int opt : { 0U, (unsigned int)OPT_PARSE_STREAM }) {
+    struct parser_context ctx = { opt | OPT_PARSE_INTERN, stderr };
+    size_t strings = 0;
+    size_t again = 0;
+
+    oci_runtime_spec *a = oci_runtime_spec_parse_data(data, &ctx, &jerr);
+    ASSERT_NE(a, nullptr) << jerr;
+    json_intern_stats(&strings, nullptr);
+    oci_runtime_spec *b = oci_runtime_spec_parse_data(data, &ctx, &jerr);
+    ASSERT_NE(b, nullptr) << jerr;
+    json_intern_stats(&again, nullptr);
+
+    // the second config adds nothing to the pool and shares the values of the first one
+    EXPECT_EQ(again, strings);
+    EXPECT_TRUE(json_interned(a->mounts[0]->type));
+    EXPECT_EQ(a->mounts[0]->type, b->mounts[0]->type);
+    EXPECT_EQ(a->mounts[0]->options[0], b->mounts[1]->options[0]);
+    EXPECT_EQ(a->process->capabilities->bounding[0], b->process->capabilities->effective[0]);
+    EXPECT_EQ(a->linux->seccomp->default_action, b->linux->seccomp->default_action);
+    EXPECT_EQ(a->linux->seccomp->syscalls[0]->names[1], b->linux->seccomp->syscalls[0]->names[1]);
+    // the members not marked intern stay private
+    EXPECT_FALSE(json_interned(a->mounts[0]->source));
+    EXPECT_NE(a->mounts[0]->source, b->mounts[0]->source);
+    EXPECT_TRUE(json_equal(&desc_oci_runtime_spec, a, plain));
+
+    // copies share the values too, and each one is freed on its own
+    oci_runtime_spec *c = clone_oci_runtime_spec(a);
+    ASSERT_NE(c, nullptr);
+    EXPECT_EQ(c->mounts[1]->type, a->mounts[1]->type);
+    free_oci_runtime_spec(a);
+    free_oci_runtime_spec(b);
+    EXPECT_STREQ(c->mounts[1]->type, "sysfs");
+    EXPECT_TRUE(json_equal(&desc_oci_runtime_spec, c, plain));
+    free_oci_runtime_spec(c);
+  }
+
+  uint8_t *bin = nullptr;
+  size_t bin_len = 0;
+  ASSERT_EQ(oci_runtime_spec_encode_binary(plain, &bin, &bin_len, &jerr), 0) << jerr;
+  struct parser_context ctx = { OPT_PARSE_INTERN, stderr };
+  oci_runtime_spec *decoded = oci_runtime_spec_decode_binary(bin, bin_len, &ctx, &jerr);
+  ASSERT_NE(decoded, nullptr) << jerr;
+  EXPECT_TRUE(json_interned(decoded->process->capabilities->bounding[1]));
+  EXPECT_EQ(decoded->process->capabilities->bounding[1], json_intern("CAP_KILL", strlen("CAP_KILL")));
+  EXPECT_TRUE(json_equal(&desc_oci_runtime_spec, decoded, plain));
+  free_oci_runtime_spec(decoded);
+  free(bin);
+
+  free_oci_runtime_spec(plain);
+}
@@ -0,0 +1,233 @@
+/******************************************************************************
+ * iSula-libutils: ut for utils_cgroup.c
+ *
+ * Copyright (c) Huawei Technologies Co., Ltd. 2023. All rights reserved.
+ *
+ * Authors:
+ * Haozi007 <liuhao27@huawei.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ********************************************************************************/
+#include <gtest/gtest.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "utils_cgroup.h"
+#include "utils_file.h"
+
+static void write_file(const std::string &path, const std::string &content)
+{
+    FILE *fp = fopen(path.c_str(), "w");
+    ASSERT_NE(fp, nullptr);
+    ASSERT_EQ(fwrite(content.data(), 1, content.size(), fp), content.size());
+    fclose(fp);
+}
+
+class utils_cgroup_testcase : public testing::Test {
+protected:
+    void SetUp() override
+    {
+        char tmpl[] = "/tmp/cgroup_ut_XXXXXX";
+        ASSERT_NE(mkdtemp(tmpl), nullptr);
+        root = tmpl;
+    }
+
+    void TearDown() override
+    {
+        (void)isula_dir_recursive_remove(root.c_str(), 0);
+    }
+
+    std::string root;
+};
+
+TEST_F(utils_cgroup_testcase, test_isula_cgroup_reader_v2)
+{
+    struct isula_cgroup_metrics m;
+    std::string dir = root + "/lxc/c1";
+    isula_cgroup_reader_t *reader = nullptr;
+
+    ASSERT_EQ(isula_dir_recursive_mk(dir.c_str(), 0755), 0);
+    write_file(root + "/cgroup", "0::/lxc/c1\n");
+    write_file(dir + "/cpu.stat", "usage_usec 1500\nuser_usec 1000\nsystem_usec 500\n"
+               "nr_periods 10\nnr_throttled 2\nthrottled_usec 7\n");
+    write_file(dir + "/pids.current", "3\n");
+    write_file(dir + "/pids.max", "max\n");
+    write_file(dir + "/memory.current", "4096\n");
+    write_file(dir + "/memory.max", "8192\n");
+    write_file(dir + "/memory.stat", "anon 100\nfile 200\nkernel 30\ninactive_file 50\n"
+               "pgfault 9\npgmajfault 1\nfile_dirty 0\n");
+    write_file(dir + "/io.stat", "8:0 rbytes=10 wbytes=20 rios=1 wios=2 dbytes=0 dios=0\n"
+               "8:16 rbytes=5 wbytes=5 rios=1 wios=1\n");
+
+    reader = isula_cgroup_reader_new(CGROUP_VERSION_2, root.c_str(), (root + "/cgroup").c_str());
+    ASSERT_NE(reader, nullptr);
+    ASSERT_EQ(isula_cgroup_reader_pid(reader), 0);
+    ASSERT_EQ(isula_cgroup_reader_read(reader, &m), 0);
+
+    ASSERT_EQ(m.cpu_use_nanos, 1500000U);
+    ASSERT_EQ(m.cpu_use_user, 1000000U);
+    ASSERT_EQ(m.cpu_use_sys, 500000U);
+    ASSERT_EQ(m.cpu_nr_periods, 10U);
+    ASSERT_EQ(m.cpu_nr_throttled, 2U);
+    ASSERT_EQ(m.cpu_throttled_nanos, 7000U);
+    ASSERT_EQ(m.pids_current, 3U);
+    ASSERT_EQ(m.pids_limit, 0U);
+    ASSERT_EQ(m.mem_used, 4096U);
+    ASSERT_EQ(m.mem_limit, 8192U);
+    ASSERT_EQ(m.rss_bytes, 100U);
+    ASSERT_EQ(m.cache, 200U);
+    ASSERT_EQ(m.cache_total, 200U);
+    ASSERT_EQ(m.kmem_used, 30U);
+    ASSERT_EQ(m.inactive_file_total, 50U);
+    ASSERT_EQ(m.page_faults, 9U);
+    ASSERT_EQ(m.major_page_faults, 1U);
+    ASSERT_EQ(m.io_read_bytes, 15U);
+    ASSERT_EQ(m.io_write_bytes, 25U);
+    ASSERT_EQ(m.io_total_bytes, 40U);
+    ASSERT_EQ(m.io_read_ops, 2U);
+    ASSERT_EQ(m.io_write_ops, 3U);
+    ASSERT_EQ(m.io_total_ops, 5U);
+
+    // the open files are read again from the start
+    write_file(dir + "/pids.current", "42\n");
+    ASSERT_EQ(isula_cgroup_reader_read(reader, &m), 0);
+    ASSERT_EQ(m.pids_current, 42U);
+    ASSERT_EQ(m.cpu_use_nanos, 1500000U);
+
+    // files bigger than the initial buffer are read whole
+    std::string big;
+    for (int i = 0; i < 500; i++) {
+        big += "8:" + std::to_string(i) + " rbytes=1 wbytes=2 rios=3 wios=4\n";
+    }
+    write_file(dir + "/io.stat", big);
+    ASSERT_EQ(isula_cgroup_reader_read(reader, &m), 0);
+    ASSERT_EQ(m.io_read_bytes, 500U);
+    ASSERT_EQ(m.io_write_ops, 2000U);
+
+    isula_cgroup_reader_free(reader);
+
+    // a systemd init sits in the init scope of the container cgroup, the container is read
+    ASSERT_EQ(isula_dir_recursive_mk((dir + "/init.scope").c_str(), 0755), 0);
+    write_file(dir + "/init.scope/pids.current", "1\n");
+    write_file(root + "/cgroup", "0::/lxc/c1/init.scope\n");
+    reader = isula_cgroup_reader_new(CGROUP_VERSION_2, root.c_str(), (root + "/cgroup").c_str());
+    ASSERT_NE(reader, nullptr);
+    ASSERT_EQ(isula_cgroup_reader_read(reader, &m), 0);
+    ASSERT_EQ(m.pids_current, 42U);
+    ASSERT_EQ(m.mem_used, 4096U);
+    isula_cgroup_reader_free(reader);
+}
+
+TEST_F(utils_cgroup_testcase, test_isula_cgroup_reader_v1)
+{
+    struct isula_cgroup_metrics m;
+    std::string cpu = root + "/cpu,cpuacct/lxc/c1";
+    std::string mem = root + "/memory/lxc/c1";
+    std::string blkio = root + "/blkio/lxc/c1";
+    isula_cgroup_reader_t *reader = nullptr;
+    uint64_t tick = 1000000000 / sysconf(_SC_CLK_TCK);
+
+    ASSERT_EQ(isula_dir_recursive_mk(cpu.c_str(), 0755), 0);
+    ASSERT_EQ(isula_dir_recursive_mk(mem.c_str(), 0755), 0);
+    ASSERT_EQ(isula_dir_recursive_mk(blkio.c_str(), 0755), 0);
+    // pids is not mounted here, its metrics stay 0
+    write_file(root + "/cgroup", "12:name=systemd:/x\n11:pids:/lxc/c1\n4:cpu,cpuacct:/lxc/c1\n"
+               "3:memory:/lxc/c1\n2:blkio:/lxc/c1\n");
+    write_file(cpu + "/cpuacct.usage", "123456\n");
+    write_file(cpu + "/cpuacct.stat", "user 3\nsystem 2\n");
+    write_file(cpu + "/cpu.stat", "nr_periods 4\nnr_throttled 1\nthrottled_time 99\n");
+    write_file(mem + "/memory.usage_in_bytes", "1024\n");
+    write_file(mem + "/memory.limit_in_bytes", "9223372036854771712\n");
+    write_file(mem + "/memory.stat", "cache 7\nrss 8\ntotal_cache 17\ntotal_rss 18\n"
+               "total_pgfault 5\ntotal_pgmajfault 2\ntotal_inactive_file 6\n");
+    write_file(blkio + "/blkio.throttle.io_service_bytes", "8:0 Read 100\n8:0 Write 50\n8:0 Sync 0\n"
+               "8:0 Total 150\n8:16 Read 1\n8:16 Write 1\n8:16 Total 2\nTotal 152\n");
+    write_file(blkio + "/blkio.throttle.io_serviced", "8:0 Read 4\n8:0 Write 3\n8:0 Total 7\nTotal 7\n");
+
+    reader = isula_cgroup_reader_new(CGROUP_VERSION_1, root.c_str(), (root + "/cgroup").c_str());
+    ASSERT_NE(reader, nullptr);
+    ASSERT_EQ(isula_cgroup_reader_read(reader, &m), 0);
+
+    ASSERT_EQ(m.cpu_use_nanos, 123456U);
+    ASSERT_EQ(m.cpu_use_user, 3 * tick);
+    ASSERT_EQ(m.cpu_use_sys, 2 * tick);
+    ASSERT_EQ(m.cpu_nr_periods, 4U);
+    ASSERT_EQ(m.cpu_nr_throttled, 1U);
+    ASSERT_EQ(m.cpu_throttled_nanos, 99U);
+    ASSERT_EQ(m.pids_current, 0U);
+    ASSERT_EQ(m.mem_used, 1024U);
+    // the page aligned LLONG_MAX of no limit
+    ASSERT_EQ(m.mem_limit, 0U);
+    ASSERT_EQ(m.kmem_used, 0U);
+    ASSERT_EQ(m.cache, 7U);
+    ASSERT_EQ(m.cache_total, 17U);
+    ASSERT_EQ(m.rss_bytes, 18U);
+    ASSERT_EQ(m.page_faults, 5U);
+    ASSERT_EQ(m.major_page_faults, 2U);
+    ASSERT_EQ(m.inactive_file_total, 6U);
+    ASSERT_EQ(m.io_read_bytes, 101U);
+    ASSERT_EQ(m.io_write_bytes, 51U);
+    ASSERT_EQ(m.io_total_bytes, 152U);
+    ASSERT_EQ(m.io_read_ops, 4U);
+    ASSERT_EQ(m.io_write_ops, 3U);
+    ASSERT_EQ(m.io_total_ops, 7U);
+
+    write_file(mem + "/memory.limit_in_bytes", "1048576\n");
+    ASSERT_EQ(isula_cgroup_reader_read(reader, &m), 0);
+    ASSERT_EQ(m.mem_limit, 1048576U);
+    isula_cgroup_reader_free(reader);
+
+    // the recursive scheduler counters win over the throttling ones, an
+    // idle CFQ with only its "Total 0" line gives way to BFQ
+    write_file(blkio + "/blkio.io_service_bytes_recursive", "Total 0\n");
+    write_file(blkio + "/blkio.io_serviced_recursive", "Total 0\n");
+    write_file(blkio + "/blkio.bfq.io_service_bytes_recursive", "8:0 Read 1000\n8:0 Write 500\n8:0 Total 1500\n"
+               "Total 1500\n");
+    write_file(blkio + "/blkio.bfq.io_serviced_recursive", "8:0 Read 40\n8:0 Write 30\n8:0 Total 70\nTotal 70\n");
+    reader = isula_cgroup_reader_new(CGROUP_VERSION_1, root.c_str(), (root + "/cgroup").c_str());
+    ASSERT_NE(reader, nullptr);
+    ASSERT_EQ(isula_cgroup_reader_read(reader, &m), 0);
+    ASSERT_EQ(m.io_read_bytes, 1000U);
+    ASSERT_EQ(m.io_write_bytes, 500U);
+    ASSERT_EQ(m.io_total_bytes, 1500U);
+    ASSERT_EQ(m.io_read_ops, 40U);
+    ASSERT_EQ(m.io_write_ops, 30U);
+    ASSERT_EQ(m.io_total_ops, 70U);
+
+    write_file(blkio + "/blkio.io_serviced_recursive", "8:0 Read 9\n8:0 Write 0\n8:0 Total 9\nTotal 9\n");
+    ASSERT_EQ(isula_cgroup_reader_read(reader, &m), 0);
+    ASSERT_EQ(m.io_read_ops, 9U);
+    ASSERT_EQ(m.io_total_ops, 9U);
+    ASSERT_EQ(m.io_read_bytes, 1000U);
+
+    isula_cgroup_reader_free(reader);
+}
+
+TEST_F(utils_cgroup_testcase, test_isula_cgroup_reader_invalid)
+{
+    struct isula_cgroup_metrics m;
+
+    ASSERT_EQ(isula_cgroup_reader_new(3, root.c_str(), "/proc/self/cgroup"), nullptr);
+    ASSERT_EQ(isula_cgroup_reader_new(CGROUP_VERSION_2, root.c_str(), (root + "/none").c_str()), nullptr);
+    // no metrics file in the cgroup directory
+    write_file(root + "/cgroup", "0::/\n");
+    ASSERT_EQ(isula_cgroup_reader_new(CGROUP_VERSION_2, root.c_str(), (root + "/cgroup").c_str()), nullptr);
+    ASSERT_EQ(isula_cgroup_reader_new_pid(0, 0), nullptr);
+    ASSERT_NE(isula_cgroup_reader_read(nullptr, &m), 0);
+    isula_cgroup_reader_free(nullptr);
+}
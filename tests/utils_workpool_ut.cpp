@@ -0,0 +1,71 @@
+/******************************************************************************
+ * iSula-libutils: ut for utils_workpool.c
+ *
+ * Copyright (c) Huawei Technologies Co., Ltd. 2023. All rights reserved.
+ *
+ * Authors:
+ * Haozi007 <liuhao27@huawei.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ ********************************************************************************/
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+#include "utils_workpool.h"
+
+struct square_job {
+    std::vector<size_t> out;
+    std::atomic<size_t> calls { 0 };
+};
+
+static void square_task(size_t index, void *data)
+{
+    struct square_job *job = (struct square_job *)data;
+
+    job->out[index] = index * index;
+    job->calls++;
+}
+
+TEST(utils_workpool_testcase, test_isula_workpool_run)
+{
+    isula_workpool_t *pool = isula_workpool_new(4);
+    ASSERT_NE(pool, nullptr);
+
+    // the pool is reused across runs of different sizes
+    for (size_t n : { (size_t)1, (size_t)3, (size_t)1000, (size_t)0, (size_t)257 }) {
+        struct square_job job;
+        job.out.assign(n, 0);
+        ASSERT_EQ(isula_workpool_run(pool, n, square_task, &job), 0);
+        ASSERT_EQ(job.calls.load(), n);
+        for (size_t i = 0; i < n; i++) {
+            ASSERT_EQ(job.out[i], i * i);
+        }
+    }
+
+    ASSERT_NE(isula_workpool_run(pool, 1, nullptr, nullptr), 0);
+    ASSERT_NE(isula_workpool_run(nullptr, 1, square_task, nullptr), 0);
+    isula_workpool_free(pool);
+    isula_workpool_free(nullptr);
+
+    pool = isula_workpool_new(0);
+    ASSERT_NE(pool, nullptr);
+    struct square_job job;
+    job.out.assign(64, 0);
+    ASSERT_EQ(isula_workpool_run(pool, 64, square_task, &job), 0);
+    ASSERT_EQ(job.calls.load(), 64);
+    isula_workpool_free(pool);
+}